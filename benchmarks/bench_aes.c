@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "encryption/aes/core.h"
+#include "encryption/aes/ttable.h"
+#include "encryption/aes/aesni.h"
+
+/* Number of blocks encrypted by each benchmark */
+#define BENCH_NUM_BLOCKS 20000
+
+/*******************************************************************************
+ * Prints the throughput of a benchmark.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_blocks - The number of blocks processed.
+ * - start - The clock value when the benchmark started.
+ * - end - The clock value when the benchmark ended.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report(const char *name, long num_blocks, clock_t start, clock_t end)
+{
+    /* Time taken in seconds */
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0) {
+        seconds = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    printf("%-32s %10ld blocks %8.3fs %12.0f blocks/s %8.2f MB/s\n",
+        name, num_blocks, seconds,
+        num_blocks / seconds,
+        (num_blocks * 16.0) / (seconds * 1024 * 1024));
+}
+
+/*******************************************************************************
+ * Encrypts blocks with aes_encrypt_block().
+ * The key is expanded again for every block (previous behaviour).
+ *
+ * inputs:
+ * - key - The key.
+ * - key_size - The size of the key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_encrypt_block(const byte *key, int key_size)
+{
+    byte block[16] = {0};
+    long i;
+
+    clock_t start = clock();
+    for (i = 0; i < BENCH_NUM_BLOCKS; i++) {
+        aes_encrypt_block(block, key, key_size, block);
+    }
+    clock_t end = clock();
+
+    bench_report("aes_encrypt_block (per-block key)", BENCH_NUM_BLOCKS,
+        start, end);
+}
+
+/*******************************************************************************
+ * Encrypts blocks with aes_encrypt_block_ctx().
+ * The key is expanded only once.
+ *
+ * inputs:
+ * - key - The key.
+ * - key_size - The size of the key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_encrypt_block_ctx(const byte *key, int key_size)
+{
+    byte block[16] = {0};
+    aes_context_t ctx;
+    long i;
+
+    clock_t start = clock();
+    aes_context_init(&ctx, key, key_size);
+    for (i = 0; i < BENCH_NUM_BLOCKS; i++) {
+        aes_encrypt_block_ctx(block, &ctx, block);
+    }
+    clock_t end = clock();
+
+    bench_report("aes_encrypt_block_ctx", BENCH_NUM_BLOCKS, start, end);
+}
+
+/*******************************************************************************
+ * Decrypts blocks with aes_decrypt_block_ctx().
+ *
+ * inputs:
+ * - key - The key.
+ * - key_size - The size of the key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_decrypt_block_ctx(const byte *key, int key_size)
+{
+    byte block[16] = {0};
+    aes_context_t ctx;
+    long i;
+
+    clock_t start = clock();
+    aes_context_init(&ctx, key, key_size);
+    for (i = 0; i < BENCH_NUM_BLOCKS; i++) {
+        aes_decrypt_block_ctx(block, &ctx, block);
+    }
+    clock_t end = clock();
+
+    bench_report("aes_decrypt_block_ctx", BENCH_NUM_BLOCKS, start, end);
+}
+
+/*******************************************************************************
+ * Encrypts blocks with a specific round engine.
+ *
+ * inputs:
+ * - name - The name of the round engine.
+ * - encrypt - The round engine's block encryption function.
+ * - key - The key.
+ * - key_size - The size of the key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_round_engine(
+    const char *name,
+    void (*encrypt)(const byte *, const aes_context_t *, byte *),
+    const byte *key, int key_size)
+{
+    byte block[16] = {0};
+    aes_context_t ctx;
+    long i;
+
+    clock_t start = clock();
+    aes_context_init(&ctx, key, key_size);
+    for (i = 0; i < BENCH_NUM_BLOCKS; i++) {
+        encrypt(block, &ctx, block);
+    }
+    clock_t end = clock();
+
+    bench_report(name, BENCH_NUM_BLOCKS, start, end);
+}
+
+/*******************************************************************************
+ * Encrypts independent blocks with a batched round engine.
+ *
+ * inputs:
+ * - name - The name of the round engine.
+ * - encrypt - The round engine's batched encryption function.
+ * - key - The key.
+ * - key_size - The size of the key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_batched_engine(
+    const char *name,
+    void (*encrypt)(const byte *, const aes_context_t *, byte *, size_t),
+    const byte *key, int key_size)
+{
+    byte blocks[AES_BATCH_BLOCKS * 16] = {0};
+    aes_context_t ctx;
+    long i;
+
+    clock_t start = clock();
+    aes_context_init(&ctx, key, key_size);
+    for (i = 0; i < BENCH_NUM_BLOCKS; i += AES_BATCH_BLOCKS) {
+        encrypt(blocks, &ctx, blocks, AES_BATCH_BLOCKS);
+    }
+    clock_t end = clock();
+
+    bench_report(name, BENCH_NUM_BLOCKS, start, end);
+}
+
+int main()
+{
+    /* Same key used by the database */
+    const byte key[32] = {
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+        0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08,
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+        0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08};
+    int key_sizes[3] = {16, 24, 32};
+    int i;
+
+    /* Show which backend aes_encrypt_block_ctx() uses */
+    printf("Backend: %s\n", aes_get_backend() == AES_BACKEND_AESNI
+        ? "AES-NI" : "portable");
+
+    /* Run each benchmark for every key size */
+    for (i = 0; i < 3; i++) {
+        printf("AES-%d\n", key_sizes[i] * 8);
+        bench_encrypt_block(key, key_sizes[i]);
+        bench_encrypt_block_ctx(key, key_sizes[i]);
+        bench_decrypt_block_ctx(key, key_sizes[i]);
+        bench_round_engine("reference engine",
+            aes_reference_encrypt_block, key, key_sizes[i]);
+        bench_round_engine("T-table engine",
+            aes_ttable_encrypt_block, key, key_sizes[i]);
+        bench_batched_engine("T-table engine(batched)",
+            aes_ttable_encrypt_blocks, key, key_sizes[i]);
+        if (aes_aesni_available()) {
+            bench_round_engine("AES-NI engine",
+                aes_aesni_encrypt_block, key, key_sizes[i]);
+            bench_batched_engine("AES-NI engine(batched)",
+                aes_aesni_encrypt_blocks, key, key_sizes[i]);
+        }
+    }
+
+    return 0;
+}
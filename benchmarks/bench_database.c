@@ -0,0 +1,290 @@
+/* clock_gettime() for wall-clock timing, since saving & loading wait on I/O */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "application/database.h"
+
+/* Name of the hospital used by the benchmark */
+#define BENCH_HOSPITAL_NAME "bench_database"
+
+/* Default number of patients */
+#define BENCH_DEFAULT_PATIENTS 20000
+
+/* Compression levels that can be chosen by name */
+struct bench_level
+{
+    const char *name;
+    int level;
+};
+typedef struct bench_level bench_level_t;
+
+const bench_level_t bench_levels[] = {
+    { "huffman", COMPRESSION_LEVEL_HUFFMAN },
+    { "zero-rle", COMPRESSION_LEVEL_HUFFMAN | COMPRESSION_FILTER_ZERO_RLE },
+    { "lz", COMPRESSION_LEVEL_LZ },
+    { "zero-rle+lz", COMPRESSION_LEVEL_LZ | COMPRESSION_FILTER_ZERO_RLE },
+    { NULL, 0 }
+};
+
+/* I/O done by the process so far, from /proc/self/io */
+struct bench_io
+{
+    /* Number of read() & write() calls */
+    unsigned long long read_calls;
+    unsigned long long write_calls;
+
+    /* Bytes passed to read() & write() */
+    unsigned long long bytes_read;
+    unsigned long long bytes_written;
+};
+typedef struct bench_io bench_io_t;
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Reads the I/O counters of the process.
+ * Only available on Linux.
+ *
+ * inputs:
+ * - io - Where to store the counters.
+ * outputs:
+ * - 0 on success, 1 if the counters are not available.
+ ******************************************************************************/
+int bench_read_io(bench_io_t *io)
+{
+    char name[64];
+    unsigned long long value;
+
+    FILE *file = fopen("/proc/self/io", "r");
+    if (file == NULL) {
+        return 1;
+    }
+
+    memset(io, 0, sizeof(*io));
+    while (fscanf(file, "%63s %llu", name, &value) == 2) {
+        if (strcmp(name, "syscr:") == 0) {
+            io->read_calls = value;
+        } else if (strcmp(name, "syscw:") == 0) {
+            io->write_calls = value;
+        } else if (strcmp(name, "rchar:") == 0) {
+            io->bytes_read = value;
+        } else if (strcmp(name, "wchar:") == 0) {
+            io->bytes_written = value;
+        }
+    }
+
+    fclose(file);
+    return 0;
+}
+
+/*******************************************************************************
+ * Prints the throughput & system calls of a benchmark.
+ * Opening /proc/self/io costs one read() call which is not subtracted.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_bytes - The size of the serialized database.
+ * - seconds - The time taken.
+ * - before - The I/O counters before the benchmark.
+ * - after - The I/O counters after the benchmark.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report(const char *name, double num_bytes, double seconds,
+    const bench_io_t *before, const bench_io_t *after)
+{
+    if (seconds <= 0) {
+        seconds = 1e-9;
+    }
+
+    printf("%-6s %8.3fs %10.2f MB/s %8llu read() %8llu write() "
+        "%10llu bytes read %10llu bytes written\n",
+        name, seconds, num_bytes / (seconds * 1024 * 1024),
+        after->read_calls - before->read_calls,
+        after->write_calls - before->write_calls,
+        after->bytes_read - before->bytes_read,
+        after->bytes_written - before->bytes_written);
+}
+
+/*******************************************************************************
+ * Checks whether a file exists.
+ *
+ * inputs:
+ * - filename - The name of the file.
+ * outputs:
+ * - 1 if the file exists, otherwise 0.
+ ******************************************************************************/
+int bench_file_exists(const char *filename)
+{
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    fclose(file);
+    return 1;
+}
+
+/*******************************************************************************
+ * Saves & loads a database of generated patients.
+ * Reports the throughput(of the serialized database) & the read()/write()
+ * system calls made by each. Loading only opens the database file, so the
+ * time to find one patient & to read every patient are reported too.
+ *
+ * The compression level is one of huffman, zero-rle(the default), lz &
+ * zero-rle+lz.
+ *
+ * Usage: bench_database [number of patients] [compression level]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long num_patients = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PATIENTS;
+    const char *level_name = argc > 2 ? argv[2] : "zero-rle";
+    char username[32];
+    bench_io_t before;
+    bench_io_t after;
+    int have_io;
+    long i;
+
+    for (i = 0; bench_levels[i].name != NULL; i++) {
+        if (strcmp(bench_levels[i].name, level_name) == 0) {
+            break;
+        }
+    }
+    if (bench_levels[i].name == NULL ||
+        database_set_compression_level(bench_levels[i].level) != 0) {
+        printf("[ERROR] Unknown compression level %s\n", level_name);
+        return 1;
+    }
+
+    /* Start from an empty database */
+    remove(BENCH_HOSPITAL_NAME "_encrypted.db");
+    hospital_record_t *records = load_database(BENCH_HOSPITAL_NAME);
+
+    /* Generate the patients, then add them all at once.
+     * Each patient's username, name, email & phone are written to strings.
+     */
+    patient_details_t *patients = (patient_details_t *)calloc(
+        num_patients, sizeof(patient_details_t));
+    char (*strings)[4][32] = malloc(num_patients * sizeof(*strings));
+    if (patients == NULL || strings == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(patients);
+        free(strings);
+        close_database(records);
+        return 1;
+    }
+    for (i = 0; i < num_patients; i++) {
+        patient_details_t *patient = &patients[i];
+        sprintf(strings[i][0], "patient%ld", i);
+        sprintf(strings[i][1], "Patient %ld", i);
+        sprintf(strings[i][2], "patient%ld@example.com", i);
+        sprintf(strings[i][3], "04%08ld", i);
+        patient->username = strings[i][0];
+        patient->name = strings[i][1];
+        patient->email = strings[i][2];
+        patient->phone = strings[i][3];
+        patient->password = (unsigned int)(i * 2654435761UL);
+        strcpy(patient->blood_type, i % 2 ? "A+" : "O-");
+        patient->medical_history = "None";
+        patient->weight = 60 + i % 40;
+        patient->height = 150 + i % 50;
+        patient->bmi = patient->weight /
+            (patient->height / 100 * patient->height / 100);
+    }
+    if (patient_add_batch(records, patients, num_patients) != 0) {
+        printf("[ERROR] Failed to import the patients\n");
+        return 1;
+    }
+    free(patients);
+    free(strings);
+
+    /* Size of the serialized database */
+    size_t size;
+    unsigned char *data = database_serialize(records, &size);
+    free(data);
+    printf("%ld patients, %lu bytes serialized, %s compression\n",
+        num_patients, (unsigned long)size, level_name);
+
+    /* Save */
+    have_io = bench_read_io(&before) == 0;
+    double start = bench_wall_seconds();
+    save_database(records);
+    double seconds = bench_wall_seconds() - start;
+    have_io = have_io && bench_read_io(&after) == 0;
+    if (!have_io) {
+        memset(&before, 0, sizeof(before));
+        memset(&after, 0, sizeof(after));
+        printf("[WARNING] /proc/self/io is not available\n");
+    }
+    bench_report("save", (double)size, seconds, &before, &after);
+
+    /* Saving should only ever write the encrypted database */
+    if (bench_file_exists(BENCH_HOSPITAL_NAME ".db") ||
+        bench_file_exists(BENCH_HOSPITAL_NAME "_compressed.db")) {
+        printf("[WARNING] Temporary database files were left behind\n");
+    }
+    close_database(records);
+
+    /* Load */
+    have_io = bench_read_io(&before) == 0;
+    start = bench_wall_seconds();
+    records = load_database(BENCH_HOSPITAL_NAME);
+    seconds = bench_wall_seconds() - start;
+    have_io = have_io && bench_read_io(&after) == 0;
+    if (!have_io) {
+        memset(&before, 0, sizeof(before));
+        memset(&after, 0, sizeof(after));
+    }
+    bench_report("load", (double)size, seconds, &before, &after);
+
+    if (records->num_patients != num_patients) {
+        printf("[ERROR] Loaded %d of %ld patients\n",
+            records->num_patients, num_patients);
+        return 1;
+    }
+
+    /* Find a patient, which reads only the page holding it */
+    sprintf(username, "patient%ld", num_patients / 2);
+    start = bench_wall_seconds();
+    patient_details_t *patient = find_patient(records, username);
+    seconds = bench_wall_seconds() - start;
+    if (patient == NULL) {
+        printf("[ERROR] %s was not found\n", username);
+        return 1;
+    }
+    printf("%-6s %8.1fus %lu of %ld patients read\n", "find", seconds * 1e6,
+        (unsigned long)records->patient_index.count, num_patients);
+
+    /* Read every other patient */
+    have_io = bench_read_io(&before) == 0;
+    start = bench_wall_seconds();
+    database_load_all(records);
+    seconds = bench_wall_seconds() - start;
+    have_io = have_io && bench_read_io(&after) == 0;
+    if (!have_io) {
+        memset(&before, 0, sizeof(before));
+        memset(&after, 0, sizeof(after));
+    }
+    bench_report("all", (double)size, seconds, &before, &after);
+
+    remove(records->encrypted_database_name);
+    close_database(records);
+    return 0;
+}
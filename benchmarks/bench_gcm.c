@@ -0,0 +1,201 @@
+/* clock_gettime() for wall-clock timing of the threaded benchmark */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "encryption/aes/core.h"
+#include "encryption/aes/gcm.h"
+#include "encryption/aes/ghash.h"
+
+/* Size of the message encrypted by each benchmark */
+#define BENCH_MESSAGE_SIZE (1024 * 1024)
+
+/*******************************************************************************
+ * Prints the throughput of a benchmark.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_bytes - The number of bytes processed.
+ * - start - The clock value when the benchmark started.
+ * - end - The clock value when the benchmark ended.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report(const char *name, double num_bytes, clock_t start, clock_t end)
+{
+    /* Time taken in seconds */
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0) {
+        seconds = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    printf("%-36s %10.0f bytes %8.3fs %10.2f MB/s\n",
+        name, num_bytes, seconds, num_bytes / (seconds * 1024 * 1024));
+}
+
+/*******************************************************************************
+ * Measures GHASH on its own.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - message - The data to hash.
+ * - size - The size of the data.
+ * - repeat - How many times to hash the data.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_ghash(const char *name, const unsigned char *message, int size,
+    int repeat)
+{
+    unsigned char h[16] = {0x66, 0xe9, 0x4b, 0xd4, 0xef, 0x8a, 0x2c, 0x3b,
+                           0x88, 0x4c, 0xfa, 0x59, 0xca, 0x34, 0x2b, 0x2e};
+    unsigned char state[16] = {0};
+    ghash_key_t key;
+    int i;
+
+    clock_t start = clock();
+    ghash_key_init(&key, h);
+    for (i = 0; i < repeat; i++) {
+        ghash_update(&key, state, message, size);
+    }
+    clock_t end = clock();
+
+    bench_report(name, (double)size * repeat, start, end);
+}
+
+/*******************************************************************************
+ * Measures aes_gcm_encrypt() followed by aes_gcm_decrypt().
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - message - The plaintext.
+ * - size - The size of the plaintext.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_gcm(const char *name, const unsigned char *message, int size)
+{
+    const unsigned char key[16] = {
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+        0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08};
+    const unsigned char nonce[12] = {
+        0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+        0xde, 0xca, 0xf8, 0x88};
+    char label[64];
+
+    /* Encrypt */
+    clock_t start = clock();
+    aes_gcm_data_t *encrypted = aes_gcm_encrypt(
+        message, size, key, 16, NULL, 0, nonce);
+    clock_t end = clock();
+    sprintf(label, "%s encrypt", name);
+    bench_report(label, size, start, end);
+
+    /* Decrypt */
+    start = clock();
+    aes_gcm_data_t *decrypted = aes_gcm_decrypt(
+        encrypted->output, encrypted->output_length, key, 16,
+        NULL, 0, nonce, encrypted->tag);
+    end = clock();
+    sprintf(label, "%s decrypt", name);
+    bench_report(label, size, start, end);
+
+    /* Make sure the round trip worked */
+    if (decrypted == NULL || memcmp(decrypted->output, message, size) != 0) {
+        printf("[ERROR] GCM round trip failed\n");
+        exit(1);
+    }
+
+    free(encrypted->output);
+    free(encrypted);
+    free(decrypted->output);
+    free(decrypted);
+}
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ * clock() adds up the time of every thread so cannot show a speed up.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Measures aes_gcm_encrypt() with different numbers of threads.
+ *
+ * inputs:
+ * - message - The plaintext.
+ * - size - The size of the plaintext.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_gcm_threads(const unsigned char *message, int size)
+{
+    const unsigned char key[16] = {0};
+    const unsigned char nonce[12] = {0};
+    int threads;
+
+    for (threads = 1; threads <= 8; threads *= 2) {
+        if (aes_gcm_set_threads(threads) != 0) {
+            printf("%d threads not supported\n", threads);
+            break;
+        }
+
+        double start = bench_wall_seconds();
+        aes_gcm_data_t *encrypted = aes_gcm_encrypt(
+            message, size, key, 16, NULL, 0, nonce);
+        double seconds = bench_wall_seconds() - start;
+
+        printf("GCM encrypt %d thread(s)            %10d bytes %8.3fs "
+            "%10.2f MB/s (wall)\n", threads, size, seconds,
+            size / (seconds * 1024 * 1024));
+
+        free(encrypted->output);
+        free(encrypted);
+    }
+
+    aes_gcm_set_threads(1);
+}
+
+int main()
+{
+    /* Message with some structure, like a database */
+    unsigned char *message = malloc(BENCH_MESSAGE_SIZE);
+    int i;
+    for (i = 0; i < BENCH_MESSAGE_SIZE; i++) {
+        message[i] = (unsigned char)(i % 251);
+    }
+
+    /* Portable(table) GHASH */
+    ghash_set_backend(GHASH_BACKEND_PORTABLE);
+    bench_ghash("GHASH portable", message, BENCH_MESSAGE_SIZE, 4);
+    bench_gcm("GCM (portable GHASH)", message, BENCH_MESSAGE_SIZE);
+
+    /* CLMUL GHASH */
+    if (ghash_set_backend(GHASH_BACKEND_CLMUL) == 0) {
+        bench_ghash("GHASH CLMUL", message, BENCH_MESSAGE_SIZE, 16);
+        bench_gcm("GCM (CLMUL GHASH)", message, BENCH_MESSAGE_SIZE);
+    }
+
+    /* Thread scaling on a larger message */
+    free(message);
+    message = malloc(BENCH_MESSAGE_SIZE * 16);
+    for (i = 0; i < BENCH_MESSAGE_SIZE * 16; i++) {
+        message[i] = (unsigned char)(i % 251);
+    }
+    bench_gcm_threads(message, BENCH_MESSAGE_SIZE * 16);
+
+    free(message);
+    return 0;
+}
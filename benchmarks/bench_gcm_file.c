@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "encryption/encryption.h"
+
+/* Files used by the benchmark */
+#define BENCH_PLAIN_FILE "bench_gcm_plain.tmp"
+#define BENCH_ENCRYPTED_FILE "bench_gcm_encrypted.tmp"
+#define BENCH_DECRYPTED_FILE "bench_gcm_decrypted.tmp"
+
+/* Default size of the file in MiB */
+#define BENCH_DEFAULT_SIZE_MIB 256
+
+/*******************************************************************************
+ * Prints the throughput of a benchmark.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_bytes - The number of bytes processed.
+ * - start - The clock value when the benchmark started.
+ * - end - The clock value when the benchmark ended.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report(const char *name, double num_bytes, clock_t start, clock_t end)
+{
+    /* Time taken in seconds */
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0) {
+        seconds = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    printf("%-20s %10.0f MiB %8.3fs %10.2f MB/s\n",
+        name, num_bytes / (1024 * 1024), seconds,
+        num_bytes / (seconds * 1024 * 1024));
+}
+
+/*******************************************************************************
+ * Encrypts & decrypts a large file with the chunked file format.
+ * Memory use stays at one AES_GCM_FILE_CHUNK_SIZE buffer regardless of the
+ * file size.
+ *
+ * Usage: bench_gcm_file [size in MiB]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    const unsigned char key[16] = {
+        0xfe, 0xff, 0xe9, 0x92, 0x86, 0x65, 0x73, 0x1c,
+        0x6d, 0x6a, 0x8f, 0x94, 0x67, 0x30, 0x83, 0x08};
+    const unsigned char nonce[12] = {
+        0xca, 0xfe, 0xba, 0xbe, 0xfa, 0xce, 0xdb, 0xad,
+        0xde, 0xca, 0xf8, 0x88};
+
+    /* Size of the file */
+    long size_mib = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_SIZE_MIB;
+    double size = (double)size_mib * 1024 * 1024;
+
+    /* Create the plaintext file one MiB at a time */
+    unsigned char *block = malloc(1024 * 1024);
+    long i;
+    for (i = 0; i < 1024 * 1024; i++) {
+        block[i] = (unsigned char)(i % 251);
+    }
+    FILE *file = fopen(BENCH_PLAIN_FILE, "wb");
+    if (file == NULL) {
+        printf("[ERROR] Failed to create %s\n", BENCH_PLAIN_FILE);
+        return 1;
+    }
+    for (i = 0; i < size_mib; i++) {
+        fwrite(block, 1, 1024 * 1024, file);
+    }
+    fclose(file);
+    free(block);
+
+    /* Encrypt */
+    clock_t start = clock();
+    int failed = aes_gcm_encrypt_file(BENCH_PLAIN_FILE, BENCH_ENCRYPTED_FILE,
+        key, 16, NULL, 0, nonce);
+    clock_t end = clock();
+    bench_report("Encrypt file", size, start, end);
+
+    /* Decrypt */
+    start = clock();
+    failed |= aes_gcm_decrypt_file(BENCH_ENCRYPTED_FILE, BENCH_DECRYPTED_FILE,
+        key, 16, NULL, 0, nonce);
+    end = clock();
+    bench_report("Decrypt file", size, start, end);
+
+    if (failed) {
+        printf("[ERROR] File round trip failed\n");
+    }
+    printf("Buffer size: %d bytes\n", AES_GCM_FILE_CHUNK_SIZE);
+
+    /* Clean up */
+    remove(BENCH_PLAIN_FILE);
+    remove(BENCH_ENCRYPTED_FILE);
+    remove(BENCH_DECRYPTED_FILE);
+    return failed;
+}
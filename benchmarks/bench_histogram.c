@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "compression/huffman/frequency_table.h"
+
+/* Default size of the data in MiB */
+#define BENCH_DEFAULT_SIZE_MIB 64
+
+/* File written for the file benchmarks */
+#define BENCH_FILE_NAME "bench_histogram.tmp"
+
+/*******************************************************************************
+ * Prints the throughput of a benchmark.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_bytes - The number of bytes counted.
+ * - start - The clock value when the benchmark started.
+ * - end - The clock value when the benchmark ended.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report(const char *name, double num_bytes, clock_t start, clock_t end)
+{
+    /* Time taken in seconds */
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0) {
+        seconds = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    printf("%-36s %8.3fs %10.2f MB/s\n", name, seconds,
+        num_bytes / (seconds * 1024 * 1024));
+}
+
+/*******************************************************************************
+ * Counts bytes the way create_frequency_table() used to: a single table,
+ * one fread() call per byte.
+ *
+ * inputs:
+ * - input - The name of the file.
+ * - frequency_table - Set to the number of occurrences of each byte.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_reference_file(const char *input, unsigned int frequency_table[256])
+{
+    unsigned char byte;
+
+    memset(frequency_table, 0, 256 * sizeof(unsigned int));
+    FILE *file = fopen(input, "rb");
+    if (file == NULL) {
+        return;
+    }
+    while (fread(&byte, 1, 1, file) == 1) {
+        frequency_table[byte] += 1;
+    }
+    fclose(file);
+}
+
+/*******************************************************************************
+ * Counts bytes in memory into a single table.
+ *
+ * inputs:
+ * - input - The data.
+ * - input_size - The size of the data.
+ * - frequency_table - Set to the number of occurrences of each byte.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_reference_buffer(const unsigned char *input, size_t input_size,
+    unsigned int frequency_table[256])
+{
+    size_t i;
+
+    memset(frequency_table, 0, 256 * sizeof(unsigned int));
+    for (i = 0; i < input_size; i++) {
+        frequency_table[input[i]] += 1;
+    }
+}
+
+/*******************************************************************************
+ * Measures the reference & interleaved histograms on one data set, in
+ * memory & from a file.
+ *
+ * inputs:
+ * - name - The name of the data.
+ * - data - The data.
+ * - size - The size of the data.
+ * outputs:
+ * - 0 if every histogram matches, otherwise 1.
+ ******************************************************************************/
+int bench_histograms(const char *name, const unsigned char *data, size_t size)
+{
+    unsigned int expected[256];
+    unsigned int actual[256];
+    char label[64];
+    int failed = 0;
+
+    FILE *file = fopen(BENCH_FILE_NAME, "wb");
+    if (file == NULL) {
+        printf("[ERROR] Failed to create %s\n", BENCH_FILE_NAME);
+        return 1;
+    }
+    fwrite(data, 1, size, file);
+    fclose(file);
+
+    clock_t start = clock();
+    bench_reference_buffer(data, size, expected);
+    clock_t end = clock();
+    sprintf(label, "%s: buffer, 1x256", name);
+    bench_report(label, (double)size, start, end);
+
+    start = clock();
+    create_frequency_table_buffer(data, size, actual);
+    end = clock();
+    sprintf(label, "%s: buffer, 8x256", name);
+    bench_report(label, (double)size, start, end);
+    failed |= memcmp(expected, actual, sizeof(expected)) != 0;
+
+    start = clock();
+    bench_reference_file(BENCH_FILE_NAME, actual);
+    end = clock();
+    sprintf(label, "%s: file, byte fread, 1x256", name);
+    bench_report(label, (double)size, start, end);
+    failed |= memcmp(expected, actual, sizeof(expected)) != 0;
+
+    start = clock();
+    create_frequency_table(BENCH_FILE_NAME, actual);
+    end = clock();
+    sprintf(label, "%s: file, block fread, 8x256", name);
+    bench_report(label, (double)size, start, end);
+    failed |= memcmp(expected, actual, sizeof(expected)) != 0;
+
+    if (failed) {
+        printf("[ERROR] %s histograms do not match\n", name);
+    }
+    remove(BENCH_FILE_NAME);
+    return failed;
+}
+
+/*******************************************************************************
+ * Measures the byte histogram used by Huffman compression.
+ *
+ * Usage: bench_histogram [size in MiB]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long size_mib = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_SIZE_MIB;
+    size_t size = (size_t)size_mib * 1024 * 1024;
+    unsigned long state = 12345;
+    int failed = 0;
+    size_t i;
+
+    unsigned char *data = (unsigned char *)malloc(size);
+    if (data == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    /* Serialized records: short text padded with zeros to 256 bytes */
+    memset(data, 0, size);
+    for (i = 0; i + 256 <= size; i += 256) {
+        sprintf((char *)data + i, "patient%lu@example.com",
+            (unsigned long)(i / 256));
+    }
+    failed |= bench_histograms("records", data, size);
+
+    /* A single repeated byte */
+    memset(data, 0, size);
+    failed |= bench_histograms("zeros", data, size);
+
+    /* Every byte value, evenly spread */
+    for (i = 0; i < size; i++) {
+        state = state * 1103515245UL + 12345UL;
+        data[i] = (unsigned char)(state >> 16);
+    }
+    failed |= bench_histograms("random", data, size);
+
+    free(data);
+    return failed;
+}
@@ -0,0 +1,301 @@
+/* clock_gettime() for wall-clock timing of the threaded benchmark */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "compression/compression.h"
+
+/* Default size of the data in MiB */
+#define BENCH_DEFAULT_SIZE_MIB 32
+
+/* Size of each block when compressing many small blocks */
+#define BENCH_SMALL_BLOCK_SIZE 4096
+
+/*******************************************************************************
+ * Prints the throughput of a benchmark.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_bytes - The number of uncompressed bytes processed.
+ * - start - The clock value when the benchmark started.
+ * - end - The clock value when the benchmark ended.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report(const char *name, double num_bytes, clock_t start, clock_t end)
+{
+    /* Time taken in seconds */
+    double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0) {
+        seconds = 1.0 / CLOCKS_PER_SEC;
+    }
+
+    printf("%-28s %8.0f MiB %8.3fs %10.2f MB/s\n",
+        name, num_bytes / (1024 * 1024), seconds,
+        num_bytes / (seconds * 1024 * 1024));
+}
+
+/*******************************************************************************
+ * Fills a buffer with data shaped like a serialized database: short text
+ * fields padded with zeros to 256 bytes.
+ *
+ * inputs:
+ * - data - The buffer.
+ * - size - The size of the buffer.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_fill_records(unsigned char *data, size_t size)
+{
+    size_t i;
+
+    memset(data, 0, size);
+    for (i = 0; i + 256 <= size; i += 256) {
+        sprintf((char *)data + i, "patient%lu@example.com",
+            (unsigned long)(i / 256));
+    }
+}
+
+/*******************************************************************************
+ * Fills a buffer with text-like data where some bytes are far more common
+ * than others.
+ *
+ * inputs:
+ * - data - The buffer.
+ * - size - The size of the buffer.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_fill_text(unsigned char *data, size_t size)
+{
+    const char *alphabet = "eeeeeeetttttaaaaooooiiinnnssshhrrdlcumwfgypbvkjxqz"
+        "         ,.\n";
+    size_t alphabet_size = strlen(alphabet);
+    unsigned long state = 12345;
+    size_t i;
+
+    for (i = 0; i < size; i++) {
+        state = state * 1103515245UL + 12345UL;
+        data[i] = (unsigned char)alphabet[(state >> 16) % alphabet_size];
+    }
+}
+
+/*******************************************************************************
+ * Compresses & decompresses data in memory.
+ * The buffers are allocated before timing starts.
+ *
+ * inputs:
+ * - name - The name of the data.
+ * - data - The data.
+ * - size - The size of the data.
+ * outputs:
+ * - 0 if the data round trips, otherwise 1.
+ ******************************************************************************/
+int bench_round_trip(const char *name, const unsigned char *data, size_t size)
+{
+    char label[64];
+    size_t bound = huffman_compress_bound(size);
+    size_t compressed_size = 0;
+    size_t decompressed_size = 0;
+    int failed = 0;
+
+    unsigned char *compressed = (unsigned char *)malloc(bound);
+    unsigned char *decompressed = (unsigned char *)malloc(size);
+    if (compressed == NULL || decompressed == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(compressed);
+        free(decompressed);
+        return 1;
+    }
+
+    clock_t start = clock();
+    failed |= huffman_compress_buffer(data, size, compressed, bound,
+        &compressed_size);
+    clock_t end = clock();
+    sprintf(label, "compress %s", name);
+    bench_report(label, (double)size, start, end);
+
+    start = clock();
+    failed |= huffman_decompress_buffer(compressed, compressed_size,
+        decompressed, size, &decompressed_size);
+    end = clock();
+    sprintf(label, "decompress %s", name);
+    bench_report(label, (double)size, start, end);
+
+    printf("%-28s %8.1f%%\n", "compressed size",
+        100.0 * compressed_size / size);
+
+    failed = failed || decompressed_size != size ||
+        memcmp(decompressed, data, size) != 0;
+    if (failed) {
+        printf("[ERROR] %s did not round trip\n", name);
+    }
+
+    free(compressed);
+    free(decompressed);
+    return failed;
+}
+
+/*******************************************************************************
+ * Compresses & decompresses data as many small blocks, where building the
+ * tree & tables for each block costs as much as coding it. The same buffers
+ * are used for every block.
+ *
+ * inputs:
+ * - name - The name of the data.
+ * - data - The data.
+ * - size - The size of the data.
+ * outputs:
+ * - 0 if every block round trips, otherwise 1.
+ ******************************************************************************/
+int bench_small_blocks(const char *name, const unsigned char *data, size_t size)
+{
+    unsigned char compressed[HUFFMAN_MAX_HEADER_SIZE +
+        2 * BENCH_SMALL_BLOCK_SIZE];
+    unsigned char decompressed[BENCH_SMALL_BLOCK_SIZE];
+    size_t bound = huffman_compress_bound(BENCH_SMALL_BLOCK_SIZE);
+    size_t num_bytes = size - size % BENCH_SMALL_BLOCK_SIZE;
+    size_t compressed_size, decompressed_size;
+    char label[64];
+    int failed = 0;
+    size_t i;
+
+    if (num_bytes == 0) {
+        return 0;
+    }
+    if (bound > sizeof(compressed)) {
+        printf("[ERROR] Block buffer is too small\n");
+        return 1;
+    }
+
+    clock_t start = clock();
+    for (i = 0; i < num_bytes; i += BENCH_SMALL_BLOCK_SIZE) {
+        failed |= huffman_compress_buffer(data + i, BENCH_SMALL_BLOCK_SIZE,
+            compressed, bound, &compressed_size);
+    }
+    clock_t end = clock();
+    sprintf(label, "compress %s in %d KiB", name, BENCH_SMALL_BLOCK_SIZE / 1024);
+    bench_report(label, (double)num_bytes, start, end);
+
+    /* Decompress the last block over & over */
+    start = clock();
+    for (i = 0; i < num_bytes; i += BENCH_SMALL_BLOCK_SIZE) {
+        failed |= huffman_decompress_buffer(compressed, compressed_size,
+            decompressed, BENCH_SMALL_BLOCK_SIZE, &decompressed_size);
+    }
+    end = clock();
+    sprintf(label, "decompress %s in %d KiB", name,
+        BENCH_SMALL_BLOCK_SIZE / 1024);
+    bench_report(label, (double)num_bytes, start, end);
+
+    if (failed || memcmp(decompressed,
+            data + num_bytes - BENCH_SMALL_BLOCK_SIZE,
+            BENCH_SMALL_BLOCK_SIZE) != 0) {
+        printf("[ERROR] %s blocks did not round trip\n", name);
+        failed = 1;
+    }
+    return failed;
+}
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ * clock() adds up the time of every thread so cannot show a speed up.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Measures block compression & decompression with different numbers of
+ * threads.
+ *
+ * inputs:
+ * - name - The name of the data.
+ * - data - The data.
+ * - size - The size of the data.
+ * outputs:
+ * - 0 if the data round trips every time, otherwise 1.
+ ******************************************************************************/
+int bench_blocks_threads(const char *name, const unsigned char *data,
+    size_t size)
+{
+    size_t compressed_size;
+    size_t decompressed_size;
+    int failed = 0;
+    int threads;
+
+    for (threads = 1; threads <= 8; threads *= 2) {
+        if (huffman_set_threads(threads) != 0) {
+            printf("%d threads not supported\n", threads);
+            break;
+        }
+
+        double start = bench_wall_seconds();
+        unsigned char *compressed = huffman_compress_blocks(
+            data, size, 0, &compressed_size);
+        double compress_seconds = bench_wall_seconds() - start;
+
+        start = bench_wall_seconds();
+        unsigned char *decompressed = huffman_decompress_blocks(
+            compressed, compressed_size, &decompressed_size);
+        double decompress_seconds = bench_wall_seconds() - start;
+
+        printf("blocks %s %d thread(s)    compress %10.2f MB/s  "
+            "decompress %10.2f MB/s (wall) %6.1f%%\n", name, threads,
+            size / (compress_seconds * 1024 * 1024),
+            size / (decompress_seconds * 1024 * 1024),
+            100.0 * compressed_size / size);
+
+        if (decompressed == NULL || decompressed_size != size ||
+            memcmp(decompressed, data, size) != 0) {
+            printf("[ERROR] %s blocks did not round trip\n", name);
+            failed = 1;
+        }
+        free(compressed);
+        free(decompressed);
+    }
+
+    huffman_set_threads(1);
+    return failed;
+}
+
+/*******************************************************************************
+ * Measures Huffman compression & decompression in memory.
+ *
+ * Usage: bench_huffman [size in MiB]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long size_mib = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_SIZE_MIB;
+    size_t size = (size_t)size_mib * 1024 * 1024;
+    int failed = 0;
+
+    unsigned char *data = (unsigned char *)malloc(size);
+    if (data == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    bench_fill_records(data, size);
+    failed |= bench_round_trip("records", data, size);
+    failed |= bench_blocks_threads("records", data, size);
+
+    bench_fill_text(data, size);
+    failed |= bench_round_trip("text", data, size);
+    failed |= bench_small_blocks("text", data, size);
+    failed |= bench_blocks_threads("text", data, size);
+
+    free(data);
+    return failed;
+}
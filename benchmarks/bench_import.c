@@ -0,0 +1,187 @@
+/* clock_gettime() for wall-clock timing */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "application/database.h"
+
+/* Name of the hospital used by the benchmark */
+#define BENCH_HOSPITAL_NAME "bench_import"
+
+/* Default number of patients */
+#define BENCH_DEFAULT_PATIENTS 1000000
+
+/* Most patients added by walking the list, which is quadratic */
+#define BENCH_WALK_PATIENTS 20000
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Generates patients with unique usernames.
+ *
+ * inputs:
+ * - num_patients - The number of patients.
+ * - strings - Set to the strings the patients point to(must be freed).
+ * outputs:
+ * - The patients(must be freed) or NULL on failure.
+ ******************************************************************************/
+patient_details_t *bench_make_patients(long num_patients, char **strings)
+{
+    long i;
+
+    patient_details_t *patients = (patient_details_t *)calloc(
+        num_patients, sizeof(patient_details_t));
+    char (*names)[2][32] = malloc(num_patients * sizeof(*names));
+    if (patients == NULL || names == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(patients);
+        free(names);
+        return NULL;
+    }
+
+    for (i = 0; i < num_patients; i++) {
+        sprintf(names[i][0], "patient%ld", i);
+        sprintf(names[i][1], "Patient %ld", i);
+        patients[i].username = names[i][0];
+        patients[i].name = names[i][1];
+    }
+    *strings = (char *)names;
+    return patients;
+}
+
+/*******************************************************************************
+ * Adds a patient by walking to the end of the list, as
+ * patient_signup_silent() did before the list kept its last patient.
+ *
+ * inputs:
+ * - records - The database.
+ * - patient - The patient to add.
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated.
+ ******************************************************************************/
+int bench_walk_signup(hospital_record_t *records,
+    const patient_details_t *patient)
+{
+    patient_details_t *copy = patient_copy(records, patient);
+    if (copy == NULL) {
+        return 1;
+    }
+
+    if (records->patients == NULL) {
+        records->patients = copy;
+    } else {
+        patient_details_t *last_patient = records->patients;
+        while (last_patient->next != NULL) {
+            last_patient = last_patient->next;
+        }
+        last_patient->next = copy;
+    }
+    records->num_patients++;
+    return 0;
+}
+
+/*******************************************************************************
+ * Adds patients to an empty database in one of several ways & reports the
+ * time taken.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - num_patients - The number of patients.
+ * - method - 0 for patient_add() one at a time, 1 for
+ *            patient_add_batch(), 2 for walking the list.
+ * outputs:
+ * - 0 if every patient was added & can be found, otherwise 1.
+ ******************************************************************************/
+int bench_add_patients(const char *name, long num_patients, int method)
+{
+    int failed = 0;
+    long i;
+
+    remove(BENCH_HOSPITAL_NAME "_encrypted.db");
+    hospital_record_t *records = load_database(BENCH_HOSPITAL_NAME);
+    char *strings;
+    patient_details_t *patients = bench_make_patients(num_patients, &strings);
+    if (patients == NULL) {
+        close_database(records);
+        return 1;
+    }
+
+    double start = bench_wall_seconds();
+    if (method == 1) {
+        failed |= patient_add_batch(records, patients, num_patients);
+    } else {
+        for (i = 0; i < num_patients; i++) {
+            if (method == 0) {
+                failed |= patient_add(records, &patients[i]) == NULL;
+            } else {
+                failed |= bench_walk_signup(records, &patients[i]);
+            }
+        }
+    }
+    double seconds = bench_wall_seconds() - start;
+
+    /* Walking the list does not index, so is not searched */
+    if (method == 2) {
+        failed |= database_rebuild_indexes(records);
+    }
+
+    printf("%-18s %8ld patients %9.3fs %10.1fns per patient\n", name,
+        num_patients, seconds, seconds * 1e9 / num_patients);
+
+    patient_details_t *middle = find_patient(records,
+        (char *)patients[num_patients / 2].username);
+    failed |= records->num_patients != num_patients ||
+        strcmp(records->patients_tail->username,
+            patients[num_patients - 1].username) != 0 ||
+        middle == NULL ||
+        strcmp(middle->name, patients[num_patients / 2].name) != 0;
+    if (failed) {
+        printf("[ERROR] %s did not add every patient\n", name);
+    }
+
+    free(patients);
+    free(strings);
+    close_database(records);
+    return failed;
+}
+
+/*******************************************************************************
+ * Measures adding patients one at a time & all at once. Walking the list
+ * to add each patient is measured with fewer patients for comparison.
+ *
+ * Usage: bench_import [number of patients]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long num_patients = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PATIENTS;
+    long num_walk = num_patients < BENCH_WALK_PATIENTS ?
+        num_patients : BENCH_WALK_PATIENTS;
+    int failed = 0;
+
+    if (num_patients <= 0) {
+        printf("[ERROR] Need at least 1 patient\n");
+        return 1;
+    }
+
+    failed |= bench_add_patients("walk list", num_walk, 2);
+    failed |= bench_add_patients("signup", num_walk, 0);
+    failed |= bench_add_patients("signup", num_patients, 0);
+    failed |= bench_add_patients("import batch", num_patients, 1);
+    return failed;
+}
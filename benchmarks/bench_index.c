@@ -0,0 +1,193 @@
+/* clock_gettime() for timing each lookup */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "application/database.h"
+
+/* Name of the hospital used by the benchmark */
+#define BENCH_HOSPITAL_NAME "bench_index"
+
+/* Default number of patients */
+#define BENCH_DEFAULT_PATIENTS 1000000
+
+/* Number of lookups timed with the index */
+#define BENCH_INDEX_LOOKUPS 200000
+
+/* Number of lookups timed with a list scan, which is far slower */
+#define BENCH_SCAN_LOOKUPS 200
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in nanoseconds.
+ ******************************************************************************/
+double bench_wall_nanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e9 + now.tv_nsec;
+}
+
+/*******************************************************************************
+ * Orders latencies from fastest to slowest.
+ ******************************************************************************/
+int bench_compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/*******************************************************************************
+ * Finds a patient by walking the list, as find_patient() did before the
+ * index.
+ *
+ * inputs:
+ * - records - The database.
+ * - username - The username to find.
+ * outputs:
+ * - The patient if found, otherwise NULL.
+ ******************************************************************************/
+patient_details_t *bench_scan_patients(hospital_record_t *records,
+    const char *username)
+{
+    patient_details_t *patients = records->patients;
+    while (patients != NULL) {
+        if (strcmp(patients->username, username) == 0) {
+            return patients;
+        }
+        patients = patients->next;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Times lookups one at a time & prints the latency percentiles.
+ *
+ * inputs:
+ * - name - The name of the benchmark.
+ * - records - The database.
+ * - num_patients - The number of patients in the database.
+ * - num_lookups - The number of lookups.
+ * - scan - 1 to walk the list, 0 to use the index.
+ * - miss - 1 to look up usernames nobody has.
+ * outputs:
+ * - 0 if every lookup gave the right answer, otherwise 1.
+ ******************************************************************************/
+int bench_lookups(const char *name, hospital_record_t *records,
+    long num_patients, long num_lookups, int scan, int miss)
+{
+    double *latencies = (double *)malloc(num_lookups * sizeof(double));
+    char (*usernames)[32] = malloc(num_lookups * sizeof(*usernames));
+    unsigned long state = 12345;
+    int failed = 0;
+    long i;
+
+    if (latencies == NULL || usernames == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(latencies);
+        free(usernames);
+        return 1;
+    }
+
+    /* Random usernames, made before timing starts */
+    for (i = 0; i < num_lookups; i++) {
+        state = state * 6364136223846793005UL + 1442695040888963407UL;
+        sprintf(usernames[i], miss ? "nobody%ld" : "patient%ld",
+            (long)((state >> 33) % num_patients));
+    }
+
+    double total = 0;
+    for (i = 0; i < num_lookups; i++) {
+        double start = bench_wall_nanoseconds();
+        patient_details_t *patient = scan ?
+            bench_scan_patients(records, usernames[i]) :
+            find_patient(records, usernames[i]);
+        latencies[i] = bench_wall_nanoseconds() - start;
+        total += latencies[i];
+
+        failed |= miss ? patient != NULL : patient == NULL ||
+            strcmp(patient->username, usernames[i]) != 0;
+    }
+
+    qsort(latencies, num_lookups, sizeof(double), bench_compare_doubles);
+    printf("%-12s %7ld lookups  mean %10.0fns  p50 %10.0fns  p90 %10.0fns  "
+        "p99 %10.0fns  p99.9 %10.0fns  max %10.0fns\n", name, num_lookups,
+        total / num_lookups, latencies[num_lookups / 2],
+        latencies[num_lookups * 9 / 10], latencies[num_lookups * 99 / 100],
+        latencies[num_lookups * 999 / 1000], latencies[num_lookups - 1]);
+
+    if (failed) {
+        printf("[ERROR] %s gave a wrong answer\n", name);
+    }
+    free(latencies);
+    free(usernames);
+    return failed;
+}
+
+/*******************************************************************************
+ * Measures finding patients by username with the index & with a list scan.
+ * Each lookup is timed on its own, including about 20ns for reading the
+ * clock.
+ *
+ * Usage: bench_index [number of patients]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long num_patients = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PATIENTS;
+    int failed = 0;
+    long i;
+
+    if (num_patients <= 0) {
+        printf("[ERROR] Need at least 1 patient\n");
+        return 1;
+    }
+
+    /* Start from an empty database */
+    remove(BENCH_HOSPITAL_NAME "_encrypted.db");
+    hospital_record_t *records = load_database(BENCH_HOSPITAL_NAME);
+
+    /* Generate the patients */
+    patient_details_t *patients = (patient_details_t *)calloc(
+        num_patients, sizeof(patient_details_t));
+    char (*usernames)[32] = malloc(num_patients * sizeof(*usernames));
+    if (patients == NULL || usernames == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(patients);
+        free(usernames);
+        close_database(records);
+        return 1;
+    }
+    for (i = 0; i < num_patients; i++) {
+        sprintf(usernames[i], "patient%ld", i);
+        patients[i].username = usernames[i];
+    }
+
+    /* Adding them all at once builds the index */
+    double start = bench_wall_nanoseconds();
+    failed |= patient_add_batch(records, patients, num_patients);
+    double seconds = (bench_wall_nanoseconds() - start) / 1e9;
+    printf("%ld patients, imported & indexed in %.3fs(%.0fns per patient)\n",
+        num_patients, seconds, seconds * 1e9 / num_patients);
+    free(patients);
+    free(usernames);
+
+    failed |= bench_lookups("index hit", records, num_patients,
+        BENCH_INDEX_LOOKUPS, 0, 0);
+    failed |= bench_lookups("index miss", records, num_patients,
+        BENCH_INDEX_LOOKUPS, 0, 1);
+    failed |= bench_lookups("scan hit", records, num_patients,
+        BENCH_SCAN_LOOKUPS, 1, 0);
+    failed |= bench_lookups("scan miss", records, num_patients,
+        BENCH_SCAN_LOOKUPS, 1, 1);
+
+    close_database(records);
+    return failed;
+}
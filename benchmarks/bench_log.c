@@ -0,0 +1,169 @@
+/* clock_gettime() for wall-clock timing, since each change waits on fsync() */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "application/database.h"
+
+/* Name of the hospital used by the benchmark */
+#define BENCH_HOSPITAL_NAME "bench_log"
+
+/* Default number of patients */
+#define BENCH_DEFAULT_PATIENTS 100000
+
+/* Patients generated & imported at a time */
+#define BENCH_IMPORT_PATIENTS 4096
+
+/* Number of changes saved by saving the whole database */
+#define BENCH_SAVES 5
+
+/* Number of changes logged */
+#define BENCH_CHANGES 1000
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Generates a patient.
+ *
+ * inputs:
+ * - patient - The patient. Its strings point into strings.
+ * - strings - Room for the patient's username, name, email & phone.
+ * - i - The number of the patient.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_make_patient(patient_details_t *patient, char strings[4][32],
+    long i)
+{
+    memset(patient, 0, sizeof(*patient));
+    sprintf(strings[0], "patient%ld", i);
+    sprintf(strings[1], "Patient %ld", i);
+    sprintf(strings[2], "patient%ld@example.com", i);
+    sprintf(strings[3], "04%08ld", i);
+    patient->username = strings[0];
+    patient->name = strings[1];
+    patient->email = strings[2];
+    patient->phone = strings[3];
+    patient->password = (unsigned int)(i * 2654435761UL);
+    strcpy(patient->blood_type, i % 2 ? "A+" : "O-");
+    patient->medical_history = "None";
+    patient->weight = 60 + i % 40;
+    patient->height = 150 + i % 50;
+    patient->bmi = patient->weight /
+        (patient->height / 100 * patient->height / 100);
+}
+
+/*******************************************************************************
+ * Compares saving the whole database after a change(as every menu action
+ * used to) with logging the change, then times replaying the log & a
+ * checkpoint in the background.
+ *
+ * Usage: bench_log [number of patients]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long num_patients = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PATIENTS;
+    patient_details_t generated[BENCH_IMPORT_PATIENTS];
+    static char strings[BENCH_IMPORT_PATIENTS][4][32];
+    long i, j;
+
+    if (num_patients <= 0) {
+        printf("[ERROR] Need at least 1 patient\n");
+        return 1;
+    }
+
+    /* Start from an empty database */
+    remove(BENCH_HOSPITAL_NAME "_encrypted.db");
+    remove(BENCH_HOSPITAL_NAME "_encrypted.log");
+    hospital_record_t *records = load_database(BENCH_HOSPITAL_NAME);
+    for (i = 0; i < num_patients; i += BENCH_IMPORT_PATIENTS) {
+        long count = num_patients - i < BENCH_IMPORT_PATIENTS ?
+            num_patients - i : BENCH_IMPORT_PATIENTS;
+        for (j = 0; j < count; j++) {
+            bench_make_patient(&generated[j], strings[j], i + j);
+        }
+        if (patient_add_batch(records, generated, count) != 0) {
+            printf("[ERROR] Failed to import the patients\n");
+            return 1;
+        }
+    }
+    save_database(records);
+    printf("%ld patients\n", num_patients);
+
+    /* Change a patient, then save everything */
+    patient_details_t *patient = find_patient(records, "patient0");
+    double start = bench_wall_seconds();
+    for (i = 0; i < BENCH_SAVES; i++) {
+        patient->weight += 1;
+        save_database(records);
+    }
+    double seconds = (bench_wall_seconds() - start) / BENCH_SAVES;
+    printf("%-10s %10.1fus per change\n", "save", seconds * 1e6);
+
+    /* Change a patient, then log only the change */
+    double slowest = 0;
+    start = bench_wall_seconds();
+    for (i = 0; i < BENCH_CHANGES; i++) {
+        double change_start = bench_wall_seconds();
+        patient->weight += 1;
+        database_log_patient(records, patient->username, patient);
+        double change_seconds = bench_wall_seconds() - change_start;
+        if (change_seconds > slowest) {
+            slowest = change_seconds;
+        }
+    }
+    seconds = (bench_wall_seconds() - start) / BENCH_CHANGES;
+    printf("%-10s %10.1fus per change %10.1fus slowest %8lu bytes logged\n",
+        "log", seconds * 1e6, slowest * 1e6,
+        (unsigned long)records->log.size);
+    float weight = patient->weight;
+    close_database(records);
+
+    /* Load, replaying every logged change */
+    start = bench_wall_seconds();
+    records = load_database(BENCH_HOSPITAL_NAME);
+    seconds = bench_wall_seconds() - start;
+    patient = find_patient(records, "patient0");
+    printf("%-10s %10.1fms with %d changes logged\n", "load",
+        seconds * 1e3, BENCH_CHANGES);
+    if (patient == NULL || patient->weight != weight) {
+        printf("[ERROR] Logged changes were not replayed\n");
+        return 1;
+    }
+
+    /* Write the changes to the database file in the background */
+    start = bench_wall_seconds();
+    database_log_checkpoint(records);
+    seconds = bench_wall_seconds() - start;
+    patient->weight += 1;
+    database_log_patient(records, patient->username, patient);
+    double logged = bench_wall_seconds() - start;
+    if (database_log_wait(records) != 0) {
+        return 1;
+    }
+    double finished = bench_wall_seconds() - start;
+    printf("%-10s %10.1fms to start %10.1fms to log a change "
+        "%10.1fms to finish\n", "checkpoint", seconds * 1e3, logged * 1e3,
+        finished * 1e3);
+
+    remove(records->encrypted_database_name);
+    remove(records->log.name);
+    close_database(records);
+    return 0;
+}
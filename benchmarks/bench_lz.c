@@ -0,0 +1,241 @@
+/* clock_gettime() for wall-clock timing */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "application/database.h"
+#include "compression/compression.h"
+
+/* Name of the hospital used by the benchmark */
+#define BENCH_HOSPITAL_NAME "bench_lz"
+
+/* Default number of patients */
+#define BENCH_DEFAULT_PATIENTS 1000000
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Serializes a database of generated patients, shaped like the ones
+ * bench_database saves.
+ *
+ * inputs:
+ * - num_patients - The number of patients.
+ * - size - Set to the size of the serialized database.
+ * outputs:
+ * - The serialized database(must be freed) or NULL on failure.
+ ******************************************************************************/
+unsigned char *bench_serialize_patients(long num_patients, size_t *size)
+{
+    long i;
+
+    /* Start from an empty database */
+    remove(BENCH_HOSPITAL_NAME "_encrypted.db");
+    hospital_record_t *records = load_database(BENCH_HOSPITAL_NAME);
+
+    /* Generate the patients, then add them all at once.
+     * Each patient's username, name, email & phone are written to strings.
+     */
+    patient_details_t *patients = (patient_details_t *)calloc(
+        num_patients, sizeof(patient_details_t));
+    char (*strings)[4][32] = malloc(num_patients * sizeof(*strings));
+    if (patients == NULL || strings == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(patients);
+        free(strings);
+        close_database(records);
+        return NULL;
+    }
+    for (i = 0; i < num_patients; i++) {
+        patient_details_t *patient = &patients[i];
+        sprintf(strings[i][0], "patient%ld", i);
+        sprintf(strings[i][1], "Patient %ld", i);
+        sprintf(strings[i][2], "patient%ld@example.com", i);
+        sprintf(strings[i][3], "04%08ld", i);
+        patient->username = strings[i][0];
+        patient->name = strings[i][1];
+        patient->email = strings[i][2];
+        patient->phone = strings[i][3];
+        patient->password = (unsigned int)(i * 2654435761UL);
+        strcpy(patient->blood_type, i % 2 ? "A+" : "O-");
+        patient->medical_history = "None";
+        patient->weight = 60 + i % 40;
+        patient->height = 150 + i % 50;
+        patient->bmi = patient->weight /
+            (patient->height / 100 * patient->height / 100);
+    }
+    if (patient_add_batch(records, patients, num_patients) != 0) {
+        printf("[ERROR] Failed to import the patients\n");
+        free(patients);
+        free(strings);
+        close_database(records);
+        return NULL;
+    }
+    free(patients);
+    free(strings);
+
+    /* Only the serialized copy is kept */
+    unsigned char *data = database_serialize(records, size);
+    close_database(records);
+    return data;
+}
+
+/*******************************************************************************
+ * Compresses & decompresses data at a compression level.
+ * Reports the compressed size & the throughput of each.
+ *
+ * inputs:
+ * - name - The name of the level.
+ * - level - The compression level.
+ * - data - The data.
+ * - size - The size of the data.
+ * outputs:
+ * - 0 if the data round trips, otherwise 1.
+ ******************************************************************************/
+int bench_level(const char *name, int level, const unsigned char *data,
+    size_t size)
+{
+    size_t bound = compression_bound(level, size);
+    size_t compressed_size = 0;
+    size_t decompressed_size = 0;
+    int failed = 0;
+
+    unsigned char *compressed = (unsigned char *)malloc(bound);
+    unsigned char *decompressed = (unsigned char *)malloc(size);
+    if (compressed == NULL || decompressed == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(compressed);
+        free(decompressed);
+        return 1;
+    }
+
+    double start = bench_wall_seconds();
+    failed |= compression_compress(level, data, size, compressed, bound,
+        &compressed_size);
+    double compress_seconds = bench_wall_seconds() - start;
+
+    start = bench_wall_seconds();
+    failed |= compression_decompress(compressed, compressed_size,
+        decompressed, size, &decompressed_size);
+    double decompress_seconds = bench_wall_seconds() - start;
+
+    printf("%-12s %12lu bytes %6.2f%% %8.2fx  compress %8.2f MB/s  "
+        "decompress %8.2f MB/s\n", name, (unsigned long)compressed_size,
+        100.0 * compressed_size / size, (double)size / compressed_size,
+        size / (compress_seconds * 1024 * 1024),
+        size / (decompress_seconds * 1024 * 1024));
+
+    failed = failed || decompressed_size != size ||
+        memcmp(decompressed, data, size) != 0;
+    if (failed) {
+        printf("[ERROR] %s did not round trip\n", name);
+    }
+
+    free(compressed);
+    free(decompressed);
+    return failed;
+}
+
+/*******************************************************************************
+ * Measures the zero run filter on its own.
+ *
+ * inputs:
+ * - data - The data.
+ * - size - The size of the data.
+ * outputs:
+ * - 0 if the data round trips, otherwise 1.
+ ******************************************************************************/
+int bench_zero_rle(const unsigned char *data, size_t size)
+{
+    size_t bound = zero_rle_bound(size);
+    size_t filtered_size = 0;
+    size_t decoded_size = 0;
+    int failed = 0;
+
+    unsigned char *filtered = (unsigned char *)malloc(bound);
+    unsigned char *decoded = (unsigned char *)malloc(size);
+    if (filtered == NULL || decoded == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free(filtered);
+        free(decoded);
+        return 1;
+    }
+
+    double start = bench_wall_seconds();
+    failed |= zero_rle_encode(data, size, filtered, bound, &filtered_size);
+    double encode_seconds = bench_wall_seconds() - start;
+
+    start = bench_wall_seconds();
+    failed |= zero_rle_decode(filtered, filtered_size, decoded, size,
+        &decoded_size);
+    double decode_seconds = bench_wall_seconds() - start;
+
+    /* For comparison with the speed of memory */
+    start = bench_wall_seconds();
+    memcpy(decoded, data, size);
+    double copy_seconds = bench_wall_seconds() - start;
+
+    printf("%-12s %12lu bytes %6.2f%% %8.2fx  encode   %8.2f MB/s  "
+        "decode     %8.2f MB/s  memcpy %8.2f MB/s\n", "zero-rle only",
+        (unsigned long)filtered_size, 100.0 * filtered_size / size,
+        (double)size / filtered_size,
+        size / (encode_seconds * 1024 * 1024),
+        size / (decode_seconds * 1024 * 1024),
+        size / (copy_seconds * 1024 * 1024));
+
+    failed = failed || decoded_size != size;
+    if (failed) {
+        printf("[ERROR] zero-rle did not round trip\n");
+    }
+
+    free(filtered);
+    free(decoded);
+    return failed;
+}
+
+/*******************************************************************************
+ * Compares the compression levels & filters on a serialized database of
+ * generated patients: compressed size & throughput.
+ *
+ * Usage: bench_lz [number of patients]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long num_patients = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PATIENTS;
+    size_t size;
+    int failed = 0;
+
+    unsigned char *data = bench_serialize_patients(num_patients, &size);
+    if (data == NULL) {
+        printf("[ERROR] Failed to serialize the database\n");
+        return 1;
+    }
+    printf("%ld patients, %lu bytes serialized\n",
+        num_patients, (unsigned long)size);
+
+    failed |= bench_zero_rle(data, size);
+    failed |= bench_level("huffman", COMPRESSION_LEVEL_HUFFMAN, data, size);
+    failed |= bench_level("zero-rle", COMPRESSION_LEVEL_HUFFMAN |
+        COMPRESSION_FILTER_ZERO_RLE, data, size);
+    failed |= bench_level("lz", COMPRESSION_LEVEL_LZ, data, size);
+    failed |= bench_level("zero-rle+lz", COMPRESSION_LEVEL_LZ |
+        COMPRESSION_FILTER_ZERO_RLE, data, size);
+
+    free(data);
+    return failed;
+}
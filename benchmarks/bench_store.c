@@ -0,0 +1,340 @@
+/* clock_gettime() for wall-clock timing, fork() to measure each layout alone */
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include "application/database.h"
+
+/* Name of the hospital used by the benchmark */
+#define BENCH_HOSPITAL_NAME "bench_store"
+
+/* Default number of patients */
+#define BENCH_DEFAULT_PATIENTS 1000000
+
+/* Patients generated & imported at a time, so the generated patients add
+ * little to the memory measured
+ */
+#define BENCH_IMPORT_PATIENTS 4096
+
+/* Number of times each scan is repeated */
+#define BENCH_SCANS 10
+
+/* A patient as it was stored before the record slab & string pool.
+ * Every string had a fixed 256 bytes & every patient its own allocation.
+ */
+struct bench_fixed_patient {
+    char username[256];
+    char name[256];
+    char email[256];
+    char phone[256];
+    unsigned int password;
+    char blood_type[3];
+    char medical_history[256];
+    float weight;
+    float bmi;
+    float height;
+    struct bench_fixed_patient *next;
+};
+
+typedef struct bench_fixed_patient bench_fixed_patient_t;
+
+/*******************************************************************************
+ * Gets the current wall-clock time.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The time in seconds.
+ ******************************************************************************/
+double bench_wall_seconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/*******************************************************************************
+ * Gets the memory the process is using(its resident set size).
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The resident set size in bytes, or 0 if it is not known.
+ ******************************************************************************/
+double bench_rss_bytes(void)
+{
+    unsigned long size = 0;
+    unsigned long resident = 0;
+
+    FILE *statm = fopen("/proc/self/statm", "r");
+    if (statm == NULL) {
+        return 0;
+    }
+    if (fscanf(statm, "%lu %lu", &size, &resident) != 2) {
+        resident = 0;
+    }
+    fclose(statm);
+    return (double)resident * sysconf(_SC_PAGESIZE);
+}
+
+/*******************************************************************************
+ * Generates a patient like those a hospital would have. Most patients share
+ * one of a few medical histories.
+ *
+ * inputs:
+ * - patient - The patient. Its strings point into strings.
+ * - strings - Room for the patient's username, name, email & phone.
+ * - i - The number of the patient.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_make_patient(patient_details_t *patient, char strings[4][32],
+    long i)
+{
+    static const char *histories[] = {
+        "None", "None", "None", "None", "Asthma", "Penicillin allergy",
+        "Type 2 diabetes, metformin", "None"
+    };
+
+    memset(patient, 0, sizeof(*patient));
+    sprintf(strings[0], "patient%ld", i);
+    sprintf(strings[1], "Patient %ld", i);
+    sprintf(strings[2], "patient%ld@example.com", i);
+    sprintf(strings[3], "04%08ld", i);
+    patient->username = strings[0];
+    patient->name = strings[1];
+    patient->email = strings[2];
+    patient->phone = strings[3];
+    patient->password = (unsigned int)(i * 2654435761UL);
+    strcpy(patient->blood_type, i % 2 ? "A+" : "O-");
+    patient->medical_history = histories[i % 8];
+    patient->weight = 60 + i % 40;
+    patient->height = 150 + i % 50;
+    patient->bmi = patient->weight /
+        (patient->height / 100 * patient->height / 100);
+}
+
+/*******************************************************************************
+ * Prints how long a scan of every patient took.
+ *
+ * inputs:
+ * - name - The name of the scan.
+ * - num_patients - The number of patients scanned each time.
+ * - seconds - The time taken for BENCH_SCANS scans.
+ * - found - The number of patients the scan found, to check the layouts
+ *           agree.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void bench_report_scan(const char *name, long num_patients, double seconds,
+    long found)
+{
+    printf("  %-22s %8.1f M patients/s %8.2f ms per scan(%ld found)\n",
+        name, num_patients * (double)BENCH_SCANS / seconds / 1e6,
+        seconds * 1e3 / BENCH_SCANS, found);
+}
+
+/*******************************************************************************
+ * Stores patients as they were before the record slab & string pool, then
+ * measures the memory used & how fast they are scanned.
+ *
+ * inputs:
+ * - num_patients - The number of patients.
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated.
+ ******************************************************************************/
+int bench_fixed_layout(long num_patients)
+{
+    bench_fixed_patient_t *patients = NULL;
+    bench_fixed_patient_t *last = NULL;
+    bench_fixed_patient_t *patient;
+    patient_details_t generated;
+    char strings[4][32];
+    long found = 0;
+    long i;
+    int scan;
+
+    double rss = bench_rss_bytes();
+    for (i = 0; i < num_patients; i++) {
+        bench_make_patient(&generated, strings, i);
+        patient = (bench_fixed_patient_t *)calloc(1,
+            sizeof(bench_fixed_patient_t));
+        if (patient == NULL) {
+            printf("[ERROR] Failed to allocate memory\n");
+            return 1;
+        }
+        strcpy(patient->username, generated.username);
+        strcpy(patient->name, generated.name);
+        strcpy(patient->email, generated.email);
+        strcpy(patient->phone, generated.phone);
+        patient->password = generated.password;
+        memcpy(patient->blood_type, generated.blood_type, 3);
+        strcpy(patient->medical_history, generated.medical_history);
+        patient->weight = generated.weight;
+        patient->height = generated.height;
+        patient->bmi = generated.bmi;
+
+        if (last == NULL) {
+            patients = patient;
+        } else {
+            last->next = patient;
+        }
+        last = patient;
+    }
+    rss = bench_rss_bytes() - rss;
+    printf("fixed 256 byte fields, %lu bytes per patient\n",
+        (unsigned long)sizeof(bench_fixed_patient_t));
+    printf("  %-22s %8.1f MiB per million patients\n", "memory",
+        rss / num_patients * 1e6 / (1024 * 1024));
+
+    /* Searching for a username that is not there reads every patient */
+    double start = bench_wall_seconds();
+    for (scan = 0; scan < BENCH_SCANS; scan++) {
+        found = 0;
+        for (patient = patients; patient != NULL; patient = patient->next) {
+            found += strcmp(patient->username, "nobody") == 0;
+        }
+    }
+    bench_report_scan("scan usernames", num_patients,
+        bench_wall_seconds() - start, found);
+
+    /* Medical histories are away from the usernames in both layouts */
+    start = bench_wall_seconds();
+    for (scan = 0; scan < BENCH_SCANS; scan++) {
+        found = 0;
+        for (patient = patients; patient != NULL; patient = patient->next) {
+            found += strcmp(patient->medical_history, "Asthma") == 0;
+        }
+    }
+    bench_report_scan("scan medical history", num_patients,
+        bench_wall_seconds() - start, found);
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Stores patients in the record slab & string pool, then measures the
+ * memory used & how fast they are scanned.
+ *
+ * inputs:
+ * - num_patients - The number of patients.
+ * outputs:
+ * - 0 on success, 1 if the patients could not be imported.
+ ******************************************************************************/
+int bench_slab_layout(long num_patients)
+{
+    patient_details_t *generated = (patient_details_t *)malloc(
+        BENCH_IMPORT_PATIENTS * sizeof(patient_details_t));
+    char (*strings)[4][32] = malloc(BENCH_IMPORT_PATIENTS * sizeof(*strings));
+    patient_details_t *patient;
+    long found = 0;
+    long i, j;
+    int scan;
+
+    remove(BENCH_HOSPITAL_NAME "_encrypted.db");
+    hospital_record_t *records = load_database(BENCH_HOSPITAL_NAME);
+    if (generated == NULL || strings == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    double rss = bench_rss_bytes();
+    for (i = 0; i < num_patients; i += BENCH_IMPORT_PATIENTS) {
+        long count = num_patients - i < BENCH_IMPORT_PATIENTS ?
+            num_patients - i : BENCH_IMPORT_PATIENTS;
+        for (j = 0; j < count; j++) {
+            bench_make_patient(&generated[j], strings[j], i + j);
+        }
+        if (patient_add_batch(records, generated, count) != 0) {
+            printf("[ERROR] Failed to import the patients\n");
+            return 1;
+        }
+    }
+    rss = bench_rss_bytes() - rss;
+    printf("record slab & string pool, %lu bytes per patient\n",
+        (unsigned long)sizeof(patient_details_t));
+    printf("  %-22s %8.1f MiB per million patients(with the index)\n",
+        "memory", rss / num_patients * 1e6 / (1024 * 1024));
+
+    double start = bench_wall_seconds();
+    for (scan = 0; scan < BENCH_SCANS; scan++) {
+        found = 0;
+        for (patient = records->patients; patient != NULL;
+            patient = patient->next) {
+            found += strcmp(patient->username, "nobody") == 0;
+        }
+    }
+    bench_report_scan("scan usernames", num_patients,
+        bench_wall_seconds() - start, found);
+
+    start = bench_wall_seconds();
+    for (scan = 0; scan < BENCH_SCANS; scan++) {
+        found = 0;
+        for (patient = records->patients; patient != NULL;
+            patient = patient->next) {
+            found += strcmp(patient->medical_history, "Asthma") == 0;
+        }
+    }
+    bench_report_scan("scan medical history", num_patients,
+        bench_wall_seconds() - start, found);
+
+    free(generated);
+    free(strings);
+    close_database(records);
+    return 0;
+}
+
+/*******************************************************************************
+ * Runs a layout in a child process, so the memory it measures is not
+ * mixed with memory the other layout used.
+ *
+ * inputs:
+ * - layout - The layout to run.
+ * - num_patients - The number of patients.
+ * outputs:
+ * - 0 if the layout succeeded, otherwise 1.
+ ******************************************************************************/
+int bench_run_alone(int (*layout)(long), long num_patients)
+{
+    int status;
+
+    fflush(stdout);
+    pid_t child = fork();
+    if (child < 0) {
+        return layout(num_patients);
+    }
+    if (child == 0) {
+        exit(layout(num_patients));
+    }
+    if (waitpid(child, &status, 0) != child || !WIFEXITED(status)) {
+        return 1;
+    }
+    return WEXITSTATUS(status);
+}
+
+/*******************************************************************************
+ * Compares the memory used & scan speed of patients with fixed size fields
+ * in separate allocations against the record slab & string pool.
+ *
+ * Usage: bench_store [number of patients]
+ ******************************************************************************/
+int main(int argc, char **argv)
+{
+    long num_patients = argc > 1 ? atol(argv[1]) : BENCH_DEFAULT_PATIENTS;
+    int failed = 0;
+
+    if (num_patients <= 0) {
+        printf("[ERROR] Need at least 1 patient\n");
+        return 1;
+    }
+
+    failed |= bench_run_alone(bench_fixed_layout, num_patients);
+    failed |= bench_run_alone(bench_slab_layout, num_patients);
+    return failed;
+}
@@ -1,9 +1,28 @@
 #ifndef APPLICATION_DATABASE_H
 #define APPLICATION_DATABASE_H
 
+#include <stddef.h>
 
 #include "application/users/patient.h"
 #include "application/users/doctor.h"
+#include "application/index.h"
+#include "application/store.h"
+#include "application/database_file.h"
+#include "application/database_log.h"
+#include "compression/compression.h"
+
+/* Compression used when the database is saved.
+ * Zeros padding the fixed size fields are removed before Huffman coding.
+ */
+#define DATABASE_DEFAULT_COMPRESSION_LEVEL \
+    (COMPRESSION_LEVEL_HUFFMAN | COMPRESSION_FILTER_ZERO_RLE)
+
+/* Size of a doctor in the serialized database */
+#define DATABASE_DOCTOR_SIZE (256 * 4 + sizeof(unsigned int) + 256 * 2)
+
+/* Size of a patient in the serialized database */
+#define DATABASE_PATIENT_SIZE \
+    (256 * 4 + sizeof(unsigned int) + 3 + 256 + 3 * sizeof(float))
 
 /* Bed details */
 struct bed_details {
@@ -26,11 +45,35 @@ struct hospital_record {
     /* Doctors */
     doctor_details_t *doctors;
 
+    /* Last patient & doctor, so adding to the lists takes the same time
+     * however long they are. NULL when the list is empty.
+     */
+    patient_details_t *patients_tail;
+    doctor_details_t *doctors_tail;
+
     /* Number of patients */
     int num_patients;
     /* Number of doctors */
     int num_doctors;
 
+    /* Patients & doctors by username */
+    username_index_t patient_index;
+    username_index_t doctor_index;
+
+    /* Memory for the patients, the doctors & their strings */
+    record_slab_t patient_slab;
+    record_slab_t doctor_slab;
+    string_pool_t strings;
+
+    /* The database file records are read from when first used. While it is
+     * open the lists only hold the records added since it was opened.
+     * NULL once every record has been read.
+     */
+    database_file_t *file;
+
+    /* Changes made since the database file was written */
+    database_log_t log;
+
     /* Beds */
     bed_details_t *beds;
 
@@ -53,6 +96,9 @@ hospital_record_t *load_database(const char *hospital_name);
 
 /*******************************************************************************
  * Save the database.
+ * Every record is written to the database file & the logs are removed.
+ * Changes made through the menus are logged instead, so this is only needed
+ * to write the database file straight away.
  * 
  * inputs:
  * - hospital_name - The name of the hospital.
@@ -60,6 +106,129 @@ hospital_record_t *load_database(const char *hospital_name);
  ******************************************************************************/
 void save_database(hospital_record_t *records);
 
+/*******************************************************************************
+ * Writes every record to a new database file, which then replaces the old
+ * one. The logs are left as they are.
+ *
+ * inputs:
+ * - records - The database.
+ * - checkpoint - The number of the new database file.
+ * outputs:
+ * - 0 on success, 1 on failure. The old database file is kept on failure.
+ ******************************************************************************/
+int database_write_checkpoint(hospital_record_t *records, size_t checkpoint);
+
+/*******************************************************************************
+ * Sets the compression level used when databases are saved.
+ * Databases saved at any level can be loaded.
+ *
+ * inputs:
+ * - level - A compression level, plus any COMPRESSION_FILTER_ flags.
+ * outputs:
+ * - 0 if the level is now in use, 1 if it is unknown.
+ ******************************************************************************/
+int database_set_compression_level(int level);
+
+/*******************************************************************************
+ * Serializes the database into memory.
+ * This is the data that is compressed & encrypted when the database is saved.
+ * 
+ * inputs:
+ * - records - The database.
+ * - size - Set to the size of the serialized database.
+ * outputs:
+ * - The serialized database(must be freed) or NULL on failure.
+ ******************************************************************************/
+unsigned char *database_serialize(hospital_record_t *records, size_t *size);
+
+/*******************************************************************************
+ * Reads a serialized database into the database.
+ * 
+ * inputs:
+ * - records - The database. Must be empty.
+ * - data - The serialized database.
+ * - size - The size of the serialized database.
+ * outputs:
+ * - 0 on success, 1 if the serialized database is invalid.
+ ******************************************************************************/
+int database_deserialize(hospital_record_t *records, const unsigned char *data,
+    size_t size);
+
+/*******************************************************************************
+ * Serializes a doctor.
+ *
+ * inputs:
+ * - position - Where to write DATABASE_DOCTOR_SIZE bytes. Moved past them.
+ * - doctor - The doctor.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void database_write_doctor(unsigned char **position,
+    const doctor_details_t *doctor);
+
+/*******************************************************************************
+ * Serializes a patient.
+ *
+ * inputs:
+ * - position - Where to write DATABASE_PATIENT_SIZE bytes. Moved past them.
+ * - patient - The patient.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void database_write_patient(unsigned char **position,
+    const patient_details_t *patient);
+
+/*******************************************************************************
+ * Copies a serialized doctor into the records.
+ * The doctor is not added to the list or the index.
+ *
+ * inputs:
+ * - records - The database.
+ * - position - DATABASE_DOCTOR_SIZE bytes to read. Moved past them.
+ * outputs:
+ * - The doctor, or NULL if memory could not be allocated.
+ ******************************************************************************/
+doctor_details_t *database_read_doctor(hospital_record_t *records,
+    const unsigned char **position);
+
+/*******************************************************************************
+ * Copies a serialized patient into the records.
+ * The patient is not added to the list or the index.
+ *
+ * inputs:
+ * - records - The database.
+ * - position - DATABASE_PATIENT_SIZE bytes to read. Moved past them.
+ * outputs:
+ * - The patient, or NULL if memory could not be allocated.
+ ******************************************************************************/
+patient_details_t *database_read_patient(hospital_record_t *records,
+    const unsigned char **position);
+
+/*******************************************************************************
+ * Reads every record not yet read from the database file into the lists.
+ * Needed before walking the lists, since records are only read from the
+ * database file when first used.
+ *
+ * inputs:
+ * - records - The database.
+ * outputs:
+ * - None. Exits if the database file is corrupt.
+ ******************************************************************************/
+void database_load_all(hospital_record_t *records);
+
+/*******************************************************************************
+ * Rebuilds the username indexes & finds the last patient & doctor again.
+ * Only needed after the lists are changed directly rather than through the
+ * signup, import & delete functions.
+ * 
+ * inputs:
+ * - records - The database.
+ * outputs:
+ * - 0 on success, 1 if a username is used twice or memory could not be
+ *   allocated.
+ ******************************************************************************/
+int database_rebuild_indexes(hospital_record_t *records);
+
 /*******************************************************************************
  * Close the database.
  * Should be called before closing to free memory allocated for the database.
@@ -0,0 +1,269 @@
+#ifndef APPLICATION_DATABASE_FILE_H
+#define APPLICATION_DATABASE_FILE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "application/users/patient.h"
+#include "application/users/doctor.h"
+
+/* First bytes of a paged database file */
+#define DATABASE_FILE_MAGIC "HDBF"
+
+/* Version of the paged database file format */
+#define DATABASE_FILE_VERSION 1
+
+/* The header, the pages & the table each start at a multiple of this */
+#define DATABASE_FILE_ALIGNMENT 4096
+
+/* Most bytes of records in a page before it is compressed */
+#define DATABASE_FILE_PAGE_SIZE (64 * 1024)
+
+/* Bytes of the header that are used. The rest of the first
+ * DATABASE_FILE_ALIGNMENT bytes are zero.
+ */
+#define DATABASE_FILE_HEADER_SIZE 80
+
+/* Bytes of the header authenticated with the table(all but the table tag) */
+#define DATABASE_FILE_HEADER_AAD_SIZE 64
+
+/* Bytes describing each page in the table */
+#define DATABASE_FILE_PAGE_ENTRY_SIZE 28
+
+/* Bytes of each entry in the username lookups */
+#define DATABASE_FILE_LOOKUP_ENTRY_SIZE 8
+
+/* A page of records, compressed & encrypted on its own */
+struct database_file_page {
+
+    /* Where the page starts in the file */
+    size_t offset;
+
+    /* Size of the page in the file */
+    size_t stored_size;
+
+    /* The page's AES-GCM tag */
+    unsigned char tag[16];
+};
+
+typedef struct database_file_page database_file_page_t;
+
+/* Finds the record holding a username without reading the records.
+ * Sorted by hash, so all records whose usernames share a hash are together.
+ */
+struct database_file_lookup {
+
+    /* Hash of the username, from username_index_hash() */
+    unsigned int hash;
+
+    /* Number of the doctor or patient in the file */
+    unsigned int record;
+};
+
+typedef struct database_file_lookup database_file_lookup_t;
+
+/* An open paged database file.
+ * The file is mapped into memory(read into memory without DATABASE_POSIX).
+ * Opening only checks the header & the table. A record is read, by
+ * decrypting & decompressing its page, the first time it is used.
+ */
+struct database_file {
+
+    /* The mapped file */
+    unsigned char *map;
+    size_t map_size;
+
+    /* Key the pages are encrypted with */
+    unsigned char key[32];
+    int key_size;
+
+    /* Random bytes starting every nonce used by the file. The page number
+     * makes up the rest.
+     */
+    unsigned char salt[8];
+
+    /* Number of the file, from the checkpoint that wrote it */
+    size_t checkpoint;
+
+    /* Number of doctors & patients in the file */
+    size_t num_doctors;
+    size_t num_patients;
+
+    /* Records in every page but the last of each kind */
+    size_t doctors_per_page;
+    size_t patients_per_page;
+
+    /* The pages. Doctors' pages come first. */
+    database_file_page_t *pages;
+    size_t num_doctor_pages;
+    size_t num_pages;
+
+    /* Records by username hash */
+    database_file_lookup_t *doctor_lookup;
+    database_file_lookup_t *patient_lookup;
+
+    /* Records read so far, by number. NULL until read. */
+    doctor_details_t **doctors;
+    patient_details_t **patients;
+
+    /* The last page read, decrypted & decompressed */
+    unsigned char *page;
+    size_t page_number;
+
+    /* Space to decrypt a page into before decompressing it */
+    unsigned char *stored_page;
+};
+
+typedef struct database_file database_file_t;
+
+/*******************************************************************************
+ * Stores a number in 4 bytes, least significant first.
+ *
+ * inputs:
+ * - bytes - Where to store the number
+ * - value - The number. Must fit in 32 bits.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_put32(unsigned char *bytes, size_t value);
+
+/*******************************************************************************
+ * Reads a number stored by database_file_put32().
+ *
+ * inputs:
+ * - bytes - The stored number
+ * outputs:
+ * - The number
+ ******************************************************************************/
+size_t database_file_get32(const unsigned char *bytes);
+
+/*******************************************************************************
+ * Writes what is buffered for a file to disk.
+ * Without DATABASE_POSIX it is only handed to the system.
+ *
+ * inputs:
+ * - file - The file
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_sync(FILE *file);
+
+/*******************************************************************************
+ * Writes the directory holding a file to disk, so a file that was just
+ * created or renamed is still there after a crash.
+ * Does nothing without DATABASE_POSIX.
+ *
+ * inputs:
+ * - filename - The file
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_sync_directory(const char *filename);
+
+/*******************************************************************************
+ * Replaces a file with another.
+ * rename() only replaces a file that exists on POSIX systems, so without
+ * DATABASE_POSIX the file is removed first.
+ *
+ * inputs:
+ * - from - The new file
+ * - to - The file to replace. Need not exist.
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_replace(const char *from, const char *to);
+
+/*******************************************************************************
+ * Checks whether a file is a paged database file.
+ *
+ * inputs:
+ * - filename - The file
+ * outputs:
+ * - 1 if the file starts with DATABASE_FILE_MAGIC, otherwise 0
+ ******************************************************************************/
+int database_file_is_paged(const char *filename);
+
+/*******************************************************************************
+ * Writes every patient & doctor in the lists to a paged database file.
+ * Records are written in list order, packed into pages that are compressed
+ * & encrypted one by one.
+ *
+ * inputs:
+ * - records - The hospital records. Every record must be in the lists.
+ * - filename - The file to write
+ * - level - The compression level for the pages
+ * - key - The key to encrypt with
+ * - key_size - The size of the key
+ * - checkpoint - The number of the file
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_write(hospital_record_t *records, const char *filename,
+    int level, const unsigned char *key, int key_size, size_t checkpoint);
+
+/*******************************************************************************
+ * Opens a paged database file.
+ * Only the header & the table are read & checked. Records are read when
+ * they are used.
+ *
+ * inputs:
+ * - filename - The file
+ * - key - The key the file was encrypted with
+ * - key_size - The size of the key
+ * outputs:
+ * - The open file, or NULL if it could not be opened or is corrupt
+ ******************************************************************************/
+database_file_t *database_file_open(const char *filename,
+    const unsigned char *key, int key_size);
+
+/*******************************************************************************
+ * Finds a doctor in the database file that has not been read yet.
+ * The doctor is copied into the records & indexed.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * - username - The username to find
+ * - doctor - Set to the doctor, or NULL if no unread doctor has the username
+ * outputs:
+ * - 0 on success, 1 if a page is corrupt or memory could not be allocated
+ ******************************************************************************/
+int database_file_find_doctor(hospital_record_t *records,
+    const char *username, doctor_details_t **doctor);
+
+/*******************************************************************************
+ * Finds a patient in the database file that has not been read yet.
+ * The patient is copied into the records & indexed.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * - username - The username to find
+ * - patient - Set to the patient, or NULL if no unread patient has the username
+ * outputs:
+ * - 0 on success, 1 if a page is corrupt or memory could not be allocated
+ ******************************************************************************/
+int database_file_find_patient(hospital_record_t *records,
+    const char *username, patient_details_t **patient);
+
+/*******************************************************************************
+ * Reads every record left in the database file, then closes it.
+ * The file's records go before the records added since it was opened, in
+ * the order they were saved.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * outputs:
+ * - 0 on success, 1 if a page is corrupt
+ ******************************************************************************/
+int database_file_load_all(hospital_record_t *records);
+
+/*******************************************************************************
+ * Closes a database file. Records already read are not freed.
+ *
+ * inputs:
+ * - file - The file
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_close(database_file_t *file);
+
+#endif
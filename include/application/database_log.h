@@ -0,0 +1,181 @@
+#ifndef APPLICATION_DATABASE_LOG_H
+#define APPLICATION_DATABASE_LOG_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "application/users/patient.h"
+#include "application/users/doctor.h"
+
+/* First bytes of a database log */
+#define DATABASE_LOG_MAGIC "HLOG"
+
+/* Version of the database log format */
+#define DATABASE_LOG_VERSION 1
+
+/* Bytes before the first entry of a log */
+#define DATABASE_LOG_HEADER_SIZE 24
+
+/* Bytes before each entry's encrypted change(its size & number) */
+#define DATABASE_LOG_ENTRY_HEADER_SIZE 8
+
+/* Once a log is this large its changes are written to the database file */
+#define DATABASE_LOG_CHECKPOINT_SIZE (4 * 1024 * 1024)
+
+/* Kinds of change in a log */
+#define DATABASE_LOG_PATIENT 1
+#define DATABASE_LOG_DELETE_PATIENT 2
+#define DATABASE_LOG_DOCTOR 3
+
+/* Changes made since the database file was written, appended one at a time.
+ * Each change is encrypted & authenticated on its own, then synced to disk,
+ * so changing a record takes the same time however large the database is.
+ * Logs are replayed when the database is loaded.
+ *
+ * The database file & each log are numbered. A log holds the changes made
+ * after the database file with its number. While a checkpoint writes the
+ * next database file, the log it writes is kept as the old log & new
+ * changes go to a new log.
+ */
+struct database_log {
+
+    /* The log & the log being written to the database file */
+    char name[272];
+    char old_name[276];
+
+    /* The log, open for appending. NULL until the next change. */
+    FILE *file;
+
+    /* Size of the log, or 0 if there is no log */
+    size_t size;
+
+    /* Number of the database file the log follows */
+    size_t checkpoint;
+
+    /* Entries in the log */
+    size_t sequence;
+
+    /* Random bytes starting the nonce of every entry. The entry's number
+     * makes up the rest.
+     */
+    unsigned char salt[8];
+
+    /* Key the entries are encrypted with */
+    unsigned char key[32];
+    int key_size;
+
+    /* Process writing a checkpoint in the background, or 0 if none */
+    long checkpoint_process;
+};
+
+typedef struct database_log database_log_t;
+
+/*******************************************************************************
+ * Initializes the log of a hospital. No file is opened.
+ *
+ * inputs:
+ * - log - The log
+ * - hospital_name - The name of the hospital
+ * - key - The key to encrypt with
+ * - key_size - The size of the key
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_init(database_log_t *log, const char *hospital_name,
+    const unsigned char *key, int key_size);
+
+/*******************************************************************************
+ * Replays the logs that follow the database file.
+ * Logs older than the database file are removed. A damaged entry ends the
+ * log, since it is what a crash while appending leaves behind. The changes
+ * before it are then saved & a new log started, so no nonce is reused.
+ *
+ * inputs:
+ * - records - The hospital records, loaded from the database file
+ * - checkpoint - The number of the database file
+ * outputs:
+ * - 0 on success, 1 if a log does not follow the database file
+ ******************************************************************************/
+int database_log_replay(hospital_record_t *records, size_t checkpoint);
+
+/*******************************************************************************
+ * Logs a patient that was added or changed.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The patient's username before the change
+ * - patient - The patient
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_patient(hospital_record_t *records, const char *username,
+    const patient_details_t *patient);
+
+/*******************************************************************************
+ * Logs a patient that was deleted.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The patient's username
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_delete_patient(hospital_record_t *records,
+    const char *username);
+
+/*******************************************************************************
+ * Logs a doctor that was added or changed.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The doctor's username before the change
+ * - doctor - The doctor
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_doctor(hospital_record_t *records, const char *username,
+    const doctor_details_t *doctor);
+
+/*******************************************************************************
+ * Writes the logged changes to the database file in a background process.
+ * Does nothing if nothing is logged or a checkpoint is already running.
+ *
+ * inputs:
+ * - records - The hospital records
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_checkpoint(hospital_record_t *records);
+
+/*******************************************************************************
+ * Waits for a checkpoint running in the background to finish.
+ *
+ * inputs:
+ * - records - The hospital records
+ * outputs:
+ * - 0 if no checkpoint failed, 1 if one failed
+ ******************************************************************************/
+int database_log_wait(hospital_record_t *records);
+
+/*******************************************************************************
+ * Removes the logs once every change is in the database file.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - checkpoint - The number of the database file just written
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_reset(hospital_record_t *records, size_t checkpoint);
+
+/*******************************************************************************
+ * Closes the log, waiting for any checkpoint. The log is kept.
+ *
+ * inputs:
+ * - records - The hospital records
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_close(hospital_record_t *records);
+
+#endif
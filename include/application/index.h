@@ -0,0 +1,120 @@
+#ifndef APPLICATION_INDEX_H
+#define APPLICATION_INDEX_H
+
+#include <stddef.h>
+
+/* Slot in a username index */
+struct username_index_entry {
+
+    /* Hash of the username */
+    unsigned int hash;
+
+    /* Username of the user. Points into the user, so is not copied. */
+    /* NULL if the slot is empty */
+    const char *username;
+
+    /* The user(a patient or a doctor) */
+    void *user;
+};
+
+typedef struct username_index_entry username_index_entry_t;
+
+/* Finds users by username.
+ * Open addressing with linear probing. Removed entries are filled by
+ * shifting later entries back, so no slots are left marked as deleted.
+ */
+struct username_index {
+
+    /* The slots. A power of 2 in number, or NULL while empty. */
+    username_index_entry_t *entries;
+
+    /* Number of slots */
+    size_t capacity;
+
+    /* Number of users */
+    size_t count;
+};
+
+typedef struct username_index username_index_t;
+
+/*******************************************************************************
+ * Hashes a username with 32-bit FNV-1a.
+ * Saved database files store this hash, so it must not change.
+ *
+ * inputs:
+ * - username - The username
+ * outputs:
+ * - The hash
+ ******************************************************************************/
+unsigned int username_index_hash(const char *username);
+
+/*******************************************************************************
+ * Initializes an empty username index.
+ * 
+ * inputs:
+ * - index - The index
+ * outputs:
+ * - none
+ ******************************************************************************/
+void username_index_init(username_index_t *index);
+
+/*******************************************************************************
+ * Makes room for a number of users, so adding them never grows the index.
+ * 
+ * inputs:
+ * - index - The index
+ * - count - The number of users the index should hold
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated
+ ******************************************************************************/
+int username_index_reserve(username_index_t *index, size_t count);
+
+/*******************************************************************************
+ * Adds a user to the index.
+ * The username is not copied, so must not change while the user is in the
+ * index. Remove the user first & add it again after.
+ * 
+ * inputs:
+ * - index - The index
+ * - username - The username of the user
+ * - user - The user
+ * outputs:
+ * - 0 on success, 1 if the username is already used or memory could not be
+ *   allocated
+ ******************************************************************************/
+int username_index_insert(username_index_t *index, const char *username,
+    void *user);
+
+/*******************************************************************************
+ * Finds a user by username.
+ * 
+ * inputs:
+ * - index - The index
+ * - username - The username to find
+ * outputs:
+ * - The user if found, otherwise NULL
+ ******************************************************************************/
+void *username_index_find(const username_index_t *index, const char *username);
+
+/*******************************************************************************
+ * Removes a user from the index.
+ * 
+ * inputs:
+ * - index - The index
+ * - username - The username of the user to remove
+ * outputs:
+ * - The removed user if found, otherwise NULL
+ ******************************************************************************/
+void *username_index_remove(username_index_t *index, const char *username);
+
+/*******************************************************************************
+ * Frees the memory used by the index. The users are not freed.
+ * 
+ * inputs:
+ * - index - The index
+ * outputs:
+ * - none
+ ******************************************************************************/
+void username_index_free(username_index_t *index);
+
+#endif
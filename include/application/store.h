@@ -0,0 +1,141 @@
+#ifndef APPLICATION_STORE_H
+#define APPLICATION_STORE_H
+
+#include <stddef.h>
+
+#include "application/index.h"
+
+/* Records in each block of a record slab */
+#define RECORD_SLAB_BLOCK_RECORDS 1024
+
+/* Bytes in each block of a string pool */
+#define STRING_POOL_BLOCK_SIZE (64 * 1024)
+
+/* Hands out records of one size from large blocks.
+ * Records are next to each other in memory rather than scattered around the
+ * heap, & cost no allocator overhead each. Released records are reused by
+ * later records. The blocks are only freed when the slab is.
+ */
+struct record_slab {
+
+    /* Size of each record, rounded up to a multiple of a pointer */
+    size_t record_size;
+
+    /* Blocks, newest first. NULL while empty. */
+    void *blocks;
+
+    /* Records handed out from the newest block */
+    size_t used;
+
+    /* Released records, linked through their first bytes */
+    void *free_records;
+};
+
+typedef struct record_slab record_slab_t;
+
+/* Holds the strings of the records, each with only as many bytes as it needs.
+ * Strings are copied into large blocks & never change. Strings that many
+ * records share(such as a medical history of "None") can be interned so
+ * they are only stored once. Nothing is freed until the pool is.
+ */
+struct string_pool {
+
+    /* Blocks, newest first. NULL while empty. */
+    void *blocks;
+
+    /* Bytes free at the end of the newest block */
+    size_t available;
+
+    /* Interned strings. The username index works for any string. */
+    username_index_t interned;
+};
+
+typedef struct string_pool string_pool_t;
+
+/*******************************************************************************
+ * Initializes an empty record slab.
+ *
+ * inputs:
+ * - slab - The slab
+ * - record_size - The size of each record
+ * outputs:
+ * - none
+ ******************************************************************************/
+void record_slab_init(record_slab_t *slab, size_t record_size);
+
+/*******************************************************************************
+ * Gets memory for a record, set to zero.
+ *
+ * inputs:
+ * - slab - The slab
+ * outputs:
+ * - The record, or NULL if memory could not be allocated
+ ******************************************************************************/
+void *record_slab_alloc(record_slab_t *slab);
+
+/*******************************************************************************
+ * Gives a record back to the slab to be reused.
+ *
+ * inputs:
+ * - slab - The slab
+ * - record - A record from record_slab_alloc()
+ * outputs:
+ * - none
+ ******************************************************************************/
+void record_slab_release(record_slab_t *slab, void *record);
+
+/*******************************************************************************
+ * Frees every record in the slab.
+ *
+ * inputs:
+ * - slab - The slab
+ * outputs:
+ * - none
+ ******************************************************************************/
+void record_slab_free(record_slab_t *slab);
+
+/*******************************************************************************
+ * Initializes an empty string pool.
+ *
+ * inputs:
+ * - pool - The pool
+ * outputs:
+ * - none
+ ******************************************************************************/
+void string_pool_init(string_pool_t *pool);
+
+/*******************************************************************************
+ * Copies a string into the pool.
+ *
+ * inputs:
+ * - pool - The pool
+ * - string - The string. NULL is copied as an empty string.
+ * outputs:
+ * - The copy, or NULL if memory could not be allocated
+ ******************************************************************************/
+const char *string_pool_copy(string_pool_t *pool, const char *string);
+
+/*******************************************************************************
+ * Copies a string into the pool unless an equal string was interned before.
+ * Only worth it for strings that are often repeated, since each interned
+ * string also takes a slot in a hash table.
+ *
+ * inputs:
+ * - pool - The pool
+ * - string - The string. NULL is interned as an empty string.
+ * outputs:
+ * - The interned string, or NULL if memory could not be allocated
+ ******************************************************************************/
+const char *string_pool_intern(string_pool_t *pool, const char *string);
+
+/*******************************************************************************
+ * Frees every string in the pool.
+ *
+ * inputs:
+ * - pool - The pool
+ * outputs:
+ * - none
+ ******************************************************************************/
+void string_pool_free(string_pool_t *pool);
+
+#endif
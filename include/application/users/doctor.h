@@ -1,46 +1,115 @@
 #ifndef APPLICATION_USERS_DOCTOR_H
 #define APPLICATION_USERS_DOCTOR_H
 
+#include <stddef.h>
+
 typedef struct hospital_record hospital_record_t;
 
+/* Fields used when searching the list & logging in come first. The strings
+ * are stored in the database's string pool rather than in the doctor.
+ */
 struct doctor_details {
     /* ID */
-    char username[256];
+    const char *username;
+
+    /* Hashed password */
+    unsigned int password;
+
+    /* Next doctor */
+    /* Needed for linked list */
+    struct doctor_details *next;
     
     /* Name */
-    char name[256];
+    const char *name;
     
     /* Email */
-    char email[256];
+    const char *email;
 
     /* Phone */
-    char phone[256];
-
-    /* Hashed password */
-    unsigned int password;
+    const char *phone;
 
     /* Specialization */
-    char specialization[256];
+    const char *specialization;
     
     /* License number */
-    char license_number[256];
-
-    /* Next doctor */
-    /* Needed for linked list */
-    struct doctor_details *next;
+    const char *license_number;
 };
 
 typedef struct doctor_details doctor_details_t;
 /*******************************************************************************
- * Silently adds a new doctor to the hospital records.
+ * Copies a doctor & its strings into the memory of the hospital records.
+ * The copy is not added to the list or the index.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - doctor - The doctor to copy. NULL strings are copied as empty strings.
+ * outputs:
+ * - The copy, or NULL if memory could not be allocated
+ ******************************************************************************/
+doctor_details_t *doctor_copy(hospital_record_t *records,
+    const doctor_details_t *doctor);
+
+/*******************************************************************************
+ * Adds a new doctor to the hospital records in memory.
+ * The doctor is copied, so the caller keeps ownership of it & its strings.
  * 
  * inputs:
  * - records - The hospital records
  * - doctor - The doctor to add
  * outputs:
- * - none
+ * - The doctor in the records, or NULL if memory could not be allocated.
+ *   Nothing is logged or saved; the caller must do so to keep the doctor.
+ ******************************************************************************/
+doctor_details_t *doctor_add(hospital_record_t *records,
+    const doctor_details_t *doctor);
+
+/*******************************************************************************
+ * Silently adds a new doctor to the hospital records & logs it.
+ * The doctor is copied, so the caller keeps ownership of it & its strings.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - doctor - The doctor to add
+ * outputs:
+ * - The doctor in the records, or NULL if memory could not be allocated.
+ *   The doctor is logged, so it is kept once this returns. Exits if the
+ *   log cannot be written.
+ ******************************************************************************/
+doctor_details_t *doctor_signup_silent(hospital_record_t *records,
+    const doctor_details_t *doctor);
+
+/*******************************************************************************
+ * Adds many doctors to the hospital records at once, in memory.
+ * Either every doctor is added or none are. The doctors are copied.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - doctors - The doctors to add, in order
+ * - num_doctors - The number of doctors
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. Nothing is logged or
+ *   saved; the caller must do so to keep the doctors.
+ ******************************************************************************/
+int doctor_add_batch(hospital_record_t *records,
+    const doctor_details_t *doctors, size_t num_doctors);
+
+/*******************************************************************************
+ * Adds many doctors to the hospital records at once & saves the database.
+ * Either every doctor is added or none are. The doctors are copied.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - doctors - The doctors to add, in order
+ * - num_doctors - The number of doctors
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. On success the doctors
+ *   are saved, so they are kept once this returns. Exits if the database
+ *   cannot be saved.
  ******************************************************************************/
-void doctor_signup_silent(hospital_record_t *records, doctor_details_t *doctor);
+int doctor_import_batch(hospital_record_t *records,
+    const doctor_details_t *doctors, size_t num_doctors);
 
 /*******************************************************************************
  * Interactively adds a new doctor to the hospital records.
@@ -59,7 +128,8 @@ void doctor_signup(hospital_record_t *records);
  * - records - The hospital records
  * - user_id - The ID of the doctor to find
  * outputs:
- * - The doctor if found, otherwise NULL
+ * - The doctor if found, otherwise NULL. Exits if the database file is
+ *   corrupt.
  ******************************************************************************/
 doctor_details_t *find_doctor(hospital_record_t *records, char *user_id);
 
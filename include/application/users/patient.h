@@ -1,29 +1,40 @@
 #ifndef APPLICATION_USERS_PATIENT_H
 #define APPLICATION_USERS_PATIENT_H
 
+#include <stddef.h>
+
 typedef struct hospital_record hospital_record_t;
 
+/* Fields used when searching the list & logging in come first, so a scan
+ * reads little more than one cache line of each patient. The strings are
+ * stored in the database's string pool rather than in the patient.
+ */
 struct patient_details {
 
     /* Username */
-    char username[256];
+    const char *username;
+
+    /* Hashed password */
+    unsigned int password;
+
+    /* Blood type. Room for "AB+" & the null terminator. */
+    char blood_type[4];
+
+    /* Next patient */
+    /* Needed for linked list */
+    struct patient_details *next;
     
     /* Name */
-    char name[256];
+    const char *name;
     
     /* Email */
-    char email[256];
+    const char *email;
 
     /* Phone */
-    char phone[256];
-
-    /* Hashed password */
-    unsigned int password;
+    const char *phone;
 
-    /* Blood type */
-    char blood_type[3];
     /* Medical history(includes allergies and medications) */
-    char medical_history[256];
+    const char *medical_history;
     /* Weight */
     float weight;
     /* BMI */
@@ -31,26 +42,95 @@ struct patient_details {
     
     /* Height */
     float height;
-
-    /* Next patient */
-    /* Needed for linked list */
-    struct patient_details *next;
 };
 
 typedef struct patient_details patient_details_t;
 
 /*******************************************************************************
- * Silently adds a new patient to the hospital records.
+ * Copies a patient & its strings into the memory of the hospital records.
+ * The copy is not added to the list or the index.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patient - The patient to copy. NULL strings are copied as empty strings.
+ * outputs:
+ * - The copy, or NULL if memory could not be allocated
+ ******************************************************************************/
+patient_details_t *patient_copy(
+    hospital_record_t *records,
+    const patient_details_t *patient
+);
+
+/*******************************************************************************
+ * Adds a new patient to the hospital records in memory.
+ * The patient is copied, so the caller keeps ownership of it & its strings.
  * 
  * inputs:
  * - records - The hospital records
  * - patient - The patient to add
  * outputs:
- * - none
+ * - The patient in the records, or NULL if memory could not be allocated.
+ *   Nothing is logged or saved; the caller must do so to keep the patient.
  ******************************************************************************/
-void patient_signup_silent(
+patient_details_t *patient_add(
     hospital_record_t *records, 
-    patient_details_t *patient
+    const patient_details_t *patient
+);
+
+/*******************************************************************************
+ * Silently adds a new patient to the hospital records & logs it.
+ * The patient is copied, so the caller keeps ownership of it & its strings.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patient - The patient to add
+ * outputs:
+ * - The patient in the records, or NULL if memory could not be allocated.
+ *   The patient is logged, so it is kept once this returns. Exits if the
+ *   log cannot be written.
+ ******************************************************************************/
+patient_details_t *patient_signup_silent(
+    hospital_record_t *records, 
+    const patient_details_t *patient
+);
+
+/*******************************************************************************
+ * Adds many patients to the hospital records at once, in memory.
+ * Either every patient is added or none are. The patients are copied.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patients - The patients to add, in order
+ * - num_patients - The number of patients
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. Nothing is logged or
+ *   saved; the caller must do so to keep the patients.
+ ******************************************************************************/
+int patient_add_batch(
+    hospital_record_t *records,
+    const patient_details_t *patients,
+    size_t num_patients
+);
+
+/*******************************************************************************
+ * Adds many patients to the hospital records at once & saves the database.
+ * Either every patient is added or none are. The patients are copied.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patients - The patients to add, in order
+ * - num_patients - The number of patients
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. On success the patients
+ *   are saved, so they are kept once this returns. Exits if the database
+ *   cannot be saved.
+ ******************************************************************************/
+int patient_import_batch(
+    hospital_record_t *records,
+    const patient_details_t *patients,
+    size_t num_patients
 );
 
 /*******************************************************************************
@@ -92,10 +172,22 @@ void print_patient_details(patient_details_t *patient);
  * - records - The hospital records
  * - user_id - The ID of the patient to find
  * outputs:
- * - The patient if found, otherwise NULL
+ * - The patient if found, otherwise NULL. Exits if the database file is
+ *   corrupt.
  ******************************************************************************/
 patient_details_t *find_patient(hospital_record_t *records, char *user_id);
 
+/*******************************************************************************
+ * Silently deletes a patient from the hospital records.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - username - The username of the patient to delete
+ * outputs:
+ * - 1 if the patient was deleted, 0 if no patient has the username
+ ******************************************************************************/
+int delete_patient_silent(hospital_record_t *records, char *username);
+
 /*******************************************************************************
  * Deletes a patient from the hospital records.
  * 
@@ -1,8 +1,85 @@
 #ifndef COMPRESSION_COMPRESSION_H
 #define COMPRESSION_COMPRESSION_H
 
+#include <stddef.h>
+#include <stdio.h>
+
+/* Compressed data starts with "HUF" & the version of the format.
+ * Version 2: "HUF" | 2 | uncompressed size | code lengths | data
+ * The size is stored 7 bits per byte, lowest first, with the top bit set on
+ * every byte but the last. Codes are canonical.
+ */
+#define HUFFMAN_MAGIC "HUF"
+#define HUFFMAN_VERSION 2
+
+/* Version 1 had no magic. Its header was:
+ * frequency table | leftover bits count | uncompressed size
+ */
+#define HUFFMAN_V1_HEADER_SIZE (256 * sizeof(unsigned int) + 1 + sizeof(unsigned int))
+
+/* Largest header of the current version */
+#define HUFFMAN_MAX_HEADER_SIZE (4 + 10 + 256)
+
+/* Data compressed in independent blocks.
+ * "HUFB" | version | block size | uncompressed size | number of blocks |
+ * block index | blocks
+ * Sizes are little endian: 4 bytes for the block size & block count, 8 bytes
+ * for the uncompressed size. The index holds the end offset(8 bytes) of each
+ * block, counted from the first block. Each block is complete Huffman data
+ * with its own code lengths.
+ */
+#define HUFFMAN_BLOCKS_MAGIC "HUFB"
+#define HUFFMAN_BLOCKS_VERSION 1
+#define HUFFMAN_BLOCKS_HEADER_SIZE (4 + 1 + 4 + 8 + 4)
+
+/* Uncompressed bytes in each block unless another size is given */
+#define HUFFMAN_DEFAULT_BLOCK_SIZE (256 * 1024)
+
+/* Most threads block compression can use */
+#define HUFFMAN_MAX_THREADS 64
+
+/* Data compressed with LZ77 matches before Huffman coding.
+ * "HUFL" | version | uncompressed size | blocks
+ * The size is stored like the size of version 2 Huffman data. Each block
+ * holds LZ_BLOCK_SIZE uncompressed bytes(the last may have fewer):
+ * number of matches | 5 streams
+ * Each stream is a 4 byte little endian size followed by Huffman data:
+ * literal bytes, literal run lengths, match lengths, low & high bytes of
+ * match distances. Lengths over 254 continue into the next byte.
+ */
+#define LZ_MAGIC "HUFL"
+#define LZ_VERSION 1
+
+/* Uncompressed bytes in each LZ block. Matches may reach into earlier
+ * blocks.
+ */
+#define LZ_BLOCK_SIZE (1024 * 1024)
+
+/* Compression levels */
+/* Huffman coding only. Fast, & nothing is allocated. */
+#define COMPRESSION_LEVEL_HUFFMAN 1
+/* LZ77 matches, then Huffman coding. Smaller for repetitive data. */
+#define COMPRESSION_LEVEL_LZ 2
+
+/* Filters run before the level's coder. Added to a level, e.g.
+ * COMPRESSION_LEVEL_HUFFMAN | COMPRESSION_FILTER_ZERO_RLE.
+ */
+/* Runs of zeros, such as the padding of fixed size fields, are replaced by
+ * their length.
+ */
+#define COMPRESSION_FILTER_ZERO_RLE 0x100
+
+/* Data passed through the zero run filter before compression.
+ * "HUFZ" | version | uncompressed size | compressed filtered data
+ * The size is stored like the size of version 2 Huffman data.
+ */
+#define ZERO_RLE_MAGIC "HUFZ"
+#define ZERO_RLE_VERSION 1
+
 /*******************************************************************************
  * Compresses a file using Huffman coding.
+ * Files are written in the current version of the format. The file is only
+ * read once.
  *
  * inputs:
  * - uncompressed_file: The file to compress
@@ -15,6 +92,7 @@ void huffman_compress(const char *uncompressed_file, const char *compressed_file
 
 /*******************************************************************************
  * Decompresses a file using Huffman coding.
+ * Files of every version are accepted.
  *
  * inputs:
  * - compressed_file: The file to decompress
@@ -24,7 +102,323 @@ void huffman_compress(const char *uncompressed_file, const char *compressed_file
  ******************************************************************************/
 void huffman_decompress(const char *compressed_file, const char *uncompressed_file);
 
+/*******************************************************************************
+ * Compresses a stream using Huffman coding.
+ * The input is read once into memory, where both passes(counting &
+ * encoding) are made. Neither stream needs to be seekable, so the input can
+ * be a pipe.
+ *
+ * inputs:
+ * - input_file: The stream to compress. Read to the end.
+ * - output_file: The stream to write compressed data to
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_compress_stream(FILE *input_file, FILE *output_file);
+
+/*******************************************************************************
+ * Decompresses a stream using Huffman coding.
+ * Streams of every version are accepted. Neither stream needs to be
+ * seekable.
+ *
+ * inputs:
+ * - input_file: The stream to decompress
+ * - output_file: The stream to write decompressed data to
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_decompress_stream(FILE *input_file, FILE *output_file);
+
+/*******************************************************************************
+ * Gets the most bytes huffman_compress_buffer() can write for an input.
+ *
+ * inputs:
+ * - input_size: The number of bytes to compress
+ * outputs:
+ * - The size of output buffer that is always large enough
+ ******************************************************************************/
+size_t huffman_compress_bound(size_t input_size);
 
+/*******************************************************************************
+ * Compresses data in memory using Huffman coding.
+ * The result has the same format as a file written by huffman_compress().
+ * Nothing is allocated.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output. huffman_compress_bound() is always
+ *                    enough.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 if the output is too small
+ ******************************************************************************/
+int huffman_compress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
 
-#endif
+/*******************************************************************************
+ * Gets the number of bytes compressed data decompresses to.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int huffman_decompressed_size(const unsigned char *input, size_t input_size,
+    size_t *size);
+
+/*******************************************************************************
+ * Decompresses data in memory using Huffman coding.
+ * Accepts the output of huffman_compress() & huffman_compress_buffer() of
+ * every version. Nothing is allocated, except for the tables of version 1
+ * data.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output. huffman_decompressed_size() gives
+ *                    the size needed.
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an output too small)
+ ******************************************************************************/
+int huffman_decompress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
+
+/*******************************************************************************
+ * Gets the number of threads block compression may use.
+ * On first use this is read from the HUFFMAN_THREADS environment variable.
+ * Defaults to 1.
+ *
+ * inputs:
+ * - none
+ * outputs:
+ * - The number of threads
+ ******************************************************************************/
+int huffman_get_threads(void);
+
+/*******************************************************************************
+ * Sets the number of threads block compression may use.
+ * Blocks are shared between the threads. The result is identical to using a
+ * single thread.
+ *
+ * inputs:
+ * - num_threads: Between 1 & HUFFMAN_MAX_THREADS
+ * outputs:
+ * - 0 if the thread count is now in use, 1 if it is not supported
+ ******************************************************************************/
+int huffman_set_threads(int num_threads);
+
+/*******************************************************************************
+ * Compresses data in memory as independent blocks.
+ * Each block has its own codes, so blocks can be compressed & decompressed
+ * at the same time, or decompressed on their own.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - block_size: The number of bytes in each block. 0 for
+ *               HUFFMAN_DEFAULT_BLOCK_SIZE.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - The compressed data(must be freed) or NULL on failure
+ ******************************************************************************/
+unsigned char *huffman_compress_blocks(const unsigned char *input,
+    size_t input_size, size_t block_size, size_t *output_size);
+
+/*******************************************************************************
+ * Decompresses data written by huffman_compress_blocks().
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - The decompressed data(must be freed) or NULL on failure
+ ******************************************************************************/
+unsigned char *huffman_decompress_blocks(const unsigned char *input,
+    size_t input_size, size_t *output_size);
+
+/*******************************************************************************
+ * Decompresses part of the data written by huffman_compress_blocks().
+ * Only the blocks holding the requested bytes are decoded.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - offset: The first uncompressed byte wanted
+ * - length: The number of uncompressed bytes wanted
+ * - output: Where to write them. Room for 'length' bytes.
+ * outputs:
+ * - 0 on success, 1 on failure(including a range past the end)
+ ******************************************************************************/
+int huffman_read_blocks(const unsigned char *input, size_t input_size,
+    size_t offset, size_t length, unsigned char *output);
+
+/*******************************************************************************
+ * Gets the most bytes lz_compress_buffer() can write for an input.
+ *
+ * inputs:
+ * - input_size: The number of bytes to compress
+ * outputs:
+ * - The size of output buffer that is always large enough
+ ******************************************************************************/
+size_t lz_compress_bound(size_t input_size);
+
+/*******************************************************************************
+ * Compresses data in memory by replacing repeated bytes with matches to
+ * earlier copies, then Huffman coding what is left.
+ * Allocates a few MiB of working memory.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output. lz_compress_bound() is always
+ *                    enough.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int lz_compress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
+
+/*******************************************************************************
+ * Gets the number of bytes data from lz_compress_buffer() decompresses to.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int lz_decompressed_size(const unsigned char *input, size_t input_size,
+    size_t *size);
+
+/*******************************************************************************
+ * Decompresses data written by lz_compress_buffer().
+ * Allocates a few MiB of working memory.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output. lz_decompressed_size() gives the
+ *                    size needed.
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an output too small)
+ ******************************************************************************/
+int lz_decompress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
+
+/*******************************************************************************
+ * Gets the most bytes zero_rle_encode() can write for an input.
+ *
+ * inputs:
+ * - input_size: The number of bytes to encode
+ * outputs:
+ * - The size of output buffer that is always large enough
+ ******************************************************************************/
+size_t zero_rle_bound(size_t input_size);
+
+/*******************************************************************************
+ * Replaces runs of zeros with their length.
+ * Runs are found 8 bytes at a time, so this runs close to the speed of
+ * copying memory. Nothing is allocated.
+ *
+ * inputs:
+ * - input: The data to encode
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the encoded data
+ * - output_capacity: The size of output. zero_rle_bound() is always enough.
+ * - output_size: Set to the number of bytes in the encoded data
+ * outputs:
+ * - 0 on success, 1 if the output is too small
+ ******************************************************************************/
+int zero_rle_encode(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
+
+/*******************************************************************************
+ * Restores data encoded by zero_rle_encode().
+ *
+ * inputs:
+ * - input: The encoded data
+ * - input_size: The number of bytes in the encoded data
+ * - output: Where to write the decoded data
+ * - output_capacity: The size of output
+ * - output_size: Set to the number of bytes in the decoded data
+ * outputs:
+ * - 0 on success, 1 if the data is invalid or the output is too small
+ ******************************************************************************/
+int zero_rle_decode(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
+
+/*******************************************************************************
+ * Gets the most bytes compression_compress() can write for an input.
+ *
+ * inputs:
+ * - level: The compression level
+ * - input_size: The number of bytes to compress
+ * outputs:
+ * - The size of output buffer that is always large enough. 0 if the level
+ *   is unknown.
+ ******************************************************************************/
+size_t compression_bound(int level, size_t input_size);
+
+/*******************************************************************************
+ * Compresses data in memory at a compression level.
+ * Filters allocate a buffer for the filtered data.
+ *
+ * inputs:
+ * - level: COMPRESSION_LEVEL_HUFFMAN or COMPRESSION_LEVEL_LZ, plus any
+ *          COMPRESSION_FILTER_ flags
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output. compression_bound() is always
+ *                    enough.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an unknown level)
+ ******************************************************************************/
+int compression_compress(int level, const unsigned char *input,
+    size_t input_size, unsigned char *output, size_t output_capacity,
+    size_t *output_size);
+
+/*******************************************************************************
+ * Gets the number of bytes compressed data of any level decompresses to.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int compression_decompressed_size(const unsigned char *input,
+    size_t input_size, size_t *size);
 
+/*******************************************************************************
+ * Decompresses data of any level. The level & filters are found from the
+ * header. Filters allocate a buffer for the filtered data.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output. compression_decompressed_size()
+ *                    gives the size needed.
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an output too small)
+ ******************************************************************************/
+int compression_decompress(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size);
+
+#endif
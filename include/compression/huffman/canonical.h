@@ -0,0 +1,82 @@
+#ifndef COMPRESSION_HUFFMAN_CANONICAL_H
+#define COMPRESSION_HUFFMAN_CANONICAL_H
+
+#include <stddef.h>
+
+#include "compression/huffman/codes.h"
+
+/* Longest code a canonical Huffman code may use */
+/* Keeps decoding to at most 2 table lookups per byte */
+#define HUFFMAN_MAX_CODE_LENGTH 15
+
+/* Most bytes needed to store the code lengths */
+#define HUFFMAN_MAX_LENGTHS_SIZE 256
+
+/*******************************************************************************
+ * Create the code length of each byte.
+ * Lengths come from a Huffman tree. If any is longer than
+ * HUFFMAN_MAX_CODE_LENGTH, the lengths are adjusted so none are while the
+ * most frequent bytes keep the shortest codes.
+ *
+ * inputs:
+ * - frequency_table: Tracks the number of occurences of each byte
+ * - lengths: Set to the code length of each byte. 0 if it does not occur.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void create_huffman_code_lengths(unsigned int frequency_table[256],
+    unsigned char lengths[256]);
+
+/*******************************************************************************
+ * Create canonical Huffman codes from code lengths.
+ * Codes of the same length are consecutive numbers in byte order, so the
+ * lengths alone are enough to rebuild the codes.
+ *
+ * inputs:
+ * - lengths: The code length of each byte
+ * - codes: The codes table to fill. 256 for each possible byte.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void create_canonical_huffman_codes(const unsigned char lengths[256],
+    HuffmanCode_t codes[256]);
+
+/*******************************************************************************
+ * Checks whether code lengths can form a complete canonical code.
+ * No codes at all(empty data) & a single code of length 1 are also valid.
+ *
+ * inputs:
+ * - lengths: The code length of each byte
+ * outputs:
+ * - 1 if the lengths are valid, otherwise 0
+ ******************************************************************************/
+int huffman_code_lengths_valid(const unsigned char lengths[256]);
+
+/*******************************************************************************
+ * Stores code lengths as runs.
+ * Each byte holds a length(high 4 bits) & how many bytes in a row use it,
+ * minus 1(low 4 bits).
+ *
+ * inputs:
+ * - lengths: The code length of each byte
+ * - output: Where to store the runs. Room for HUFFMAN_MAX_LENGTHS_SIZE bytes.
+ * outputs:
+ * - The number of bytes written
+ ******************************************************************************/
+size_t write_huffman_code_lengths(const unsigned char lengths[256],
+    unsigned char *output);
+
+/*******************************************************************************
+ * Reads code lengths stored by write_huffman_code_lengths().
+ *
+ * inputs:
+ * - input: The runs
+ * - input_size: The number of bytes available
+ * - lengths: Set to the code length of each byte
+ * outputs:
+ * - The number of bytes read or 0 if the runs are invalid
+ ******************************************************************************/
+size_t read_huffman_code_lengths(const unsigned char *input, size_t input_size,
+    unsigned char lengths[256]);
+
+#endif
@@ -1,19 +1,39 @@
 #ifndef COMPRESSION_HUFFMAN_CODES_H
 #define COMPRESSION_HUFFMAN_CODES_H
 
+#include <stdint.h>
+
+#include "compression/huffman/tree.h"
+
+/* A Huffman code packed into an integer */
+struct HuffmanCode {
+
+    /* The path to the byte in the tree. Right aligned. */
+    /* The first step(0 = left, 1 = right) is the most significant bit */
+    uint64_t bits;
+
+    /* Number of bits in the code. 0 if the byte does not occur. */
+    int length;
+};
+
+typedef struct HuffmanCode HuffmanCode_t;
+
 /*******************************************************************************
  * Generate the Huffman codes.
  * Codes are paths used to reach a specific byte in the tree.
+ * Paths can be at most 64 steps long. Frequencies that fit in an unsigned int
+ * cannot build a tree deeper than that.
  *
  * inputs:
  * - node: The node to generate the codes for
- * - code: The code to store the codes
+ * - bits: The path to the node
  * - depth: The depth of the node
  * - codes: The codes table to store the codes. 256 for each possible byte.
+ *          Must be zeroed before the first call.
  * outputs:
  * - none
  ******************************************************************************/
-void generate_huffman_codes(HuffmanNode_t *node, char *code, int depth, char *codes[256]);
+void generate_huffman_codes(HuffmanNode_t *node, uint64_t bits, int depth,
+    HuffmanCode_t codes[256]);
 
 #endif
-
@@ -0,0 +1,97 @@
+#ifndef COMPRESSION_HUFFMAN_DECODE_TABLE_H
+#define COMPRESSION_HUFFMAN_DECODE_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "compression/huffman/tree.h"
+
+/* Most bits looked up by the first table */
+#define HUFFMAN_DECODE_BITS 10
+
+/* Most bits looked up by each table after the first */
+/* Only codes longer than HUFFMAN_DECODE_BITS need them */
+#define HUFFMAN_DECODE_SUB_BITS 8
+
+/* Most entries the tables of canonical code lengths can need.
+ * A second table of w bits needs a code of HUFFMAN_DECODE_BITS + w bits,
+ * so at least w + 1 bytes start with its prefix. Codes of at most 15 bits
+ * give w <= 5, which at most 42 full(6 byte) prefixes & 1 more of 3 bits
+ * can reach: 42 * 32 + 8 entries after the first table.
+ */
+#define HUFFMAN_DECODE_MAX_ENTRIES ((1 << HUFFMAN_DECODE_BITS) + 42 * 32 + 8)
+
+/* Result of looking up the next bits of compressed data */
+struct HuffmanDecodeEntry {
+
+    /* The decoded byte, or the index of the next table if next_bits > 0 */
+    uint32_t value;
+
+    /* Number of bits used */
+    unsigned char length;
+
+    /* Number of bits looked up by the next table. 0 for a decoded byte. */
+    unsigned char next_bits;
+};
+
+typedef struct HuffmanDecodeEntry HuffmanDecodeEntry_t;
+
+/* Tables used to decode several bits at a time */
+struct HuffmanDecodeTable {
+
+    /* Every table, one after the other. The first table starts at 0. */
+    HuffmanDecodeEntry_t *entries;
+    size_t size;
+    size_t capacity;
+
+    /* Holds the tables of canonical code lengths, so they need no
+     * allocation. Tables of a tree are allocated since they have no limit.
+     */
+    HuffmanDecodeEntry_t fixed_entries[HUFFMAN_DECODE_MAX_ENTRIES];
+
+    /* Number of bits looked up by the first table */
+    int bits;
+};
+
+typedef struct HuffmanDecodeTable HuffmanDecodeTable_t;
+
+/*******************************************************************************
+ * Create the decode tables of a Huffman tree.
+ * Each entry of a table is the result of following its index(as bits) down
+ * the tree: either a leaf or another table for the node that was reached.
+ *
+ * inputs:
+ * - table: The table to create
+ * - root: The root of the Huffman tree. Must have at least 2 leaves.
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int create_huffman_decode_table(HuffmanDecodeTable_t *table, HuffmanNode_t *root);
+
+/*******************************************************************************
+ * Create the decode tables of canonical Huffman code lengths.
+ * The tables are filled straight from the codes without building a tree.
+ * Codes are at most HUFFMAN_MAX_CODE_LENGTH bits, so only one table follows
+ * the first. The tables are kept in the table itself without allocating.
+ *
+ * inputs:
+ * - table: The table to create
+ * - lengths: The code length of each byte. At least 2 must be non-zero &
+ *            huffman_code_lengths_valid() must accept them.
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int create_huffman_decode_table_from_lengths(HuffmanDecodeTable_t *table,
+    const unsigned char lengths[256]);
+
+/*******************************************************************************
+ * Free the decode tables.
+ *
+ * inputs:
+ * - table: The table to free
+ * outputs:
+ * - none
+ ******************************************************************************/
+void free_huffman_decode_table(HuffmanDecodeTable_t *table);
+
+#endif
@@ -1,9 +1,27 @@
 #ifndef COMPRESSION_HUFFMAN_FREQUENCY_TABLE_H
 #define COMPRESSION_HUFFMAN_FREQUENCY_TABLE_H
 
+#include <stddef.h>
+
+/*******************************************************************************
+ * Adds the occurrences of each byte in memory to a frequency table.
+ * Bytes are counted into interleaved sub-tables, so long runs of one byte
+ * (like zero padding) count as fast as varied data.
+ *
+ * inputs:
+ * - input: The data to count
+ * - input_size: The number of bytes in the data
+ * - frequency_table: The counts to add to
+ * outputs:
+ * - none
+ ******************************************************************************/
+void add_frequencies(const unsigned char *input, size_t input_size,
+    unsigned int frequency_table[256]);
+
 /*******************************************************************************
  * Create frequency table.
  * The frequency table is an array that tracks the occurrences of each byte.
+ * The file is read a block at a time.
  *
  * inputs:
  * - input: name of the file to create frequency table from
@@ -13,5 +31,18 @@
  ******************************************************************************/
 void create_frequency_table(const char *input, unsigned int frequency_table[256]);
 
+/*******************************************************************************
+ * Create frequency table from data in memory.
+ *
+ * inputs:
+ * - input: The data to create the frequency table from
+ * - input_size: The number of bytes in the data
+ * - frequency_table: Tracks the number of occurences of each byte
+ * outputs:
+ * - none
+ ******************************************************************************/
+void create_frequency_table_buffer(const unsigned char *input, size_t input_size,
+    unsigned int frequency_table[256]);
+
 #endif
 
@@ -23,25 +23,32 @@ struct HuffmanNode {
 
 typedef struct HuffmanNode HuffmanNode_t;
 
+/* Most nodes a Huffman tree can have: 256 leaves & 255 internal nodes */
+#define HUFFMAN_MAX_NODES 511
+
+/* Holds every node of a Huffman tree */
+/* The tree is freed along with it, so nodes are never allocated one by one */
+struct HuffmanTree {
+
+    /* Leaves sorted by frequency, then internal nodes in the order made */
+    HuffmanNode_t nodes[HUFFMAN_MAX_NODES];
+
+    /* Number of nodes used */
+    int node_count;
+};
+
+typedef struct HuffmanTree HuffmanTree_t;
+
 /*******************************************************************************
  * Create Huffman tree.
  *
  * inputs:
+ * - tree: Where to store the nodes of the tree
  * - frequency_table: The frequency table to create the Huffman tree from
  * outputs:
- * - The root of the Huffman tree
+ * - The root of the Huffman tree or NULL if no byte occurs
  ******************************************************************************/
-HuffmanNode_t *create_huffman_tree(unsigned int frequency_table[256]);
-
-/*******************************************************************************
- * Free the Huffman tree.
- *
- * inputs:
- * - node: The node to free
- * outputs:
- * - none
- ******************************************************************************/
-void free_huffman_tree(HuffmanNode_t *node);
+HuffmanNode_t *create_huffman_tree(HuffmanTree_t *tree,
+    const unsigned int frequency_table[256]);
 
 #endif
-
@@ -0,0 +1,103 @@
+#ifndef COMPRESSION_LZ_MATCH_FINDER_H
+#define COMPRESSION_LZ_MATCH_FINDER_H
+
+#include <stddef.h>
+
+/* Shortest match worth replacing with a length & distance */
+#define LZ_MIN_MATCH 4
+
+/* Furthest back a match may start. Distances are stored in 2 bytes. */
+#define LZ_WINDOW_SIZE 65535
+
+/* Bits of the hash of the next LZ_MIN_MATCH bytes */
+#define LZ_HASH_BITS 16
+
+/* Most earlier positions compared when looking for a match */
+#define LZ_MAX_CHAIN 32
+
+/* A match this long is taken without looking for a longer one */
+#define LZ_NICE_MATCH 256
+
+/* Finds earlier copies of the bytes at a position.
+ * Positions with the same hash are chained together, newest first.
+ */
+struct LzMatchFinder {
+
+    /* The data being compressed */
+    const unsigned char *data;
+    size_t size;
+
+    /* Newest position(+ 1) with each hash. 0 if there is none. */
+    size_t *head;
+
+    /* Previous position(+ 1) with the same hash, for each position in the
+     * window. Indexed by position modulo the window.
+     */
+    size_t *previous;
+};
+
+typedef struct LzMatchFinder LzMatchFinder_t;
+
+/* A match found by the match finder */
+struct LzMatch {
+
+    /* Number of bytes that match. 0 if there is no match. */
+    size_t length;
+
+    /* How far back the match starts */
+    size_t distance;
+};
+
+typedef struct LzMatch LzMatch_t;
+
+/*******************************************************************************
+ * Create a match finder.
+ *
+ * inputs:
+ * - finder: The match finder to create
+ * - data: The data to find matches in
+ * - size: The number of bytes in the data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int create_lz_match_finder(LzMatchFinder_t *finder, const unsigned char *data,
+    size_t size);
+
+/*******************************************************************************
+ * Adds a position to the match finder, so later positions can match it.
+ * Positions must be added in order.
+ *
+ * inputs:
+ * - finder: The match finder
+ * - position: The position to add
+ * outputs:
+ * - none
+ ******************************************************************************/
+void insert_lz_position(LzMatchFinder_t *finder, size_t position);
+
+/*******************************************************************************
+ * Finds the longest match for the bytes at a position.
+ * Only positions already added are searched.
+ *
+ * inputs:
+ * - finder: The match finder
+ * - position: The position to find a match for
+ * - max_length: The longest match allowed
+ * outputs:
+ * - The longest match found. Its length is 0 if none is at least
+ *   LZ_MIN_MATCH bytes.
+ ******************************************************************************/
+LzMatch_t find_lz_match(const LzMatchFinder_t *finder, size_t position,
+    size_t max_length);
+
+/*******************************************************************************
+ * Free a match finder.
+ *
+ * inputs:
+ * - finder: The match finder to free
+ * outputs:
+ * - none
+ ******************************************************************************/
+void free_lz_match_finder(LzMatchFinder_t *finder);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef COMPRESSION_LZ_STREAMS_H
+#define COMPRESSION_LZ_STREAMS_H
+
+#include <stddef.h>
+
+#include "compression/varint.h"
+
+/* Each block is split into streams of similar bytes, each Huffman coded
+ * with its own codes.
+ */
+#define LZ_STREAM_LITERALS 0
+#define LZ_STREAM_LITERAL_LENGTHS 1
+#define LZ_STREAM_MATCH_LENGTHS 2
+#define LZ_STREAM_DISTANCES_LOW 3
+#define LZ_STREAM_DISTANCES_HIGH 4
+#define LZ_NUM_STREAMS 5
+
+/* Bytes before each stream holding its compressed size */
+#define LZ_STREAM_SIZE_BYTES 4
+
+/* Most bytes of the header before the blocks */
+#define LZ_MAX_HEADER_SIZE (4 + 1 + COMPRESSION_MAX_VARINT_SIZE)
+
+#endif
@@ -0,0 +1,34 @@
+#ifndef COMPRESSION_VARINT_H
+#define COMPRESSION_VARINT_H
+
+#include <stddef.h>
+
+/* Most bytes of a stored size */
+#define COMPRESSION_MAX_VARINT_SIZE 10
+
+/*******************************************************************************
+ * Stores a size 7 bits per byte, lowest first, with the top bit set on every
+ * byte but the last.
+ *
+ * inputs:
+ * - output: Where to store it. Room for COMPRESSION_MAX_VARINT_SIZE bytes.
+ * - value: The size
+ * outputs:
+ * - The number of bytes written
+ ******************************************************************************/
+size_t compression_write_varint(unsigned char *output, size_t value);
+
+/*******************************************************************************
+ * Reads a size stored by compression_write_varint().
+ *
+ * inputs:
+ * - input: The stored size
+ * - input_size: The number of bytes available
+ * - value: Set to the size
+ * outputs:
+ * - The number of bytes read or 0 if the size is invalid
+ ******************************************************************************/
+size_t compression_read_varint(const unsigned char *input, size_t input_size,
+    size_t *value);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef ENCRYPTION_AES_AESNI_H
+#define ENCRYPTION_AES_AESNI_H
+
+#include "encryption/aes/core.h"
+
+/*******************************************************************************
+ * Checks whether the AES-NI backend can be used.
+ * The backend must be compiled in(x86 with GCC/Clang) & the CPU must
+ * support the AES-NI instructions.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if the AES-NI backend can be used, otherwise 0.
+ ******************************************************************************/
+int aes_aesni_available(void);
+
+/*******************************************************************************
+ * Expands the key using AESKEYGENASSIST.
+ * Fills the cipher & equivalent inverse cipher round keys of the context.
+ *
+ * inputs:
+ * - ctx - The context to fill. num_rounds & key_size must already be set.
+ * - key - The 128, 192, or 256 bit key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_aesni_key_expansion(aes_context_t *ctx, const unsigned char *key);
+
+/*******************************************************************************
+ * AES encryption/decryption of a single block using AESENC/AESDEC.
+ *
+ * inputs:
+ * - input - The input to encrypt/decrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the result. May be the same as input.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_aesni_encrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output);
+void aes_aesni_decrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output);
+
+/*******************************************************************************
+ * AES encryption of several independent blocks using AESENC.
+ * Blocks are interleaved AES_BATCH_BLOCKS at a time so the latency of each
+ * AESENC is hidden behind the other blocks.
+ *
+ * inputs:
+ * - input - The blocks to encrypt. num_blocks * 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted blocks.
+ * - num_blocks - The number of blocks.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_aesni_encrypt_blocks(
+    const unsigned char *input, const aes_context_t *ctx,
+    unsigned char *output, size_t num_blocks);
+
+#endif
@@ -2,14 +2,84 @@
 #ifndef ENCRYPTION_AES_CORE_H
 #define ENCRYPTION_AES_CORE_H
 
+#include <stddef.h>
+#include <stdint.h>
+
 /* An unsigned char is a byte */
 typedef unsigned char byte;
 
+/* Largest number of rounds used by AES (AES-256) */
+#define AES_MAX_ROUNDS 14
+
+/* AES backends
+ * Portable: T-table or reference round engine(see AES_TTABLES).
+ * AES-NI: x86 AES instructions. Only used if the CPU supports them.
+ */
+#define AES_BACKEND_PORTABLE 0
+#define AES_BACKEND_AESNI 1
+
+/* Holds an AES key that has been expanded once.
+ * Can be reused for every block encrypted/decrypted with the same key.
+ * No memory is allocated so it can live on the stack or inside other structs.
+ */
+struct aes_context {
+
+    /* Round keys used by the cipher
+     * Only the first (num_rounds + 1) * 16 bytes are used.
+     */
+    byte round_keys[(AES_MAX_ROUNDS + 1) * 16];
+
+    /* Round keys used by the equivalent inverse cipher (FIPS-197 5.3.5)
+     * Same keys in reverse order with InvMixColumns applied to rounds 1..n-1.
+     */
+    byte inv_round_keys[(AES_MAX_ROUNDS + 1) * 16];
+
+    /* Same round keys as big-endian 32-bit words
+     * Used by the T-table round engine.
+     */
+    uint32_t round_words[(AES_MAX_ROUNDS + 1) * 4];
+    uint32_t inv_round_words[(AES_MAX_ROUNDS + 1) * 4];
+
+    /* Number of rounds. 10/12/14 for 128/192/256 bit keys. */
+    int num_rounds;
+
+    /* Size of the key in bytes */
+    int key_size;
+};
+typedef struct aes_context aes_context_t;
+
+/* An expanded key is simply the AES context */
+typedef aes_context_t aes_key_t;
+
 typedef struct aes_encrypted_result {
     byte *bytes;
     int size;
 } aes_encrypted_result;
 
+/*******************************************************************************
+ * Gets the AES backend in use.
+ * On first use the backend is chosen from the AES_BACKEND environment
+ * variable("portable" or "aesni"). Otherwise AES-NI is used when the CPU
+ * supports it.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - AES_BACKEND_PORTABLE or AES_BACKEND_AESNI.
+*******************************************************************************/
+int aes_get_backend(void);
+
+/*******************************************************************************
+ * Forces the given AES backend to be used.
+ * Contexts created with aes_context_init() work with every backend.
+ *
+ * inputs:
+ * - backend - AES_BACKEND_PORTABLE or AES_BACKEND_AESNI.
+ * outputs:
+ * - 0 if the backend is now in use, 1 if it is not supported.
+*******************************************************************************/
+int aes_set_backend(int backend);
+
 /* Helper functions */
 char *convert_bytes_to_hex_string(const byte *input, int input_size);
 byte *convert_hex_string_to_bytes(const char *input);
@@ -28,6 +98,69 @@ byte *convert_hex_string_to_bytes(const char *input);
 *******************************************************************************/
 void aes_encrypt_block(const byte *input, const byte *key, int key_size, byte *output);
 void aes_decrypt_block(const byte *input, const byte *key, int key_size, byte *output);
+
+/*******************************************************************************
+ * Expands the key into the given AES context.
+ * Only needs to be called once per key.
+ *
+ * inputs:
+ * - ctx - The context to initialize.
+ * - key - The 128, 192, or 256 bit key.
+ * - key_size - The size of the key.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_context_init(aes_context_t *ctx, const byte *key, int key_size);
+
+/*******************************************************************************
+ * AES encryption/decryption using an already expanded key.
+ *
+ * inputs:
+ * - input - The input to encrypt/decrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the result. May be the same as input.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_encrypt_block_ctx(const byte *input, const aes_context_t *ctx, byte *output);
+void aes_decrypt_block_ctx(const byte *input, const aes_context_t *ctx, byte *output);
+
+/* Most blocks encrypted together by the batched round engines */
+#define AES_BATCH_BLOCKS 8
+
+/*******************************************************************************
+ * AES encryption of several independent blocks using an already expanded
+ * key. E.g. the counter blocks of CTR mode.
+ * The blocks are interleaved so the rounds of one block overlap with the
+ * rounds of the others.
+ *
+ * inputs:
+ * - input - The blocks to encrypt. num_blocks * 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted blocks.
+ * - num_blocks - The number of blocks.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_encrypt_blocks_ctx(
+    const byte *input, const aes_context_t *ctx, byte *output,
+    size_t num_blocks);
+
+/*******************************************************************************
+ * Reference round engine.
+ * Works on a byte state matrix with separate SubBytes, ShiftRows,
+ * MixColumns & AddRoundKey passes. Used when AES_TTABLES is not defined.
+ *
+ * inputs:
+ * - input - The input to encrypt/decrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the result. May be the same as input.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_reference_encrypt_block(const byte *input, const aes_context_t *ctx, byte *output);
+void aes_reference_decrypt_block(const byte *input, const aes_context_t *ctx, byte *output);
+
 aes_encrypted_result *aes_encrypt_bytes(const byte *input, int input_size, const byte *key, int key_size);
 
 #endif
\ No newline at end of file
@@ -2,6 +2,18 @@
 #ifndef ENCRYPTION_GCM_H
 #define ENCRYPTION_GCM_H
 
+#include <stddef.h>
+
+#include "encryption/aes/core.h"
+#include "encryption/aes/ghash.h"
+
+/* Direction of a streaming GCM operation */
+#define AES_GCM_ENCRYPT 0
+#define AES_GCM_DECRYPT 1
+
+/* Most threads a single AES-GCM operation can use */
+#define AES_GCM_MAX_THREADS 64
+
 /* Holds data encrypted with AES-GCM */
 struct aes_gcm_data {
     /* Stores the output of the encryption/decryption & its length */
@@ -15,6 +27,170 @@ struct aes_gcm_data {
 };
 typedef struct aes_gcm_data aes_gcm_data_t;
 
+/* State of a streaming AES-GCM encryption/decryption.
+ * Created with aes_gcm_init(). Fields should not be changed directly.
+ */
+struct aes_gcm_context
+{
+    /* AES_GCM_ENCRYPT or AES_GCM_DECRYPT */
+    int mode;
+
+    /* Holds the expanded key
+     * Expanded once & reused for every block.
+     */
+    aes_context_t aes;
+
+    /* Holds the hash subkey
+    * Used in GHASH calculations.
+    */
+    unsigned char hash_subkey[16];
+
+    /* Holds the hash subkey & its precomputed tables
+    * Used by the GHASH backends.
+    */
+    ghash_key_t ghash_key;
+
+    /* The counter block */
+    unsigned char counter_block[16];
+
+    /* Holds y0 aka the first counter block encrypted with the key
+    * Used in tag generation.
+    */
+    unsigned char y0[16];
+
+    /* Holds the ghash */
+    unsigned char ghash[16];
+
+    /* Keystream for the current block
+    * Only partly used if the last update did not end on a block boundary.
+    */
+    unsigned char keystream[16];
+
+    /* AAD or ciphertext bytes waiting for a full block before GHASH */
+    unsigned char ghash_buffer[16];
+
+    /* Bytes of AAD & plaintext/ciphertext processed so far */
+    unsigned long long aad_length;
+    unsigned long long text_length;
+
+    /* Set once the first plaintext/ciphertext is processed.
+    * No more AAD can be added after this.
+    */
+    int aad_finished;
+};
+typedef struct aes_gcm_context aes_gcm_context_t;
+
+/*******************************************************************************
+ * Gets the number of threads AES-GCM may use.
+ * On first use this is read from the AES_GCM_THREADS environment variable.
+ * Defaults to 1.
+ *
+ * inputs:
+ * - None.
+ *
+ * outputs:
+ * - The number of threads.
+ ******************************************************************************/
+int aes_gcm_get_threads(void);
+
+/*******************************************************************************
+ * Sets the number of threads AES-GCM may use.
+ * Large inputs to aes_gcm_update() are split between the threads. The
+ * result is identical to using a single thread.
+ *
+ * inputs:
+ * - num_threads - Between 1 & AES_GCM_MAX_THREADS.
+ *
+ * outputs:
+ * - 0 if the thread count is now in use, 1 if it is not supported.
+ ******************************************************************************/
+int aes_gcm_set_threads(int num_threads);
+
+/*******************************************************************************
+ * Starts a streaming AES-GCM encryption/decryption.
+ * Call aes_gcm_update_aad() for any AAD, then aes_gcm_update() for each
+ * chunk of input, then aes_gcm_final() or aes_gcm_verify().
+ *
+ * inputs:
+ * - ctx - The context to initialize.
+ * - key - The key to use.
+ * - key_size - The size of the key.
+ * - nonce - The nonce. Must be 12 bytes.
+ * - mode - AES_GCM_ENCRYPT or AES_GCM_DECRYPT.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_init(
+    aes_gcm_context_t *ctx,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *nonce,
+    int mode);
+
+/*******************************************************************************
+ * Adds AAD(additional authentication data) to a streaming operation.
+ * Can be called several times but only before the first aes_gcm_update().
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - aad - The AAD.
+ * - aad_length - The length of the AAD.
+ *
+ * outputs:
+ * - 0 if the AAD was added, 1 if aes_gcm_update() was already called.
+ ******************************************************************************/
+int aes_gcm_update_aad(
+    aes_gcm_context_t *ctx,
+    const unsigned char *aad,
+    size_t aad_length);
+
+/*******************************************************************************
+ * Encrypts/decrypts the next chunk of input.
+ * Chunks can be any size. The keystream & GHASH are computed in the same
+ * pass over the chunk.
+ * When decrypting, the output must not be trusted until aes_gcm_verify()
+ * succeeds.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - input - The plaintext(encrypting) or ciphertext(decrypting).
+ * - length - The length of the input.
+ * - output - Where to write the result. Can be the same as 'input'.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_update(
+    aes_gcm_context_t *ctx,
+    const unsigned char *input,
+    size_t length,
+    unsigned char *output);
+
+/*******************************************************************************
+ * Finishes a streaming operation & creates the authentication tag.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - tag - Where to write the 16 byte tag.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_final(aes_gcm_context_t *ctx, unsigned char tag[16]);
+
+/*******************************************************************************
+ * Finishes a streaming operation & checks the authentication tag.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - tag - The 16 byte tag to check against.
+ *
+ * outputs:
+ * - 0 if the tag is valid, 1 otherwise.
+ ******************************************************************************/
+int aes_gcm_verify(aes_gcm_context_t *ctx, const unsigned char tag[16]);
+
 
 /*******************************************************************************
  * Encrypts the input using AES-GCM.
@@ -0,0 +1,153 @@
+#ifndef ENCRYPTION_AES_GHASH_H
+#define ENCRYPTION_AES_GHASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bits of a block the portable backend multiplies at once(4 or 8).
+ * 4: 16 entry table, 256 bytes per key.
+ * 8: 256 entry table, 4 KiB per key. Fewer steps per block.
+ * Set with the GHASH_TABLE_BITS CMake option.
+ */
+#ifndef GHASH_TABLE_BITS
+#define GHASH_TABLE_BITS 4
+#endif
+#define GHASH_TABLE_SIZE (1 << GHASH_TABLE_BITS)
+
+/* GHASH backends
+ * Portable: table-driven GF(2^128) multiplication in C.
+ * CLMUL: x86 carry-less multiply(PCLMULQDQ). Only used if the CPU supports it.
+ */
+#define GHASH_BACKEND_PORTABLE 0
+#define GHASH_BACKEND_CLMUL 1
+
+/* Holds the hash subkey(H) & anything precomputed from it.
+ * Created once per key & reused for every block.
+ */
+struct ghash_key {
+
+    /* The hash subkey H */
+    unsigned char h[16];
+
+    /* Multiples of H for the portable backend. Entry i is i • H.
+     * Stored as the big-endian upper & lower 64 bits.
+     */
+    uint64_t table_high[GHASH_TABLE_SIZE];
+    uint64_t table_low[GHASH_TABLE_SIZE];
+
+    /* H¹, H², H³, H⁴ for the CLMUL backend
+     * Stored byte-reversed, the order the CLMUL code works in.
+     * Only filled if the CPU supports PCLMULQDQ.
+     */
+    unsigned char clmul_powers[4][16];
+};
+typedef struct ghash_key ghash_key_t;
+
+/*******************************************************************************
+ * Gets the GHASH backend in use.
+ * On first use the backend is chosen from the GHASH_BACKEND environment
+ * variable("portable" or "clmul"). Otherwise CLMUL is used when the CPU
+ * supports it.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - GHASH_BACKEND_PORTABLE or GHASH_BACKEND_CLMUL.
+ ******************************************************************************/
+int ghash_get_backend(void);
+
+/*******************************************************************************
+ * Forces the given GHASH backend to be used.
+ * Keys created with ghash_key_init() work with every backend.
+ *
+ * inputs:
+ * - backend - GHASH_BACKEND_PORTABLE or GHASH_BACKEND_CLMUL.
+ * outputs:
+ * - 0 if the backend is now in use, 1 if it is not supported.
+ ******************************************************************************/
+int ghash_set_backend(int backend);
+
+/*******************************************************************************
+ * Precomputes everything needed to GHASH with the given hash subkey.
+ *
+ * inputs:
+ * - key - The GHASH key to initialize.
+ * - h - The hash subkey. The all-zero block encrypted with the AES key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_key_init(ghash_key_t *key, const unsigned char h[16]);
+
+/*******************************************************************************
+ * Absorbs data into a running GHASH.
+ * For each 16 byte block: state = (state ⊕ block) • H
+ * A final partial block is padded with zeros, as GCM requires for the AAD
+ * and the ciphertext.
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - state - The running GHASH value. Updated in place.
+ * - data - The data to absorb.
+ * - length - The length of the data in bytes.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_update(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    const unsigned char *data,
+    size_t length);
+
+/*******************************************************************************
+ * Multiplies a GHASH value by a power of H.
+ * Used to join GHASH values computed separately:
+ *   GHASH(A || B) = GHASH(A) • H^n ⊕ GHASH(B), n = number of blocks in B
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - state - The GHASH value. Updated in place.
+ * - exponent - The power of H.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_multiply_h_power(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    unsigned long long exponent);
+
+/*******************************************************************************
+ * Portable table backend.
+ * ghash_table_multiply() replaces 'block' with block • H.
+ ******************************************************************************/
+void ghash_table_key_init(ghash_key_t *key);
+void ghash_table_multiply(const ghash_key_t *key, unsigned char block[16]);
+
+/* Reduction of the bits shifted out of Z by the portable backend, as the
+ * top 16 bits of Z. GHASH_TABLE_SIZE entries.
+ */
+extern const uint16_t ghash_table_reduce[GHASH_TABLE_SIZE];
+
+/*******************************************************************************
+ * Writes a 64-bit word as 8 big-endian bytes.
+ *
+ * inputs:
+ * - p - Where to write the bytes.
+ * - w - The word to write.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_store_64(unsigned char *p, uint64_t w);
+
+/*******************************************************************************
+ * CLMUL backend.
+ * Same inputs as ghash_key_init()/ghash_update().
+ ******************************************************************************/
+int ghash_clmul_available(void);
+void ghash_clmul_key_init(ghash_key_t *key);
+void ghash_clmul_update(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    const unsigned char *data,
+    size_t length);
+
+#endif
@@ -16,5 +16,7 @@ typedef struct roundKeys roundKeys_t;
 
 /* KeySchedule functions */
 roundKeys_t *key_expansion(const unsigned char *key, int key_size);
+int key_expansion_into(
+    const unsigned char *key, int key_size, unsigned char *keys);
 
 #endif
\ No newline at end of file
@@ -5,6 +5,9 @@
 /* Needed by getSubByte() to map the input byte to a substitution byte */
 extern const unsigned char sbox_table[256];
 
+/* Lookup table for the inverse AES S-box */
+extern const unsigned char inv_sbox_table[256];
+
 /* Lookup table for the AES Rcon */
 extern const unsigned char rcon_table[15];
 
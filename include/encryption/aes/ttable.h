@@ -0,0 +1,53 @@
+#ifndef ENCRYPTION_AES_TTABLE_H
+#define ENCRYPTION_AES_TTABLE_H
+
+#include <stdint.h>
+
+#include "encryption/aes/core.h"
+
+/* Combined SubBytes+ShiftRows+MixColumns tables on 32-bit column words */
+extern const uint32_t aes_te0[256];
+extern const uint32_t aes_te1[256];
+extern const uint32_t aes_te2[256];
+extern const uint32_t aes_te3[256];
+
+/* Combined InvSubBytes+InvShiftRows+InvMixColumns tables */
+extern const uint32_t aes_td0[256];
+extern const uint32_t aes_td1[256];
+extern const uint32_t aes_td2[256];
+extern const uint32_t aes_td3[256];
+
+/*******************************************************************************
+ * AES encryption/decryption of a single block using the T-table round engine.
+ * Each round is 16 table lookups on 32-bit column words instead of separate
+ * SubBytes, ShiftRows, MixColumns & AddRoundKey passes over a state matrix.
+ *
+ * inputs:
+ * - input - The input to encrypt/decrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the result. May be the same as input.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_ttable_encrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output);
+void aes_ttable_decrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output);
+
+/*******************************************************************************
+ * AES encryption of several independent blocks using the T-table round
+ * engine. Blocks are interleaved 4 at a time.
+ *
+ * inputs:
+ * - input - The blocks to encrypt. num_blocks * 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted blocks.
+ * - num_blocks - The number of blocks.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_ttable_encrypt_blocks(
+    const unsigned char *input, const aes_context_t *ctx,
+    unsigned char *output, size_t num_blocks);
+
+#endif
@@ -1,8 +1,16 @@
 #ifndef ENCRYPTION_ENCRYPTION_H
 #define ENCRYPTION_ENCRYPTION_H
 
+#include <stddef.h>
+
+/* Bytes of a file encrypted/decrypted at a time
+ * Each chunk has its own authentication tag.
+ */
+#define AES_GCM_FILE_CHUNK_SIZE (1024 * 1024)
+
 /*******************************************************************************
  * Encrypts a file using AES-GCM.
+ * The file is encrypted AES_GCM_FILE_CHUNK_SIZE bytes at a time.
  *
  * inputs:
  * - plaintext_file - The file to encrypt.
@@ -14,9 +22,9 @@
  * - nonce - The nonce. Must be 12 bytes.
  *
  * outputs:
- * - None.
+ * - 0 on success, 1 on failure.
  ******************************************************************************/
-void aes_gcm_encrypt_file(
+int aes_gcm_encrypt_file(
     const char *plaintext_file,
     const char *encrypted_file,
     const unsigned char *key,
@@ -27,6 +35,8 @@ void aes_gcm_encrypt_file(
 
 /*******************************************************************************
  * Decrypts a file using AES-GCM.
+ * Each chunk is checked before it is written. If any chunk is invalid the
+ * decrypted file is deleted.
  *
  * inputs:
  * - encrypted_file - The file to decrypt.
@@ -38,9 +48,9 @@ void aes_gcm_encrypt_file(
  * - nonce - The nonce. Must be 12 bytes.
  *
  * outputs:
- * - None.
+ * - 0 on success, 1 on failure.
  ******************************************************************************/
-void aes_gcm_decrypt_file(
+int aes_gcm_decrypt_file(
     const char *encrypted_file,
     const char *decrypted_file,
     const unsigned char *key,
@@ -49,5 +59,57 @@ void aes_gcm_decrypt_file(
     int aad_length,
     const unsigned char *nonce);
 
+/*******************************************************************************
+ * Encrypts data in memory straight into an encrypted file.
+ * The file has the same format as one written by aes_gcm_encrypt_file().
+ *
+ * inputs:
+ * - data - The data to encrypt.
+ * - length - The length of the data.
+ * - encrypted_file - The file to write the encrypted data to.
+ * - key - The key to use for the encryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_encrypt_buffer_to_file(
+    const unsigned char *data,
+    size_t length,
+    const char *encrypted_file,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce);
+
+/*******************************************************************************
+ * Decrypts a file using AES-GCM straight into memory.
+ * Nothing is returned unless every chunk of the file is authentic.
+ *
+ * inputs:
+ * - encrypted_file - The file to decrypt.
+ * - key - The key to use for the decryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ * - length - Set to the length of the decrypted data.
+ *
+ * outputs:
+ * - The decrypted data(must be freed) or NULL on failure.
+ ******************************************************************************/
+unsigned char *aes_gcm_decrypt_file_to_buffer(
+    const char *encrypted_file,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce,
+    size_t *length);
+
 #endif
 
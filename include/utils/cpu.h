@@ -0,0 +1,25 @@
+#ifndef UTILS_CPU_H
+#define UTILS_CPU_H
+
+/*******************************************************************************
+ * Checks whether the CPU supports the AES-NI instructions.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if AES-NI is supported, otherwise 0.
+ ******************************************************************************/
+int cpu_has_aesni(void);
+
+/*******************************************************************************
+ * Checks whether the CPU supports the PCLMULQDQ(carry-less multiply)
+ * instruction.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if PCLMULQDQ is supported, otherwise 0.
+ ******************************************************************************/
+int cpu_has_pclmul(void);
+
+#endif
@@ -8,6 +8,27 @@
 #include "encryption/encryption.h"
 #include "compression/compression.h"
 
+/* Compression used when databases are saved */
+int database_compression_level = DATABASE_DEFAULT_COMPRESSION_LEVEL;
+
+/*******************************************************************************
+ * Sets the compression level used when databases are saved.
+ * Databases saved at any level can be loaded.
+ *
+ * inputs:
+ * - level - A compression level, plus any COMPRESSION_FILTER_ flags.
+ * outputs:
+ * - 0 if the level is now in use, 1 if it is unknown.
+ ******************************************************************************/
+int database_set_compression_level(int level) {
+
+    if (compression_bound(level, 0) == 0) {
+        return 1;
+    }
+    database_compression_level = level;
+    return 0;
+}
+
 /*******************************************************************************
  * Initialize the database.
  * 
@@ -26,6 +47,20 @@ hospital_record_t *database_init(const char *hospital_name) {
     records->num_patients = 0;
     records->doctors = NULL;
     records->num_doctors = 0;
+    records->patients_tail = NULL;
+    records->doctors_tail = NULL;
+    username_index_init(&records->patient_index);
+    username_index_init(&records->doctor_index);
+    record_slab_init(&records->patient_slab, sizeof(patient_details_t));
+    record_slab_init(&records->doctor_slab, sizeof(doctor_details_t));
+    string_pool_init(&records->strings);
+    records->file = NULL;
+
+    /* Changes are logged with the same key as the database */
+    unsigned char *key = convert_hex_string_to_bytes(
+        "feffe9928665731c6d6a8f9467308308");
+    database_log_init(&records->log, hospital_name, key, 16);
+    free(key);
 
     /* Initialize 10 beds */
     records->beds = (bed_details_t *)malloc(10 * sizeof(bed_details_t));
@@ -54,307 +89,642 @@ hospital_record_t *database_init(const char *hospital_name) {
 }
 
 /*******************************************************************************
- * Load the database.
- * 
+ * Copies a field into the serialized database.
+ *
  * inputs:
- * - hospital_name - The name of the hospital.
+ * - position - The position to write to. Moved past the field.
+ * - field - The field.
+ * - size - The size of the field.
  * outputs:
- * - The database.
+ * - None.
  ******************************************************************************/
-hospital_record_t *load_database(const char *hospital_name) {
+void database_write_field(unsigned char **position, const void *field,
+    size_t size) {
 
-    /* Create encryption key & nonce */
-    unsigned char *key = convert_hex_string_to_bytes(
-        "feffe9928665731c6d6a8f9467308308");
-    unsigned char *nonce = convert_hex_string_to_bytes(
-        "cafebabefacedbaddecaf888");
-    int key_size = 16;
+    memcpy(*position, field, size);
+    *position += size;
+}
 
-    /* Initialize the database */
-    hospital_record_t *records = database_init(hospital_name);
+/*******************************************************************************
+ * Copies a string into the serialized database, padded with zeros.
+ * Longer strings are cut short so the field still ends in a zero.
+ *
+ * inputs:
+ * - position - The position to write to. Moved past the field.
+ * - string - The string.
+ * - size - The size of the field.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void database_write_string(unsigned char **position, const char *string,
+    size_t size) {
 
-    /* Name of database file(s) */
-    char db_name[256];
-    strcpy(db_name, hospital_name);
-    strcat(db_name, "_encrypted.db");
-    char db_name_compressed[256];
-    strcpy(db_name_compressed, hospital_name);
-    strcat(db_name_compressed, "_compressed.db");
+    size_t length = strlen(string);
+    if (length > size - 1) {
+        length = size - 1;
+    }
 
-    /* If the database does not exist */
-    FILE *encrypted_db = fopen(records->encrypted_database_name, "rb");
-    if (encrypted_db == NULL) {
-     
-        /* Assume no database exists yet*/
-        return records;
+    memcpy(*position, string, length);
+    memset(*position + length, 0, size - length);
+    *position += size;
+}
+
+/*******************************************************************************
+ * Copies a string out of the serialized database.
+ * The caller has checked the database is long enough.
+ *
+ * inputs:
+ * - position - The position to read from. Moved past the field.
+ * - string - Where to store the string. Room for size + 1 bytes.
+ * - size - The size of the field.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void database_read_string(const unsigned char **position, char *string,
+    size_t size) {
+
+    memcpy(string, *position, size);
+    string[size] = '\0';
+    *position += size;
+}
+
+/*******************************************************************************
+ * Copies a field out of the serialized database.
+ *
+ * inputs:
+ * - position - The position to read from. Moved past the field.
+ * - end - The end of the serialized database.
+ * - field - Where to store the field.
+ * - size - The size of the field.
+ * outputs:
+ * - 0 on success, 1 if the database ends before the field.
+ ******************************************************************************/
+int database_read_field(const unsigned char **position,
+    const unsigned char *end, void *field, size_t size) {
+
+    if ((size_t)(end - *position) < size) {
+        return 1;
     }
 
-    /* Decrypt the database */
-    aes_gcm_decrypt_file(
-        records->encrypted_database_name,
-        db_name_compressed,
-        key, key_size,
-        NULL, 0,
-        nonce);
+    memcpy(field, *position, size);
+    *position += size;
+    return 0;
+}
 
-    /* Decompress the database */
-    huffman_decompress(db_name_compressed, db_name); 
+/*******************************************************************************
+ * Serializes a doctor.
+ *
+ * inputs:
+ * - position - Where to write DATABASE_DOCTOR_SIZE bytes. Moved past them.
+ * - doctor - The doctor.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void database_write_doctor(unsigned char **position,
+    const doctor_details_t *doctor) {
+
+    database_write_string(position, doctor->username, 256);
+    database_write_string(position, doctor->name, 256);
+    database_write_string(position, doctor->email, 256);
+    database_write_string(position, doctor->phone, 256);
+    database_write_field(position, &doctor->password, sizeof(unsigned int));
+    database_write_string(position, doctor->specialization, 256);
+    database_write_string(position, doctor->license_number, 256);
+}
 
-    /* Open the database file */
-    FILE *db = fopen(db_name, "rb");
+/*******************************************************************************
+ * Serializes a patient.
+ *
+ * inputs:
+ * - position - Where to write DATABASE_PATIENT_SIZE bytes. Moved past them.
+ * - patient - The patient.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void database_write_patient(unsigned char **position,
+    const patient_details_t *patient) {
+
+    database_write_string(position, patient->username, 256);
+    database_write_string(position, patient->name, 256);
+    database_write_string(position, patient->email, 256);
+    database_write_string(position, patient->phone, 256);
+    database_write_field(position, &patient->password, sizeof(unsigned int));
+    database_write_field(position, patient->blood_type, 3);
+    database_write_string(position, patient->medical_history, 256);
+    database_write_field(position, &patient->weight, sizeof(float));
+    database_write_field(position, &patient->height, sizeof(float));
+    database_write_field(position, &patient->bmi, sizeof(float));
+}
+
+/*******************************************************************************
+ * Copies a serialized doctor into the records.
+ * The doctor is not added to the list or the index.
+ *
+ * inputs:
+ * - records - The database.
+ * - position - DATABASE_DOCTOR_SIZE bytes to read. Moved past them.
+ * outputs:
+ * - The doctor, or NULL if memory could not be allocated.
+ ******************************************************************************/
+doctor_details_t *database_read_doctor(hospital_record_t *records,
+    const unsigned char **position) {
+
+    /* Strings are read here then copied into the records */
+    char username[257];
+    char name[257];
+    char email[257];
+    char phone[257];
+    char specialization[257];
+    char license_number[257];
+    doctor_details_t fields;
+
+    database_read_string(position, username, 256);
+    database_read_string(position, name, 256);
+    database_read_string(position, email, 256);
+    database_read_string(position, phone, 256);
+    memcpy(&fields.password, *position, sizeof(unsigned int));
+    *position += sizeof(unsigned int);
+    database_read_string(position, specialization, 256);
+    database_read_string(position, license_number, 256);
+    fields.username = username;
+    fields.name = name;
+    fields.email = email;
+    fields.phone = phone;
+    fields.specialization = specialization;
+    fields.license_number = license_number;
+
+    return doctor_copy(records, &fields);
+}
+
+/*******************************************************************************
+ * Copies a serialized patient into the records.
+ * The patient is not added to the list or the index.
+ *
+ * inputs:
+ * - records - The database.
+ * - position - DATABASE_PATIENT_SIZE bytes to read. Moved past them.
+ * outputs:
+ * - The patient, or NULL if memory could not be allocated.
+ ******************************************************************************/
+patient_details_t *database_read_patient(hospital_record_t *records,
+    const unsigned char **position) {
+
+    /* Strings are read here then copied into the records */
+    char username[257];
+    char name[257];
+    char email[257];
+    char phone[257];
+    char medical_history[257];
+    patient_details_t fields;
+
+    memset(&fields, 0, sizeof(fields));
+    database_read_string(position, username, 256);
+    database_read_string(position, name, 256);
+    database_read_string(position, email, 256);
+    database_read_string(position, phone, 256);
+    memcpy(&fields.password, *position, sizeof(unsigned int));
+    *position += sizeof(unsigned int);
+    memcpy(fields.blood_type, *position, 3);
+    *position += 3;
+    database_read_string(position, medical_history, 256);
+    memcpy(&fields.weight, *position, sizeof(float));
+    memcpy(&fields.height, *position + sizeof(float), sizeof(float));
+    memcpy(&fields.bmi, *position + 2 * sizeof(float), sizeof(float));
+    *position += 3 * sizeof(float);
+    fields.username = username;
+    fields.name = name;
+    fields.email = email;
+    fields.phone = phone;
+    fields.medical_history = medical_history;
+
+    return patient_copy(records, &fields);
+}
+
+/*******************************************************************************
+ * Reads every record not yet read from the database file into the lists.
+ * Needed before walking the lists, since records are only read from the
+ * database file when first used.
+ *
+ * inputs:
+ * - records - The database.
+ * outputs:
+ * - None. Exits if the database file is corrupt.
+ ******************************************************************************/
+void database_load_all(hospital_record_t *records) {
+
+    /* Stop rather than continue with(and later save over) a damaged
+     * database.
+     */
+    if (records->file != NULL && database_file_load_all(records) != 0) {
+        printf("[ERROR] %s is corrupt\n", records->encrypted_database_name);
+        exit(1);
+    }
+}
+
+/*******************************************************************************
+ * Serializes the database into memory.
+ * Format:
+ *   number of doctors | doctors | number of patients | patients
+ * Every record has a fixed size(DATABASE_DOCTOR_SIZE/DATABASE_PATIENT_SIZE).
+ * Strings are padded with zeros to 256 bytes.
+ * 
+ * inputs:
+ * - records - The hospital records.
+ * - size - Set to the size of the serialized database.
+ * outputs:
+ * - The serialized database(must be freed) or NULL on failure.
+ ******************************************************************************/
+unsigned char *database_serialize(hospital_record_t *records, size_t *size) {
+
+    database_load_all(records);
+
+    /* Count the records actually in the lists so the size is exact */
+    int num_doctors = 0;
+    doctor_details_t *doctors = records->doctors;
+    while (doctors != NULL) {
+        num_doctors++;
+        doctors = doctors->next;
+    }
+    int num_patients = 0;
+    patient_details_t *patients = records->patients;
+    while (patients != NULL) {
+        num_patients++;
+        patients = patients->next;
+    }
+
+    /* Allocate the whole database at once */
+    *size = 2 * sizeof(int) +
+        (size_t)num_doctors * DATABASE_DOCTOR_SIZE +
+        (size_t)num_patients * DATABASE_PATIENT_SIZE;
+    unsigned char *data = (unsigned char *)malloc(*size);
+    if (data == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return NULL;
+    }
+    unsigned char *position = data;
 
     /* -----------------------------------------------------------------------*/
     /* Doctors section */
     /* -----------------------------------------------------------------------*/
-    /* Read all the doctors from the database */
-    fread(&records->num_doctors, sizeof(int), 1, db);
+    database_write_field(&position, &num_doctors, sizeof(int));
 
-    /* Linked list for doctors */
-    /* Keeps track of the last doctor in the linked list */
-    doctor_details_t *doctors_tail = NULL;
+    for (doctors = records->doctors; doctors != NULL; doctors = doctors->next) {
+        database_write_doctor(&position, doctors);
+    }
 
-    /* Load all the doctors from the database */
+    /* -----------------------------------------------------------------------*/
+    /* Patient section */
+    /* -----------------------------------------------------------------------*/
+    database_write_field(&position, &num_patients, sizeof(int));
+
+    for (patients = records->patients; patients != NULL;
+        patients = patients->next) {
+        database_write_patient(&position, patients);
+    }
+
+    return data;
+}
+
+/*******************************************************************************
+ * Reads a serialized database into the hospital records.
+ * Bytes after the last patient are ignored.
+ * 
+ * inputs:
+ * - records - The hospital records. Must be empty.
+ * - data - The serialized database.
+ * - size - The size of the serialized database.
+ * outputs:
+ * - 0 on success, 1 if the serialized database is invalid.
+ ******************************************************************************/
+int database_deserialize(hospital_record_t *records, const unsigned char *data,
+    size_t size) {
+
+    const unsigned char *position = data;
+    const unsigned char *end = data + size;
+    int num_doctors;
+    int num_patients;
     int i;
-    for (i = 0; i < records->num_doctors; i++) {
-
-        /* Allocate memory to hold the new doctor */
-        doctor_details_t *doctor = (doctor_details_t *)calloc(
-            1, sizeof(doctor_details_t)
-        );
-        
-        /* Read each field from the database */
-        /* Username */
-        fread(doctor->username, sizeof(char), 256, db);
-        /* Name */
-        fread(doctor->name, sizeof(char), 256, db);
-        /* Email */
-        fread(doctor->email, sizeof(char), 256, db);
-        /* Phone */
-        fread(doctor->phone, sizeof(char), 256, db);
-        /* Password */
-        fread(&doctor->password, sizeof(unsigned int), 1, db);
-        /* Specialization */
-        fread(doctor->specialization, sizeof(char), 256, db);
-        /* License number */
-        fread(doctor->license_number, sizeof(char), 256, db);
-
-        /* If this is the first entry of the linked list */
-        if ( records->doctors == NULL ) {
-            records->doctors = doctor;
-            doctors_tail = doctor;
 
-        /* For all other entries */
-        } else {
-            /* Update the tail to the new doctor */
-            doctors_tail->next = doctor;
+    /* -----------------------------------------------------------------------*/
+    /* Doctors section */
+    /* -----------------------------------------------------------------------*/
+    if (database_read_field(&position, end, &num_doctors, sizeof(int)) ||
+        num_doctors < 0) {
+        return 1;
+    }
+
+    /* Room in the index for every doctor */
+    if ((size_t)num_doctors >
+            (size_t)(end - position) / DATABASE_DOCTOR_SIZE ||
+        username_index_reserve(&records->doctor_index,
+            records->doctor_index.count + num_doctors) != 0) {
+        return 1;
+    }
+
+    for (i = 0; i < num_doctors; i++) {
+
+        if ((size_t)(end - position) < DATABASE_DOCTOR_SIZE) {
+            return 1;
+        }
+
+        /* Copy the doctor into the records */
+        doctor_details_t *doctor = database_read_doctor(records, &position);
+        if (doctor == NULL) {
+            return 1;
+        }
+
+        /* Index by username. If a username is used twice only the first
+         * is found, as when the list was searched.
+         */
+        username_index_insert(&records->doctor_index, doctor->username,
+            doctor);
 
-            /* Prepare to store the next doctor */
-            doctors_tail = doctors_tail->next;
+        /* Append to the linked list */
+        if (records->doctors_tail == NULL) {
+            records->doctors = doctor;
+        } else {
+            records->doctors_tail->next = doctor;
         }
+        records->doctors_tail = doctor;
+        records->num_doctors++;
     }
 
     /* -----------------------------------------------------------------------*/
     /* Patients section */
     /* -----------------------------------------------------------------------*/
+    if (database_read_field(&position, end, &num_patients, sizeof(int)) ||
+        num_patients < 0) {
+        return 1;
+    }
 
-    /* Read all the patients from the database */
-    fread(&records->num_patients, sizeof(int), 1, db);
-
-    /* Linked list for patients */
-    /* Keeps track of the last patient in the linked list */
-    patient_details_t *patients_tail = NULL;
-
-    /* Load all the patients from the database */
-    for (i = 0; i < records->num_patients; i++) {
-
-        /* Allocate memory to hold the new patient */
-        patient_details_t *patient = (patient_details_t *)calloc(
-            1, sizeof(patient_details_t)
-        );
-        
-        /* Read each field from the database */
-        /* Username */
-        fread(patient->username, sizeof(char), 256, db);
-        /* Name */
-        fread(patient->name, sizeof(char), 256, db);
-        /* Email */
-        fread(patient->email, sizeof(char), 256, db);
-        /* Phone */
-        fread(patient->phone, sizeof(char), 256, db);
-        /* Password */
-        fread(&patient->password, sizeof(unsigned int), 1, db);
-        /* Blood type */
-        fread(patient->blood_type, sizeof(char), 3, db);
-        /* Medical history */
-        fread(patient->medical_history, sizeof(char), 256, db);
-        /* Weight */
-        fread(&patient->weight, sizeof(float), 1, db);
-        /* Height */
-        fread(&patient->height, sizeof(float), 1, db);
-        /* BMI */
-        fread(&patient->bmi, sizeof(float), 1, db);
-
-        /* If this is the first entry of the linked list */
-        if ( records->patients == NULL ) {
-            records->patients = patient;
-            patients_tail = patient;
+    /* Room in the index for every patient */
+    if ((size_t)num_patients >
+            (size_t)(end - position) / DATABASE_PATIENT_SIZE ||
+        username_index_reserve(&records->patient_index,
+            records->patient_index.count + num_patients) != 0) {
+        return 1;
+    }
 
-        /* For all other entries */
-        } else {
-            /* Update the tail to the new patient */
-            patients_tail->next = patient;
+    for (i = 0; i < num_patients; i++) {
 
-            /* Prepare to store the next patient */
-            patients_tail = patients_tail->next;
+        if ((size_t)(end - position) < DATABASE_PATIENT_SIZE) {
+            return 1;
         }
+
+        /* Copy the patient into the records */
+        patient_details_t *patient = database_read_patient(records,
+            &position);
+        if (patient == NULL) {
+            return 1;
+        }
+
+        /* Index by username. If a username is used twice only the first
+         * is found, as when the list was searched.
+         */
+        username_index_insert(&records->patient_index, patient->username,
+            patient);
+
+        /* Append to the linked list */
+        if (records->patients_tail == NULL) {
+            records->patients = patient;
+        } else {
+            records->patients_tail->next = patient;
+        }
+        records->patients_tail = patient;
+        records->num_patients++;
     }
 
-    /* Close the files opened */
-    fclose(db);
-    fclose(encrypted_db);
+    return 0;
+}
 
-    /* Remove the compressed database file */
-    if (remove(db_name_compressed) != 0) {
-        printf("Error: Failed to delete %s\n", db_name_compressed);
+/*******************************************************************************
+ * Rebuilds the username indexes & finds the last patient & doctor again.
+ * Only needed after the lists are changed directly rather than through the
+ * signup, import & delete functions.
+ * 
+ * inputs:
+ * - records - The database.
+ * outputs:
+ * - 0 on success, 1 if a username is used twice or memory could not be
+ *   allocated.
+ ******************************************************************************/
+int database_rebuild_indexes(hospital_record_t *records) {
+
+    int failed = 0;
+
+    database_load_all(records);
+    username_index_free(&records->patient_index);
+    username_index_free(&records->doctor_index);
+    if (username_index_reserve(&records->patient_index,
+            (size_t)records->num_patients) != 0 ||
+        username_index_reserve(&records->doctor_index,
+            (size_t)records->num_doctors) != 0) {
+        return 1;
     }
 
-    /* Remove the database file */
-    if (remove(db_name) != 0) {
-        printf("Error: Failed to delete %s\n", db_name);
+    patient_details_t *patients;
+    records->patients_tail = NULL;
+    for (patients = records->patients; patients != NULL;
+        patients = patients->next) {
+        failed |= username_index_insert(&records->patient_index,
+            patients->username, patients);
+        records->patients_tail = patients;
     }
 
-    /* Return the list of users */
-    return records;
+    doctor_details_t *doctors;
+    records->doctors_tail = NULL;
+    for (doctors = records->doctors; doctors != NULL; doctors = doctors->next) {
+        failed |= username_index_insert(&records->doctor_index,
+            doctors->username, doctors);
+        records->doctors_tail = doctors;
+    }
+
+    return failed;
 }
 
 /*******************************************************************************
- * Save the database.
- * 
+ * Reads a database saved whole before the paged database file.
+ * The database is decrypted, decompressed & read entirely in memory.
+ *
  * inputs:
- * - records - The hospital records.
+ * - records - The hospital records. Must be empty.
+ * - key - The key the database was encrypted with.
+ * - key_size - The size of the key.
  * outputs:
- * - None.
+ * - None. Exits if the database is corrupt.
  ******************************************************************************/
-void save_database(hospital_record_t *records) {
+void database_load_whole(hospital_record_t *records, const unsigned char *key,
+    int key_size) {
 
-    /* Create encryption key & nonce */
-    unsigned char *key = convert_hex_string_to_bytes(
-        "feffe9928665731c6d6a8f9467308308");
     unsigned char *nonce = convert_hex_string_to_bytes(
         "cafebabefacedbaddecaf888");
-    int key_size = 16;
 
-    /* Name of database file(s) */
-    char db_name[256];
-    strcpy(db_name, records->hospital_name);
-    strcat(db_name, ".db");
-    /* Compressed database name */
-    char db_name_compressed[256];
-    strcpy(db_name_compressed, records->hospital_name);
-    strcat(db_name_compressed, "_compressed.db");
-
-    /* Open the database file */
-    FILE *db = fopen(db_name, "wb");
-
-    /* Failure to open the database file should cause the program to exit.*/
-    if (db == NULL) {
-        printf("Error: Failed to open stored database file.\n");
+    /* Decrypt the database
+    * Stop rather than continue with(and later save over) a damaged database.
+    */
+    size_t compressed_size;
+    unsigned char *compressed = aes_gcm_decrypt_file_to_buffer(
+        records->encrypted_database_name,
+        key, key_size,
+        NULL, 0,
+        nonce,
+        &compressed_size);
+    free(nonce);
+    if (compressed == NULL) {
+        printf("[ERROR] Failed to decrypt %s\n",
+            records->encrypted_database_name);
         exit(1);
     }
 
-    /* -----------------------------------------------------------------------*/
-    /* Doctors section */
-    /* -----------------------------------------------------------------------*/
+    /* Decompress the database */
+    size_t size;
+    unsigned char *data = NULL;
+    if (compression_decompressed_size(compressed, compressed_size,
+            &size) == 0) {
+        data = (unsigned char *)malloc(size > 0 ? size : 1);
+    }
+    if (data != NULL && compression_decompress(compressed, compressed_size,
+            data, size, &size) != 0) {
+        free(data);
+        data = NULL;
+    }
+    free(compressed);
 
-    /* Write the number of doctors to the database */
-    fwrite(&records->num_doctors, sizeof(int), 1, db);
+    /* Read the doctors & patients */
+    if (data == NULL || database_deserialize(records, data, size) != 0) {
+        printf("[ERROR] %s is corrupt\n", records->encrypted_database_name);
+        exit(1);
+    }
+    free(data);
+}
 
-    /* Linked list for doctors */
-    doctor_details_t *doctors = records->doctors;
+/*******************************************************************************
+ * Load the database.
+ * Only the header & the table of the database file are read. Each record is
+ * read from the file the first time it is used. Databases saved whole by
+ * older versions are read entirely.
+ * 
+ * inputs:
+ * - hospital_name - The name of the hospital.
+ * outputs:
+ * - The database.
+ ******************************************************************************/
+hospital_record_t *load_database(const char *hospital_name) {
 
-    /* Add each node to the database */
-    while (doctors != NULL) {
-       /* Write each field to the database */
-       /* Username*/
-        fwrite(doctors->username, sizeof(char), 256, db);
-        /* Name */
-        fwrite(doctors->name, sizeof(char), 256, db);
-        /* Email */
-        fwrite(doctors->email, sizeof(char), 256, db);
-        /* Phone */
-        fwrite(doctors->phone, sizeof(char), 256, db);
-        /* Password */
-        fwrite(&doctors->password, sizeof(unsigned int), 1, db);
-        /* Specialization */
-        fwrite(doctors->specialization, sizeof(char), 256, db);
-        /* License number */
-        fwrite(doctors->license_number, sizeof(char), 256, db);
-        
-        /* Move to the next node */
-        doctors = doctors->next;
-    }
+    /* Initialize the database */
+    hospital_record_t *records = database_init(hospital_name);
 
-    /* -----------------------------------------------------------------------*/
-    /* Patient section */
-    /* -----------------------------------------------------------------------*/
+    /* If the database does not exist */
+    FILE *encrypted_db = fopen(records->encrypted_database_name, "rb");
+    if (encrypted_db == NULL) {
+     
+        /* Assume no database exists yet, though changes may be logged */
+        if (database_log_replay(records, 0) != 0) {
+            exit(1);
+        }
+        return records;
+    }
+    fclose(encrypted_db);
 
-    /* Write the number of patients to the database */
-    fwrite(&records->num_patients, sizeof(int), 1, db);
+    /* Create encryption key */
+    unsigned char *key = convert_hex_string_to_bytes(
+        "feffe9928665731c6d6a8f9467308308");
+    int key_size = 16;
 
-    /* Linked list for patients */
-    patient_details_t *patients = records->patients;
+    if (!database_file_is_paged(records->encrypted_database_name)) {
+        database_load_whole(records, key, key_size);
+        free(key);
+    } else {
+
+        /* Open the database file
+        * Stop rather than continue with(and later save over) a damaged
+        * database.
+        */
+        records->file = database_file_open(records->encrypted_database_name,
+            key, key_size);
+        free(key);
+        if (records->file == NULL) {
+            printf("[ERROR] %s is corrupt\n",
+                records->encrypted_database_name);
+            exit(1);
+        }
+        records->num_doctors = (int)records->file->num_doctors;
+        records->num_patients = (int)records->file->num_patients;
+    }
 
-    /* Add each node to the database */
-    while (patients != NULL) {
-        /* Write each field to the database */
-        /* Username */
-        fwrite(patients->username, sizeof(char), 256, db);
-        /* Name */
-        fwrite(patients->name, sizeof(char), 256, db);
-        /* Email */
-        fwrite(patients->email, sizeof(char), 256, db);
-        /* Phone */
-        fwrite(patients->phone, sizeof(char), 256, db);
-        /* Password */
-        fwrite(&patients->password, sizeof(unsigned int), 1, db);
-        /* Blood type */
-        fwrite(patients->blood_type, sizeof(char), 3, db);
-        /* Medical history */
-        fwrite(patients->medical_history, sizeof(char), 256, db);
-        /* Weight */
-        fwrite(&patients->weight, sizeof(float), 1, db);
-        /* Height */
-        fwrite(&patients->height, sizeof(float), 1, db);
-        /* BMI */
-        fwrite(&patients->bmi, sizeof(float), 1, db);
-
-        /* Move to the next patient */
-        patients = patients->next;
+    /* Apply the changes made since the database file was written */
+    if (database_log_replay(records,
+            records->file != NULL ? records->file->checkpoint : 0) != 0) {
+        exit(1);
     }
 
-    /* Close the database file */
-    fclose(db);
+    /* Return the list of users */
+    return records;
+}
 
-    /* Compress the database */
-    huffman_compress(db_name, db_name_compressed);
+/*******************************************************************************
+ * Writes every record to a new database file, which then replaces the old
+ * one. The old database file is kept if writing fails part way. The new
+ * file is on disk before this returns, so the logs can then be removed.
+ *
+ * inputs:
+ * - records - The hospital records.
+ * - checkpoint - The number of the new database file.
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int database_write_checkpoint(hospital_record_t *records, size_t checkpoint) {
 
-    /* Encrypt the database */
-    aes_gcm_encrypt_file(
-        db_name_compressed,
-        records->encrypted_database_name,
-        key, key_size,
-        NULL, 0,
-        nonce);
-    
-    /* Remove all database file(s) except the encrypted database file */
-    if (remove(db_name_compressed) != 0) {
-        printf("Error: Failed to delete %s\n", db_name_compressed);
+    char temporary_name[sizeof(records->encrypted_database_name) + 4];
+
+    /* The old file is replaced, so read what is left of it first */
+    database_load_all(records);
+
+    /* Create encryption key */
+    unsigned char *key = convert_hex_string_to_bytes(
+        "feffe9928665731c6d6a8f9467308308");
+    int key_size = 16;
+
+    /* Write the database next to the old one, then replace it */
+    strcpy(temporary_name, records->encrypted_database_name);
+    strcat(temporary_name, ".tmp");
+    int failed = key == NULL || database_file_write(records, temporary_name,
+        database_compression_level, key, key_size, checkpoint) != 0 ||
+        database_file_replace(temporary_name,
+            records->encrypted_database_name) != 0 ||
+        database_file_sync_directory(records->encrypted_database_name) != 0;
+    free(key);
+
+    if (failed) {
+        remove(temporary_name);
     }
+    return failed;
+}
 
-    if (remove(db_name) != 0) {
-        printf("Error: Failed to delete %s\n", db_name);
+/*******************************************************************************
+ * Save the database.
+ * Every record is written to the database file & the logs are removed.
+ * 
+ * inputs:
+ * - records - The hospital records.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void save_database(hospital_record_t *records) {
+
+    /* Let a checkpoint in the background finish first */
+    database_log_wait(records);
+
+    /* Failure to save the database should cause the program to exit.*/
+    size_t checkpoint = records->log.checkpoint + 1;
+    if (database_write_checkpoint(records, checkpoint) != 0) {
+        printf("Error: Failed to write %s\n",
+            records->encrypted_database_name);
+        exit(1);
     }
 
+    /* Every change is in the database file now */
+    database_log_reset(records, checkpoint);
 }
 
 
@@ -368,30 +738,18 @@ void save_database(hospital_record_t *records) {
  ******************************************************************************/
 void close_database(hospital_record_t *records) {
 
-    /* Free the linked list of patients */
-    patient_details_t *patients = records->patients;
-    while (patients != NULL) {
-        /* Store the next node before freeing the current node */
-        patient_details_t *next = patients->next;
-        free(patients);
+    /* Close the log & the database file */
+    database_log_close(records);
+    database_file_close(records->file);
 
-        /* Move to the next node */
-        /* Loop will continue until the next node is NULL */
-        patients = next;
-    }
+    /* Free the patients, the doctors & their strings */
+    record_slab_free(&records->patient_slab);
+    record_slab_free(&records->doctor_slab);
+    string_pool_free(&records->strings);
 
-    /* Free the linked list of doctors */
-    doctor_details_t *doctors = records->doctors;
-    while (doctors != NULL) {
-
-        /* Store the next node before freeing the current node */
-        doctor_details_t *next = doctors->next;
-        free(doctors);
-
-        /* Move to the next node */
-        /* Loop will continue until the next node is NULL */
-        doctors = next;
-    }
+    /* Free the indexes */
+    username_index_free(&records->patient_index);
+    username_index_free(&records->doctor_index);
 
     /* Free the list of beds */
     free(records->beds);
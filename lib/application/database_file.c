@@ -0,0 +1,1028 @@
+#ifdef DATABASE_POSIX
+/* mmap() & fstat() to map the database file, fsync() & fileno() */
+#define _POSIX_C_SOURCE 200112L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef DATABASE_POSIX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "application/database.h"
+#include "application/database_file.h"
+#include "compression/compression.h"
+#include "encryption/aes/gcm.h"
+#include "utils/random.h"
+
+/*******************************************************************************
+ * Stores a number in 4 bytes, least significant first.
+ *
+ * inputs:
+ * - bytes - Where to store the number
+ * - value - The number. Must fit in 32 bits.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_put32(unsigned char *bytes, size_t value) {
+
+    int i;
+    for (i = 0; i < 4; i++) {
+        bytes[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/*******************************************************************************
+ * Reads a number stored by database_file_put32().
+ *
+ * inputs:
+ * - bytes - The stored number
+ * outputs:
+ * - The number
+ ******************************************************************************/
+size_t database_file_get32(const unsigned char *bytes) {
+
+    return (size_t)bytes[0] | (size_t)bytes[1] << 8 |
+        (size_t)bytes[2] << 16 | (size_t)bytes[3] << 24;
+}
+
+/*******************************************************************************
+ * Stores a number in 8 bytes, least significant first.
+ *
+ * inputs:
+ * - bytes - Where to store the number
+ * - value - The number
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_put64(unsigned char *bytes, size_t value) {
+
+    /* Shifted in 2 steps so a 32-bit size_t is not shifted by 32 */
+    database_file_put32(bytes, value & 0xFFFFFFFFUL);
+    database_file_put32(bytes + 4, (value >> 16) >> 16);
+}
+
+/*******************************************************************************
+ * Reads a number stored by database_file_put64().
+ *
+ * inputs:
+ * - bytes - The stored number
+ * - value - Set to the number
+ * outputs:
+ * - 0 on success, 1 if the number does not fit in a size_t
+ ******************************************************************************/
+int database_file_get64(const unsigned char *bytes, size_t *value) {
+
+    size_t high = database_file_get32(bytes + 4);
+    if (((high << 16) << 16) >> 16 >> 16 != high) {
+        return 1;
+    }
+    *value = database_file_get32(bytes) | (high << 16) << 16;
+    return 0;
+}
+
+/*******************************************************************************
+ * Creates the nonce for a page. Every page of a file has its own nonce, &
+ * every file its own salt, so no nonce is used twice with the key.
+ *
+ * inputs:
+ * - salt - The salt of the file
+ * - page_number - The number of the page. The table uses the number after
+ *                 the last page.
+ * - nonce - Where to store the 12 byte nonce
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_nonce(const unsigned char salt[8], size_t page_number,
+    unsigned char nonce[12]) {
+
+    memcpy(nonce, salt, 8);
+    database_file_put32(nonce + 8, page_number);
+}
+
+/*******************************************************************************
+ * Gets the number of pages needed for some records.
+ *
+ * inputs:
+ * - num_records - The number of records
+ * - per_page - The number of records that fit in a page
+ * outputs:
+ * - The number of pages
+ ******************************************************************************/
+size_t database_file_count_pages(size_t num_records, size_t per_page) {
+
+    return (num_records + per_page - 1) / per_page;
+}
+
+/*******************************************************************************
+ * Orders lookup entries by hash, then by record.
+ ******************************************************************************/
+int database_file_compare_lookups(const void *a, const void *b) {
+
+    const database_file_lookup_t *x = (const database_file_lookup_t *)a;
+    const database_file_lookup_t *y = (const database_file_lookup_t *)b;
+
+    if (x->hash != y->hash) {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    return (x->record > y->record) - (x->record < y->record);
+}
+
+/*******************************************************************************
+ * Checks whether a file is a paged database file.
+ *
+ * inputs:
+ * - filename - The file
+ * outputs:
+ * - 1 if the file starts with DATABASE_FILE_MAGIC, otherwise 0
+ ******************************************************************************/
+int database_file_is_paged(const char *filename) {
+
+    unsigned char magic[4];
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return 0;
+    }
+    size_t size = fread(magic, 1, sizeof(magic), file);
+    fclose(file);
+
+    return size == sizeof(magic) &&
+        memcmp(magic, DATABASE_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+/*******************************************************************************
+ * Writes what is buffered for a file to disk.
+ * Without DATABASE_POSIX it is only handed to the system.
+ *
+ * inputs:
+ * - file - The file
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_sync(FILE *file) {
+
+    if (fflush(file) != 0) {
+        return 1;
+    }
+#ifdef DATABASE_POSIX
+    if (fsync(fileno(file)) != 0) {
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+/*******************************************************************************
+ * Writes the directory holding a file to disk, so a file that was just
+ * created or renamed is still there after a crash.
+ * Does nothing without DATABASE_POSIX.
+ *
+ * inputs:
+ * - filename - The file
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_sync_directory(const char *filename) {
+
+#ifdef DATABASE_POSIX
+    char directory[512];
+
+    const char *slash = strrchr(filename, '/');
+    if (slash == NULL) {
+        strcpy(directory, ".");
+    } else if (slash == filename) {
+        strcpy(directory, "/");
+    } else if ((size_t)(slash - filename) < sizeof(directory)) {
+        memcpy(directory, filename, slash - filename);
+        directory[slash - filename] = '\0';
+    } else {
+        return 1;
+    }
+
+    int descriptor = open(directory, O_RDONLY);
+    if (descriptor < 0) {
+        return 1;
+    }
+    int failed = fsync(descriptor) != 0;
+    close(descriptor);
+    return failed;
+#else
+    (void)filename;
+    return 0;
+#endif
+}
+
+/*******************************************************************************
+ * Replaces a file with another.
+ * rename() only replaces a file that exists on POSIX systems, so without
+ * DATABASE_POSIX the file is removed first.
+ *
+ * inputs:
+ * - from - The new file
+ * - to - The file to replace. Need not exist.
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_replace(const char *from, const char *to) {
+
+#ifndef DATABASE_POSIX
+    remove(to);
+#endif
+    return rename(from, to) != 0;
+}
+
+/*******************************************************************************
+ * Compresses & encrypts a page, then writes it to the end of the file.
+ *
+ * inputs:
+ * - file - The file
+ * - page - The records of the page. Encrypted in place.
+ * - size - The size of the records
+ * - compressed - Space for the compressed page
+ * - bound - The size of the space for the compressed page
+ * - level - The compression level
+ * - key - The key to encrypt with
+ * - key_size - The size of the key
+ * - salt - The salt of the file
+ * - page_number - The number of the page
+ * - entry - Set to where the page was written & its tag
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_write_page(FILE *file, const unsigned char *page,
+    size_t size, unsigned char *compressed, size_t bound, int level,
+    const unsigned char *key, int key_size, const unsigned char salt[8],
+    size_t page_number, database_file_page_t *entry) {
+
+    aes_gcm_context_t ctx;
+    unsigned char nonce[12];
+
+    if (compression_compress(level, page, size, compressed, bound,
+            &entry->stored_size) != 0) {
+        return 1;
+    }
+
+    database_file_nonce(salt, page_number, nonce);
+    aes_gcm_init(&ctx, key, key_size, nonce, AES_GCM_ENCRYPT);
+    aes_gcm_update(&ctx, compressed, entry->stored_size, compressed);
+    aes_gcm_final(&ctx, entry->tag);
+
+    long offset = ftell(file);
+    if (offset < 0 || fwrite(compressed, 1, entry->stored_size, file) !=
+            entry->stored_size) {
+        return 1;
+    }
+    entry->offset = (size_t)offset;
+    return 0;
+}
+
+/*******************************************************************************
+ * Writes every patient & doctor in the lists to a paged database file.
+ * Format:
+ *   header | pages of doctors | pages of patients | table
+ * The header is DATABASE_FILE_ALIGNMENT bytes & is not encrypted. The pages
+ * are packed one after another. The table says where each page is & holds
+ * its tag, then lists every doctor & patient by username hash. The table is
+ * encrypted with the header as AAD, so the header cannot be changed either.
+ *
+ * inputs:
+ * - records - The hospital records. Every record must be in the lists.
+ * - filename - The file to write
+ * - level - The compression level for the pages
+ * - key - The key to encrypt with
+ * - key_size - The size of the key
+ * - checkpoint - The number of the file
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int database_file_write(hospital_record_t *records, const char *filename,
+    int level, const unsigned char *key, int key_size, size_t checkpoint) {
+
+    size_t doctors_per_page = DATABASE_FILE_PAGE_SIZE / DATABASE_DOCTOR_SIZE;
+    size_t patients_per_page = DATABASE_FILE_PAGE_SIZE / DATABASE_PATIENT_SIZE;
+    size_t num_doctors = 0;
+    size_t num_patients = 0;
+    size_t i;
+    int failed = 0;
+
+    doctor_details_t *doctor;
+    for (doctor = records->doctors; doctor != NULL; doctor = doctor->next) {
+        num_doctors++;
+    }
+    patient_details_t *patient;
+    for (patient = records->patients; patient != NULL;
+        patient = patient->next) {
+        num_patients++;
+    }
+    size_t num_doctor_pages = database_file_count_pages(num_doctors,
+        doctors_per_page);
+    size_t num_pages = num_doctor_pages +
+        database_file_count_pages(num_patients, patients_per_page);
+    if (num_doctors > 0xFFFFFFFFUL || num_patients > 0xFFFFFFFFUL) {
+        return 1;
+    }
+
+    /* The table & space to build each page in */
+    size_t table_size = num_pages * DATABASE_FILE_PAGE_ENTRY_SIZE +
+        (num_doctors + num_patients) * DATABASE_FILE_LOOKUP_ENTRY_SIZE;
+    size_t bound = compression_bound(level, DATABASE_FILE_PAGE_SIZE);
+    database_file_page_t *pages = (database_file_page_t *)malloc(
+        (num_pages > 0 ? num_pages : 1) * sizeof(database_file_page_t));
+    database_file_lookup_t *lookups = (database_file_lookup_t *)malloc(
+        (num_doctors + num_patients > 0 ? num_doctors + num_patients : 1) *
+        sizeof(database_file_lookup_t));
+    unsigned char *table = (unsigned char *)malloc(
+        table_size > 0 ? table_size : 1);
+    unsigned char *page = (unsigned char *)malloc(DATABASE_FILE_PAGE_SIZE);
+    unsigned char *compressed = (unsigned char *)malloc(bound > 0 ? bound : 1);
+    unsigned char *salt = random_bytes(8);
+    FILE *file = fopen(filename, "wb");
+    unsigned char header[DATABASE_FILE_ALIGNMENT];
+
+    if (bound == 0 || pages == NULL || lookups == NULL || table == NULL ||
+        page == NULL || compressed == NULL || salt == NULL || file == NULL) {
+        printf("[ERROR] Failed to write %s\n", filename);
+        failed = 1;
+    }
+
+    /* Room for the header, written last once the table's tag is known */
+    memset(header, 0, sizeof(header));
+    if (!failed) {
+        failed = fwrite(header, 1, sizeof(header), file) != sizeof(header);
+    }
+
+    /* Pages of doctors */
+    unsigned char *position = page;
+    size_t page_number = 0;
+    i = 0;
+    for (doctor = records->doctors; !failed && doctor != NULL;
+        doctor = doctor->next) {
+        database_write_doctor(&position, doctor);
+        lookups[i].hash = username_index_hash(doctor->username);
+        lookups[i].record = (unsigned int)i;
+        i++;
+
+        if (i % doctors_per_page == 0 || doctor->next == NULL) {
+            failed = database_file_write_page(file, page,
+                (size_t)(position - page), compressed, bound, level, key,
+                key_size, salt, page_number, &pages[page_number]);
+            page_number++;
+            position = page;
+        }
+    }
+
+    /* Pages of patients */
+    i = 0;
+    for (patient = records->patients; !failed && patient != NULL;
+        patient = patient->next) {
+        database_write_patient(&position, patient);
+        lookups[num_doctors + i].hash = username_index_hash(patient->username);
+        lookups[num_doctors + i].record = (unsigned int)i;
+        i++;
+
+        if (i % patients_per_page == 0 || patient->next == NULL) {
+            failed = database_file_write_page(file, page,
+                (size_t)(position - page), compressed, bound, level, key,
+                key_size, salt, page_number, &pages[page_number]);
+            page_number++;
+            position = page;
+        }
+    }
+
+    /* Pad so the table starts on a multiple of DATABASE_FILE_ALIGNMENT */
+    long offset = failed ? -1 : ftell(file);
+    if (offset < 0) {
+        failed = 1;
+    } else {
+        size_t padding = (DATABASE_FILE_ALIGNMENT -
+            (size_t)offset % DATABASE_FILE_ALIGNMENT) %
+            DATABASE_FILE_ALIGNMENT;
+        failed = fwrite(header, 1, padding, file) != padding;
+        offset += (long)padding;
+    }
+
+    if (!failed) {
+
+        /* Pages, then the lookups sorted by username hash */
+        position = table;
+        for (i = 0; i < num_pages; i++) {
+            database_file_put64(position, pages[i].offset);
+            database_file_put32(position + 8, pages[i].stored_size);
+            memcpy(position + 12, pages[i].tag, 16);
+            position += DATABASE_FILE_PAGE_ENTRY_SIZE;
+        }
+        qsort(lookups, num_doctors, sizeof(database_file_lookup_t),
+            database_file_compare_lookups);
+        qsort(lookups + num_doctors, num_patients,
+            sizeof(database_file_lookup_t), database_file_compare_lookups);
+        for (i = 0; i < num_doctors + num_patients; i++) {
+            database_file_put32(position, lookups[i].hash);
+            database_file_put32(position + 4, lookups[i].record);
+            position += DATABASE_FILE_LOOKUP_ENTRY_SIZE;
+        }
+
+        /* The header */
+        memcpy(header, DATABASE_FILE_MAGIC, 4);
+        database_file_put32(header + 4, DATABASE_FILE_VERSION);
+        database_file_put32(header + 8, DATABASE_FILE_ALIGNMENT);
+        database_file_put32(header + 12, DATABASE_FILE_PAGE_SIZE);
+        database_file_put32(header + 16, num_doctors);
+        database_file_put32(header + 20, num_patients);
+        database_file_put32(header + 24, doctors_per_page);
+        database_file_put32(header + 28, patients_per_page);
+        database_file_put32(header + 32, num_pages);
+        database_file_put32(header + 36, checkpoint);
+        memcpy(header + 40, salt, 8);
+        database_file_put64(header + 48, (size_t)offset);
+        database_file_put64(header + 56, table_size);
+
+        /* Encrypt the table, which authenticates the header too */
+        aes_gcm_context_t ctx;
+        unsigned char nonce[12];
+        database_file_nonce(salt, num_pages, nonce);
+        aes_gcm_init(&ctx, key, key_size, nonce, AES_GCM_ENCRYPT);
+        aes_gcm_update_aad(&ctx, header, DATABASE_FILE_HEADER_AAD_SIZE);
+        aes_gcm_update(&ctx, table, table_size, table);
+        aes_gcm_final(&ctx, header + DATABASE_FILE_HEADER_AAD_SIZE);
+
+        /* The file must be on disk before it replaces the old one & the
+         * logs are removed
+         */
+        failed = fwrite(table, 1, table_size, file) != table_size ||
+            fseek(file, 0, SEEK_SET) != 0 ||
+            fwrite(header, 1, DATABASE_FILE_HEADER_SIZE, file) !=
+                DATABASE_FILE_HEADER_SIZE ||
+            database_file_sync(file) != 0;
+    }
+
+    if (file != NULL && fclose(file) != 0) {
+        failed = 1;
+    }
+    free(pages);
+    free(lookups);
+    free(table);
+    free(page);
+    free(compressed);
+    free(salt);
+    return failed;
+}
+
+/*******************************************************************************
+ * Reads the header & the table of a mapped database file.
+ *
+ * inputs:
+ * - file - The file. Its map, key & key size are set.
+ * outputs:
+ * - 0 on success, 1 if the file is corrupt or memory could not be allocated
+ ******************************************************************************/
+int database_file_read_table(database_file_t *file) {
+
+    const unsigned char *header = file->map;
+    size_t table_offset, table_size;
+    size_t max_stored_size = 1;
+    size_t i;
+
+    if (file->map_size < DATABASE_FILE_ALIGNMENT ||
+        memcmp(header, DATABASE_FILE_MAGIC, 4) != 0 ||
+        database_file_get32(header + 4) != DATABASE_FILE_VERSION ||
+        database_file_get32(header + 8) != DATABASE_FILE_ALIGNMENT ||
+        database_file_get32(header + 12) != DATABASE_FILE_PAGE_SIZE ||
+        database_file_get64(header + 48, &table_offset) != 0 ||
+        database_file_get64(header + 56, &table_size) != 0) {
+        return 1;
+    }
+
+    /* Records are a fixed size, so the counts give the number of pages */
+    file->num_doctors = database_file_get32(header + 16);
+    file->num_patients = database_file_get32(header + 20);
+    file->doctors_per_page = database_file_get32(header + 24);
+    file->patients_per_page = database_file_get32(header + 28);
+    file->num_pages = database_file_get32(header + 32);
+    file->checkpoint = database_file_get32(header + 36);
+    memcpy(file->salt, header + 40, 8);
+    if (file->doctors_per_page !=
+            DATABASE_FILE_PAGE_SIZE / DATABASE_DOCTOR_SIZE ||
+        file->patients_per_page !=
+            DATABASE_FILE_PAGE_SIZE / DATABASE_PATIENT_SIZE) {
+        return 1;
+    }
+    file->num_doctor_pages = database_file_count_pages(file->num_doctors,
+        file->doctors_per_page);
+    if (file->num_pages != file->num_doctor_pages + database_file_count_pages(
+            file->num_patients, file->patients_per_page) ||
+        table_size != file->num_pages * DATABASE_FILE_PAGE_ENTRY_SIZE +
+            (file->num_doctors + file->num_patients) *
+            DATABASE_FILE_LOOKUP_ENTRY_SIZE ||
+        table_offset < DATABASE_FILE_ALIGNMENT ||
+        table_offset > file->map_size ||
+        table_size > file->map_size - table_offset) {
+        return 1;
+    }
+
+    /* Decrypt the table & check it & the header are authentic */
+    unsigned char *table = (unsigned char *)malloc(
+        table_size > 0 ? table_size : 1);
+    if (table == NULL) {
+        return 1;
+    }
+    aes_gcm_context_t ctx;
+    unsigned char nonce[12];
+    database_file_nonce(file->salt, file->num_pages, nonce);
+    aes_gcm_init(&ctx, file->key, file->key_size, nonce, AES_GCM_DECRYPT);
+    aes_gcm_update_aad(&ctx, header, DATABASE_FILE_HEADER_AAD_SIZE);
+    aes_gcm_update(&ctx, file->map + table_offset, table_size, table);
+    if (aes_gcm_verify(&ctx, header + DATABASE_FILE_HEADER_AAD_SIZE) != 0) {
+        free(table);
+        return 1;
+    }
+
+    /* Pages must lie between the header & the table */
+    file->pages = (database_file_page_t *)malloc(
+        (file->num_pages > 0 ? file->num_pages : 1) *
+        sizeof(database_file_page_t));
+    file->doctor_lookup = (database_file_lookup_t *)malloc(
+        (file->num_doctors + file->num_patients > 0 ?
+            file->num_doctors + file->num_patients : 1) *
+        sizeof(database_file_lookup_t));
+    if (file->pages == NULL || file->doctor_lookup == NULL) {
+        free(table);
+        return 1;
+    }
+    file->patient_lookup = file->doctor_lookup + file->num_doctors;
+
+    const unsigned char *position = table;
+    for (i = 0; i < file->num_pages; i++) {
+        database_file_page_t *page = &file->pages[i];
+        database_file_get64(position, &page->offset);
+        page->stored_size = database_file_get32(position + 8);
+        memcpy(page->tag, position + 12, 16);
+        position += DATABASE_FILE_PAGE_ENTRY_SIZE;
+
+        if (page->offset < DATABASE_FILE_ALIGNMENT ||
+            page->offset > table_offset ||
+            page->stored_size > table_offset - page->offset) {
+            free(table);
+            return 1;
+        }
+        if (page->stored_size > max_stored_size) {
+            max_stored_size = page->stored_size;
+        }
+    }
+
+    /* Lookups must point at records in the file */
+    for (i = 0; i < file->num_doctors + file->num_patients; i++) {
+        file->doctor_lookup[i].hash = (unsigned int)database_file_get32(
+            position);
+        file->doctor_lookup[i].record = (unsigned int)database_file_get32(
+            position + 4);
+        position += DATABASE_FILE_LOOKUP_ENTRY_SIZE;
+
+        if (file->doctor_lookup[i].record >= (i < file->num_doctors ?
+                file->num_doctors : file->num_patients)) {
+            free(table);
+            return 1;
+        }
+    }
+    free(table);
+
+    /* Nothing is read yet */
+    file->doctors = (doctor_details_t **)calloc(
+        file->num_doctors > 0 ? file->num_doctors : 1,
+        sizeof(doctor_details_t *));
+    file->patients = (patient_details_t **)calloc(
+        file->num_patients > 0 ? file->num_patients : 1,
+        sizeof(patient_details_t *));
+    file->page = (unsigned char *)malloc(DATABASE_FILE_PAGE_SIZE);
+    file->stored_page = (unsigned char *)malloc(max_stored_size);
+    file->page_number = file->num_pages;
+
+    return file->doctors == NULL || file->patients == NULL ||
+        file->page == NULL || file->stored_page == NULL;
+}
+
+/*******************************************************************************
+ * Maps a whole file into memory.
+ * Without DATABASE_POSIX the file is read into memory instead.
+ *
+ * inputs:
+ * - filename - The file
+ * - size - Set to the size of the file
+ * outputs:
+ * - The mapped file, or NULL if it is empty or could not be mapped
+ ******************************************************************************/
+unsigned char *database_file_map(const char *filename, size_t *size) {
+
+    unsigned char *map = NULL;
+    *size = 0;
+
+#ifdef DATABASE_POSIX
+    struct stat status;
+    int descriptor = open(filename, O_RDONLY);
+    if (descriptor < 0) {
+        return NULL;
+    }
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        void *mapped = mmap(NULL, (size_t)status.st_size, PROT_READ,
+            MAP_PRIVATE, descriptor, 0);
+        if (mapped != MAP_FAILED) {
+            map = (unsigned char *)mapped;
+            *size = (size_t)status.st_size;
+        }
+    }
+    close(descriptor);
+#else
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+    }
+    if (length > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        map = (unsigned char *)malloc((size_t)length);
+    }
+    if (map != NULL &&
+        fread(map, 1, (size_t)length, file) != (size_t)length) {
+        free(map);
+        map = NULL;
+    }
+    if (map != NULL) {
+        *size = (size_t)length;
+    }
+    fclose(file);
+#endif
+
+    return map;
+}
+
+/*******************************************************************************
+ * Unmaps a file mapped by database_file_map().
+ *
+ * inputs:
+ * - map - The mapped file
+ * - size - The size of the file
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_unmap(unsigned char *map, size_t size) {
+
+#ifdef DATABASE_POSIX
+    munmap(map, size);
+#else
+    free(map);
+#endif
+}
+
+/*******************************************************************************
+ * Opens a paged database file.
+ * The file is mapped rather than read, so only the parts used are read
+ * from disk.
+ *
+ * inputs:
+ * - filename - The file
+ * - key - The key the file was encrypted with
+ * - key_size - The size of the key
+ * outputs:
+ * - The open file, or NULL if it could not be opened or is corrupt
+ ******************************************************************************/
+database_file_t *database_file_open(const char *filename,
+    const unsigned char *key, int key_size) {
+
+    if (key_size < 0 || key_size > 32) {
+        return NULL;
+    }
+
+    database_file_t *file = (database_file_t *)calloc(1,
+        sizeof(database_file_t));
+    if (file == NULL) {
+        return NULL;
+    }
+    memcpy(file->key, key, key_size);
+    file->key_size = key_size;
+
+    /* Map the whole file */
+    file->map = database_file_map(filename, &file->map_size);
+    if (file->map == NULL || database_file_read_table(file) != 0) {
+        database_file_close(file);
+        return NULL;
+    }
+    return file;
+}
+
+/*******************************************************************************
+ * Decrypts & decompresses a page, unless it was the last page read.
+ *
+ * inputs:
+ * - file - The file
+ * - page_number - The number of the page
+ * - size - The size of the records in the page
+ * outputs:
+ * - The records of the page, or NULL if the page is corrupt
+ ******************************************************************************/
+const unsigned char *database_file_read_page(database_file_t *file,
+    size_t page_number, size_t size) {
+
+    const database_file_page_t *page = &file->pages[page_number];
+    aes_gcm_context_t ctx;
+    unsigned char nonce[12];
+    size_t decompressed_size;
+
+    if (file->page_number == page_number) {
+        return file->page;
+    }
+
+    database_file_nonce(file->salt, page_number, nonce);
+    aes_gcm_init(&ctx, file->key, file->key_size, nonce, AES_GCM_DECRYPT);
+    aes_gcm_update(&ctx, file->map + page->offset, page->stored_size,
+        file->stored_page);
+    if (aes_gcm_verify(&ctx, page->tag) != 0 ||
+        compression_decompress(file->stored_page, page->stored_size,
+            file->page, DATABASE_FILE_PAGE_SIZE, &decompressed_size) != 0 ||
+        decompressed_size != size) {
+        printf("[ERROR] Page %lu of the database is corrupt\n",
+            (unsigned long)page_number);
+        file->page_number = file->num_pages;
+        return NULL;
+    }
+
+    file->page_number = page_number;
+    return file->page;
+}
+
+/*******************************************************************************
+ * Reads a doctor from the file into the records, unless it was read before.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * - number - The number of the doctor in the file
+ * outputs:
+ * - The doctor, or NULL if its page is corrupt or memory could not be
+ *   allocated
+ ******************************************************************************/
+doctor_details_t *database_file_load_doctor(hospital_record_t *records,
+    size_t number) {
+
+    database_file_t *file = records->file;
+    if (file->doctors[number] != NULL) {
+        return file->doctors[number];
+    }
+
+    /* Only the last page of doctors is not full */
+    size_t page_number = number / file->doctors_per_page;
+    size_t first = page_number * file->doctors_per_page;
+    size_t count = file->num_doctors - first < file->doctors_per_page ?
+        file->num_doctors - first : file->doctors_per_page;
+    const unsigned char *position = database_file_read_page(file,
+        page_number, count * DATABASE_DOCTOR_SIZE);
+    if (position == NULL) {
+        return NULL;
+    }
+    position += (number - first) * DATABASE_DOCTOR_SIZE;
+
+    /* If a username is used twice only the first is indexed */
+    doctor_details_t *doctor = database_read_doctor(records, &position);
+    if (doctor != NULL) {
+        username_index_insert(&records->doctor_index, doctor->username,
+            doctor);
+        file->doctors[number] = doctor;
+    }
+    return doctor;
+}
+
+/*******************************************************************************
+ * Reads a patient from the file into the records, unless it was read before.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * - number - The number of the patient in the file
+ * outputs:
+ * - The patient, or NULL if its page is corrupt or memory could not be
+ *   allocated
+ ******************************************************************************/
+patient_details_t *database_file_load_patient(hospital_record_t *records,
+    size_t number) {
+
+    database_file_t *file = records->file;
+    if (file->patients[number] != NULL) {
+        return file->patients[number];
+    }
+
+    /* Only the last page of patients is not full */
+    size_t page_number = number / file->patients_per_page;
+    size_t first = page_number * file->patients_per_page;
+    size_t count = file->num_patients - first < file->patients_per_page ?
+        file->num_patients - first : file->patients_per_page;
+    const unsigned char *position = database_file_read_page(file,
+        file->num_doctor_pages + page_number, count * DATABASE_PATIENT_SIZE);
+    if (position == NULL) {
+        return NULL;
+    }
+    position += (number - first) * DATABASE_PATIENT_SIZE;
+
+    /* If a username is used twice only the first is indexed */
+    patient_details_t *patient = database_read_patient(records, &position);
+    if (patient != NULL) {
+        username_index_insert(&records->patient_index, patient->username,
+            patient);
+        file->patients[number] = patient;
+    }
+    return patient;
+}
+
+/*******************************************************************************
+ * Finds the first lookup entry with a hash.
+ *
+ * inputs:
+ * - lookup - The lookup, sorted by hash
+ * - count - The number of entries
+ * - hash - The hash
+ * outputs:
+ * - The first entry with the hash, or where it would be
+ ******************************************************************************/
+size_t database_file_search(const database_file_lookup_t *lookup,
+    size_t count, unsigned int hash) {
+
+    size_t low = 0;
+    size_t high = count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (lookup[middle].hash < hash) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/*******************************************************************************
+ * Finds a doctor in the database file that has not been read yet.
+ * Doctors read before are indexed under their current username, so are
+ * skipped.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * - username - The username to find
+ * - doctor - Set to the doctor, or NULL if no unread doctor has the username
+ * outputs:
+ * - 0 on success, 1 if a page is corrupt or memory could not be allocated
+ ******************************************************************************/
+int database_file_find_doctor(hospital_record_t *records,
+    const char *username, doctor_details_t **doctor) {
+
+    database_file_t *file = records->file;
+    *doctor = NULL;
+    unsigned int hash = username_index_hash(username);
+    size_t i = database_file_search(file->doctor_lookup, file->num_doctors,
+        hash);
+
+    for (; i < file->num_doctors && file->doctor_lookup[i].hash == hash; i++) {
+        size_t number = file->doctor_lookup[i].record;
+        if (file->doctors[number] != NULL) {
+            continue;
+        }
+        doctor_details_t *loaded = database_file_load_doctor(records, number);
+        if (loaded == NULL) {
+            return 1;
+        }
+        if (strcmp(loaded->username, username) == 0) {
+            *doctor = loaded;
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Finds a patient in the database file that has not been read yet.
+ * Patients read before are indexed under their current username, so are
+ * skipped.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * - username - The username to find
+ * - patient - Set to the patient, or NULL if no unread patient has the username
+ * outputs:
+ * - 0 on success, 1 if a page is corrupt or memory could not be allocated
+ ******************************************************************************/
+int database_file_find_patient(hospital_record_t *records,
+    const char *username, patient_details_t **patient) {
+
+    database_file_t *file = records->file;
+    *patient = NULL;
+    unsigned int hash = username_index_hash(username);
+    size_t i = database_file_search(file->patient_lookup, file->num_patients,
+        hash);
+
+    for (; i < file->num_patients && file->patient_lookup[i].hash == hash;
+        i++) {
+        size_t number = file->patient_lookup[i].record;
+        if (file->patients[number] != NULL) {
+            continue;
+        }
+        patient_details_t *loaded = database_file_load_patient(records,
+            number);
+        if (loaded == NULL) {
+            return 1;
+        }
+        if (strcmp(loaded->username, username) == 0) {
+            *patient = loaded;
+            return 0;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Reads every record left in the database file, then closes it.
+ * Records are read in file order, so each page is only decrypted once.
+ *
+ * inputs:
+ * - records - The hospital records. Their file must be open.
+ * outputs:
+ * - 0 on success, 1 if a page is corrupt
+ ******************************************************************************/
+int database_file_load_all(hospital_record_t *records) {
+
+    database_file_t *file = records->file;
+    size_t i;
+
+    /* Room in the indexes for every record */
+    if (username_index_reserve(&records->doctor_index,
+            records->doctor_index.count + file->num_doctors) != 0 ||
+        username_index_reserve(&records->patient_index,
+            records->patient_index.count + file->num_patients) != 0) {
+        return 1;
+    }
+
+    for (i = 0; i < file->num_doctors; i++) {
+        if (database_file_load_doctor(records, i) == NULL) {
+            return 1;
+        }
+    }
+    for (i = 0; i < file->num_patients; i++) {
+        if (database_file_load_patient(records, i) == NULL) {
+            return 1;
+        }
+    }
+
+    /* Link the file's doctors before those added since it was opened */
+    for (i = 0; i < file->num_doctors; i++) {
+        file->doctors[i]->next = i + 1 < file->num_doctors ?
+            file->doctors[i + 1] : records->doctors;
+    }
+    if (file->num_doctors > 0) {
+        if (records->doctors_tail == NULL) {
+            records->doctors_tail = file->doctors[file->num_doctors - 1];
+        }
+        records->doctors = file->doctors[0];
+    }
+
+    /* Link the file's patients before those added since it was opened */
+    for (i = 0; i < file->num_patients; i++) {
+        file->patients[i]->next = i + 1 < file->num_patients ?
+            file->patients[i + 1] : records->patients;
+    }
+    if (file->num_patients > 0) {
+        if (records->patients_tail == NULL) {
+            records->patients_tail = file->patients[file->num_patients - 1];
+        }
+        records->patients = file->patients[0];
+    }
+
+    database_file_close(file);
+    records->file = NULL;
+    return 0;
+}
+
+/*******************************************************************************
+ * Closes a database file. Records already read are not freed.
+ *
+ * inputs:
+ * - file - The file
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_file_close(database_file_t *file) {
+
+    if (file == NULL) {
+        return;
+    }
+    if (file->map != NULL) {
+        database_file_unmap(file->map, file->map_size);
+    }
+    free(file->pages);
+    free(file->doctor_lookup);
+    free(file->doctors);
+    free(file->patients);
+    free(file->page);
+    free(file->stored_page);
+    free(file);
+}
@@ -0,0 +1,696 @@
+#ifdef DATABASE_POSIX
+/* fork() & waitpid() for background checkpoints */
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef DATABASE_POSIX
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#endif
+
+#include "application/database.h"
+#include "application/database_log.h"
+#include "encryption/aes/gcm.h"
+#include "utils/random.h"
+
+/* Largest change in a log: its kind, a username & a doctor */
+#define DATABASE_LOG_MAX_CHANGE_SIZE (1 + 256 + \
+    (DATABASE_DOCTOR_SIZE > DATABASE_PATIENT_SIZE ? \
+        DATABASE_DOCTOR_SIZE : DATABASE_PATIENT_SIZE))
+
+/*******************************************************************************
+ * Initializes the log of a hospital. No file is opened.
+ *
+ * inputs:
+ * - log - The log
+ * - hospital_name - The name of the hospital
+ * - key - The key to encrypt with
+ * - key_size - The size of the key
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_init(database_log_t *log, const char *hospital_name,
+    const unsigned char *key, int key_size) {
+
+    strcpy(log->name, hospital_name);
+    strcat(log->name, "_encrypted.log");
+    strcpy(log->old_name, log->name);
+    strcat(log->old_name, ".old");
+
+    log->file = NULL;
+    log->size = 0;
+    log->checkpoint = 0;
+    log->sequence = 0;
+    memset(log->salt, 0, sizeof(log->salt));
+    memcpy(log->key, key, key_size);
+    log->key_size = key_size;
+    log->checkpoint_process = 0;
+}
+
+/*******************************************************************************
+ * Builds the header of a log.
+ * Format:
+ *   magic | version | checkpoint | reserved | salt
+ *
+ * inputs:
+ * - log - The log
+ * - header - Where to store DATABASE_LOG_HEADER_SIZE bytes
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_header(const database_log_t *log, unsigned char *header) {
+
+    memcpy(header, DATABASE_LOG_MAGIC, 4);
+    database_file_put32(header + 4, DATABASE_LOG_VERSION);
+    database_file_put32(header + 8, log->checkpoint);
+    database_file_put32(header + 12, 0);
+    memcpy(header + 16, log->salt, 8);
+}
+
+/*******************************************************************************
+ * Starts encrypting or decrypting an entry of a log.
+ * The log's header & the entry's header are authenticated with the change.
+ *
+ * inputs:
+ * - ctx - The GCM context
+ * - log - The log
+ * - entry - The entry, starting with its header
+ * - mode - AES_GCM_ENCRYPT or AES_GCM_DECRYPT
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_start_entry(aes_gcm_context_t *ctx,
+    const database_log_t *log, const unsigned char *entry, int mode) {
+
+    unsigned char header[DATABASE_LOG_HEADER_SIZE];
+    unsigned char nonce[12];
+
+    database_log_header(log, header);
+    memcpy(nonce, log->salt, 8);
+    database_file_put32(nonce + 8, log->sequence);
+
+    aes_gcm_init(ctx, log->key, log->key_size, nonce, mode);
+    aes_gcm_update_aad(ctx, header, DATABASE_LOG_HEADER_SIZE);
+    aes_gcm_update_aad(ctx, entry, DATABASE_LOG_ENTRY_HEADER_SIZE);
+}
+
+/*******************************************************************************
+ * Applies a patient that was added or changed.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The patient's username before the change
+ * - position - The serialized patient
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated
+ ******************************************************************************/
+int database_log_apply_patient(hospital_record_t *records, char *username,
+    const unsigned char *position) {
+
+    patient_details_t *changed = database_read_patient(records, &position);
+    if (changed == NULL) {
+        return 1;
+    }
+
+    /* A new patient goes at the end of the list */
+    patient_details_t *patient = find_patient(records, username);
+    if (patient == NULL) {
+        if (records->patients_tail == NULL) {
+            records->patients = changed;
+        } else {
+            records->patients_tail->next = changed;
+        }
+        records->patients_tail = changed;
+        records->num_patients += 1;
+        return username_index_insert(&records->patient_index,
+            changed->username, changed);
+    }
+
+    /* A changed patient keeps its place */
+    patient_details_t *next = patient->next;
+    *patient = *changed;
+    patient->next = next;
+    record_slab_release(&records->patient_slab, changed);
+    if (strcmp(username, patient->username) != 0) {
+        username_index_remove(&records->patient_index, username);
+        return username_index_insert(&records->patient_index,
+            patient->username, patient);
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Applies a doctor that was added or changed.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The doctor's username before the change
+ * - position - The serialized doctor
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated
+ ******************************************************************************/
+int database_log_apply_doctor(hospital_record_t *records, char *username,
+    const unsigned char *position) {
+
+    doctor_details_t *changed = database_read_doctor(records, &position);
+    if (changed == NULL) {
+        return 1;
+    }
+
+    /* A new doctor goes at the end of the list */
+    doctor_details_t *doctor = find_doctor(records, username);
+    if (doctor == NULL) {
+        if (records->doctors_tail == NULL) {
+            records->doctors = changed;
+        } else {
+            records->doctors_tail->next = changed;
+        }
+        records->doctors_tail = changed;
+        records->num_doctors += 1;
+        return username_index_insert(&records->doctor_index,
+            changed->username, changed);
+    }
+
+    /* A changed doctor keeps its place */
+    doctor_details_t *next = doctor->next;
+    *doctor = *changed;
+    doctor->next = next;
+    record_slab_release(&records->doctor_slab, changed);
+    if (strcmp(username, doctor->username) != 0) {
+        username_index_remove(&records->doctor_index, username);
+        return username_index_insert(&records->doctor_index,
+            doctor->username, doctor);
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Applies a change read from a log.
+ * Format:
+ *   kind | username before the change | serialized patient or doctor
+ *
+ * inputs:
+ * - records - The hospital records
+ * - change - The change
+ * - size - The size of the change
+ * outputs:
+ * - 0 on success, 1 if the change is invalid
+ ******************************************************************************/
+int database_log_apply(hospital_record_t *records,
+    const unsigned char *change, size_t size) {
+
+    char username[257];
+
+    if (size < 1 + 256) {
+        return 1;
+    }
+    memcpy(username, change + 1, 256);
+    username[256] = '\0';
+
+    if (change[0] == DATABASE_LOG_PATIENT &&
+        size == 1 + 256 + DATABASE_PATIENT_SIZE) {
+        return database_log_apply_patient(records, username, change + 257);
+    } else if (change[0] == DATABASE_LOG_DELETE_PATIENT && size == 1 + 256) {
+        delete_patient_silent(records, username);
+        return 0;
+    } else if (change[0] == DATABASE_LOG_DOCTOR &&
+        size == 1 + 256 + DATABASE_DOCTOR_SIZE) {
+        return database_log_apply_doctor(records, username, change + 257);
+    }
+    return 1;
+}
+
+/*******************************************************************************
+ * Reads a whole file into memory.
+ *
+ * inputs:
+ * - filename - The file
+ * - size - Set to the size of the file
+ * outputs:
+ * - The contents(must be freed), or NULL if the file could not be read
+ ******************************************************************************/
+unsigned char *database_log_read_file(const char *filename, size_t *size) {
+
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+
+    unsigned char *data = NULL;
+    long length = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        length = ftell(file);
+    }
+    if (length >= 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char *)malloc(length > 0 ? length : 1);
+    }
+    if (data != NULL &&
+        fread(data, 1, (size_t)length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+
+    *size = (size_t)length;
+    return data;
+}
+
+/*******************************************************************************
+ * Replays a log if it follows the database file.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - filename - The log
+ * - checkpoint - The number of the database file it must follow
+ * outputs:
+ * - 1 if the log was replayed, 2 if it was replayed up to a damaged entry,
+ *   0 if there is no log or it was older than the database file(& removed),
+ *   -1 if it is not a log or does not follow the database file
+ ******************************************************************************/
+int database_log_read(hospital_record_t *records, const char *filename,
+    size_t checkpoint) {
+
+    database_log_t *log = &records->log;
+    unsigned char change[DATABASE_LOG_MAX_CHANGE_SIZE];
+    aes_gcm_context_t ctx;
+    size_t size;
+
+    unsigned char *data = database_log_read_file(filename, &size);
+    if (data == NULL) {
+        return 0;
+    }
+
+    /* A crash while the log was created leaves less than a header */
+    if (size < DATABASE_LOG_HEADER_SIZE) {
+        free(data);
+        remove(filename);
+        return 0;
+    }
+    if (memcmp(data, DATABASE_LOG_MAGIC, 4) != 0 ||
+        database_file_get32(data + 4) != DATABASE_LOG_VERSION) {
+        free(data);
+        return -1;
+    }
+
+    /* Changes already in the database file */
+    size_t log_checkpoint = database_file_get32(data + 8);
+    if (log_checkpoint < checkpoint) {
+        free(data);
+        remove(filename);
+        return 0;
+    }
+    if (log_checkpoint > checkpoint) {
+        free(data);
+        return -1;
+    }
+
+    /* Entries are appended to this log from now on */
+    log->checkpoint = log_checkpoint;
+    memcpy(log->salt, data + 16, 8);
+    log->sequence = 0;
+    size_t position = DATABASE_LOG_HEADER_SIZE;
+
+    /* Apply each entry until the first one that is cut short or damaged */
+    while (size - position >= DATABASE_LOG_ENTRY_HEADER_SIZE + 16) {
+        const unsigned char *entry = data + position;
+        size_t change_size = database_file_get32(entry);
+        if (database_file_get32(entry + 4) != (log->sequence & 0xFFFFFFFFUL) ||
+            change_size > DATABASE_LOG_MAX_CHANGE_SIZE ||
+            change_size > size - position -
+                DATABASE_LOG_ENTRY_HEADER_SIZE - 16) {
+            break;
+        }
+
+        database_log_start_entry(&ctx, log, entry, AES_GCM_DECRYPT);
+        aes_gcm_update(&ctx, entry + DATABASE_LOG_ENTRY_HEADER_SIZE,
+            change_size, change);
+        if (aes_gcm_verify(&ctx, entry + DATABASE_LOG_ENTRY_HEADER_SIZE +
+                change_size) != 0 ||
+            database_log_apply(records, change, change_size) != 0) {
+            break;
+        }
+
+        position += DATABASE_LOG_ENTRY_HEADER_SIZE + change_size + 16;
+        log->sequence++;
+    }
+    free(data);
+    log->size = position;
+
+    /* Nothing may be appended after a damaged entry, since the next entry
+     * would reuse its nonce. The caller writes a checkpoint instead, which
+     * starts a new log with a new salt.
+     */
+    if (position != size) {
+        printf("[WARNING] Ignoring a damaged change at the end of %s\n",
+            filename);
+        return 2;
+    }
+    return 1;
+}
+
+/*******************************************************************************
+ * Replays the logs that follow the database file.
+ * Logs older than the database file are removed. A damaged entry ends the
+ * log, since it is what a crash while appending leaves behind. If a
+ * checkpoint was cut short, or a log ends with a damaged entry, the changes
+ * are written to the database file & the logs removed.
+ *
+ * inputs:
+ * - records - The hospital records, loaded from the database file
+ * - checkpoint - The number of the database file
+ * outputs:
+ * - 0 on success, 1 if a log does not follow the database file
+ ******************************************************************************/
+int database_log_replay(hospital_record_t *records, size_t checkpoint) {
+
+    database_log_t *log = &records->log;
+    log->checkpoint = checkpoint;
+
+    /* The old log is only left when a checkpoint did not finish */
+    int old = database_log_read(records, log->old_name, checkpoint);
+    if (old < 0) {
+        printf("[ERROR] %s does not follow %s\n", log->old_name,
+            records->encrypted_database_name);
+        return 1;
+    }
+
+    /* The log follows the checkpoint the old log was for */
+    log->size = 0;
+    log->sequence = 0;
+    log->checkpoint = checkpoint + (old != 0);
+    int current = database_log_read(records, log->name, log->checkpoint);
+    if (current < 0) {
+        printf("[ERROR] %s does not follow %s\n", log->name,
+            records->encrypted_database_name);
+        return 1;
+    }
+
+    /* Finish the checkpoint, or replace a log ending in a damaged entry */
+    if (old != 0 || current == 2) {
+        save_database(records);
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Appends an entry to the log & syncs it to disk.
+ * The log is created the first time.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - entry - The entry. The change starts after DATABASE_LOG_ENTRY_HEADER_SIZE
+ *           bytes & is followed by room for the tag. Encrypted in place.
+ * - change_size - The size of the change
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_append(hospital_record_t *records, unsigned char *entry,
+    size_t change_size) {
+
+    database_log_t *log = &records->log;
+    unsigned char header[DATABASE_LOG_HEADER_SIZE];
+    aes_gcm_context_t ctx;
+    int failed = 0;
+
+    /* Create the log, or continue the log that was replayed */
+    if (log->file == NULL && log->size > 0) {
+        log->file = fopen(log->name, "ab");
+        failed = log->file == NULL;
+    } else if (log->file == NULL) {
+        unsigned char *salt = random_bytes(8);
+        log->file = fopen(log->name, "wb");
+        failed = salt == NULL || log->file == NULL;
+        if (!failed) {
+            memcpy(log->salt, salt, 8);
+            log->sequence = 0;
+            database_log_header(log, header);
+            failed = fwrite(header, 1, sizeof(header), log->file) !=
+                sizeof(header) || database_file_sync(log->file) != 0 ||
+                database_file_sync_directory(log->name) != 0;
+            log->size = sizeof(header);
+        }
+        free(salt);
+    }
+
+    /* Encrypt the change */
+    size_t size = DATABASE_LOG_ENTRY_HEADER_SIZE + change_size + 16;
+    database_file_put32(entry, change_size);
+    database_file_put32(entry + 4, log->sequence);
+    if (!failed) {
+        database_log_start_entry(&ctx, log, entry, AES_GCM_ENCRYPT);
+        aes_gcm_update(&ctx, entry + DATABASE_LOG_ENTRY_HEADER_SIZE,
+            change_size, entry + DATABASE_LOG_ENTRY_HEADER_SIZE);
+        aes_gcm_final(&ctx, entry + size - 16);
+    }
+
+    /* The change is only made once it is on disk */
+    if (failed || fwrite(entry, 1, size, log->file) != size ||
+        database_file_sync(log->file) != 0) {
+        printf("Error: Failed to write %s\n", log->name);
+        exit(1);
+    }
+    log->size += size;
+    log->sequence++;
+
+    /* Keep the log short so loading stays quick */
+    if (log->size >= DATABASE_LOG_CHECKPOINT_SIZE) {
+        database_log_checkpoint(records);
+    }
+}
+
+/*******************************************************************************
+ * Logs a patient that was added or changed.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The patient's username before the change
+ * - patient - The patient
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_patient(hospital_record_t *records, const char *username,
+    const patient_details_t *patient) {
+
+    unsigned char entry[DATABASE_LOG_ENTRY_HEADER_SIZE +
+        DATABASE_LOG_MAX_CHANGE_SIZE + 16];
+    unsigned char *position = entry + DATABASE_LOG_ENTRY_HEADER_SIZE;
+
+    *position++ = DATABASE_LOG_PATIENT;
+    memset(position, 0, 256);
+    strncpy((char *)position, username, 255);
+    position += 256;
+    database_write_patient(&position, patient);
+
+    database_log_append(records, entry,
+        (size_t)(position - entry) - DATABASE_LOG_ENTRY_HEADER_SIZE);
+}
+
+/*******************************************************************************
+ * Logs a patient that was deleted.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The patient's username
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_delete_patient(hospital_record_t *records,
+    const char *username) {
+
+    unsigned char entry[DATABASE_LOG_ENTRY_HEADER_SIZE + 1 + 256 + 16];
+    unsigned char *position = entry + DATABASE_LOG_ENTRY_HEADER_SIZE;
+
+    *position++ = DATABASE_LOG_DELETE_PATIENT;
+    memset(position, 0, 256);
+    strncpy((char *)position, username, 255);
+
+    database_log_append(records, entry, 1 + 256);
+}
+
+/*******************************************************************************
+ * Logs a doctor that was added or changed.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - username - The doctor's username before the change
+ * - doctor - The doctor
+ * outputs:
+ * - none. Exits if the log cannot be written.
+ ******************************************************************************/
+void database_log_doctor(hospital_record_t *records, const char *username,
+    const doctor_details_t *doctor) {
+
+    unsigned char entry[DATABASE_LOG_ENTRY_HEADER_SIZE +
+        DATABASE_LOG_MAX_CHANGE_SIZE + 16];
+    unsigned char *position = entry + DATABASE_LOG_ENTRY_HEADER_SIZE;
+
+    *position++ = DATABASE_LOG_DOCTOR;
+    memset(position, 0, 256);
+    strncpy((char *)position, username, 255);
+    position += 256;
+    database_write_doctor(&position, doctor);
+
+    database_log_append(records, entry,
+        (size_t)(position - entry) - DATABASE_LOG_ENTRY_HEADER_SIZE);
+}
+
+/*******************************************************************************
+ * Checks on a checkpoint running in the background.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - wait - 1 to wait for the checkpoint to finish, 0 to only check
+ * outputs:
+ * - -1 if it is still running, 0 if none is running, 1 if it failed
+ ******************************************************************************/
+int database_log_poll(hospital_record_t *records, int wait) {
+
+    database_log_t *log = &records->log;
+
+    if (log->checkpoint_process == 0) {
+        return 0;
+    }
+
+#ifdef DATABASE_POSIX
+    int status;
+    pid_t process = waitpid((pid_t)log->checkpoint_process, &status,
+        wait ? 0 : WNOHANG);
+    if (process == 0) {
+        return -1;
+    }
+
+    log->checkpoint_process = 0;
+    if (process < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("[ERROR] Failed to write a checkpoint of %s\n",
+            records->encrypted_database_name);
+        return 1;
+    }
+#else
+    (void)wait;
+#endif
+    return 0;
+}
+
+/*******************************************************************************
+ * Writes the logged changes to the database file in a background process.
+ * The process gets a copy of the records as they are now, so changes can
+ * still be made & logged while it writes. Does nothing if nothing is logged
+ * or a checkpoint is already running. Without DATABASE_POSIX the database
+ * is saved instead, before returning.
+ *
+ * inputs:
+ * - records - The hospital records
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_checkpoint(hospital_record_t *records) {
+
+    database_log_t *log = &records->log;
+
+    /* One checkpoint at a time. One that failed is written here instead. */
+    int status = database_log_poll(records, 0);
+    if (status != 0) {
+        if (status == 1) {
+            save_database(records);
+        }
+        return;
+    }
+    if (log->sequence == 0) {
+        return;
+    }
+
+#ifdef DATABASE_POSIX
+    /* Later changes go to a new log that follows the checkpoint */
+    if (log->file != NULL) {
+        fclose(log->file);
+        log->file = NULL;
+    }
+    if (rename(log->name, log->old_name) != 0) {
+        save_database(records);
+        return;
+    }
+    size_t checkpoint = log->checkpoint + 1;
+    log->checkpoint = checkpoint;
+    log->size = 0;
+    log->sequence = 0;
+
+    /* Output waiting to be printed would otherwise be printed twice */
+    fflush(stdout);
+    pid_t process = fork();
+    if (process == 0) {
+        int failed = database_write_checkpoint(records, checkpoint);
+        if (!failed) {
+            remove(log->old_name);
+        }
+        _exit(failed);
+    }
+
+    /* Write it here if there cannot be another process */
+    if (process < 0) {
+        save_database(records);
+        return;
+    }
+    log->checkpoint_process = (long)process;
+#else
+    /* No other process can write it */
+    save_database(records);
+#endif
+}
+
+/*******************************************************************************
+ * Waits for a checkpoint running in the background to finish.
+ *
+ * inputs:
+ * - records - The hospital records
+ * outputs:
+ * - 0 if no checkpoint failed, 1 if one failed
+ ******************************************************************************/
+int database_log_wait(hospital_record_t *records) {
+
+    return database_log_poll(records, 1) == 1;
+}
+
+/*******************************************************************************
+ * Removes the logs once every change is in the database file.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - checkpoint - The number of the database file just written
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_reset(hospital_record_t *records, size_t checkpoint) {
+
+    database_log_t *log = &records->log;
+
+    if (log->file != NULL) {
+        fclose(log->file);
+        log->file = NULL;
+    }
+    remove(log->name);
+    remove(log->old_name);
+    log->size = 0;
+    log->sequence = 0;
+    log->checkpoint = checkpoint;
+}
+
+/*******************************************************************************
+ * Closes the log, waiting for any checkpoint. The log is kept.
+ *
+ * inputs:
+ * - records - The hospital records
+ * outputs:
+ * - none
+ ******************************************************************************/
+void database_log_close(hospital_record_t *records) {
+
+    database_log_wait(records);
+    if (records->log.file != NULL) {
+        fclose(records->log.file);
+        records->log.file = NULL;
+    }
+}
@@ -176,17 +176,15 @@ void print_menu(hospital_record_t *records) {
  ******************************************************************************/
 void seed_data(hospital_record_t *records) {
     /* Add a doctor to the hospital records */
-    doctor_details_t *doctor = (doctor_details_t *)calloc(
-        1, sizeof(doctor_details_t)
-    );
-    strcpy(doctor->username, "1");
-    strcpy(doctor->name, "John Doe");
-    strcpy(doctor->email, "john.doe@example.com");
-    strcpy(doctor->phone, "1234567890");
-    doctor->password = hash_string("1");
-    strcpy(doctor->specialization, "Cardiology");
-    strcpy(doctor->license_number, "1234567890");
-    doctor_signup_silent(records, doctor);
+    doctor_details_t doctor;
+    doctor.username = "1";
+    doctor.name = "John Doe";
+    doctor.email = "john.doe@example.com";
+    doctor.phone = "1234567890";
+    doctor.password = hash_string("1");
+    doctor.specialization = "Cardiology";
+    doctor.license_number = "1234567890";
+    doctor_signup_silent(records, &doctor);
 }
 
 /*******************************************************************************
@@ -216,9 +214,6 @@ void initialize_hospital(hospital_record_t *records) {
         printf("Future doctors can only be added after logging in as a doctor\n");
         printf("--------------------------------\n");
 
-        /* Save the database */
-        save_database(records);
-
         /* Redirecting to starting menu message*/
         printf("Redirecting to starting menu\n");
     }
@@ -267,9 +262,6 @@ void use(const char *hospital_name)
                 break;
         }
 
-        /* Save the database */
-        save_database(records);
-
         /* Print the menu again */
         print_menu(records);
 
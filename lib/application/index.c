@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "application/index.h"
+
+/* Slots in the smallest index */
+#define USERNAME_INDEX_MIN_CAPACITY 16
+
+/*******************************************************************************
+ * Hashes a username with 32-bit FNV-1a.
+ * 
+ * inputs:
+ * - username - The username
+ * outputs:
+ * - The hash
+ ******************************************************************************/
+unsigned int username_index_hash(const char *username) {
+
+    unsigned long hash = 2166136261UL;
+    while (*username != '\0') {
+        hash ^= (unsigned char)*username++;
+        hash = (hash * 16777619UL) & 0xFFFFFFFFUL;
+    }
+    return (unsigned int)hash;
+}
+
+/*******************************************************************************
+ * Initializes an empty username index.
+ * 
+ * inputs:
+ * - index - The index
+ * outputs:
+ * - none
+ ******************************************************************************/
+void username_index_init(username_index_t *index) {
+
+    index->entries = NULL;
+    index->capacity = 0;
+    index->count = 0;
+}
+
+/*******************************************************************************
+ * Finds the slot of a username, or the empty slot where it would go.
+ * 
+ * inputs:
+ * - index - The index. Must have slots.
+ * - username - The username
+ * - hash - The hash of the username
+ * outputs:
+ * - The slot
+ ******************************************************************************/
+size_t username_index_slot(const username_index_t *index,
+    const char *username, unsigned int hash) {
+
+    size_t mask = index->capacity - 1;
+    size_t slot = hash & mask;
+
+    while (index->entries[slot].username != NULL) {
+        if (index->entries[slot].hash == hash &&
+            strcmp(index->entries[slot].username, username) == 0) {
+            break;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+/*******************************************************************************
+ * Moves the users into a new set of slots.
+ * 
+ * inputs:
+ * - index - The index
+ * - capacity - The new number of slots. A power of 2 above the user count.
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated
+ ******************************************************************************/
+int username_index_resize(username_index_t *index, size_t capacity) {
+
+    username_index_entry_t *old_entries = index->entries;
+    size_t old_capacity = index->capacity;
+    size_t i;
+
+    username_index_entry_t *entries = (username_index_entry_t *)calloc(
+        capacity, sizeof(username_index_entry_t));
+    if (entries == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    index->entries = entries;
+    index->capacity = capacity;
+    for (i = 0; i < old_capacity; i++) {
+        if (old_entries[i].username != NULL) {
+            size_t slot = old_entries[i].hash & (capacity - 1);
+            while (entries[slot].username != NULL) {
+                slot = (slot + 1) & (capacity - 1);
+            }
+            entries[slot] = old_entries[i];
+        }
+    }
+
+    free(old_entries);
+    return 0;
+}
+
+/*******************************************************************************
+ * Makes room for a number of users, so adding them never grows the index.
+ * The index is kept at most 3/4 full so probes stay short.
+ * 
+ * inputs:
+ * - index - The index
+ * - count - The number of users the index should hold
+ * outputs:
+ * - 0 on success, 1 if memory could not be allocated
+ ******************************************************************************/
+int username_index_reserve(username_index_t *index, size_t count) {
+
+    size_t capacity = index->capacity > 0 ?
+        index->capacity : USERNAME_INDEX_MIN_CAPACITY;
+    while (count > capacity / 4 * 3) {
+        capacity *= 2;
+    }
+
+    if (capacity == index->capacity) {
+        return 0;
+    }
+    return username_index_resize(index, capacity);
+}
+
+/*******************************************************************************
+ * Adds a user to the index.
+ * The username is not copied, so must not change while the user is in the
+ * index. Remove the user first & add it again after.
+ * 
+ * inputs:
+ * - index - The index
+ * - username - The username of the user
+ * - user - The user
+ * outputs:
+ * - 0 on success, 1 if the username is already used or memory could not be
+ *   allocated
+ ******************************************************************************/
+int username_index_insert(username_index_t *index, const char *username,
+    void *user) {
+
+    if (username_index_reserve(index, index->count + 1) != 0) {
+        return 1;
+    }
+
+    unsigned int hash = username_index_hash(username);
+    size_t slot = username_index_slot(index, username, hash);
+    if (index->entries[slot].username != NULL) {
+        return 1;
+    }
+
+    index->entries[slot].hash = hash;
+    index->entries[slot].username = username;
+    index->entries[slot].user = user;
+    index->count++;
+    return 0;
+}
+
+/*******************************************************************************
+ * Finds a user by username.
+ * 
+ * inputs:
+ * - index - The index
+ * - username - The username to find
+ * outputs:
+ * - The user if found, otherwise NULL
+ ******************************************************************************/
+void *username_index_find(const username_index_t *index, const char *username) {
+
+    if (index->count == 0) {
+        return NULL;
+    }
+
+    size_t slot = username_index_slot(index, username,
+        username_index_hash(username));
+    return index->entries[slot].user;
+}
+
+/*******************************************************************************
+ * Removes a user from the index.
+ * Later users in the same run of slots are shifted back into the gap,
+ * unless that would move them before their own home slot.
+ * 
+ * inputs:
+ * - index - The index
+ * - username - The username of the user to remove
+ * outputs:
+ * - The removed user if found, otherwise NULL
+ ******************************************************************************/
+void *username_index_remove(username_index_t *index, const char *username) {
+
+    if (index->count == 0) {
+        return NULL;
+    }
+
+    size_t mask = index->capacity - 1;
+    size_t gap = username_index_slot(index, username,
+        username_index_hash(username));
+    void *user = index->entries[gap].user;
+    if (index->entries[gap].username == NULL) {
+        return NULL;
+    }
+
+    size_t slot = gap;
+    while (1) {
+        slot = (slot + 1) & mask;
+        if (index->entries[slot].username == NULL) {
+            break;
+        }
+
+        /* Distance from each slot back to the home slot of this user */
+        size_t home = index->entries[slot].hash & mask;
+        if (((slot - home) & mask) >= ((slot - gap) & mask)) {
+            index->entries[gap] = index->entries[slot];
+            gap = slot;
+        }
+    }
+
+    index->entries[gap].username = NULL;
+    index->entries[gap].user = NULL;
+    index->count--;
+    return user;
+}
+
+/*******************************************************************************
+ * Frees the memory used by the index. The users are not freed.
+ * 
+ * inputs:
+ * - index - The index
+ * outputs:
+ * - none
+ ******************************************************************************/
+void username_index_free(username_index_t *index) {
+
+    free(index->entries);
+    username_index_init(index);
+}
@@ -0,0 +1,230 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "application/store.h"
+
+/* Bytes before the first record or string of a block. Holds the pointer to
+ * the next block & keeps what follows aligned for any field.
+ */
+#define STORE_BLOCK_HEADER_SIZE (2 * sizeof(void *))
+
+/*******************************************************************************
+ * Allocates a block & puts it at the front of a list of blocks.
+ *
+ * inputs:
+ * - blocks - The list of blocks, newest first
+ * - size - The number of bytes needed after the header
+ * outputs:
+ * - The first byte after the header, or NULL if memory could not be allocated
+ ******************************************************************************/
+unsigned char *store_add_block(void **blocks, size_t size) {
+
+    void **block = (void **)malloc(STORE_BLOCK_HEADER_SIZE + size);
+    if (block == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return NULL;
+    }
+
+    block[0] = *blocks;
+    *blocks = block;
+    return (unsigned char *)block + STORE_BLOCK_HEADER_SIZE;
+}
+
+/*******************************************************************************
+ * Frees a list of blocks.
+ *
+ * inputs:
+ * - blocks - The list of blocks. Set to NULL.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void store_free_blocks(void **blocks) {
+
+    void **block = (void **)*blocks;
+    while (block != NULL) {
+        void **next = (void **)block[0];
+        free(block);
+        block = next;
+    }
+    *blocks = NULL;
+}
+
+/*******************************************************************************
+ * Initializes an empty record slab.
+ *
+ * inputs:
+ * - slab - The slab
+ * - record_size - The size of each record
+ * outputs:
+ * - none
+ ******************************************************************************/
+void record_slab_init(record_slab_t *slab, size_t record_size) {
+
+    /* Room to link released records & keep every record aligned */
+    slab->record_size = (record_size + sizeof(void *) - 1) /
+        sizeof(void *) * sizeof(void *);
+    slab->blocks = NULL;
+    slab->used = RECORD_SLAB_BLOCK_RECORDS;
+    slab->free_records = NULL;
+}
+
+/*******************************************************************************
+ * Gets memory for a record, set to zero.
+ * Released records are used first, then the rest of the newest block.
+ *
+ * inputs:
+ * - slab - The slab
+ * outputs:
+ * - The record, or NULL if memory could not be allocated
+ ******************************************************************************/
+void *record_slab_alloc(record_slab_t *slab) {
+
+    unsigned char *record;
+
+    if (slab->free_records != NULL) {
+        record = (unsigned char *)slab->free_records;
+        slab->free_records = *(void **)record;
+    } else {
+
+        /* Start a new block once the newest is full */
+        if (slab->used == RECORD_SLAB_BLOCK_RECORDS) {
+            if (store_add_block(&slab->blocks,
+                    RECORD_SLAB_BLOCK_RECORDS * slab->record_size) == NULL) {
+                return NULL;
+            }
+            slab->used = 0;
+        }
+
+        record = (unsigned char *)slab->blocks + STORE_BLOCK_HEADER_SIZE +
+            slab->used * slab->record_size;
+        slab->used++;
+    }
+
+    memset(record, 0, slab->record_size);
+    return record;
+}
+
+/*******************************************************************************
+ * Gives a record back to the slab to be reused.
+ *
+ * inputs:
+ * - slab - The slab
+ * - record - A record from record_slab_alloc()
+ * outputs:
+ * - none
+ ******************************************************************************/
+void record_slab_release(record_slab_t *slab, void *record) {
+
+    *(void **)record = slab->free_records;
+    slab->free_records = record;
+}
+
+/*******************************************************************************
+ * Frees every record in the slab.
+ *
+ * inputs:
+ * - slab - The slab
+ * outputs:
+ * - none
+ ******************************************************************************/
+void record_slab_free(record_slab_t *slab) {
+
+    store_free_blocks(&slab->blocks);
+    slab->used = RECORD_SLAB_BLOCK_RECORDS;
+    slab->free_records = NULL;
+}
+
+/*******************************************************************************
+ * Initializes an empty string pool.
+ *
+ * inputs:
+ * - pool - The pool
+ * outputs:
+ * - none
+ ******************************************************************************/
+void string_pool_init(string_pool_t *pool) {
+
+    pool->blocks = NULL;
+    pool->available = 0;
+    username_index_init(&pool->interned);
+}
+
+/*******************************************************************************
+ * Copies a string into the pool.
+ * A string longer than a block gets a block of its own.
+ *
+ * inputs:
+ * - pool - The pool
+ * - string - The string. NULL is copied as an empty string.
+ * outputs:
+ * - The copy, or NULL if memory could not be allocated
+ ******************************************************************************/
+const char *string_pool_copy(string_pool_t *pool, const char *string) {
+
+    if (string == NULL) {
+        string = "";
+    }
+    size_t size = strlen(string) + 1;
+
+    /* Start a new block once the newest is full */
+    if (size > pool->available) {
+        size_t block_size = size > STRING_POOL_BLOCK_SIZE ?
+            size : STRING_POOL_BLOCK_SIZE;
+        if (store_add_block(&pool->blocks, block_size) == NULL) {
+            return NULL;
+        }
+        pool->available = block_size;
+    }
+
+    /* Strings fill each block from its end back to the header */
+    pool->available -= size;
+    char *copy = (char *)pool->blocks + STORE_BLOCK_HEADER_SIZE +
+        pool->available;
+    memcpy(copy, string, size);
+    return copy;
+}
+
+/*******************************************************************************
+ * Copies a string into the pool unless an equal string was interned before.
+ *
+ * inputs:
+ * - pool - The pool
+ * - string - The string. NULL is interned as an empty string.
+ * outputs:
+ * - The interned string, or NULL if memory could not be allocated
+ ******************************************************************************/
+const char *string_pool_intern(string_pool_t *pool, const char *string) {
+
+    if (string == NULL) {
+        string = "";
+    }
+    const char *interned = (const char *)username_index_find(&pool->interned,
+        string);
+    if (interned != NULL) {
+        return interned;
+    }
+
+    interned = string_pool_copy(pool, string);
+    if (interned == NULL ||
+        username_index_insert(&pool->interned, interned,
+            (void *)interned) != 0) {
+        return NULL;
+    }
+    return interned;
+}
+
+/*******************************************************************************
+ * Frees every string in the pool.
+ *
+ * inputs:
+ * - pool - The pool
+ * outputs:
+ * - none
+ ******************************************************************************/
+void string_pool_free(string_pool_t *pool) {
+
+    store_free_blocks(&pool->blocks);
+    pool->available = 0;
+    username_index_free(&pool->interned);
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "application/database.h"
@@ -9,43 +10,232 @@
 #include "utils/input.h"
 
 /*******************************************************************************
- * Silently adds a new doctor to the hospital records.
+ * Copies a doctor & its strings into the memory of the hospital records.
+ * Many doctors share a specialization, so specializations are interned. The
+ * other strings are copied as they are.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - doctor - The doctor to copy. NULL strings are copied as empty strings.
+ * outputs:
+ * - The copy, or NULL if memory could not be allocated
+ ******************************************************************************/
+doctor_details_t *doctor_copy(hospital_record_t *records,
+    const doctor_details_t *doctor)
+{
+    doctor_details_t *copy = (doctor_details_t *)record_slab_alloc(
+        &records->doctor_slab);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+
+    /* Copy the fields, then the strings the fields point to */
+    *copy = *doctor;
+    copy->next = NULL;
+    copy->username = string_pool_copy(&records->strings, doctor->username);
+    copy->name = string_pool_copy(&records->strings, doctor->name);
+    copy->email = string_pool_copy(&records->strings, doctor->email);
+    copy->phone = string_pool_copy(&records->strings, doctor->phone);
+    copy->specialization = string_pool_intern(&records->strings,
+        doctor->specialization);
+    copy->license_number = string_pool_copy(&records->strings,
+        doctor->license_number);
+
+    /* Give the memory back if any string could not be copied */
+    if (copy->username == NULL || copy->name == NULL || copy->email == NULL ||
+        copy->phone == NULL || copy->specialization == NULL ||
+        copy->license_number == NULL)
+    {
+        record_slab_release(&records->doctor_slab, copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+/*******************************************************************************
+ * Adds a new doctor to the hospital records in memory.
+ * The doctor is copied, so the caller keeps ownership of it & its strings.
  *
  * inputs:
  * - records - The hospital records
  * - doctor - The doctor to add
  * outputs:
- * - none
+ * - The doctor in the records, or NULL if memory could not be allocated.
+ *   Nothing is logged or saved; the caller must do so to keep the doctor.
  ******************************************************************************/
-void doctor_signup_silent(hospital_record_t *records, doctor_details_t *doctor)
+doctor_details_t *doctor_add(hospital_record_t *records,
+    const doctor_details_t *doctor)
 {
+    /* Copy the doctor into the records */
+    doctor_details_t *copy = doctor_copy(records, doctor);
+    if (copy == NULL)
+    {
+        return NULL;
+    }
+
     /* If this is the first doctor */
-    if (records->num_doctors == 0)
+    if (records->doctors_tail == NULL)
     {
         /* Add the doctor to the list */
-        records->doctors = doctor;
-
-        /* Mark the end of the list */
-        records->doctors->next = NULL;
+        records->doctors = copy;
     }
     /* If this is not the first entry */
     else
     {
+        /* Add the new doctor after the last doctor */
+        records->doctors_tail->next = copy;
+    }
+    records->doctors_tail = copy;
+
+    /* Update the number of doctors */
+    records->num_doctors += 1;
+
+    /* Index the doctor by username */
+    username_index_insert(&records->doctor_index, copy->username, copy);
+
+    return copy;
+}
+
+/*******************************************************************************
+ * Silently adds a new doctor to the hospital records & logs it.
+ * The doctor is copied, so the caller keeps ownership of it & its strings.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - doctor - The doctor to add
+ * outputs:
+ * - The doctor in the records, or NULL if memory could not be allocated.
+ *   The doctor is logged, so it is kept once this returns. Exits if the
+ *   log cannot be written.
+ ******************************************************************************/
+doctor_details_t *doctor_signup_silent(hospital_record_t *records,
+    const doctor_details_t *doctor)
+{
+    /* Add the doctor, then log it */
+    doctor_details_t *added = doctor_add(records, doctor);
+    if (added != NULL)
+    {
+        database_log_doctor(records, added->username, added);
+    }
+    return added;
+}
+
+/*******************************************************************************
+ * Adds many doctors to the hospital records at once, in memory.
+ * Room in the index is made once for all of them, then each is copied,
+ * indexed & linked in a single pass. Either every doctor is added or none
+ * are.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - doctors - The doctors to add, in order
+ * - num_doctors - The number of doctors
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. Nothing is logged or
+ *   saved; the caller must do so to keep the doctors.
+ ******************************************************************************/
+int doctor_add_batch(hospital_record_t *records,
+    const doctor_details_t *doctors, size_t num_doctors)
+{
+    doctor_details_t *first = NULL;
+    doctor_details_t *last = NULL;
+    size_t i;
+
+    /* Make room for every doctor */
+    if (username_index_reserve(&records->doctor_index,
+            records->doctor_index.count + num_doctors) != 0)
+    {
+        return 1;
+    }
+
+    /* Copy & index every doctor, undoing it all if any username is taken */
+    for (i = 0; i < num_doctors; i++)
+    {
+        doctor_details_t *copy = NULL;
+        if (doctors[i].username != NULL && doctors[i].username[0] != '\0' &&
+            find_doctor(records, (char *)doctors[i].username) == NULL)
+        {
+            copy = doctor_copy(records, &doctors[i]);
+        }
+        if (copy == NULL || username_index_insert(&records->doctor_index,
+                copy->username, copy) != 0)
+        {
+            printf("Doctor %s could not be imported\n",
+                doctors[i].username != NULL ? doctors[i].username : "");
+            if (copy != NULL)
+            {
+                record_slab_release(&records->doctor_slab, copy);
+            }
+            while (first != NULL)
+            {
+                doctor_details_t *next = first->next;
+                username_index_remove(&records->doctor_index,
+                    first->username);
+                record_slab_release(&records->doctor_slab, first);
+                first = next;
+            }
+            return 1;
+        }
 
-        /* Find the last doctor */
-        doctor_details_t *last_doctor = records->doctors;
-        while (last_doctor->next != NULL)
+        /* Link the copies together until they are all added */
+        if (last == NULL)
         {
-            last_doctor = last_doctor->next;
+            first = copy;
         }
+        else
+        {
+            last->next = copy;
+        }
+        last = copy;
+    }
 
-        /* Add the new doctor to the end of the list */
-        last_doctor->next = doctor;
+    /* Link the doctors after the last doctor */
+    if (first != NULL)
+    {
+        if (records->doctors_tail == NULL)
+        {
+            records->doctors = first;
+        }
+        else
+        {
+            records->doctors_tail->next = first;
+        }
+        records->doctors_tail = last;
+        records->num_doctors += (int)num_doctors;
     }
 
-    /* Update the number of doctors */
-    records->num_doctors += 1;
+    return 0;
 }
+
+/*******************************************************************************
+ * Adds many doctors to the hospital records at once & saves the database.
+ * Either every doctor is added or none are. The doctors are copied.
+ * Saving once is quicker than logging every doctor of a large batch.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - doctors - The doctors to add, in order
+ * - num_doctors - The number of doctors
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. On success the doctors
+ *   are saved, so they are kept once this returns. Exits if the database
+ *   cannot be saved.
+ ******************************************************************************/
+int doctor_import_batch(hospital_record_t *records,
+    const doctor_details_t *doctors, size_t num_doctors)
+{
+    if (doctor_add_batch(records, doctors, num_doctors) != 0)
+    {
+        return 1;
+    }
+    save_database(records);
+    return 0;
+}
+
 /*******************************************************************************
  * Validates the username.
  * 
@@ -153,18 +343,22 @@ void doctor_signup(hospital_record_t *records)
                 sizeof(license_number));
 
     /* Create a new doctor */
-    doctor_details_t *doctor = (doctor_details_t *)calloc(
-        1, sizeof(doctor_details_t));
-    strcpy(doctor->username, username);
-    strcpy(doctor->name, name);
-    strcpy(doctor->email, email);
-    strcpy(doctor->phone, phone);
-    doctor->password = password;
-    strcpy(doctor->specialization, specialization);
-    strcpy(doctor->license_number, license_number);
-
-    /* Add the doctor to the hospital records */
-    doctor_signup_silent(records, doctor);
+    doctor_details_t doctor;
+    doctor.username = username;
+    doctor.name = name;
+    doctor.email = email;
+    doctor.phone = phone;
+    doctor.password = password;
+    doctor.specialization = specialization;
+    doctor.license_number = license_number;
+
+    /* Add the doctor to the hospital records & log it */
+    doctor_details_t *added = doctor_signup_silent(records, &doctor);
+    if (added == NULL)
+    {
+        printf("Signup failed\n");
+        return;
+    }
 
     /* Print a success message if signup is successful */
     printf("Signup successful\n");
@@ -187,38 +381,34 @@ void add_patient(hospital_record_t *records)
 
 /*******************************************************************************
  * Finds a doctor in the hospital records.
+ * Takes the same time however many doctors there are. A doctor not yet read
+ * from the database file is read now.
  *
  * inputs:
  * - records - The hospital records
- * - num_users - The number of users in the database
  * - user_id - The ID of the user to find
  * outputs:
- * - The user if found, otherwise NULL
+ * - The user if found, otherwise NULL. Exits if the database file is
+ *   corrupt.
  ******************************************************************************/
 doctor_details_t *find_doctor(
     hospital_record_t *records,
     char *user_id)
 {
-
-    /* Get the doctors from the hospital records */
-    doctor_details_t *doctors = records->doctors;
-
-    /* Iterate through the doctors */
-    while (doctors != NULL)
+    /* Look the username up in the index */
+    doctor_details_t *doctor = (doctor_details_t *)username_index_find(
+        &records->doctor_index, user_id);
+
+    /* Then in the database file. A damaged page could hide the doctor, so
+     * stop rather than report it missing.
+     */
+    if (doctor == NULL && records->file != NULL &&
+        database_file_find_doctor(records, user_id, &doctor) != 0)
     {
-
-        /* If this user's ID matches the given ID */
-        if (strcmp(doctors->username, user_id) == 0)
-        {
-            return doctors;
-        }
-
-        /* Move to the next doctor */
-        doctors = doctors->next;
+        printf("[ERROR] %s is corrupt\n", records->encrypted_database_name);
+        exit(1);
     }
-
-    /* If no doctor is found, return NULL */
-    return NULL;
+    return doctor;
 }
 
 /*******************************************************************************
@@ -242,6 +432,27 @@ void print_doctor_update_menu()
            "X. Exit\n");
 }
 
+/*******************************************************************************
+ * Points a field of a doctor at a copy of a new string.
+ * The field is left as it was if the string could not be copied.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - field - The field to update
+ * - value - The new string
+ * outputs:
+ * - none
+ ******************************************************************************/
+void doctor_update_string(hospital_record_t *records, const char **field,
+    const char *value)
+{
+    const char *copy = string_pool_copy(&records->strings, value);
+    if (copy != NULL)
+    {
+        *field = copy;
+    }
+}
+
 /*******************************************************************************
  * Updates a doctor's details in the hospital records.
  *
@@ -263,6 +474,9 @@ void update_doctor_details(
             break;
         }
 
+        /* The username the change is logged under */
+        const char *logged_username = doctor->username;
+
         /* Process the menu choice */
         if (choice == '1')
         {
@@ -271,8 +485,16 @@ void update_doctor_details(
             char username[256];
             doctor_ask_for_username(records, username, 1);
 
-            /* Update the doctor's username */
-            strcpy(doctor->username, username);
+            /* Update the doctor's username & where it is indexed */
+            const char *copy = string_pool_copy(&records->strings, username);
+            if (copy != NULL)
+            {
+                username_index_remove(&records->doctor_index,
+                    doctor->username);
+                doctor->username = copy;
+                username_index_insert(&records->doctor_index,
+                    doctor->username, doctor);
+            }
         }
         else if (choice == '2')
         {
@@ -281,7 +503,7 @@ void update_doctor_details(
             ask_for_name(name, 1);
 
             /* Update the doctor's name */
-            strcpy(doctor->name, name);
+            doctor_update_string(records, &doctor->name, name);
         }
         else if (choice == '3')
         {
@@ -291,7 +513,7 @@ void update_doctor_details(
             ask_for_email(email, 1);
 
             /* Update the doctor's email */
-            strcpy(doctor->email, email);
+            doctor_update_string(records, &doctor->email, email);
         }
         else if (choice == '4')
         {
@@ -301,7 +523,7 @@ void update_doctor_details(
             ask_for_phone(phone, 1);
 
             /* Update the doctor's phone */
-            strcpy(doctor->phone, phone);
+            doctor_update_string(records, &doctor->phone, phone);
         }
         else if (choice == '5')
         {
@@ -321,7 +543,12 @@ void update_doctor_details(
                         sizeof(specialization));
 
             /* Update the doctor's specialization */
-            strcpy(doctor->specialization, specialization);
+            const char *interned = string_pool_intern(&records->strings,
+                specialization);
+            if (interned != NULL)
+            {
+                doctor->specialization = interned;
+            }
         }
         else if (choice == '7')
         {
@@ -332,16 +559,18 @@ void update_doctor_details(
                         sizeof(license_number));
 
             /* Update the doctor's license number */
-            strcpy(doctor->license_number, license_number);
+            doctor_update_string(records, &doctor->license_number,
+                license_number);
 
         /* Otherwise, invalid option */
         } else {
             /* Invalid option */
             printf("Invalid choice\n");
+            continue;
         }
 
-        /* Update the records after every action */
-        save_database(records);
+        /* Log the change, rather than saving every doctor again */
+        database_log_doctor(records, logged_username, doctor);
     }
 }
 
@@ -357,6 +586,7 @@ void view_all_patients(hospital_record_t *records)
 {
 
     /* Get the patients from the hospital records */
+    database_load_all(records);
     patient_details_t *patients = records->patients;
 
     /* Iterate through the patients */
@@ -616,9 +846,6 @@ void doctor_use(hospital_record_t *records, doctor_details_t *doctor)
             printf("Invalid choice\n");
         }
 
-        /* Update the records after every action */
-        save_database(records);
-
         /* Print the menu again */
         print_doctor_menu();
     }
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
@@ -8,43 +9,115 @@
 #include "utils/input.h"
 
 /*******************************************************************************
- * Silently adds a new patient to the hospital records.
+ * Copies a patient & its strings into the memory of the hospital records.
+ * Medical histories are often the same, so are interned. The other strings
+ * are copied as they are.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patient - The patient to copy. NULL strings are copied as empty strings.
+ * outputs:
+ * - The copy, or NULL if memory could not be allocated
+ ******************************************************************************/
+patient_details_t *patient_copy(
+    hospital_record_t *records,
+    const patient_details_t *patient
+) {
+
+    patient_details_t *copy = (patient_details_t *)record_slab_alloc(
+        &records->patient_slab);
+    if (copy == NULL) {
+        return NULL;
+    }
+
+    /* Copy the fields, then the strings the fields point to */
+    *copy = *patient;
+    copy->next = NULL;
+    copy->username = string_pool_copy(&records->strings, patient->username);
+    copy->name = string_pool_copy(&records->strings, patient->name);
+    copy->email = string_pool_copy(&records->strings, patient->email);
+    copy->phone = string_pool_copy(&records->strings, patient->phone);
+    copy->medical_history = string_pool_intern(&records->strings,
+        patient->medical_history);
+
+    /* Give the memory back if any string could not be copied */
+    if (copy->username == NULL || copy->name == NULL || copy->email == NULL ||
+        copy->phone == NULL || copy->medical_history == NULL) {
+        record_slab_release(&records->patient_slab, copy);
+        return NULL;
+    }
+
+    return copy;
+}
+
+/*******************************************************************************
+ * Adds a new patient to the hospital records in memory.
+ * The patient is copied, so the caller keeps ownership of it & its strings.
  * 
  * inputs:
  * - records - The hospital records
  * - patient - The patient to add
  * outputs:
- * - none
+ * - The patient in the records, or NULL if memory could not be allocated.
+ *   Nothing is logged or saved; the caller must do so to keep the patient.
  ******************************************************************************/
-void patient_signup_silent(
+patient_details_t *patient_add(
     hospital_record_t *records, 
-    patient_details_t *patient
+    const patient_details_t *patient
 ) {
 
+    /* Copy the patient into the records */
+    patient_details_t *copy = patient_copy(records, patient);
+    if (copy == NULL) {
+        return NULL;
+    }
+
     /* If this is the first patient */
-    if ( records->num_patients == 0 ) {
+    if (records->patients_tail == NULL) {
 
         /* Add the patient to the list */
-        records->patients = patient;
+        records->patients = copy;
 
-        /* Mark the end of the list */
-        records->patients->next = NULL;
-    
     /* If this is not the first entry */
     } else {
 
-        /* Find the last patient*/
-        patient_details_t *last_patient = records->patients;
-        while (last_patient->next != NULL) {
-            last_patient = last_patient->next;
-        }
-
-        /* Add the new patient to the end of the list */
-        last_patient->next = patient;
+        /* Add the new patient after the last patient */
+        records->patients_tail->next = copy;
     }
+    records->patients_tail = copy;
 
     /* Update the number of patients */
     records->num_patients += 1;
+
+    /* Index the patient by username */
+    username_index_insert(&records->patient_index, copy->username, copy);
+
+    return copy;
+}
+
+/*******************************************************************************
+ * Silently adds a new patient to the hospital records & logs it.
+ * The patient is copied, so the caller keeps ownership of it & its strings.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patient - The patient to add
+ * outputs:
+ * - The patient in the records, or NULL if memory could not be allocated.
+ *   The patient is logged, so it is kept once this returns. Exits if the
+ *   log cannot be written.
+ ******************************************************************************/
+patient_details_t *patient_signup_silent(
+    hospital_record_t *records, 
+    const patient_details_t *patient
+) {
+
+    /* Add the patient, then log it */
+    patient_details_t *added = patient_add(records, patient);
+    if (added != NULL) {
+        database_log_patient(records, added->username, added);
+    }
+    return added;
 }
 
 /*******************************************************************************
@@ -65,46 +138,130 @@ float calculate_bmi(float weight, float height) {
 }
 
 /*******************************************************************************
- * Silently adds a new patient to the hospital records.
+ * Adds a new patient to the hospital records & says so.
  * 
  * inputs:
  * - records - The hospital records
  * - patient - The patient to add
  * outputs:
- * - none
+ * - none. The patient is logged, so it is kept once this returns.
  ******************************************************************************/
 void patient_signup_batch(
     hospital_record_t *records, 
     patient_details_t *patient
 ) {
 
-    /* If this is the first patient */
-    if ( records->num_patients == 0 ) {
+    /* Add the patient to the end of the list */
+    patient_signup_silent(records, patient);
 
-        /* Add the patient to the list */
-        records->patients = patient;
+    /* Indicate a patient has been successfully added */
+    printf("Patient %s added successfully\n", patient->username);
+}
 
-        /* Mark the end of the list */
-        records->patients->next = NULL;
-    
-    /* If this is not the first entry */
-    } else {
+/*******************************************************************************
+ * Adds many patients to the hospital records at once, in memory.
+ * Room in the index is made once for all of them, then each is copied,
+ * indexed & linked in a single pass. Either every patient is added or none
+ * are.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patients - The patients to add, in order
+ * - num_patients - The number of patients
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. Nothing is logged or
+ *   saved; the caller must do so to keep the patients.
+ ******************************************************************************/
+int patient_add_batch(
+    hospital_record_t *records,
+    const patient_details_t *patients,
+    size_t num_patients
+) {
+
+    patient_details_t *first = NULL;
+    patient_details_t *last = NULL;
+    size_t i;
+
+    /* Make room for every patient */
+    if (username_index_reserve(&records->patient_index,
+            records->patient_index.count + num_patients) != 0) {
+        return 1;
+    }
 
-        /* Find the last patient*/
-        patient_details_t *last_patient = records->patients;
-        while (last_patient->next != NULL) {
-            last_patient = last_patient->next;
+    /* Copy & index every patient, undoing it all if any username is taken */
+    for (i = 0; i < num_patients; i++) {
+        patient_details_t *copy = NULL;
+        if (patients[i].username != NULL && patients[i].username[0] != '\0' &&
+            find_patient(records, (char *)patients[i].username) == NULL) {
+            copy = patient_copy(records, &patients[i]);
+        }
+        if (copy == NULL || username_index_insert(&records->patient_index,
+                copy->username, copy) != 0) {
+            printf("Patient %s could not be imported\n",
+                patients[i].username != NULL ? patients[i].username : "");
+            if (copy != NULL) {
+                record_slab_release(&records->patient_slab, copy);
+            }
+            while (first != NULL) {
+                patient_details_t *next = first->next;
+                username_index_remove(&records->patient_index,
+                    first->username);
+                record_slab_release(&records->patient_slab, first);
+                first = next;
+            }
+            return 1;
         }
 
-        /* Add the new patient to the end of the list */
-        last_patient->next = patient;
+        /* Link the copies together until they are all added */
+        if (last == NULL) {
+            first = copy;
+        } else {
+            last->next = copy;
+        }
+        last = copy;
     }
 
-    /* Update the number of patients */
-    records->num_patients += 1;
+    /* Link the patients after the last patient */
+    if (first != NULL) {
+        if (records->patients_tail == NULL) {
+            records->patients = first;
+        } else {
+            records->patients_tail->next = first;
+        }
+        records->patients_tail = last;
+        records->num_patients += (int)num_patients;
+    }
 
-    /* Indicate a patient has been successfully added */
-    printf("Patient %s added successfully\n", patient->username);
+    return 0;
+}
+
+/*******************************************************************************
+ * Adds many patients to the hospital records at once & saves the database.
+ * Either every patient is added or none are. The patients are copied.
+ * Saving once is quicker than logging every patient of a large batch.
+ * 
+ * inputs:
+ * - records - The hospital records
+ * - patients - The patients to add, in order
+ * - num_patients - The number of patients
+ * outputs:
+ * - 0 on success, 1 if a username is empty or already used(including twice
+ *   in the batch) or memory could not be allocated. On success the patients
+ *   are saved, so they are kept once this returns. Exits if the database
+ *   cannot be saved.
+ ******************************************************************************/
+int patient_import_batch(
+    hospital_record_t *records,
+    const patient_details_t *patients,
+    size_t num_patients
+) {
+
+    if (patient_add_batch(records, patients, num_patients) != 0) {
+        return 1;
+    }
+    save_database(records);
+    return 0;
 }
 
 /*******************************************************************************
@@ -207,7 +364,7 @@ patient_details_t *patient_signup(hospital_record_t *records) {
     char blood_type[256];
     ask_for_blood_type(blood_type, 0);
     /* Medical history */
-    char medical_history[256];
+    char medical_history[512];
     ask_for_medical_history(NULL, medical_history);
     /* Weight */
     float weight_float = ask_for_weight(0);
@@ -215,70 +372,63 @@ patient_details_t *patient_signup(hospital_record_t *records) {
     float height_float = ask_for_height(0);
 
     /* Create a new patient */
-    patient_details_t *patient = malloc(sizeof(patient_details_t));
-    /* Username */
-    strcpy(patient->username, username);
-    /* Name */
-    strcpy(patient->name, name);
-    /* Email */
-    strcpy(patient->email, email);
-    /* Phone */
-    strcpy(patient->phone, phone);
-    /* Password */
-    patient->password = password;
+    patient_details_t patient;
+    patient.username = username;
+    patient.name = name;
+    patient.email = email;
+    patient.phone = phone;
+    patient.password = password;
     /* Blood type */
-    strcpy(patient->blood_type, blood_type);
-    /* Medical history */
-    strcpy(patient->medical_history, medical_history);
-    /* Weight */
-    patient->weight = weight_float;
-    /* Height */
-    patient->height = height_float;
+    strcpy(patient.blood_type, blood_type);
+    patient.medical_history = medical_history;
+    patient.weight = weight_float;
+    patient.height = height_float;
     /* BMI */
-    patient->bmi = calculate_bmi(patient->weight, patient->height);
+    patient.bmi = calculate_bmi(patient.weight, patient.height);
 
-    /* Add the patient to the hospital records */
-    patient_signup_silent(records, patient);
+    /* Add the patient to the hospital records & log it */
+    patient_details_t *added = patient_signup_silent(records, &patient);
+    if (added == NULL) {
+        printf("Patient %s could not be added\n", username);
+        return NULL;
+    }
 
     /* Print a success message */
-    printf("Patient %s added successfully\n", patient->username);
+    printf("Patient %s added successfully\n", added->username);
 
     /* Return the newly created patient */
-    return patient;
+    return added;
 }
 
 
 /*******************************************************************************
  * Finds a patient in the hospital records.
+ * Takes the same time however many patients there are. A patient not yet
+ * read from the database file is read now.
  * 
  * inputs:
  * - records - The hospital records
- * - num_users - The number of users in the database
  * - user_id - The ID of the user to find
  * outputs:
- * - The user if found, otherwise NULL
+ * - The user if found, otherwise NULL. Exits if the database file is
+ *   corrupt.
  ******************************************************************************/
 patient_details_t *find_patient(hospital_record_t *records, 
     char *user_id) {
 
-    /* Get the patients from the hospital records */
-    patient_details_t *patients = records->patients;
-
-    /* Iterate through the patients */
-    while ( patients != NULL) {
-
-        /* If this user's ID matches the given ID */
-        if (strcmp(patients->username, user_id) == 0) {
-            return patients;
-        }
-
-        /* Move to the next patient */
-        patients = patients->next;
+    /* Look the username up in the index */
+    patient_details_t *patient = (patient_details_t *)username_index_find(
+        &records->patient_index, user_id);
+
+    /* Then in the database file. A damaged page could hide the patient, so
+     * stop rather than report it missing.
+     */
+    if (patient == NULL && records->file != NULL &&
+        database_file_find_patient(records, user_id, &patient) != 0) {
+        printf("[ERROR] %s is corrupt\n", records->encrypted_database_name);
+        exit(1);
     }
-
-    /* If no patient is found, return NULL */
-    return NULL;
-
+    return patient;
 }
 /*******************************************************************************
  * Prints the choices available for the patient update menu.
@@ -305,6 +455,26 @@ void print_patient_update_menu()
 }
 
 
+/*******************************************************************************
+ * Points a field of a patient at a copy of a new string.
+ * The field is left as it was if the string could not be copied.
+ *
+ * inputs:
+ * - records - The hospital records
+ * - field - The field to update
+ * - value - The new string
+ * outputs:
+ * - none
+ ******************************************************************************/
+void patient_update_string(hospital_record_t *records, const char **field,
+    const char *value)
+{
+    const char *copy = string_pool_copy(&records->strings, value);
+    if (copy != NULL) {
+        *field = copy;
+    }
+}
+
 /*******************************************************************************
  * Updates a patient's details in the hospital records.
  *
@@ -329,27 +499,55 @@ void update_patient_details(
             break;
         }
 
+        /* The username the change is logged under */
+        const char *logged_username = patient->username;
+
         /* Process the menu choice */
         if (strcmp(choice, "1") == 0) {
             /* Ask for the new username */
             char username[256];
             patient_ask_for_username(records, username, 1);
-            /* Update the username */
-            strcpy(patient->username, username);
+            /* Update the username & where it is indexed */
+            const char *copy = string_pool_copy(&records->strings, username);
+            if (copy != NULL) {
+                username_index_remove(&records->patient_index,
+                    patient->username);
+                patient->username = copy;
+                username_index_insert(&records->patient_index,
+                    patient->username, patient);
+            }
         } else if (strcmp(choice, "2") == 0) {
-            ask_for_name(patient->name, 1);
+            char name[256];
+            ask_for_name(name, 1);
+            patient_update_string(records, &patient->name, name);
         } else if (strcmp(choice, "3") == 0) {
-            ask_for_email(patient->email, 1);
+            char email[256];
+            ask_for_email(email, 1);
+            patient_update_string(records, &patient->email, email);
         } else if (strcmp(choice, "4") == 0) {
-            ask_for_phone(patient->phone, 1);
+            char phone[256];
+            ask_for_phone(phone, 1);
+            patient_update_string(records, &patient->phone, phone);
         } else if (strcmp(choice, "5") == 0) {
             patient->password = ask_for_password(1);
         } else if (strcmp(choice, "6") == 0) {
-            ask_for_blood_type(patient->blood_type, 1);
+            char blood_type[256];
+            ask_for_blood_type(blood_type, 1);
+            strcpy(patient->blood_type, blood_type);
         } else if (strcmp(choice, "7") == 0) {
-            ask_for_medical_history(patient->medical_history, patient->medical_history);
+            /* Room for the existing history, a new line & the new history */
+            char medical_history[512];
+            ask_for_medical_history(patient->medical_history, medical_history);
+            const char *history = string_pool_intern(&records->strings,
+                medical_history);
+            if (history != NULL) {
+                patient->medical_history = history;
+            }
         } else if (strcmp(choice, "8") == 0) {
-            patient->medical_history[0] = '\0';
+            const char *history = string_pool_intern(&records->strings, "");
+            if (history != NULL) {
+                patient->medical_history = history;
+            }
         } else if (strcmp(choice, "9") == 0) {
             patient->weight = ask_for_weight(1);
 
@@ -362,10 +560,12 @@ void update_patient_details(
             patient->bmi = calculate_bmi(patient->weight, patient->height);
         } else {
             printf("Invalid choice\n");
+            print_patient_update_menu();
+            continue;
         }
 
-        /* Update the records after every action */
-        save_database(records);
+        /* Log the change, rather than saving every patient again */
+        database_log_patient(records, logged_username, patient);
 
         /* Print the menu again */
         print_patient_update_menu();
@@ -379,52 +579,61 @@ void update_patient_details(
  * - records - The hospital records
  * - username - The username of the patient to delete
  * outputs:
- * - none
+ * - 1 if the patient was deleted, 0 if no patient has the username
  ******************************************************************************/
-void delete_patient_silent(hospital_record_t *records, char *username) {
-
-    /* Get the patients from the hospital records */
-    patient_details_t *patients = records->patients;
+int delete_patient_silent(hospital_record_t *records, char *username) {
 
-    /* Stores the previous patient */
-    patient_details_t *prev_patient = NULL;
-
-    /* Iterate through the patients */
-    while ( patients != NULL) {
-
-        /* If this user's ID matches the given ID */
-        if (strcmp(patients->username, username) == 0) {
+    /* Nothing needs to be read from the database file if there is no such
+     * patient
+     */
+    if (find_patient(records, username) == NULL) {
+        return 0;
+    }
 
-            /* Get the current patient */
-            patient_details_t *current_patient = patients;
+    /* The patient must be in the list to be unlinked */
+    database_load_all(records);
 
-            /* If there was a previous patient */
-            if (prev_patient != NULL) {
+    /* Find the patient & stop indexing it */
+    patient_details_t *patient = (patient_details_t *)username_index_remove(
+        &records->patient_index, username);
+    if (patient == NULL) {
+        return 0;
+    }
 
-                /* Update the next pointer of the previous patient */
-                prev_patient->next = patients->next;
+    /* Find the previous patient in the list */
+    patient_details_t *prev_patient = NULL;
+    patient_details_t *patients = records->patients;
+    while (patients != patient) {
+        prev_patient = patients;
+        patients = patients->next;
+    }
 
-            /* Otherwise if this is the first patient */
-            } else {
+    /* If there was a previous patient */
+    if (prev_patient != NULL) {
 
-                /* Update the head of the list */
-                records->patients = patients->next;
-            }
+        /* Update the next pointer of the previous patient */
+        prev_patient->next = patient->next;
 
-            /* Free the memory allocated for the current patient */
-            free(current_patient);
-
-            /* Decrement the number of patients */
-            records->num_patients -= 1;
+    /* Otherwise if this is the first patient */
+    } else {
 
-            /* Return */
-            return;
-        }
+        /* Update the head of the list */
+        records->patients = patient->next;
+    }
 
-        /* Move to the next patient */
-        patients = patients->next;
+    /* If this was the last patient */
+    if (records->patients_tail == patient) {
+        records->patients_tail = prev_patient;
     }
 
+    /* Give the memory back to be reused.
+     * Its strings stay in the pool until the database is closed.
+     */
+    record_slab_release(&records->patient_slab, patient);
+
+    /* Decrement the number of patients */
+    records->num_patients -= 1;
+    return 1;
 }
 
 /*******************************************************************************
@@ -441,9 +650,13 @@ void delete_patient(hospital_record_t *records) {
         sizeof(username));
 
     /* Delete the patient from the hospital records */
-    delete_patient_silent(records, username);
+    if (!delete_patient_silent(records, username)) {
+        printf("Patient not found\n");
+        return;
+    }
 
-    /* Print a success message if deletion is successful */
+    /* Log the deletion & print a success message */
+    database_log_delete_patient(records, username);
     printf("Patient deleted successfully\n");
 }
 
@@ -536,9 +749,6 @@ void patient_use(hospital_record_t *records, patient_details_t *patient) {
             printf("Invalid choice\n");
         }
 
-        /* Update the records after every action */
-        save_database(records);
-
         /* Print the menu again */
         print_patient_menu();
     }
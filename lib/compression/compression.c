@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression/compression.h"
+#include "compression/varint.h"
+
+/* Most bytes of the zero run filter header */
+#define ZERO_RLE_MAX_HEADER_SIZE (4 + 1 + COMPRESSION_MAX_VARINT_SIZE)
+
+/*******************************************************************************
+ * Checks whether compressed data was written by the LZ level.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * outputs:
+ * - 1 if the data starts with LZ_MAGIC, otherwise 0
+ ******************************************************************************/
+int compression_is_lz(const unsigned char *input, size_t input_size) {
+
+    return input_size >= 4 && memcmp(input, LZ_MAGIC, 4) == 0;
+}
+
+/*******************************************************************************
+ * Checks whether compressed data was passed through the zero run filter.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * outputs:
+ * - 1 if the data starts with ZERO_RLE_MAGIC, otherwise 0
+ ******************************************************************************/
+int compression_is_zero_rle(const unsigned char *input, size_t input_size) {
+
+    return input_size >= 4 && memcmp(input, ZERO_RLE_MAGIC, 4) == 0;
+}
+
+/*******************************************************************************
+ * Reads the header of data passed through the zero run filter.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - The size of the header or 0 if it is invalid
+ ******************************************************************************/
+size_t read_zero_rle_header(const unsigned char *input, size_t input_size,
+    size_t *size) {
+
+    if (input_size < 5 || input[4] != ZERO_RLE_VERSION) {
+        printf("[ERROR] Unsupported zero run filter header\n");
+        return 0;
+    }
+
+    size_t varint_size = compression_read_varint(input + 5, input_size - 5,
+        size);
+    if (varint_size == 0) {
+        printf("[ERROR] Invalid zero run filter header\n");
+        return 0;
+    }
+    return 5 + varint_size;
+}
+
+/*******************************************************************************
+ * Gets the most bytes compression_compress() can write for an input.
+ *
+ * inputs:
+ * - level: The compression level
+ * - input_size: The number of bytes to compress
+ * outputs:
+ * - The size of output buffer that is always large enough. 0 if the level
+ *   is unknown.
+ ******************************************************************************/
+size_t compression_bound(int level, size_t input_size) {
+
+    if (level & COMPRESSION_FILTER_ZERO_RLE) {
+        size_t bound = compression_bound(level & ~COMPRESSION_FILTER_ZERO_RLE,
+            zero_rle_bound(input_size));
+        return bound == 0 ? 0 : ZERO_RLE_MAX_HEADER_SIZE + bound;
+    }
+
+    switch (level) {
+        case COMPRESSION_LEVEL_HUFFMAN:
+            return huffman_compress_bound(input_size);
+        case COMPRESSION_LEVEL_LZ:
+            return lz_compress_bound(input_size);
+        default:
+            return 0;
+    }
+}
+
+/*******************************************************************************
+ * Passes data through the zero run filter, then compresses it.
+ *
+ * inputs:
+ * - level: The compression level, without the filter
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int compression_compress_zero_rle(int level, const unsigned char *input,
+    size_t input_size, unsigned char *output, size_t output_capacity,
+    size_t *output_size) {
+
+    size_t filtered_capacity = zero_rle_bound(input_size);
+    size_t filtered_size;
+    size_t compressed_size;
+
+    if (output_capacity < ZERO_RLE_MAX_HEADER_SIZE) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 1;
+    }
+    memcpy(output, ZERO_RLE_MAGIC, 4);
+    output[4] = ZERO_RLE_VERSION;
+    size_t header_size = 5 + compression_write_varint(output + 5, input_size);
+
+    unsigned char *filtered = (unsigned char *)malloc(filtered_capacity);
+    if (filtered == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    int failed = zero_rle_encode(input, input_size, filtered,
+            filtered_capacity, &filtered_size) != 0 ||
+        compression_compress(level, filtered, filtered_size,
+            output + header_size, output_capacity - header_size,
+            &compressed_size) != 0;
+    free(filtered);
+
+    if (failed) {
+        return 1;
+    }
+    *output_size = header_size + compressed_size;
+    return 0;
+}
+
+/*******************************************************************************
+ * Compresses data in memory at a compression level.
+ * Filters allocate a buffer for the filtered data.
+ *
+ * inputs:
+ * - level: COMPRESSION_LEVEL_HUFFMAN or COMPRESSION_LEVEL_LZ, plus any
+ *          COMPRESSION_FILTER_ flags
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output. compression_bound() is always
+ *                    enough.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an unknown level)
+ ******************************************************************************/
+int compression_compress(int level, const unsigned char *input,
+    size_t input_size, unsigned char *output, size_t output_capacity,
+    size_t *output_size) {
+
+    if (compression_bound(level, 0) == 0) {
+        printf("[ERROR] Unknown compression level %d\n", level);
+        return 1;
+    }
+
+    if (level & COMPRESSION_FILTER_ZERO_RLE) {
+        return compression_compress_zero_rle(
+            level & ~COMPRESSION_FILTER_ZERO_RLE, input, input_size,
+            output, output_capacity, output_size);
+    }
+
+    if (level == COMPRESSION_LEVEL_LZ) {
+        return lz_compress_buffer(input, input_size, output,
+            output_capacity, output_size);
+    }
+    return huffman_compress_buffer(input, input_size, output,
+        output_capacity, output_size);
+}
+
+/*******************************************************************************
+ * Gets the number of bytes compressed data of any level decompresses to.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int compression_decompressed_size(const unsigned char *input,
+    size_t input_size, size_t *size) {
+
+    if (compression_is_zero_rle(input, input_size)) {
+        return read_zero_rle_header(input, input_size, size) == 0;
+    }
+    if (compression_is_lz(input, input_size)) {
+        return lz_decompressed_size(input, input_size, size);
+    }
+    return huffman_decompressed_size(input, input_size, size);
+}
+
+/*******************************************************************************
+ * Decompresses data passed through the zero run filter, then undoes the
+ * filter.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int compression_decompress_zero_rle(const unsigned char *input,
+    size_t input_size, unsigned char *output, size_t output_capacity,
+    size_t *output_size) {
+
+    size_t size, filtered_size;
+
+    size_t header_size = read_zero_rle_header(input, input_size, &size);
+    if (header_size == 0) {
+        return 1;
+    }
+    if (size > output_capacity) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 1;
+    }
+
+    /* Filters are only applied once */
+    const unsigned char *compressed = input + header_size;
+    size_t compressed_size = input_size - header_size;
+    if (compression_is_zero_rle(compressed, compressed_size) ||
+        compression_decompressed_size(compressed, compressed_size,
+            &filtered_size) != 0 ||
+        filtered_size > zero_rle_bound(size)) {
+        printf("[ERROR] Invalid zero run filter data\n");
+        return 1;
+    }
+
+    unsigned char *filtered = (unsigned char *)malloc(
+        filtered_size > 0 ? filtered_size : 1);
+    if (filtered == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    int failed = compression_decompress(compressed, compressed_size,
+            filtered, filtered_size, &filtered_size) != 0 ||
+        zero_rle_decode(filtered, filtered_size, output, size,
+            output_size) != 0 ||
+        *output_size != size;
+    free(filtered);
+
+    if (failed) {
+        printf("[ERROR] Invalid zero run filter data\n");
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Decompresses data of any level. The level & filters are found from the
+ * header. Filters allocate a buffer for the filtered data.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output. compression_decompressed_size()
+ *                    gives the size needed.
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an output too small)
+ ******************************************************************************/
+int compression_decompress(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    if (compression_is_zero_rle(input, input_size)) {
+        return compression_decompress_zero_rle(input, input_size, output,
+            output_capacity, output_size);
+    }
+    if (compression_is_lz(input, input_size)) {
+        return lz_decompress_buffer(input, input_size, output,
+            output_capacity, output_size);
+    }
+    return huffman_decompress_buffer(input, input_size, output,
+        output_capacity, output_size);
+}
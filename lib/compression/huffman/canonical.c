@@ -0,0 +1,261 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression/huffman/tree.h"
+#include "compression/huffman/codes.h"
+#include "compression/huffman/canonical.h"
+
+/*******************************************************************************
+ * Shortens code lengths longer than HUFFMAN_MAX_CODE_LENGTH.
+ * Long codes are cut to the maximum, then codes are moved down a level until
+ * the lengths form a complete code again. The most frequent bytes are then
+ * given the shortest of the new lengths.
+ *
+ * inputs:
+ * - frequency_table: Tracks the number of occurences of each byte
+ * - lengths: The code lengths from the Huffman tree. Adjusted in place.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void limit_huffman_code_lengths(unsigned int frequency_table[256],
+    unsigned char lengths[256]) {
+
+    /* Number of codes of each length, with long codes cut to the maximum */
+    unsigned int count[HUFFMAN_MAX_CODE_LENGTH + 1] = { 0 };
+    int i, j;
+    for (i = 0; i < 256; i++) {
+        if (lengths[i] > 0) {
+            count[lengths[i] > HUFFMAN_MAX_CODE_LENGTH ?
+                HUFFMAN_MAX_CODE_LENGTH : lengths[i]] += 1;
+        }
+    }
+
+    /* Kraft sum in units of the longest code. A complete code fills
+     * exactly 1 << HUFFMAN_MAX_CODE_LENGTH.
+     */
+    unsigned long total = 0;
+    for (i = 1; i <= HUFFMAN_MAX_CODE_LENGTH; i++) {
+        total += (unsigned long)count[i] << (HUFFMAN_MAX_CODE_LENGTH - i);
+    }
+
+    /* Each step removes a longest code & splits a shorter code in 2 */
+    while (total > (1UL << HUFFMAN_MAX_CODE_LENGTH)) {
+        count[HUFFMAN_MAX_CODE_LENGTH] -= 1;
+        for (i = HUFFMAN_MAX_CODE_LENGTH - 1; i > 0; i--) {
+            if (count[i] > 0) {
+                count[i] -= 1;
+                count[i + 1] += 2;
+                break;
+            }
+        }
+        total -= 1;
+    }
+
+    /* Order the bytes from most to least frequent */
+    unsigned char order[256];
+    int num_bytes = 0;
+    for (i = 0; i < 256; i++) {
+        if (lengths[i] > 0) {
+            order[num_bytes++] = (unsigned char)i;
+        }
+    }
+    for (i = 1; i < num_bytes; i++) {
+        unsigned char byte = order[i];
+        for (j = i; j > 0 &&
+            frequency_table[order[j - 1]] < frequency_table[byte]; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = byte;
+    }
+
+    /* Hand out the lengths, shortest first */
+    int length = 1;
+    for (i = 0; i < num_bytes; i++) {
+        while (count[length] == 0) {
+            length++;
+        }
+        lengths[order[i]] = (unsigned char)length;
+        count[length] -= 1;
+    }
+}
+
+/*******************************************************************************
+ * Create the code length of each byte.
+ * Lengths come from a Huffman tree. If any is longer than
+ * HUFFMAN_MAX_CODE_LENGTH, the lengths are adjusted so none are while the
+ * most frequent bytes keep the shortest codes.
+ *
+ * inputs:
+ * - frequency_table: Tracks the number of occurences of each byte
+ * - lengths: Set to the code length of each byte. 0 if it does not occur.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void create_huffman_code_lengths(unsigned int frequency_table[256],
+    unsigned char lengths[256]) {
+
+    /* Create Huffman tree */
+    HuffmanTree_t tree;
+    HuffmanNode_t *huffman_tree = create_huffman_tree(&tree, frequency_table);
+
+    /* Depth of each byte in the tree */
+    HuffmanCode_t codes[256];
+    memset(codes, 0, sizeof(codes));
+    generate_huffman_codes(huffman_tree, 0, 0, codes);
+
+    int i;
+    int longest = 0;
+    for (i = 0; i < 256; i++) {
+        lengths[i] = (unsigned char)codes[i].length;
+        if (codes[i].length > longest) {
+            longest = codes[i].length;
+        }
+    }
+
+    /* A single byte still needs a length to be stored */
+    if (longest == 0) {
+        for (i = 0; i < 256; i++) {
+            if (frequency_table[i] > 0) {
+                lengths[i] = 1;
+            }
+        }
+    }
+
+    if (longest > HUFFMAN_MAX_CODE_LENGTH) {
+        limit_huffman_code_lengths(frequency_table, lengths);
+    }
+}
+
+/*******************************************************************************
+ * Create canonical Huffman codes from code lengths.
+ * Codes of the same length are consecutive numbers in byte order, so the
+ * lengths alone are enough to rebuild the codes.
+ *
+ * inputs:
+ * - lengths: The code length of each byte
+ * - codes: The codes table to fill. 256 for each possible byte.
+ * outputs:
+ * - none
+ ******************************************************************************/
+void create_canonical_huffman_codes(const unsigned char lengths[256],
+    HuffmanCode_t codes[256]) {
+
+    unsigned int count[HUFFMAN_MAX_CODE_LENGTH + 1] = { 0 };
+    uint64_t next_code[HUFFMAN_MAX_CODE_LENGTH + 1];
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        count[lengths[i]] += 1;
+    }
+    count[0] = 0;
+
+    /* First code of each length follows on from the last shorter code */
+    uint64_t code = 0;
+    for (i = 1; i <= HUFFMAN_MAX_CODE_LENGTH; i++) {
+        code = (code + count[i - 1]) << 1;
+        next_code[i] = code;
+    }
+
+    for (i = 0; i < 256; i++) {
+        codes[i].length = lengths[i];
+        codes[i].bits = lengths[i] > 0 ? next_code[lengths[i]]++ : 0;
+    }
+}
+
+/*******************************************************************************
+ * Checks whether code lengths can form a complete canonical code.
+ * No codes at all(empty data) & a single code of length 1 are also valid.
+ *
+ * inputs:
+ * - lengths: The code length of each byte
+ * outputs:
+ * - 1 if the lengths are valid, otherwise 0
+ ******************************************************************************/
+int huffman_code_lengths_valid(const unsigned char lengths[256]) {
+
+    unsigned long total = 0;
+    int num_codes = 0;
+    int i;
+
+    for (i = 0; i < 256; i++) {
+        if (lengths[i] > HUFFMAN_MAX_CODE_LENGTH) {
+            return 0;
+        }
+        if (lengths[i] > 0) {
+            total += 1UL << (HUFFMAN_MAX_CODE_LENGTH - lengths[i]);
+            num_codes++;
+        }
+    }
+
+    /* A single byte is given a length of 1 but never coded */
+    if (num_codes == 1) {
+        return total == (1UL << (HUFFMAN_MAX_CODE_LENGTH - 1));
+    }
+
+    /* Every string of bits must decode to exactly one byte */
+    return num_codes == 0 || total == (1UL << HUFFMAN_MAX_CODE_LENGTH);
+}
+
+/*******************************************************************************
+ * Stores code lengths as runs.
+ * Each byte holds a length(high 4 bits) & how many bytes in a row use it,
+ * minus 1(low 4 bits).
+ *
+ * inputs:
+ * - lengths: The code length of each byte
+ * - output: Where to store the runs. Room for HUFFMAN_MAX_LENGTHS_SIZE bytes.
+ * outputs:
+ * - The number of bytes written
+ ******************************************************************************/
+size_t write_huffman_code_lengths(const unsigned char lengths[256],
+    unsigned char *output) {
+
+    size_t size = 0;
+    int i = 0;
+
+    while (i < 256) {
+        int run = 1;
+        while (i + run < 256 && run < 16 && lengths[i + run] == lengths[i]) {
+            run++;
+        }
+        output[size++] = (unsigned char)((lengths[i] << 4) | (run - 1));
+        i += run;
+    }
+
+    return size;
+}
+
+/*******************************************************************************
+ * Reads code lengths stored by write_huffman_code_lengths().
+ *
+ * inputs:
+ * - input: The runs
+ * - input_size: The number of bytes available
+ * - lengths: Set to the code length of each byte
+ * outputs:
+ * - The number of bytes read or 0 if the runs are invalid
+ ******************************************************************************/
+size_t read_huffman_code_lengths(const unsigned char *input, size_t input_size,
+    unsigned char lengths[256]) {
+
+    size_t size = 0;
+    int i = 0;
+
+    while (i < 256) {
+        if (size == input_size) {
+            return 0;
+        }
+
+        int length = input[size] >> 4;
+        int run = (input[size] & 0x0F) + 1;
+        size++;
+
+        if (i + run > 256) {
+            return 0;
+        }
+        memset(lengths + i, length, run);
+        i += run;
+    }
+
+    return size;
+}
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression/huffman/tree.h"
+#include "compression/huffman/decode_table.h"
+#include "compression/huffman/codes.h"
+#include "compression/huffman/canonical.h"
+
+/*******************************************************************************
+ * Get the height of a Huffman tree.
+ *
+ * inputs:
+ * - node: The root of the tree
+ * outputs:
+ * - The number of steps to the deepest leaf
+ ******************************************************************************/
+int huffman_tree_height(HuffmanNode_t *node) {
+
+    if (node == NULL || (node->left == NULL && node->right == NULL)) {
+        return 0;
+    }
+
+    int left = huffman_tree_height(node->left);
+    int right = huffman_tree_height(node->right);
+    return 1 + (left > right ? left : right);
+}
+
+/*******************************************************************************
+ * Adds a table for a node of the tree.
+ * Tables are only as wide as the subtree below the node needs.
+ *
+ * inputs:
+ * - table: The decode tables
+ * - node: The node reached before this table. An internal node.
+ * - max_bits: The most bits this table may look up
+ * - bits: Set to the number of bits looked up by the new table
+ * outputs:
+ * - The index of the new table or -1 on failure
+ ******************************************************************************/
+long add_huffman_decode_table(HuffmanDecodeTable_t *table,
+    HuffmanNode_t *node, int max_bits, int *bits) {
+
+    int height = huffman_tree_height(node);
+    int width = height < max_bits ? height : max_bits;
+    size_t count = (size_t)1 << width;
+
+    /* Reserve the entries of this table */
+    if (table->size + count > table->capacity) {
+        size_t capacity = table->capacity > 0 ? table->capacity : 1024;
+        while (capacity < table->size + count) {
+            capacity *= 2;
+        }
+        HuffmanDecodeEntry_t *entries = (HuffmanDecodeEntry_t *)realloc(
+            table->entries, capacity * sizeof(HuffmanDecodeEntry_t));
+        if (entries == NULL) {
+            printf("[ERROR] Failed to allocate memory\n");
+            return -1;
+        }
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+    size_t base = table->size;
+    table->size += count;
+
+    /* Follow the bits of each index down the tree */
+    size_t index;
+    for (index = 0; index < count; index++) {
+        HuffmanNode_t *current_node = node;
+        int length = 0;
+        while (length < width &&
+            (current_node->left != NULL || current_node->right != NULL)) {
+            int bit = (int)(index >> (width - 1 - length)) & 1;
+            current_node = bit == 0 ? current_node->left : current_node->right;
+            length += 1;
+        }
+
+        HuffmanDecodeEntry_t entry;
+        entry.length = (unsigned char)length;
+
+        /* A leaf was reached */
+        if (current_node->left == NULL && current_node->right == NULL) {
+            entry.value = current_node->data;
+            entry.next_bits = 0;
+
+        /* The code is longer than the table. Continue in another table. */
+        } else {
+            int next_bits;
+            long next = add_huffman_decode_table(table, current_node,
+                HUFFMAN_DECODE_SUB_BITS, &next_bits);
+            if (next < 0) {
+                return -1;
+            }
+            entry.value = (uint32_t)next;
+            entry.next_bits = (unsigned char)next_bits;
+        }
+
+        /* Adding tables may have moved the entries */
+        table->entries[base + index] = entry;
+    }
+
+    *bits = width;
+    return (long)base;
+}
+
+/*******************************************************************************
+ * Create the decode tables of a Huffman tree.
+ * Each entry of a table is the result of following its index(as bits) down
+ * the tree: either a leaf or another table for the node that was reached.
+ *
+ * inputs:
+ * - table: The table to create
+ * - root: The root of the Huffman tree. Must have at least 2 leaves.
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int create_huffman_decode_table(HuffmanDecodeTable_t *table, HuffmanNode_t *root) {
+
+    table->entries = NULL;
+    table->size = 0;
+    table->capacity = 0;
+    table->bits = 0;
+
+    if (add_huffman_decode_table(table, root, HUFFMAN_DECODE_BITS,
+            &table->bits) < 0) {
+        free_huffman_decode_table(table);
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Create the decode tables of canonical Huffman code lengths.
+ * The tables are filled straight from the codes without building a tree.
+ * Codes are at most HUFFMAN_MAX_CODE_LENGTH bits, so only one table follows
+ * the first. The tables are kept in the table itself without allocating.
+ *
+ * inputs:
+ * - table: The table to create
+ * - lengths: The code length of each byte. At least 2 must be non-zero &
+ *            huffman_code_lengths_valid() must accept them.
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int create_huffman_decode_table_from_lengths(HuffmanDecodeTable_t *table,
+    const unsigned char lengths[256]) {
+
+    HuffmanCode_t codes[256];
+    int i;
+
+    table->entries = NULL;
+    table->size = 0;
+    table->capacity = 0;
+    table->bits = 0;
+    create_canonical_huffman_codes(lengths, codes);
+
+    /* The first table is only as wide as the longest code */
+    int longest = 0;
+    for (i = 0; i < 256; i++) {
+        if (lengths[i] > longest) {
+            longest = lengths[i];
+        }
+    }
+    int width = longest < HUFFMAN_DECODE_BITS ? longest : HUFFMAN_DECODE_BITS;
+    size_t first_size = (size_t)1 << width;
+
+    /* Bits needed after the first table by the codes starting with each
+     * index of the first table
+     */
+    unsigned char next_bits[1 << HUFFMAN_DECODE_BITS];
+    memset(next_bits, 0, first_size);
+    for (i = 0; i < 256; i++) {
+        if (codes[i].length > width) {
+            int extra = codes[i].length - width;
+            size_t prefix = (size_t)(codes[i].bits >> extra);
+            if (extra > next_bits[prefix]) {
+                next_bits[prefix] = (unsigned char)extra;
+            }
+        }
+    }
+
+    /* Place the second tables after the first */
+    size_t size = first_size;
+    size_t prefix;
+    for (prefix = 0; prefix < first_size; prefix++) {
+        if (next_bits[prefix] > 0) {
+            size += (size_t)1 << next_bits[prefix];
+        }
+    }
+    if (size > HUFFMAN_DECODE_MAX_ENTRIES) {
+        printf("[ERROR] Code lengths need too many decode table entries\n");
+        return 1;
+    }
+    table->entries = table->fixed_entries;
+    table->size = size;
+    table->capacity = size;
+    table->bits = width;
+
+    /* Link the first table to the second tables */
+    size_t base = first_size;
+    for (prefix = 0; prefix < first_size; prefix++) {
+        if (next_bits[prefix] > 0) {
+            table->entries[prefix].value = (uint32_t)base;
+            table->entries[prefix].length = (unsigned char)width;
+            table->entries[prefix].next_bits = next_bits[prefix];
+            base += (size_t)1 << next_bits[prefix];
+        }
+    }
+
+    /* Each code fills every entry that starts with it */
+    for (i = 0; i < 256; i++) {
+        int length = codes[i].length;
+        HuffmanDecodeEntry_t entry;
+        size_t start, count, j;
+
+        if (length == 0) {
+            continue;
+        }
+        entry.value = (uint32_t)i;
+        entry.next_bits = 0;
+
+        if (length <= width) {
+            entry.length = (unsigned char)length;
+            start = (size_t)codes[i].bits << (width - length);
+            count = (size_t)1 << (width - length);
+        } else {
+            int extra = length - width;
+            size_t code_prefix = (size_t)(codes[i].bits >> extra);
+            int bits = table->entries[code_prefix].next_bits;
+            size_t rest = (size_t)(codes[i].bits & ((1u << extra) - 1));
+
+            entry.length = (unsigned char)extra;
+            start = table->entries[code_prefix].value +
+                (rest << (bits - extra));
+            count = (size_t)1 << (bits - extra);
+        }
+
+        for (j = 0; j < count; j++) {
+            table->entries[start + j] = entry;
+        }
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Free the decode tables.
+ *
+ * inputs:
+ * - table: The table to free
+ * outputs:
+ * - none
+ ******************************************************************************/
+void free_huffman_decode_table(HuffmanDecodeTable_t *table) {
+
+    if (table->entries != table->fixed_entries) {
+        free(table->entries);
+    }
+    table->entries = NULL;
+    table->size = 0;
+    table->capacity = 0;
+}
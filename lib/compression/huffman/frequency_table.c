@@ -1,4 +1,67 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "compression/huffman/frequency_table.h"
+
+/* Bytes of the input file counted at a time */
+#define FREQUENCY_READ_BLOCK_SIZE (64 * 1024)
+
+/* Inputs smaller than this are counted into a single table, since clearing
+ * & merging the sub-tables would cost more than it saves
+ */
+#define FREQUENCY_SUB_TABLES_MIN_SIZE 1024
+
+/*******************************************************************************
+ * Adds the occurrences of each byte in memory to a frequency table.
+ * Counting into one table stalls on runs of the same byte, since each
+ * increment must wait for the last one to be stored. Eight sub-tables are
+ * used instead, one for each byte of a 64-bit word, then added together.
+ *
+ * inputs:
+ * - input: The data to count
+ * - input_size: The number of bytes in the data
+ * - frequency_table: The counts to add to
+ * outputs:
+ * - none
+ ******************************************************************************/
+void add_frequencies(const unsigned char *input, size_t input_size,
+    unsigned int frequency_table[256]) {
+
+    size_t i = 0;
+    int j;
+
+    if (input_size >= FREQUENCY_SUB_TABLES_MIN_SIZE) {
+        unsigned int counts[8][256];
+        memset(counts, 0, sizeof(counts));
+
+        /* 8 bytes at a time, each into its own sub-table */
+        for (; i + 8 <= input_size; i += 8) {
+            uint64_t word;
+            memcpy(&word, input + i, 8);
+            counts[0][word & 0xFF] += 1;
+            counts[1][(word >> 8) & 0xFF] += 1;
+            counts[2][(word >> 16) & 0xFF] += 1;
+            counts[3][(word >> 24) & 0xFF] += 1;
+            counts[4][(word >> 32) & 0xFF] += 1;
+            counts[5][(word >> 40) & 0xFF] += 1;
+            counts[6][(word >> 48) & 0xFF] += 1;
+            counts[7][word >> 56] += 1;
+        }
+
+        for (j = 0; j < 256; j++) {
+            frequency_table[j] += counts[0][j] + counts[1][j] + counts[2][j] +
+                counts[3][j] + counts[4][j] + counts[5][j] + counts[6][j] +
+                counts[7][j];
+        }
+    }
+
+    /* The last few bytes(or a small input) */
+    for (; i < input_size; i++) {
+        frequency_table[input[i]] += 1;
+    }
+}
 
 /*******************************************************************************
  * Create frequency table.
@@ -12,6 +75,9 @@
  ******************************************************************************/
 void create_frequency_table(const char *input, unsigned int frequency_table[256]) {
 
+    /* Initialize each byte to occur 0 times initially */
+    memset(frequency_table, 0, 256 * sizeof(unsigned int));
+
     /* Open the input file */
     FILE *input_file_pointer = fopen(input, "rb");
     if (!input_file_pointer) {
@@ -19,20 +85,40 @@ void create_frequency_table(const char *input, unsigned int frequency_table[256]
         return;
     }
 
-    /* Initialize each byte to occur 0 times initially */
-    int i;
-    for (i = 0; i < 256; i++) {
-        frequency_table[i] = 0;
+    unsigned char *block = (unsigned char *)malloc(FREQUENCY_READ_BLOCK_SIZE);
+    if (block == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        fclose(input_file_pointer);
+        return;
     }
 
-    /* Read the input file - 1 byte at a time */
-    unsigned char byte;
-    while (fread(&byte, sizeof(unsigned char), 1, input_file_pointer) == 1) {
-
-        /* Increment the occurence count of this byte */
-        frequency_table[byte] += 1;
+    /* Read the input file a block at a time */
+    size_t length;
+    while ((length = fread(block, 1, FREQUENCY_READ_BLOCK_SIZE,
+            input_file_pointer)) > 0) {
+        add_frequencies(block, length, frequency_table);
     }
 
     /* Close the input file */
+    free(block);
     fclose(input_file_pointer);
 }
+
+/*******************************************************************************
+ * Create frequency table from data in memory.
+ *
+ * inputs:
+ * - input: The data to create the frequency table from
+ * - input_size: The number of bytes in the data
+ * - frequency_table: Tracks the number of occurences of each byte
+ * outputs:
+ * - none
+ ******************************************************************************/
+void create_frequency_table_buffer(const unsigned char *input, size_t input_size,
+    unsigned int frequency_table[256]) {
+
+    /* Initialize each byte to occur 0 times initially */
+    memset(frequency_table, 0, 256 * sizeof(unsigned int));
+
+    add_frequencies(input, input_size, frequency_table);
+}
@@ -0,0 +1,567 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HUFFMAN_PTHREADS
+#include <pthread.h>
+#endif
+
+#include "compression/compression.h"
+
+/* Number of threads block compression may use. 0 until huffman_get_threads(). */
+int huffman_num_threads = 0;
+
+/* Where the parts of block compressed data are */
+struct HuffmanBlocks {
+
+    /* Uncompressed bytes in each block(the last may have fewer) */
+    size_t block_size;
+
+    /* Uncompressed bytes in all the blocks */
+    size_t size;
+
+    /* Number of blocks */
+    size_t num_blocks;
+
+    /* End offset of each block, 8 bytes each */
+    const unsigned char *index;
+
+    /* The compressed blocks, one after the other */
+    const unsigned char *data;
+    size_t data_size;
+};
+
+typedef struct HuffmanBlocks HuffmanBlocks_t;
+
+/* Blocks shared between threads. Each thread takes the next block left. */
+struct HuffmanBlockJob {
+
+    /* Processes one block. Returns 0 on success, 1 on failure. */
+    int (*process)(struct HuffmanBlockJob *job, size_t block);
+
+    /* Compression: the input & where to write the compressed blocks.
+     * Each block gets block_bound bytes of room. Its size is stored in its
+     * slot of the index until the blocks are joined.
+     */
+    const unsigned char *input;
+    size_t input_size;
+    unsigned char *compressed;
+    size_t block_bound;
+
+    /* Decompression: the blocks & where to write them */
+    const HuffmanBlocks_t *blocks;
+    unsigned char *output;
+
+    size_t block_size;
+    size_t num_blocks;
+
+    /* Next block to take & whether any block failed */
+    size_t next_block;
+    int failed;
+
+#ifdef HUFFMAN_PTHREADS
+    pthread_mutex_t lock;
+#endif
+};
+
+typedef struct HuffmanBlockJob HuffmanBlockJob_t;
+
+/*******************************************************************************
+ * Stores a number as little endian bytes.
+ *
+ * inputs:
+ * - output: Where to store the number
+ * - value: The number
+ * - num_bytes: The number of bytes to use
+ * outputs:
+ * - none
+ ******************************************************************************/
+void huffman_store_le(unsigned char *output, unsigned long long value,
+    int num_bytes) {
+
+    int i;
+    for (i = 0; i < num_bytes; i++) {
+        output[i] = (unsigned char)(value >> (8 * i));
+    }
+}
+
+/*******************************************************************************
+ * Loads a number stored as little endian bytes.
+ *
+ * inputs:
+ * - input: The bytes
+ * - num_bytes: The number of bytes used
+ * outputs:
+ * - The number
+ ******************************************************************************/
+unsigned long long huffman_load_le(const unsigned char *input, int num_bytes) {
+
+    unsigned long long value = 0;
+    int i;
+    for (i = num_bytes - 1; i >= 0; i--) {
+        value = (value << 8) | input[i];
+    }
+    return value;
+}
+
+/*******************************************************************************
+ * Gets the number of threads block compression may use.
+ * On first use this is read from the HUFFMAN_THREADS environment variable.
+ * Defaults to 1.
+ *
+ * inputs:
+ * - none
+ * outputs:
+ * - The number of threads
+ ******************************************************************************/
+int huffman_get_threads(void) {
+
+    /* Choose the thread count the first time */
+    if (huffman_num_threads == 0) {
+        const char *requested = getenv("HUFFMAN_THREADS");
+
+        huffman_num_threads = 1;
+        if (requested != NULL && huffman_set_threads(atoi(requested)) != 0) {
+            printf("[WARNING] Invalid HUFFMAN_THREADS, using 1 thread\n");
+        }
+    }
+
+    return huffman_num_threads;
+}
+
+/*******************************************************************************
+ * Sets the number of threads block compression may use.
+ *
+ * inputs:
+ * - num_threads: Between 1 & HUFFMAN_MAX_THREADS
+ * outputs:
+ * - 0 if the thread count is now in use, 1 if it is not supported
+ ******************************************************************************/
+int huffman_set_threads(int num_threads) {
+
+    /* Only a single thread without pthreads */
+#ifndef HUFFMAN_PTHREADS
+    if (num_threads != 1) {
+        return 1;
+    }
+#endif
+
+    if (num_threads < 1 || num_threads > HUFFMAN_MAX_THREADS) {
+        return 1;
+    }
+
+    huffman_num_threads = num_threads;
+    return 0;
+}
+
+/*******************************************************************************
+ * Processes blocks until none are left.
+ *
+ * inputs:
+ * - arg: The HuffmanBlockJob_t shared by the threads
+ * outputs:
+ * - NULL
+ ******************************************************************************/
+void *huffman_block_worker_run(void *arg) {
+
+    HuffmanBlockJob_t *job = (HuffmanBlockJob_t *)arg;
+
+    while (1) {
+
+        /* Take the next block */
+#ifdef HUFFMAN_PTHREADS
+        pthread_mutex_lock(&job->lock);
+#endif
+        size_t block = job->next_block;
+        int stop = block == job->num_blocks || job->failed;
+        if (!stop) {
+            job->next_block += 1;
+        }
+#ifdef HUFFMAN_PTHREADS
+        pthread_mutex_unlock(&job->lock);
+#endif
+        if (stop) {
+            break;
+        }
+
+        if (job->process(job, block) != 0) {
+#ifdef HUFFMAN_PTHREADS
+            pthread_mutex_lock(&job->lock);
+#endif
+            job->failed = 1;
+#ifdef HUFFMAN_PTHREADS
+            pthread_mutex_unlock(&job->lock);
+#endif
+        }
+    }
+
+    return NULL;
+}
+
+/*******************************************************************************
+ * Processes every block of a job, using up to huffman_get_threads() threads.
+ * The calling thread works on blocks too. If a thread cannot be started,
+ * the others take its share.
+ *
+ * inputs:
+ * - job: The job
+ * outputs:
+ * - 0 if every block was processed, 1 if any failed
+ ******************************************************************************/
+int huffman_run_block_job(HuffmanBlockJob_t *job) {
+
+    job->next_block = 0;
+    job->failed = 0;
+
+#ifdef HUFFMAN_PTHREADS
+    pthread_t threads[HUFFMAN_MAX_THREADS];
+    int started[HUFFMAN_MAX_THREADS];
+    int num_threads = huffman_get_threads();
+    int i;
+
+    /* No more threads than blocks */
+    if ((size_t)num_threads > job->num_blocks) {
+        num_threads = (int)job->num_blocks;
+    }
+
+    pthread_mutex_init(&job->lock, NULL);
+    for (i = 1; i < num_threads; i++) {
+        started[i] = pthread_create(&threads[i], NULL,
+            huffman_block_worker_run, job) == 0;
+    }
+    huffman_block_worker_run(job);
+    for (i = 1; i < num_threads; i++) {
+        if (started[i]) {
+            pthread_join(threads[i], NULL);
+        }
+    }
+    pthread_mutex_destroy(&job->lock);
+#else
+    huffman_block_worker_run(job);
+#endif
+
+    return job->failed;
+}
+
+/*******************************************************************************
+ * Compresses one block.
+ *
+ * inputs:
+ * - job: The job
+ * - block: The index of the block
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_compress_block(HuffmanBlockJob_t *job, size_t block) {
+
+    size_t start = block * job->block_size;
+    size_t length = job->input_size - start < job->block_size ?
+        job->input_size - start : job->block_size;
+    unsigned char *index = job->compressed + HUFFMAN_BLOCKS_HEADER_SIZE;
+    unsigned char *data = index + 8 * job->num_blocks;
+    size_t size;
+
+    if (huffman_compress_buffer(job->input + start, length,
+            data + block * job->block_bound, job->block_bound, &size) != 0) {
+        return 1;
+    }
+    huffman_store_le(index + 8 * block, size, 8);
+    return 0;
+}
+
+/*******************************************************************************
+ * Compresses data in memory as independent blocks.
+ * Each block has its own codes, so blocks can be compressed & decompressed
+ * at the same time, or decompressed on their own.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - block_size: The number of bytes in each block. 0 for
+ *               HUFFMAN_DEFAULT_BLOCK_SIZE.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - The compressed data(must be freed) or NULL on failure
+ ******************************************************************************/
+unsigned char *huffman_compress_blocks(const unsigned char *input,
+    size_t input_size, size_t block_size, size_t *output_size) {
+
+    if (block_size == 0) {
+        block_size = HUFFMAN_DEFAULT_BLOCK_SIZE;
+    }
+
+    /* The block size & count are stored in 4 bytes */
+    size_t num_blocks = input_size / block_size + (input_size % block_size != 0);
+    if (block_size > 0xFFFFFFFFUL || num_blocks > 0xFFFFFFFFUL) {
+        printf("[ERROR] Too many or too large blocks\n");
+        return NULL;
+    }
+
+    /* Room for every block to be as large as it can be */
+    size_t block_bound = huffman_compress_bound(block_size);
+    size_t front_size = HUFFMAN_BLOCKS_HEADER_SIZE + 8 * num_blocks;
+    if (num_blocks > 0 &&
+        block_bound > ((size_t)-1 - front_size) / num_blocks) {
+        printf("[ERROR] Too many or too large blocks\n");
+        return NULL;
+    }
+    unsigned char *output = (unsigned char *)malloc(
+        front_size + num_blocks * block_bound);
+    if (output == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return NULL;
+    }
+
+    HuffmanBlockJob_t job;
+    memset(&job, 0, sizeof(job));
+    job.process = huffman_compress_block;
+    job.input = input;
+    job.input_size = input_size;
+    job.compressed = output;
+    job.block_bound = block_bound;
+    job.block_size = block_size;
+    job.num_blocks = num_blocks;
+    if (huffman_run_block_job(&job) != 0) {
+        free(output);
+        return NULL;
+    }
+
+    memcpy(output, HUFFMAN_BLOCKS_MAGIC, 4);
+    output[4] = HUFFMAN_BLOCKS_VERSION;
+    huffman_store_le(output + 5, block_size, 4);
+    huffman_store_le(output + 9, input_size, 8);
+    huffman_store_le(output + 17, num_blocks, 4);
+
+    /* Move the blocks together & turn their sizes into end offsets.
+     * Blocks only ever move back, so they can be moved in place.
+     */
+    unsigned char *index = output + HUFFMAN_BLOCKS_HEADER_SIZE;
+    unsigned char *data = index + 8 * num_blocks;
+    size_t offset = 0;
+    size_t i;
+    for (i = 0; i < num_blocks; i++) {
+        size_t size = (size_t)huffman_load_le(index + 8 * i, 8);
+        memmove(data + offset, data + i * block_bound, size);
+        offset += size;
+        huffman_store_le(index + 8 * i, offset, 8);
+    }
+
+    /* Give back the room that was not used */
+    unsigned char *smaller = (unsigned char *)realloc(output,
+        front_size + offset > 0 ? front_size + offset : 1);
+    if (smaller != NULL) {
+        output = smaller;
+    }
+
+    *output_size = front_size + offset;
+    return output;
+}
+
+/*******************************************************************************
+ * Reads the header & block index of block compressed data.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - blocks: Set to where the parts of the data are
+ * outputs:
+ * - 0 on success, 1 if the header or index is invalid
+ ******************************************************************************/
+int read_huffman_blocks(const unsigned char *input, size_t input_size,
+    HuffmanBlocks_t *blocks) {
+
+    if (input_size < HUFFMAN_BLOCKS_HEADER_SIZE ||
+        memcmp(input, HUFFMAN_BLOCKS_MAGIC, 4) != 0) {
+        printf("[ERROR] Compressed blocks have an invalid header\n");
+        return 1;
+    }
+    if (input[4] != HUFFMAN_BLOCKS_VERSION) {
+        printf("[ERROR] Unsupported compressed blocks version %d\n", input[4]);
+        return 1;
+    }
+
+    unsigned long long size = huffman_load_le(input + 9, 8);
+    blocks->block_size = (size_t)huffman_load_le(input + 5, 4);
+    blocks->num_blocks = (size_t)huffman_load_le(input + 17, 4);
+    blocks->size = (size_t)size;
+
+    /* The block count must match the sizes & the index must fit */
+    if (blocks->block_size == 0 || (unsigned long long)blocks->size != size ||
+        blocks->num_blocks != blocks->size / blocks->block_size +
+            (blocks->size % blocks->block_size != 0) ||
+        blocks->num_blocks > (input_size - HUFFMAN_BLOCKS_HEADER_SIZE) / 8) {
+        printf("[ERROR] Compressed blocks have an invalid header\n");
+        return 1;
+    }
+
+    blocks->index = input + HUFFMAN_BLOCKS_HEADER_SIZE;
+    blocks->data = blocks->index + 8 * blocks->num_blocks;
+    blocks->data_size = input_size - HUFFMAN_BLOCKS_HEADER_SIZE -
+        8 * blocks->num_blocks;
+
+    /* Blocks follow one another & end within the data */
+    unsigned long long previous = 0;
+    size_t i;
+    for (i = 0; i < blocks->num_blocks; i++) {
+        unsigned long long end = huffman_load_le(blocks->index + 8 * i, 8);
+        if (end < previous || end > blocks->data_size) {
+            printf("[ERROR] Compressed blocks have an invalid index\n");
+            return 1;
+        }
+        previous = end;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Decompresses one block straight into its place in a buffer.
+ *
+ * inputs:
+ * - blocks: Where the parts of the data are
+ * - block: The index of the block
+ * - output: Where to write the block
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_decompress_block_into(const HuffmanBlocks_t *blocks, size_t block,
+    unsigned char *output) {
+
+    size_t start = block == 0 ? 0 :
+        (size_t)huffman_load_le(blocks->index + 8 * (block - 1), 8);
+    size_t end = (size_t)huffman_load_le(blocks->index + 8 * block, 8);
+    size_t offset = block * blocks->block_size;
+    size_t length = blocks->size - offset < blocks->block_size ?
+        blocks->size - offset : blocks->block_size;
+
+    size_t size;
+    if (huffman_decompress_buffer(blocks->data + start, end - start,
+            output, length, &size) != 0) {
+        return 1;
+    }
+    if (size != length) {
+        printf("[ERROR] Compressed block has the wrong size\n");
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Decompresses one block of a job.
+ *
+ * inputs:
+ * - job: The job
+ * - block: The index of the block
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_decompress_block(HuffmanBlockJob_t *job, size_t block) {
+
+    return huffman_decompress_block_into(job->blocks, block,
+        job->output + block * job->block_size);
+}
+
+/*******************************************************************************
+ * Decompresses data written by huffman_compress_blocks().
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - The decompressed data(must be freed) or NULL on failure
+ ******************************************************************************/
+unsigned char *huffman_decompress_blocks(const unsigned char *input,
+    size_t input_size, size_t *output_size) {
+
+    HuffmanBlocks_t blocks;
+    if (read_huffman_blocks(input, input_size, &blocks) != 0) {
+        return NULL;
+    }
+
+    unsigned char *output = (unsigned char *)malloc(
+        blocks.size > 0 ? blocks.size : 1);
+    if (output == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return NULL;
+    }
+
+    /* Each block is written straight to its place in the output */
+    HuffmanBlockJob_t job;
+    memset(&job, 0, sizeof(job));
+    job.process = huffman_decompress_block;
+    job.blocks = &blocks;
+    job.output = output;
+    job.block_size = blocks.block_size;
+    job.num_blocks = blocks.num_blocks;
+    if (huffman_run_block_job(&job) != 0) {
+        free(output);
+        return NULL;
+    }
+
+    *output_size = blocks.size;
+    return output;
+}
+
+/*******************************************************************************
+ * Decompresses part of the data written by huffman_compress_blocks().
+ * Only the blocks holding the requested bytes are decoded.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - offset: The first uncompressed byte wanted
+ * - length: The number of uncompressed bytes wanted
+ * - output: Where to write them. Room for 'length' bytes.
+ * outputs:
+ * - 0 on success, 1 on failure(including a range past the end)
+ ******************************************************************************/
+int huffman_read_blocks(const unsigned char *input, size_t input_size,
+    size_t offset, size_t length, unsigned char *output) {
+
+    HuffmanBlocks_t blocks;
+    if (read_huffman_blocks(input, input_size, &blocks) != 0) {
+        return 1;
+    }
+    if (offset > blocks.size || length > blocks.size - offset) {
+        printf("[ERROR] Range is past the end of the data\n");
+        return 1;
+    }
+
+    /* Blocks only partly wanted are decoded here first */
+    unsigned char *block_data = NULL;
+    int failed = 0;
+
+    while (length > 0 && !failed) {
+        size_t block = offset / blocks.block_size;
+        size_t skip = offset - block * blocks.block_size;
+        size_t block_length = blocks.size - block * blocks.block_size <
+            blocks.block_size ? blocks.size - block * blocks.block_size :
+            blocks.block_size;
+        size_t wanted = block_length - skip < length ?
+            block_length - skip : length;
+
+        /* Whole blocks are decoded straight into the output */
+        if (skip == 0 && wanted == block_length) {
+            failed = huffman_decompress_block_into(&blocks, block, output);
+
+        } else {
+            if (block_data == NULL) {
+                block_data = (unsigned char *)malloc(blocks.block_size);
+                if (block_data == NULL) {
+                    printf("[ERROR] Failed to allocate memory\n");
+                    return 1;
+                }
+            }
+            failed = huffman_decompress_block_into(&blocks, block, block_data);
+            memcpy(output, block_data + skip, wanted);
+        }
+
+        output += wanted;
+        offset += wanted;
+        length -= wanted;
+    }
+
+    free(block_data);
+    return failed;
+}
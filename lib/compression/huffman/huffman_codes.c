@@ -1,7 +1,7 @@
 #include <stdlib.h>
-#include <string.h>
 
 #include "compression/huffman/tree.h"
+#include "compression/huffman/codes.h"
 
 /*******************************************************************************
  * Generate the Huffman codes.
@@ -9,13 +9,15 @@
  *
  * inputs:
  * - node: The node to generate the codes for
- * - code: The code to store the codes
+ * - bits: The path to the node
  * - depth: The depth of the node
  * - codes: The codes table to store the codes. 256 for each possible byte.
+ *          Must be zeroed before the first call.
  * outputs:
  * - none
  ******************************************************************************/
-void generate_huffman_codes(HuffmanNode_t *node, char *code, int depth, char *codes[256]) {
+void generate_huffman_codes(HuffmanNode_t *node, uint64_t bits, int depth,
+    HuffmanCode_t codes[256]) {
 
     /* Do nothing if the node is NULL */
     if (node == NULL) {
@@ -24,25 +26,20 @@ void generate_huffman_codes(HuffmanNode_t *node, char *code, int depth, char *co
 
     /* If the node is a leaf node */
     if (node->left == NULL && node->right == NULL) {
-        /* Null terminate the code */
-        code[depth] = '\0';
 
-        /* Copy the path to the byte in the codes table */
-        codes[node->data] = (char *) malloc((strlen(code) + 1) * sizeof(char)); 
-        strcpy(codes[node->data], code);
+        /* Store the path to the byte in the codes table */
+        codes[node->data].bits = bits;
+        codes[node->data].length = depth;
     
     /* If the node is an internal node */
     } else {
 
         /* Go left */
         /* 0 is added to the path to indicate the left direction */
-        code[depth] = '0';
-        generate_huffman_codes(node->left, code, depth + 1, codes);
+        generate_huffman_codes(node->left, bits << 1, depth + 1, codes);
 
         /* Go right */
         /* 1 is added to the path to indicate the right direction */
-        code[depth] = '1';
-        generate_huffman_codes(node->right, code, depth + 1, codes);
+        generate_huffman_codes(node->right, (bits << 1) | 1, depth + 1, codes);
     }
 }
-
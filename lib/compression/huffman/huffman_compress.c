@@ -1,102 +1,333 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "compression/compression.h"
 #include "compression/huffman/frequency_table.h"
 #include "compression/huffman/tree.h"
 #include "compression/huffman/codes.h"
-#include "utils/bitops.h"
+#include "compression/huffman/canonical.h"
+
+/* Bytes of the uncompressed data encoded at a time */
+#define HUFFMAN_INPUT_BLOCK_SIZE (64 * 1024)
+
+/* Bytes first set aside for a stream of unknown size */
+#define HUFFMAN_STREAM_INITIAL_SIZE (64 * 1024)
+
+/* Bits waiting to be written */
+struct HuffmanBitWriter {
+
+    /* The bits. The first bit is the most significant bit. */
+    uint64_t accumulator;
+
+    /* Number of bits in the accumulator */
+    int count;
+};
+
+typedef struct HuffmanBitWriter HuffmanBitWriter_t;
 
 /*******************************************************************************
- * Writes the compressed data to the file.
+ * Creates the canonical Huffman code of each byte.
  *
  * inputs:
- * - input_file: The file to read from
- * - output_file: The file to write compressed data to
- * - codes: The Huffman codes to use for compression
+ * - frequency_table: Tracks the number of occurences of each byte
+ * - lengths: Set to the code length of each byte
+ * - codes: The codes table to fill. 256 for each possible byte.
  * outputs:
- * - none
+ * - The number of bits needed to encode all the bytes counted. 0 when there
+ *   is at most 1 different byte, since those need no bits.
  ******************************************************************************/
-void write_compressed_data(FILE *input_file, FILE *output_file, char *codes[256]) {
+unsigned long long create_huffman_code_table(unsigned int frequency_table[256],
+    unsigned char lengths[256], HuffmanCode_t codes[256]) {
 
-    /* Buffer for writing bits */
-    /* Waits until 8 bits(1 byte) is collected before writing to file */
-    unsigned char buffer = 0;
+    create_huffman_code_lengths(frequency_table, lengths);
+    create_canonical_huffman_codes(lengths, codes);
 
-    /* Keeps track of the number of bits in the buffer */
-    int bit_count = 0;
+    /* The code lengths give the exact size of the output */
+    unsigned long long total_bits = 0;
+    int num_codes = 0;
+    int i;
+    for (i = 0; i < 256; i++) {
+        total_bits += (unsigned long long)frequency_table[i] * codes[i].length;
+        num_codes += codes[i].length > 0;
+    }
 
-    /* Reserve 1 byte for the leftover bits count */
-    unsigned char leftover_bits_count = 0;
-    long leftover_bits_position = ftell(output_file);
-    fwrite(&leftover_bits_count, sizeof(unsigned char), 1, output_file);
+    return num_codes > 1 ? total_bits : 0;
+}
 
-    /* Reserve unsigned int for the compressed data size */
-    unsigned int compressed_data_size = 0;
-    fwrite(&compressed_data_size, sizeof(unsigned int), 1, output_file);
+/*******************************************************************************
+ * Creates the header written before the compressed data.
+ * Format: "HUF" | version | uncompressed size | code lengths
+ *
+ * inputs:
+ * - header: Where to write the header. HUFFMAN_MAX_HEADER_SIZE bytes.
+ * - input_size: The number of bytes of uncompressed data
+ * - lengths: The code length of each byte
+ * outputs:
+ * - The size of the header
+ ******************************************************************************/
+size_t write_huffman_header(unsigned char *header, size_t input_size,
+    const unsigned char lengths[256]) {
 
-    /* Loop until there are no more bytes to read */
-    unsigned char byte;
-    while (fread(&byte, sizeof(unsigned char), 1, input_file) == 1) {
+    size_t size = 0;
 
-        /* Update the compressed data size */
-        compressed_data_size += 1;
+    memcpy(header, HUFFMAN_MAGIC, 3);
+    header[3] = HUFFMAN_VERSION;
+    size += 4;
 
-        /* Get the Huffman code for the byte */
-        char *code = codes[byte];
+    /* 7 bits at a time, lowest first */
+    while (input_size >= 0x80) {
+        header[size++] = (unsigned char)((input_size & 0x7F) | 0x80);
+        input_size >>= 7;
+    }
+    header[size++] = (unsigned char)input_size;
 
-        /* Add the Huffman code to the buffer */
-        int i;
-        for (i = 0; i < strlen(code); i++) {
-            /* Get the bit for the current depth in the code */
-            unsigned char bit = code[i] == '1' ? 1 : 0;
+    size += write_huffman_code_lengths(lengths, header + size);
+    return size;
+}
 
-            /* Add bit to buffer */
-            buffer = append_bit(buffer, bit);
+/*******************************************************************************
+ * Encodes bytes with their Huffman codes.
+ * Whole codes are shifted into a 64-bit accumulator which is written 32 bits
+ * at a time, so the output is only touched once per 4 bytes.
+ *
+ * inputs:
+ * - codes: The Huffman codes. None may have a length of 0.
+ * - input: The bytes to encode
+ * - input_size: The number of bytes to encode
+ * - writer: Bits not yet written. Carried over between calls.
+ * - output: Where to write the encoded bytes. Must have room for
+ *           input_size * (longest code length) / 8 + 8 bytes.
+ * outputs:
+ * - The number of bytes written to output
+ ******************************************************************************/
+size_t huffman_encode(const HuffmanCode_t codes[256],
+    const unsigned char *input, size_t input_size,
+    HuffmanBitWriter_t *writer, unsigned char *output) {
 
-            /* Increment the bit count */
-            bit_count += 1;
+    uint64_t accumulator = writer->accumulator;
+    int count = writer->count;
+    unsigned char *position = output;
+    size_t i;
 
-            /* If buffer is full, write it to file */
-            if (bit_count == 8) {
-                /* Write the full byte to the file */
-                fwrite(&buffer, sizeof(unsigned char), 1, output_file);
-                
-                /* Reset the buffer */
-                /* Binary form of 0 is 00000000 */
-                buffer = 0;
+    for (i = 0; i < input_size; i++) {
+        const HuffmanCode_t *code = &codes[input[i]];
 
-                /* Reset the bit count */
-                bit_count = 0;
+        /* Codes longer than 32 bits(rare) may not fit next to 31 waiting
+         * bits. Writing whole bytes first leaves at most 7.
+         */
+        if (count + code->length > 64) {
+            while (count >= 8) {
+                *position++ = (unsigned char)(accumulator >> 56);
+                accumulator <<= 8;
+                count -= 8;
             }
         }
+
+        /* Place the code right after the bits already waiting */
+        accumulator |= code->bits << (64 - count - code->length);
+        count += code->length;
+
+        /* Write 32 bits at a time */
+        if (count >= 32) {
+            position[0] = (unsigned char)(accumulator >> 56);
+            position[1] = (unsigned char)(accumulator >> 48);
+            position[2] = (unsigned char)(accumulator >> 40);
+            position[3] = (unsigned char)(accumulator >> 32);
+            position += 4;
+            accumulator <<= 32;
+            count -= 32;
+        }
     }
 
-    /* Update the leftover bits count */
-    leftover_bits_count = bit_count;
+    writer->accumulator = accumulator;
+    writer->count = count;
+    return (size_t)(position - output);
+}
 
-    /* If there are bits left in the buffer */
-    if (bit_count > 0) {
-        /* Calculate the bits not used in the buffer */
-        int free_space = 8 - bit_count;
+/*******************************************************************************
+ * Writes the bits left in the accumulator.
+ * The last byte is padded with 0.
+ *
+ * inputs:
+ * - writer: Bits not yet written
+ * - output: Where to write the bytes. Must have room for 8 bytes.
+ * outputs:
+ * - The number of bytes written to output
+ ******************************************************************************/
+size_t huffman_encode_finish(HuffmanBitWriter_t *writer, unsigned char *output) {
 
-        /* Pad the buffer with 0 */
-        /* Achieved by shifting the buffer left by the number of bits not used */
-        buffer = shift_byte_left(buffer, free_space);
+    size_t length = 0;
 
-        /* Write the last buffer to the file */
-        fwrite(&buffer, sizeof(unsigned char), 1, output_file);
+    while (writer->count > 0) {
+        output[length++] = (unsigned char)(writer->accumulator >> 56);
+        writer->accumulator <<= 8;
+        writer->count -= 8;
     }
 
-    /* Write the number of leftover bits & compressed data size */
-    /* Needed so decompression knows how many bits to read */
-    fseek(output_file, leftover_bits_position, SEEK_SET);
-    fwrite(&leftover_bits_count, sizeof(unsigned char), 1, output_file);
-    fwrite(&compressed_data_size, sizeof(unsigned int), 1, output_file);
+    writer->accumulator = 0;
+    writer->count = 0;
+    return length;
+}
+
+/*******************************************************************************
+ * Writes the compressed data to a file.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output_file: The file to write compressed data to
+ * - codes: The Huffman codes to use for compression
+ * - total_bits: The number of bits of compressed data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int write_compressed_data(const unsigned char *input, size_t input_size,
+    FILE *output_file, const HuffmanCode_t codes[256],
+    unsigned long long total_bits) {
+
+    HuffmanBitWriter_t writer = { 0, 0 };
+    int failed = 0;
+
+    /* A single repeated byte(or nothing at all) needs no bits */
+    if (total_bits == 0) {
+        return 0;
+    }
+
+    /* Room for a block where every byte has the longest code */
+    int max_length = 0;
+    int i;
+    for (i = 0; i < 256; i++) {
+        if (codes[i].length > max_length) {
+            max_length = codes[i].length;
+        }
+    }
+    unsigned char *output = (unsigned char *)malloc(
+        (size_t)HUFFMAN_INPUT_BLOCK_SIZE * max_length / 8 + 8);
+    if (output == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    /* Encode the data a block at a time */
+    size_t position = 0;
+    size_t length;
+    while (!failed && position < input_size) {
+        length = input_size - position < HUFFMAN_INPUT_BLOCK_SIZE ?
+            input_size - position : HUFFMAN_INPUT_BLOCK_SIZE;
+        size_t encoded = huffman_encode(codes, input + position, length,
+            &writer, output);
+        failed = fwrite(output, 1, encoded, output_file) != encoded;
+        position += length;
+    }
+
+    /* Write the last bits */
+    length = huffman_encode_finish(&writer, output);
+    if (fwrite(output, 1, length, output_file) != length) {
+        failed = 1;
+    }
+
+    free(output);
+    return failed;
+}
+
+/*******************************************************************************
+ * Reads everything left in a stream into memory.
+ * The stream does not need to be seekable, so pipes can be read.
+ *
+ * inputs:
+ * - input_file: The stream to read
+ * - size: Set to the number of bytes read
+ * outputs:
+ * - The data(must be freed) or NULL on failure
+ ******************************************************************************/
+unsigned char *huffman_read_stream(FILE *input_file, size_t *size) {
+
+    size_t capacity = HUFFMAN_STREAM_INITIAL_SIZE;
+    size_t length = 0;
+    unsigned char *data = (unsigned char *)malloc(capacity);
+
+    while (data != NULL) {
+
+        /* Grow by doubling so each byte is only copied a few times */
+        if (length == capacity) {
+            unsigned char *larger = capacity * 2 > capacity ?
+                (unsigned char *)realloc(data, capacity * 2) : NULL;
+            if (larger == NULL) {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = larger;
+            capacity *= 2;
+        }
+
+        size_t read = fread(data + length, 1, capacity - length, input_file);
+        length += read;
+        if (read == 0) {
+            break;
+        }
+    }
+
+    if (data == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return NULL;
+    }
+    if (ferror(input_file)) {
+        printf("[ERROR] Failed to read input\n");
+        free(data);
+        return NULL;
+    }
+
+    *size = length;
+    return data;
+}
+
+/*******************************************************************************
+ * Compresses a stream using Huffman coding.
+ * The input is read once into memory, where both passes(counting &
+ * encoding) are made. Neither stream needs to be seekable.
+ *
+ * inputs:
+ * - input_file: The stream to compress
+ * - output_file: The stream to write compressed data to
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_compress_stream(FILE *input_file, FILE *output_file) {
+
+    /* Read the whole input */
+    size_t input_size;
+    unsigned char *input = huffman_read_stream(input_file, &input_size);
+    if (input == NULL) {
+        return 1;
+    }
+
+    /* Create frequency table */
+    unsigned int frequency_table[256];
+    create_frequency_table_buffer(input, input_size, frequency_table);
+
+    /* Create a table of codes for each byte */
+    unsigned char lengths[256];
+    HuffmanCode_t codes[256];
+    unsigned long long total_bits = create_huffman_code_table(
+        frequency_table, lengths, codes);
+
+    /* Write the header, then the compressed data */
+    unsigned char header[HUFFMAN_MAX_HEADER_SIZE];
+    size_t header_size = write_huffman_header(header, input_size, lengths);
+    int failed = fwrite(header, 1, header_size, output_file) != header_size ||
+        write_compressed_data(input, input_size, output_file, codes,
+            total_bits) != 0;
+
+    free(input);
+    return failed;
 }
 
 /*******************************************************************************
  * Compresses a file using Huffman coding.
+ * The file is only read once.
  *
  * inputs:
  * - uncompressed_file: The file to compress
@@ -105,42 +336,94 @@ void write_compressed_data(FILE *input_file, FILE *output_file, char *codes[256]
  * - none
  ******************************************************************************/
 void huffman_compress(const char *uncompressed_file, const char *compressed_file) {
-    
-    /* Create frequency table */
-    unsigned int frequency_table[256];
-    create_frequency_table(uncompressed_file, frequency_table);
-
-    /* Create Huffman tree */
-    HuffmanNode_t *huffman_tree = create_huffman_tree(frequency_table);
 
-    /* Create a table of codes for each byte */
-    char *codes[256] = { NULL };
-    char temp_code_buffer[256];
-    generate_huffman_codes(huffman_tree, temp_code_buffer, 0, codes);
+    /* Open the uncompressed file */
+    FILE *uncompressed_file_pointer = fopen(uncompressed_file, "rb");
+    if (!uncompressed_file_pointer) {
+        printf("Error opening input file: %s\n", uncompressed_file);
+        return;
+    }
 
     /* Open the compressed file */
     FILE *compressed_file_pointer = fopen(compressed_file, "wb");
     if (!compressed_file_pointer) {
         printf("Error opening output file: %s\n", compressed_file);
+        fclose(uncompressed_file_pointer);
         return;
     }
 
-    /* Write the frequency table to the compressed file */
-    fwrite(frequency_table, sizeof(unsigned int), 256, compressed_file_pointer);
-
-    /* Open the uncompressed file */
-    FILE *uncompressed_file_pointer = fopen(uncompressed_file, "rb");
-    if (!uncompressed_file_pointer) {
-        printf("Error opening input file: %s\n", uncompressed_file);
-        return;
+    if (huffman_compress_stream(uncompressed_file_pointer,
+            compressed_file_pointer) != 0) {
+        printf("Error writing output file: %s\n", compressed_file);
     }
 
-    /* Write the compressed data to the compressed file */
-    write_compressed_data(uncompressed_file_pointer, compressed_file_pointer, codes);
-
-    /* Close the file pointers & clean up memory */
+    /* Close the file pointers */
     fclose(compressed_file_pointer);
     fclose(uncompressed_file_pointer);
-    free_huffman_tree(huffman_tree);
 }
 
+/*******************************************************************************
+ * Gets the most bytes huffman_compress_buffer() can write for an input.
+ *
+ * inputs:
+ * - input_size: The number of bytes to compress
+ * outputs:
+ * - The size of output buffer that is always large enough
+ ******************************************************************************/
+size_t huffman_compress_bound(size_t input_size) {
+
+    /* Every byte with the longest code: input_size * 15 / 8, rounded up */
+    return HUFFMAN_MAX_HEADER_SIZE + input_size +
+        input_size / 8 * (HUFFMAN_MAX_CODE_LENGTH - 8) + HUFFMAN_MAX_CODE_LENGTH;
+}
+
+/*******************************************************************************
+ * Compresses data in memory using Huffman coding.
+ * The result has the same format as a file written by huffman_compress().
+ * Nothing is allocated.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output. huffman_compress_bound() is always
+ *                    enough.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 if the output is too small
+ ******************************************************************************/
+int huffman_compress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    /* Create frequency table */
+    unsigned int frequency_table[256];
+    create_frequency_table_buffer(input, input_size, frequency_table);
+
+    /* Create a table of codes for each byte */
+    unsigned char lengths[256];
+    HuffmanCode_t codes[256];
+    unsigned long long total_bits = create_huffman_code_table(
+        frequency_table, lengths, codes);
+
+    /* The output size is known exactly before encoding */
+    unsigned char header[HUFFMAN_MAX_HEADER_SIZE];
+    size_t header_size = write_huffman_header(header, input_size, lengths);
+    size_t size = header_size + (size_t)((total_bits + 7) / 8);
+    if (size > output_capacity) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 1;
+    }
+    memcpy(output, header, header_size);
+
+    /* Encode straight into the output */
+    /* A single repeated byte(or nothing at all) needs no bits */
+    if (total_bits > 0) {
+        HuffmanBitWriter_t writer = { 0, 0 };
+        unsigned char *position = output + header_size;
+        position += huffman_encode(codes, input, input_size, &writer, position);
+        huffman_encode_finish(&writer, position);
+    }
+
+    *output_size = size;
+    return 0;
+}
@@ -1,69 +1,442 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 
 #include "compression/compression.h"
 #include "compression/huffman/tree.h"
-#include "utils/bitops.h"
+#include "compression/huffman/decode_table.h"
+#include "compression/huffman/canonical.h"
 
+/* Bytes of a compressed file read at a time */
+#define HUFFMAN_READ_BLOCK_SIZE (64 * 1024)
+
+/* Bytes decompressed before they are written to the file */
+#define HUFFMAN_WRITE_BLOCK_SIZE (256 * 1024)
+
+/* Reads the compressed data several bits at a time */
+struct HuffmanBitReader {
+
+    /* Bits not used yet. The next bit is the most significant bit. */
+    uint64_t bits;
+
+    /* Number of bits in 'bits' */
+    int count;
+
+    /* The compressed data not loaded into 'bits' yet */
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+
+    /* If not NULL, 'data' is refilled from this file once used up */
+    FILE *file;
+    unsigned char *block;
+
+    /* Zero bits added after the end of the compressed data */
+    unsigned long long padding_bits;
+};
+
+typedef struct HuffmanBitReader HuffmanBitReader_t;
 
 /*******************************************************************************
- * Reads the compressed data from the file.
+ * Loads bytes of compressed data until at least 57 bits are available.
+ * Past the end of the data, zero bits are added so decoding never has to
+ * check for the end. decode_huffman_finish() checks none of them were used.
  *
  * inputs:
- * - input_file: The file to read compressed data from
- * - root: The root of the Huffman tree.
+ * - reader: The reader
  * outputs:
  * - none
  ******************************************************************************/
-void read_compressed_data(FILE *input_file, FILE *output_file, HuffmanNode_t *root) {
+void huffman_bit_reader_refill(HuffmanBitReader_t *reader) {
+
+    /* Load 8 bytes at once when they are available.
+     * Bits past the whole bytes taken are loaded again(unchanged) next time.
+     */
+    if (reader->size - reader->position >= 8) {
+        const unsigned char *p = reader->data + reader->position;
+        uint64_t word = ((uint64_t)p[0] << 56) | ((uint64_t)p[1] << 48) |
+            ((uint64_t)p[2] << 40) | ((uint64_t)p[3] << 32) |
+            ((uint64_t)p[4] << 24) | ((uint64_t)p[5] << 16) |
+            ((uint64_t)p[6] << 8) | (uint64_t)p[7];
+        int bytes = (63 - reader->count) >> 3;
+
+        reader->bits |= word >> reader->count;
+        reader->position += bytes;
+        reader->count += bytes * 8;
+        return;
+    }
 
-    /* Current node in the Huffman tree */
-    HuffmanNode_t *current_node = root;
-    
-    /* Read the leftover bits count from the end of file */
-    unsigned char leftover_bits;
-    fread(&leftover_bits, sizeof(unsigned char), 1, input_file);
+    while (reader->count <= 56) {
 
-    /* Read the compressed data size */
-    unsigned int compressed_data_size;
-    fread(&compressed_data_size, sizeof(unsigned int), 1, input_file);
+        /* Read the next block of the file */
+        if (reader->position == reader->size && reader->file != NULL) {
+            reader->size = fread(reader->block, 1, HUFFMAN_READ_BLOCK_SIZE,
+                reader->file);
+            reader->position = 0;
+            reader->data = reader->block;
+            if (reader->size == 0) {
+                reader->file = NULL;
+            }
+        }
 
-    /* Loop until there are no more bytes to read */
-    int i;
-    for (i = 0; i < compressed_data_size; i++) {
+        if (reader->position < reader->size) {
+            reader->bits |= (uint64_t)reader->data[reader->position++] <<
+                (56 - reader->count);
+        } else {
+            reader->padding_bits += 8;
+        }
+        reader->count += 8;
+    }
+}
 
-        /* Read the next byte */
-        unsigned char byte;
-        fread(&byte, sizeof(unsigned char), 1, input_file);
+/*******************************************************************************
+ * Decodes bytes using the decode tables.
+ * Each step looks up to HUFFMAN_DECODE_BITS bits at once. Only codes longer
+ * than that go on to a second table.
+ *
+ * inputs:
+ * - table: The decode tables
+ * - reader: The compressed data
+ * - output: Where to write the decoded bytes
+ * - count: The number of bytes to decode
+ * outputs:
+ * - none
+ ******************************************************************************/
+void decode_huffman(const HuffmanDecodeTable_t *table,
+    HuffmanBitReader_t *reader, unsigned char *output, size_t count) {
 
-        /* For the last byte, only process the leftover bits */
-        int bits_to_process = (i == compressed_data_size - 1) ? leftover_bits : 8;
+    const HuffmanDecodeEntry_t *entries = table->entries;
+    int shift = 64 - table->bits;
 
-        /* Process each bit in the byte */
-        int j;
-        for (j = 0; j < bits_to_process; j++) {
+    /* Kept in locals since writes to output could alias the reader */
+    uint64_t bits = reader->bits;
+    int available = reader->count;
+    size_t i;
 
-            /* Get the current bit (starting from most significant bit) */
-            unsigned char bit = get_bit_msb(byte, j);
+    for (i = 0; i < count; i++) {
 
-            /* If the bit is 0, go left otherwise go right */
-            current_node = (bit == 0) ? current_node->left : current_node->right;
+        /* Make sure a whole code(or first table lookup) is available */
+        if (available < 32) {
+            reader->bits = bits;
+            reader->count = available;
+            huffman_bit_reader_refill(reader);
+            bits = reader->bits;
+            available = reader->count;
+        }
 
-            /* If the current node is a leaf node */
-            if (current_node->left == NULL && current_node->right == NULL) {
-                /* Write the byte to the output file */
-                fwrite(&current_node->data, sizeof(unsigned char), 1, output_file);
+        const HuffmanDecodeEntry_t *entry = &entries[bits >> shift];
 
-                /* Reset the current node to the root */
-                current_node = root;
+        /* Codes longer than the first table */
+        while (entry->next_bits != 0) {
+            bits <<= entry->length;
+            available -= entry->length;
+            if (available < HUFFMAN_DECODE_SUB_BITS) {
+                reader->bits = bits;
+                reader->count = available;
+                huffman_bit_reader_refill(reader);
+                bits = reader->bits;
+                available = reader->count;
             }
+            entry = &entries[entry->value +
+                (bits >> (64 - entry->next_bits))];
+        }
+
+        bits <<= entry->length;
+        available -= entry->length;
+        output[i] = (unsigned char)entry->value;
+    }
+
+    reader->bits = bits;
+    reader->count = available;
+}
+
+/*******************************************************************************
+ * Checks the compressed data was not too short.
+ *
+ * inputs:
+ * - reader: The reader used for decoding
+ * outputs:
+ * - 0 if only real bits were decoded, 1 if the data was truncated
+ ******************************************************************************/
+int decode_huffman_finish(const HuffmanBitReader_t *reader) {
+
+    /* Padding bits are the last bits loaded, so any beyond 'count' were used */
+    if (reader->padding_bits > (unsigned long long)reader->count) {
+        printf("[ERROR] Compressed data is truncated\n");
+        return 1;
+    }
+    return 0;
+}
+
+/* What the header of compressed data says */
+struct HuffmanHeader {
+
+    /* Version of the format */
+    int version;
+
+    /* Number of bytes of uncompressed data */
+    size_t size;
+
+    /* Number of bytes before the compressed data */
+    size_t header_size;
+
+    /* Version 1: number of occurences of each byte */
+    unsigned int frequency_table[256];
+
+    /* Version 2: code length of each byte */
+    unsigned char lengths[256];
+};
+
+typedef struct HuffmanHeader HuffmanHeader_t;
+
+/*******************************************************************************
+ * Checks whether data starts with a version 1 header.
+ * Version 1 had no magic, but its size field always equals the sum of its
+ * frequency table.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes available
+ * outputs:
+ * - 1 if the header is a version 1 header, otherwise 0
+ ******************************************************************************/
+int huffman_is_v1_header(const unsigned char *input, size_t input_size) {
+
+    unsigned int frequency_table[256];
+    unsigned int sum = 0;
+    unsigned int size;
+    int i;
+
+    if (input_size < HUFFMAN_V1_HEADER_SIZE) {
+        return 0;
+    }
+
+    memcpy(frequency_table, input, 256 * sizeof(unsigned int));
+    for (i = 0; i < 256; i++) {
+        sum += frequency_table[i];
+    }
+    memcpy(&size, input + 256 * sizeof(unsigned int) + 1, sizeof(unsigned int));
+
+    /* The leftover bits count is less than a byte */
+    return sum == size && input[256 * sizeof(unsigned int)] < 8;
+}
+
+/*******************************************************************************
+ * Reads the header written before the compressed data.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes available
+ * - header: Set to what the header says
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int read_huffman_header(const unsigned char *input, size_t input_size,
+    HuffmanHeader_t *header) {
+
+    size_t position = 4;
+    int shift = 0;
+    int i;
+
+    /* A version 1 frequency table could(rarely) start with the magic, so its
+     * own check decides
+     */
+    if (input_size < 4 || memcmp(input, HUFFMAN_MAGIC, 3) != 0 ||
+        huffman_is_v1_header(input, input_size)) {
+
+        if (!huffman_is_v1_header(input, input_size)) {
+            printf("[ERROR] Compressed data has an invalid header\n");
+            return 1;
+        }
+
+        /* Every byte of the original data was counted once */
+        header->version = 1;
+        header->header_size = HUFFMAN_V1_HEADER_SIZE;
+        memcpy(header->frequency_table, input, 256 * sizeof(unsigned int));
+        header->size = 0;
+        for (i = 0; i < 256; i++) {
+            header->size += header->frequency_table[i];
+        }
+        return 0;
+    }
+
+    header->version = input[3];
+    if (header->version != HUFFMAN_VERSION) {
+        printf("[ERROR] Unsupported compressed data version %d\n",
+            header->version);
+        return 1;
+    }
+
+    /* Uncompressed size: 7 bits at a time, lowest first */
+    header->size = 0;
+    do {
+        if (position == input_size || shift > 63) {
+            printf("[ERROR] Compressed data has an invalid header\n");
+            return 1;
+        }
+        header->size |= (size_t)(input[position] & 0x7F) << shift;
+        shift += 7;
+    } while (input[position++] & 0x80);
 
+    /* Code lengths */
+    size_t lengths_size = read_huffman_code_lengths(
+        input + position, input_size - position, header->lengths);
+    if (lengths_size == 0 || !huffman_code_lengths_valid(header->lengths)) {
+        printf("[ERROR] Compressed data has an invalid header\n");
+        return 1;
+    }
+
+    header->header_size = position + lengths_size;
+    return 0;
+}
+
+/*******************************************************************************
+ * Prepares to decode the data described by a header.
+ *
+ * inputs:
+ * - header: The header
+ * - table: Set to the decode tables if they are needed
+ * - single_byte: Set to the only byte of the data if there is no need for
+ *                tables, or -1 if the data is empty
+ * outputs:
+ * - 1 if the tables were created(and must be freed), 0 if they are not
+ *   needed, -1 on failure
+ ******************************************************************************/
+int create_huffman_decoder(const HuffmanHeader_t *header,
+    HuffmanDecodeTable_t *table, int *single_byte) {
+
+    int num_codes = 0;
+    int i;
+
+    *single_byte = -1;
+
+    /* Version 1 rebuilds the tree from the frequencies */
+    if (header->version == 1) {
+        HuffmanTree_t tree;
+        HuffmanNode_t *root = create_huffman_tree(&tree,
+            header->frequency_table);
+        int result = 0;
+
+        if (root != NULL && root->left == NULL && root->right == NULL) {
+            *single_byte = root->data;
+        } else if (root != NULL) {
+            result = create_huffman_decode_table(table, root) == 0 ? 1 : -1;
+        }
+        return result;
+    }
+
+    /* Version 2 builds the tables straight from the code lengths */
+    for (i = 0; i < 256; i++) {
+        if (header->lengths[i] > 0) {
+            num_codes++;
+            *single_byte = i;
         }
     }
+
+    /* No codes means no data */
+    if (num_codes == 0 && header->size > 0) {
+        printf("[ERROR] Compressed data has an invalid header\n");
+        return -1;
+    }
+    if (num_codes < 2) {
+        return 0;
+    }
+
+    *single_byte = -1;
+    return create_huffman_decode_table_from_lengths(table, header->lengths) == 0 ?
+        1 : -1;
 }
 
+/*******************************************************************************
+ * Decompresses a stream using Huffman coding.
+ * Streams of every version are accepted. Neither stream needs to be
+ * seekable.
+ *
+ * inputs:
+ * - input_file: The stream to decompress
+ * - output_file: The stream to write decompressed data to
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int huffman_decompress_stream(FILE *input_file, FILE *output_file) {
+
+    /* Read the header */
+    /* Enough is read for a header of any version. What is left is data. */
+    unsigned char *start = (unsigned char *)malloc(HUFFMAN_V1_HEADER_SIZE);
+    if (start == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+    size_t start_size = fread(start, 1, HUFFMAN_V1_HEADER_SIZE, input_file);
+    HuffmanHeader_t header;
+    if (read_huffman_header(start, start_size, &header) != 0) {
+        free(start);
+        return 1;
+    }
+
+    /* Prepare to decode */
+    HuffmanDecodeTable_t table;
+    int single_byte;
+    int has_table = create_huffman_decoder(&header, &table, &single_byte);
+    if (has_table < 0) {
+        free(start);
+        return 1;
+    }
+
+    unsigned char *output = (unsigned char *)malloc(HUFFMAN_WRITE_BLOCK_SIZE);
+    size_t size = header.size;
+    int failed = output == NULL;
+
+    /* A single byte has no codes to read */
+    if (!failed && !has_table) {
+        memset(output, single_byte, HUFFMAN_WRITE_BLOCK_SIZE);
+        while (!failed && size > 0) {
+            size_t length = size < HUFFMAN_WRITE_BLOCK_SIZE ?
+                size : HUFFMAN_WRITE_BLOCK_SIZE;
+            failed = fwrite(output, 1, length, output_file) != length;
+            size -= length;
+        }
+
+    } else if (!failed) {
+
+        /* Decode the data after the header, then the rest of the stream a
+         * block at a time
+         */
+        HuffmanBitReader_t reader;
+        memset(&reader, 0, sizeof(reader));
+        reader.data = start + header.header_size;
+        reader.size = start_size - header.header_size;
+        reader.file = input_file;
+        reader.block = (unsigned char *)malloc(HUFFMAN_READ_BLOCK_SIZE);
+        failed = reader.block == NULL;
+
+        while (!failed && size > 0) {
+            size_t length = size < HUFFMAN_WRITE_BLOCK_SIZE ?
+                size : HUFFMAN_WRITE_BLOCK_SIZE;
+            decode_huffman(&table, &reader, output, length);
+            failed = fwrite(output, 1, length, output_file) != length;
+            size -= length;
+        }
+        failed = failed || decode_huffman_finish(&reader);
+
+        free(reader.block);
+    }
+
+    if (output == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+    }
+    if (has_table) {
+        free_huffman_decode_table(&table);
+    }
+    free(output);
+    free(start);
+    return failed;
+}
 
 /*******************************************************************************
  * Decompresses a file using Huffman coding.
+ * Files of every version are accepted.
  *
  * inputs:
  * - compressed_file: The file to decompress
@@ -80,25 +453,113 @@ void huffman_decompress(const char *compressed_file, const char *uncompressed_fi
         return;
     }
 
-    /* Read the frequency table from the compressed file */
-    unsigned int frequency_table[256];
-    fread(frequency_table, sizeof(unsigned int), 256, compressed_file_pointer);
-
-    /* Create Huffman tree */
-    HuffmanNode_t *huffman_tree = create_huffman_tree(frequency_table);
-
     /* Open the uncompressed file */
     FILE *uncompressed_file_pointer = fopen(uncompressed_file, "wb");
     if (!uncompressed_file_pointer) {
         printf("Error opening output file: %s\n", uncompressed_file);
+        fclose(compressed_file_pointer);
         return;
-    }    
+    }
+
+    if (huffman_decompress_stream(compressed_file_pointer,
+            uncompressed_file_pointer) != 0) {
+        printf("Error reading input file: %s\n", compressed_file);
+    }
 
-    /* Read the compressed data from the compressed file */
-    read_compressed_data(compressed_file_pointer, uncompressed_file_pointer, huffman_tree);
-    
-    /* Close the file pointers*/
+    /* Close the file pointers */
     fclose(compressed_file_pointer);
     fclose(uncompressed_file_pointer);
-    free_huffman_tree(huffman_tree);
+}
+
+/*******************************************************************************
+ * Gets the number of bytes compressed data decompresses to.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int huffman_decompressed_size(const unsigned char *input, size_t input_size,
+    size_t *size) {
+
+    HuffmanHeader_t header;
+    if (read_huffman_header(input, input_size, &header) != 0) {
+        return 1;
+    }
+
+    *size = header.size;
+    return 0;
+}
+
+/*******************************************************************************
+ * Decompresses data in memory using Huffman coding.
+ * Accepts the output of huffman_compress() & huffman_compress_buffer() of
+ * every version. The header gives the exact number of bytes to decode, so no
+ * padding bits are ever decoded. Nothing is allocated, except for the
+ * tables of version 1 data.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output. huffman_decompressed_size() gives
+ *                    the size needed.
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an output too small)
+ ******************************************************************************/
+int huffman_decompress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    /* Read the header */
+    HuffmanHeader_t header;
+    if (read_huffman_header(input, input_size, &header) != 0) {
+        return 1;
+    }
+    if (header.size > output_capacity) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 1;
+    }
+    size_t size = header.size;
+    const unsigned char *data = input + header.header_size;
+    size_t data_size = input_size - header.header_size;
+
+    /* Prepare to decode */
+    HuffmanDecodeTable_t table;
+    int single_byte;
+    int has_table = create_huffman_decoder(&header, &table, &single_byte);
+    if (has_table < 0) {
+        return 1;
+    }
+
+    /* A single byte has no codes to read */
+    if (!has_table) {
+        memset(output, single_byte, size);
+        *output_size = size;
+        return 0;
+    }
+
+    /* Each byte takes at least 1 bit */
+    if (size / 8 > data_size) {
+        printf("[ERROR] Compressed data is truncated\n");
+        free_huffman_decode_table(&table);
+        return 1;
+    }
+
+    /* Decode straight into the output */
+    HuffmanBitReader_t reader;
+    memset(&reader, 0, sizeof(reader));
+    reader.data = data;
+    reader.size = data_size;
+
+    decode_huffman(&table, &reader, output, size);
+    free_huffman_decode_table(&table);
+    if (decode_huffman_finish(&reader) != 0) {
+        return 1;
+    }
+
+    *output_size = size;
+    return 0;
 }
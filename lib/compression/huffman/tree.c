@@ -1,156 +1,96 @@
+
 #include <stdlib.h>
 
 #include "compression/huffman/tree.h"
 
 /*******************************************************************************
- * Sort the nodes by frequency in ascending order.
+ * Compare two leaf nodes by frequency, then by byte.
+ * No two leaves are equal, so the order does not depend on the sort used.
  *
  * inputs:
- * - nodes: The nodes to sort
- * - node_count: The number of nodes in the array
+ * - a: The first node
+ * - b: The second node
  * outputs:
- * - none
+ * - Less than, equal to or greater than 0 if a comes before, with or after b
  ******************************************************************************/
-void sort_nodes(HuffmanNode_t *nodes[], int node_count) {
-
-    while ( 1 ) {
-
-        /* Assume the nodes are sorted unless proven otherwise */
-        int sorted = 1;
-
-        /* Check if the nodes are sorted */
-        int i;
-        for (i = 1; i < node_count; i++) {
+int compare_huffman_leaves(const void *a, const void *b) {
 
-            /* If this node is lower than the previous node */
-            if (nodes[i]->frequency < nodes[i - 1]->frequency) {
-                
-                /* Nodes are not sorted correctly */
-                sorted = 0;
-
-                /* Swap the nodes */
-                HuffmanNode_t *temp = nodes[i];
-                nodes[i] = nodes[i - 1];
-                nodes[i - 1] = temp;
-
-                /* Restart the while loop */
-                break;
-            }
-        }
+    const HuffmanNode_t *node1 = (const HuffmanNode_t *)a;
+    const HuffmanNode_t *node2 = (const HuffmanNode_t *)b;
 
-        /* Exit once nodes are sorted */
-        if (sorted) {
-            break;
-        }
+    if (node1->frequency != node2->frequency) {
+        return node1->frequency < node2->frequency ? -1 : 1;
     }
+    return (int)node1->data - (int)node2->data;
 }
 
-
 /*******************************************************************************
  * Create Huffman tree.
+ * Uses two queues: the leaves sorted by frequency, and the internal nodes,
+ * which are made in order of frequency so never need sorting. The two
+ * lowest nodes are always at the front of one of them.
+ * On a tie a leaf is taken before an internal node, then older internal
+ * nodes first, which gives the same tree as earlier versions.
  *
  * inputs:
+ * - tree: Where to store the nodes of the tree
  * - frequency_table: The frequency table to create the Huffman tree from
  * outputs:
- * - The root of the Huffman tree
+ * - The root of the Huffman tree or NULL if no byte occurs
  ******************************************************************************/
-HuffmanNode_t *create_huffman_tree(unsigned int frequency_table[256]) {
+HuffmanNode_t *create_huffman_tree(HuffmanTree_t *tree,
+    const unsigned int frequency_table[256]) {
 
-    /* Store nodes */
-    HuffmanNode_t *nodes[256] = {NULL};
-
-    /* Track the number of nodes */
-    int node_count = 0;
+    HuffmanNode_t *nodes = tree->nodes;
+    int leaf_count = 0;
 
     /* Create leaf nodes for each byte that occurs in the file */
     int i;
     for (i = 0; i < 256; i++) {
-
-        /* If the byte occurs at least once */
         if (frequency_table[i] > 0) {
-
-            /* Create a leaf node for this byte */
-            HuffmanNode_t *node = (HuffmanNode_t *) malloc(sizeof(HuffmanNode_t));
-            node->data = i;
-            node->frequency = frequency_table[i];
+            nodes[leaf_count].data = (unsigned char)i;
+            nodes[leaf_count].frequency = frequency_table[i];
 
             /* Leaf nodes have no children */
-            node->left = NULL;
-            node->right = NULL;
-
-            /* Add the node to the nodes array */
-            nodes[node_count] = node;
-
-            /* Increment the node count */
-            node_count += 1;
+            nodes[leaf_count].left = NULL;
+            nodes[leaf_count].right = NULL;
+            leaf_count += 1;
         }
     }
+    tree->node_count = leaf_count;
 
+    if (leaf_count == 0) {
+        return NULL;
+    }
 
-    /* If there is more than 1 unique byte in the file */
-    if ( node_count > 1 ) {
-
-        /* Loop until only 1 node remains */
-        while (node_count > 1) {
-
-            /* Ensure the nodes are sorted by frequency */
-            sort_nodes(nodes, node_count);
+    /* The leaf queue */
+    qsort(nodes, leaf_count, sizeof(HuffmanNode_t), compare_huffman_leaves);
 
-            /* Take the two nodes with the lowest frequency */
-            HuffmanNode_t *node1 = nodes[0];
-            HuffmanNode_t *node2 = nodes[1];
+    /* Front of each queue. The internal queue starts after the leaves. */
+    int next_leaf = 0;
+    int next_internal = leaf_count;
 
-            /* Create an internal node */
-            HuffmanNode_t *internal_node = (HuffmanNode_t *) malloc(sizeof(HuffmanNode_t));
-            internal_node->frequency = node1->frequency + node2->frequency;
-            internal_node->left = node1;
-            internal_node->right = node2;
+    /* Each internal node joins the two lowest nodes */
+    while (tree->node_count < 2 * leaf_count - 1) {
 
-            /* Move every node in the array up by 2 positions */
-            /* This effeectively removes the first two nodes from the array */
-            for (i = 0; i < node_count - 2; i++) {
-                nodes[i] = nodes[i + 2];
+        HuffmanNode_t *children[2];
+        int j;
+        for (j = 0; j < 2; j++) {
+            if (next_leaf < leaf_count && (next_internal == tree->node_count ||
+                nodes[next_leaf].frequency <= nodes[next_internal].frequency)) {
+                children[j] = &nodes[next_leaf++];
+            } else {
+                children[j] = &nodes[next_internal++];
             }
-            node_count -= 2;
-
-            /* Add the internal node to the array */
-            nodes[node_count] = internal_node;
-            node_count += 1;
         }
-    }
-
-    /* Return the root of the tree */
-    return nodes[0];
-}
 
-/*******************************************************************************
- * Free the Huffman tree.
- *
- * inputs:
- * - node: The node to free
- * outputs:
- * - none
- ******************************************************************************/
-void free_huffman_tree(HuffmanNode_t *node) {
-
-    /* If the node is not null */
-    if (node != NULL) {
-
-        /* If the node is a leaf node */
-        if (node->left == NULL && node->right == NULL) {
-            /* Free the node */
-            free(node);
-        
-        /* If the node is an internal node */
-        } else {
-            /* Free the left child */
-            free_huffman_tree(node->left);
-
-            /* Free the right child */
-            free_huffman_tree(node->right);
-
-            /* Free the node */
-            free(node);
-        }
+        HuffmanNode_t *internal_node = &nodes[tree->node_count++];
+        internal_node->data = 0;
+        internal_node->frequency = children[0]->frequency + children[1]->frequency;
+        internal_node->left = children[0];
+        internal_node->right = children[1];
     }
+
+    /* The last node made is the root */
+    return &nodes[tree->node_count - 1];
 }
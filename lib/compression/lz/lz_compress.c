@@ -0,0 +1,324 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression/compression.h"
+#include "compression/lz/match_finder.h"
+#include "compression/lz/streams.h"
+
+/* The streams of one block before Huffman coding */
+struct LzStreams {
+
+    /* Bytes of each stream. LZ_BLOCK_SIZE each. */
+    unsigned char *data[LZ_NUM_STREAMS];
+
+    /* Bytes written to each stream */
+    size_t size[LZ_NUM_STREAMS];
+
+    /* Number of matches */
+    size_t num_matches;
+};
+
+typedef struct LzStreams LzStreams_t;
+
+/*******************************************************************************
+ * Adds a length to a stream. Lengths over 254 are stored as 255s followed by
+ * what is left.
+ *
+ * inputs:
+ * - streams: The streams
+ * - stream: Which stream to add to
+ * - length: The length
+ * outputs:
+ * - none
+ ******************************************************************************/
+void lz_write_length(LzStreams_t *streams, int stream, size_t length) {
+
+    unsigned char *output = streams->data[stream];
+    size_t size = streams->size[stream];
+
+    while (length >= 255) {
+        output[size++] = 255;
+        length -= 255;
+    }
+    output[size++] = (unsigned char)length;
+    streams->size[stream] = size;
+}
+
+/*******************************************************************************
+ * Adds a match & the literal bytes before it to the streams.
+ * Every match covers at least LZ_MIN_MATCH bytes, so no stream grows by more
+ * than the bytes covered.
+ *
+ * inputs:
+ * - streams: The streams
+ * - literals: The literal bytes before the match
+ * - num_literals: The number of literal bytes
+ * - match: The match
+ * outputs:
+ * - none
+ ******************************************************************************/
+void lz_write_match(LzStreams_t *streams, const unsigned char *literals,
+    size_t num_literals, LzMatch_t match) {
+
+    memcpy(streams->data[LZ_STREAM_LITERALS] +
+        streams->size[LZ_STREAM_LITERALS], literals, num_literals);
+    streams->size[LZ_STREAM_LITERALS] += num_literals;
+
+    lz_write_length(streams, LZ_STREAM_LITERAL_LENGTHS, num_literals);
+    lz_write_length(streams, LZ_STREAM_MATCH_LENGTHS,
+        match.length - LZ_MIN_MATCH);
+
+    streams->data[LZ_STREAM_DISTANCES_LOW]
+        [streams->size[LZ_STREAM_DISTANCES_LOW]++] =
+        (unsigned char)(match.distance & 0xFF);
+    streams->data[LZ_STREAM_DISTANCES_HIGH]
+        [streams->size[LZ_STREAM_DISTANCES_HIGH]++] =
+        (unsigned char)(match.distance >> 8);
+
+    streams->num_matches++;
+}
+
+/*******************************************************************************
+ * Splits a block into literals & matches.
+ * Each position takes the longest match found, unless the next position
+ * has a longer one(lazy matching). Every position is added to the match
+ * finder so later blocks can match it too.
+ *
+ * inputs:
+ * - finder: The match finder over all the data
+ * - start: The first byte of the block
+ * - end: One past the last byte of the block
+ * - streams: Set to the streams of the block
+ * outputs:
+ * - none
+ ******************************************************************************/
+void lz_parse_block(LzMatchFinder_t *finder, size_t start, size_t end,
+    LzStreams_t *streams) {
+
+    const unsigned char *data = finder->data;
+    size_t literal_start = start;
+    size_t position = start;
+    LzMatch_t match = { 0, 0 };
+    int have_match = 0;
+    int i;
+
+    for (i = 0; i < LZ_NUM_STREAMS; i++) {
+        streams->size[i] = 0;
+    }
+    streams->num_matches = 0;
+
+    while (position < end) {
+
+        /* The match may have been found by the lazy check */
+        if (!have_match) {
+            match = find_lz_match(finder, position, end - position);
+        }
+        have_match = 0;
+
+        insert_lz_position(finder, position);
+        if (match.length == 0) {
+            position++;
+            continue;
+        }
+
+        /* A longer match 1 byte later is worth a literal */
+        if (match.length < LZ_NICE_MATCH && position + 1 < end) {
+            LzMatch_t next = find_lz_match(finder, position + 1,
+                end - position - 1);
+            if (next.length > match.length) {
+                match = next;
+                have_match = 1;
+                position++;
+                continue;
+            }
+        }
+
+        lz_write_match(streams, data + literal_start,
+            position - literal_start, match);
+
+        /* The first position of the match is already added */
+        size_t match_end = position + match.length;
+        for (position++; position < match_end; position++) {
+            insert_lz_position(finder, position);
+        }
+        literal_start = position;
+    }
+
+    /* Bytes after the last match are the rest of the literals */
+    memcpy(streams->data[LZ_STREAM_LITERALS] +
+        streams->size[LZ_STREAM_LITERALS], data + literal_start,
+        end - literal_start);
+    streams->size[LZ_STREAM_LITERALS] += end - literal_start;
+}
+
+/*******************************************************************************
+ * Gets the most bytes a block can be written in, which is enough to store
+ * it as literals only.
+ *
+ * inputs:
+ * - block_size: The number of bytes in the block
+ * outputs:
+ * - The most bytes the block's streams can take
+ ******************************************************************************/
+size_t lz_block_bound(size_t block_size) {
+
+    return COMPRESSION_MAX_VARINT_SIZE + LZ_NUM_STREAMS * LZ_STREAM_SIZE_BYTES +
+        huffman_compress_bound(block_size) +
+        (LZ_NUM_STREAMS - 1) * huffman_compress_bound(0);
+}
+
+/*******************************************************************************
+ * Gets the most bytes lz_compress_buffer() can write for an input.
+ *
+ * inputs:
+ * - input_size: The number of bytes to compress
+ * outputs:
+ * - The size of output buffer that is always large enough
+ ******************************************************************************/
+size_t lz_compress_bound(size_t input_size) {
+
+    size_t num_full_blocks = input_size / LZ_BLOCK_SIZE;
+    size_t last_block_size = input_size % LZ_BLOCK_SIZE;
+
+    return LZ_MAX_HEADER_SIZE + num_full_blocks * lz_block_bound(LZ_BLOCK_SIZE) +
+        (last_block_size > 0 ? lz_block_bound(last_block_size) : 0);
+}
+
+/*******************************************************************************
+ * Writes the streams of a block, each Huffman coded with its own codes.
+ * If that could take more than lz_block_bound(), the block is written as
+ * literals only instead, which always fits.
+ *
+ * inputs:
+ * - streams: The streams of the block. Changed if the block is written as
+ *            literals only.
+ * - block: The uncompressed block
+ * - block_size: The number of bytes in the block
+ * - output: Where to write the block
+ * - output_capacity: The number of bytes available
+ * outputs:
+ * - The number of bytes written or 0 if the output is too small
+ ******************************************************************************/
+size_t lz_write_block(LzStreams_t *streams, const unsigned char *block,
+    size_t block_size, unsigned char *output, size_t output_capacity) {
+
+    const unsigned char *data[LZ_NUM_STREAMS];
+    size_t worst_size = COMPRESSION_MAX_VARINT_SIZE;
+    size_t size;
+    int i;
+
+    for (i = 0; i < LZ_NUM_STREAMS; i++) {
+        data[i] = streams->data[i];
+        worst_size += LZ_STREAM_SIZE_BYTES +
+            huffman_compress_bound(streams->size[i]);
+    }
+
+    /* Keep lz_compress_bound() true for data with few matches */
+    if (worst_size > lz_block_bound(block_size)) {
+        for (i = 0; i < LZ_NUM_STREAMS; i++) {
+            streams->size[i] = 0;
+        }
+        data[LZ_STREAM_LITERALS] = block;
+        streams->size[LZ_STREAM_LITERALS] = block_size;
+        streams->num_matches = 0;
+    }
+
+    if (output_capacity < COMPRESSION_MAX_VARINT_SIZE) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 0;
+    }
+    size = compression_write_varint(output, streams->num_matches);
+
+    for (i = 0; i < LZ_NUM_STREAMS; i++) {
+        size_t stream_size;
+
+        if (output_capacity - size < LZ_STREAM_SIZE_BYTES ||
+            huffman_compress_buffer(data[i], streams->size[i],
+                output + size + LZ_STREAM_SIZE_BYTES,
+                output_capacity - size - LZ_STREAM_SIZE_BYTES,
+                &stream_size) != 0) {
+            printf("[ERROR] Output buffer is too small\n");
+            return 0;
+        }
+
+        /* Little endian size of the stream */
+        output[size] = (unsigned char)(stream_size & 0xFF);
+        output[size + 1] = (unsigned char)((stream_size >> 8) & 0xFF);
+        output[size + 2] = (unsigned char)((stream_size >> 16) & 0xFF);
+        output[size + 3] = (unsigned char)((stream_size >> 24) & 0xFF);
+        size += LZ_STREAM_SIZE_BYTES + stream_size;
+    }
+
+    return size;
+}
+
+/*******************************************************************************
+ * Compresses data in memory by replacing repeated bytes with matches to
+ * earlier copies, then Huffman coding what is left.
+ * Allocates a few MiB of working memory.
+ *
+ * inputs:
+ * - input: The data to compress
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the compressed data
+ * - output_capacity: The size of output. lz_compress_bound() is always
+ *                    enough.
+ * - output_size: Set to the number of bytes in the compressed data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int lz_compress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    LzMatchFinder_t finder;
+    LzStreams_t streams;
+    size_t size = 0;
+    size_t start;
+    int failed = 0;
+    int i;
+
+    if (output_capacity < LZ_MAX_HEADER_SIZE) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 1;
+    }
+    memcpy(output, LZ_MAGIC, 4);
+    output[4] = LZ_VERSION;
+    size = 5 + compression_write_varint(output + 5, input_size);
+
+    if (create_lz_match_finder(&finder, input, input_size) != 0) {
+        return 1;
+    }
+
+    /* One buffer for every stream */
+    unsigned char *work = (unsigned char *)malloc(
+        (size_t)LZ_NUM_STREAMS * LZ_BLOCK_SIZE);
+    if (work == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free_lz_match_finder(&finder);
+        return 1;
+    }
+    for (i = 0; i < LZ_NUM_STREAMS; i++) {
+        streams.data[i] = work + (size_t)i * LZ_BLOCK_SIZE;
+    }
+
+    for (start = 0; start < input_size && !failed; start += LZ_BLOCK_SIZE) {
+        size_t block_size = input_size - start < LZ_BLOCK_SIZE ?
+            input_size - start : LZ_BLOCK_SIZE;
+
+        lz_parse_block(&finder, start, start + block_size, &streams);
+        size_t written = lz_write_block(&streams, input + start, block_size,
+            output + size, output_capacity - size);
+        failed = written == 0;
+        size += written;
+    }
+
+    free(work);
+    free_lz_match_finder(&finder);
+
+    if (failed) {
+        return 1;
+    }
+    *output_size = size;
+    return 0;
+}
@@ -0,0 +1,285 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compression/compression.h"
+#include "compression/lz/match_finder.h"
+#include "compression/lz/streams.h"
+
+/* A decoded stream being read */
+struct LzStreamReader {
+    const unsigned char *data;
+    size_t size;
+    size_t position;
+};
+
+typedef struct LzStreamReader LzStreamReader_t;
+
+/*******************************************************************************
+ * Reads a length stored as 255s followed by what is left.
+ *
+ * inputs:
+ * - reader: The stream to read from
+ * - length: Set to the length
+ * outputs:
+ * - 0 on success, 1 if the stream ends first
+ ******************************************************************************/
+int lz_read_length(LzStreamReader_t *reader, size_t *length) {
+
+    size_t result = 0;
+    unsigned char byte;
+
+    do {
+        if (reader->position == reader->size) {
+            return 1;
+        }
+        byte = reader->data[reader->position++];
+        result += byte;
+    } while (byte == 255);
+
+    *length = result;
+    return 0;
+}
+
+/*******************************************************************************
+ * Decodes the Huffman coded streams of a block.
+ *
+ * inputs:
+ * - input: The streams
+ * - input_size: The number of bytes available
+ * - work: Where to decode the streams. LZ_BLOCK_SIZE bytes for each.
+ * - readers: Set to the decoded streams
+ * outputs:
+ * - The number of bytes read or 0 if the streams are invalid
+ ******************************************************************************/
+size_t lz_read_streams(const unsigned char *input, size_t input_size,
+    unsigned char *work, LzStreamReader_t readers[LZ_NUM_STREAMS]) {
+
+    size_t size = 0;
+    int i;
+
+    for (i = 0; i < LZ_NUM_STREAMS; i++) {
+        if (input_size - size < LZ_STREAM_SIZE_BYTES) {
+            return 0;
+        }
+        size_t stream_size = (size_t)input[size] |
+            ((size_t)input[size + 1] << 8) |
+            ((size_t)input[size + 2] << 16) |
+            ((size_t)input[size + 3] << 24);
+        size += LZ_STREAM_SIZE_BYTES;
+        if (stream_size > input_size - size) {
+            return 0;
+        }
+
+        /* No stream can be larger than a block */
+        size_t decoded_size;
+        unsigned char *decoded = work + (size_t)i * LZ_BLOCK_SIZE;
+        if (huffman_decompressed_size(input + size, stream_size,
+                &decoded_size) != 0 || decoded_size > LZ_BLOCK_SIZE ||
+            huffman_decompress_buffer(input + size, stream_size, decoded,
+                LZ_BLOCK_SIZE, &decoded_size) != 0) {
+            return 0;
+        }
+
+        readers[i].data = decoded;
+        readers[i].size = decoded_size;
+        readers[i].position = 0;
+        size += stream_size;
+    }
+
+    return size;
+}
+
+/*******************************************************************************
+ * Rebuilds a block from its literals & matches.
+ *
+ * inputs:
+ * - readers: The decoded streams of the block
+ * - num_matches: The number of matches in the block
+ * - output: All the data decompressed so far. Matches may copy from any of
+ *           it.
+ * - start: Where the block starts in output
+ * - block_size: The number of bytes in the block
+ * outputs:
+ * - 0 on success, 1 if the block is invalid
+ ******************************************************************************/
+int lz_decode_block(LzStreamReader_t readers[LZ_NUM_STREAMS],
+    size_t num_matches, unsigned char *output, size_t start,
+    size_t block_size) {
+
+    LzStreamReader_t *literals = &readers[LZ_STREAM_LITERALS];
+    LzStreamReader_t *low = &readers[LZ_STREAM_DISTANCES_LOW];
+    LzStreamReader_t *high = &readers[LZ_STREAM_DISTANCES_HIGH];
+    size_t position = start;
+    size_t end = start + block_size;
+    size_t i;
+
+    for (i = 0; i < num_matches; i++) {
+        size_t num_literals, length;
+
+        if (lz_read_length(&readers[LZ_STREAM_LITERAL_LENGTHS],
+                &num_literals) != 0 ||
+            lz_read_length(&readers[LZ_STREAM_MATCH_LENGTHS], &length) != 0 ||
+            low->position == low->size || high->position == high->size) {
+            return 1;
+        }
+        length += LZ_MIN_MATCH;
+        size_t distance = (size_t)low->data[low->position++] |
+            ((size_t)high->data[high->position++] << 8);
+
+        if (num_literals > literals->size - literals->position ||
+            num_literals > end - position) {
+            return 1;
+        }
+        memcpy(output + position, literals->data + literals->position,
+            num_literals);
+        literals->position += num_literals;
+        position += num_literals;
+
+        if (distance == 0 || distance > position || length > end - position) {
+            return 1;
+        }
+
+        /* Byte by byte, as a match may overlap the bytes it creates */
+        const unsigned char *from = output + position - distance;
+        unsigned char *to = output + position;
+        if (distance >= length) {
+            memcpy(to, from, length);
+        } else {
+            size_t j;
+            for (j = 0; j < length; j++) {
+                to[j] = from[j];
+            }
+        }
+        position += length;
+    }
+
+    /* The rest of the literals end the block */
+    size_t num_literals = literals->size - literals->position;
+    if (num_literals != end - position) {
+        return 1;
+    }
+    memcpy(output + position, literals->data + literals->position,
+        num_literals);
+
+    /* Every stream must be used up */
+    for (i = 1; i < LZ_NUM_STREAMS; i++) {
+        if (readers[i].position != readers[i].size) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Reads the header of data written by lz_compress_buffer().
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - The size of the header or 0 if it is invalid
+ ******************************************************************************/
+size_t read_lz_header(const unsigned char *input, size_t input_size,
+    size_t *size) {
+
+    if (input_size < 5 || memcmp(input, LZ_MAGIC, 4) != 0) {
+        printf("[ERROR] Not LZ compressed data\n");
+        return 0;
+    }
+    if (input[4] != LZ_VERSION) {
+        printf("[ERROR] Unsupported LZ version %d\n", input[4]);
+        return 0;
+    }
+
+    size_t varint_size = compression_read_varint(input + 5, input_size - 5, size);
+    if (varint_size == 0) {
+        printf("[ERROR] Invalid LZ header\n");
+        return 0;
+    }
+    return 5 + varint_size;
+}
+
+/*******************************************************************************
+ * Gets the number of bytes data from lz_compress_buffer() decompresses to.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - size: Set to the number of bytes of decompressed data
+ * outputs:
+ * - 0 on success, 1 if the header is invalid
+ ******************************************************************************/
+int lz_decompressed_size(const unsigned char *input, size_t input_size,
+    size_t *size) {
+
+    return read_lz_header(input, input_size, size) == 0;
+}
+
+/*******************************************************************************
+ * Decompresses data written by lz_compress_buffer().
+ * Allocates a few MiB of working memory.
+ *
+ * inputs:
+ * - input: The compressed data
+ * - input_size: The number of bytes in the compressed data
+ * - output: Where to write the decompressed data
+ * - output_capacity: The size of output. lz_decompressed_size() gives the
+ *                    size needed.
+ * - output_size: Set to the number of bytes in the decompressed data
+ * outputs:
+ * - 0 on success, 1 on failure(including an output too small)
+ ******************************************************************************/
+int lz_decompress_buffer(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    LzStreamReader_t readers[LZ_NUM_STREAMS];
+    size_t size;
+    size_t start;
+    int failed = 0;
+
+    size_t position = read_lz_header(input, input_size, &size);
+    if (position == 0) {
+        return 1;
+    }
+    if (size > output_capacity) {
+        printf("[ERROR] Output buffer is too small\n");
+        return 1;
+    }
+
+    /* One buffer for every stream */
+    unsigned char *work = (unsigned char *)malloc(
+        (size_t)LZ_NUM_STREAMS * LZ_BLOCK_SIZE);
+    if (work == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        return 1;
+    }
+
+    for (start = 0; start < size && !failed; start += LZ_BLOCK_SIZE) {
+        size_t block_size = size - start < LZ_BLOCK_SIZE ?
+            size - start : LZ_BLOCK_SIZE;
+        size_t num_matches;
+
+        size_t header_size = compression_read_varint(input + position,
+            input_size - position, &num_matches);
+        size_t streams_size = header_size == 0 ? 0 :
+            lz_read_streams(input + position + header_size,
+                input_size - position - header_size, work, readers);
+
+        failed = streams_size == 0 ||
+            lz_decode_block(readers, num_matches, output, start,
+                block_size) != 0;
+        position += header_size + streams_size;
+    }
+
+    free(work);
+
+    /* Nothing may follow the last block */
+    if (failed || position != input_size) {
+        printf("[ERROR] Invalid LZ compressed data\n");
+        return 1;
+    }
+    *output_size = size;
+    return 0;
+}
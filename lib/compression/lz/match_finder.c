@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "compression/lz/match_finder.h"
+
+/* Number of entries in the window table. Positions a window apart share
+ * an entry, but only the newer one can still be matched.
+ */
+#define LZ_WINDOW_ENTRIES (LZ_WINDOW_SIZE + 1)
+
+/*******************************************************************************
+ * Hash the LZ_MIN_MATCH bytes at a position.
+ *
+ * inputs:
+ * - data: The bytes
+ * outputs:
+ * - The hash. Less than 1 << LZ_HASH_BITS.
+ ******************************************************************************/
+unsigned int lz_hash(const unsigned char *data) {
+
+    uint32_t word = (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+        ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    return (unsigned int)((word * 2654435761U) >> (32 - LZ_HASH_BITS));
+}
+
+/*******************************************************************************
+ * Create a match finder.
+ *
+ * inputs:
+ * - finder: The match finder to create
+ * - data: The data to find matches in
+ * - size: The number of bytes in the data
+ * outputs:
+ * - 0 on success, 1 on failure
+ ******************************************************************************/
+int create_lz_match_finder(LzMatchFinder_t *finder, const unsigned char *data,
+    size_t size) {
+
+    finder->data = data;
+    finder->size = size;
+    finder->head = (size_t *)calloc((size_t)1 << LZ_HASH_BITS, sizeof(size_t));
+    finder->previous = (size_t *)calloc(LZ_WINDOW_ENTRIES, sizeof(size_t));
+    if (finder->head == NULL || finder->previous == NULL) {
+        printf("[ERROR] Failed to allocate memory\n");
+        free_lz_match_finder(finder);
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Adds a position to the match finder, so later positions can match it.
+ * Positions must be added in order.
+ *
+ * inputs:
+ * - finder: The match finder
+ * - position: The position to add
+ * outputs:
+ * - none
+ ******************************************************************************/
+void insert_lz_position(LzMatchFinder_t *finder, size_t position) {
+
+    /* Too close to the end for a whole match */
+    if (position + LZ_MIN_MATCH > finder->size) {
+        return;
+    }
+
+    unsigned int hash = lz_hash(finder->data + position);
+    finder->previous[position % LZ_WINDOW_ENTRIES] = finder->head[hash];
+    finder->head[hash] = position + 1;
+}
+
+/*******************************************************************************
+ * Finds the longest match for the bytes at a position.
+ * Only positions already added are searched.
+ *
+ * inputs:
+ * - finder: The match finder
+ * - position: The position to find a match for
+ * - max_length: The longest match allowed
+ * outputs:
+ * - The longest match found. Its length is 0 if none is at least
+ *   LZ_MIN_MATCH bytes.
+ ******************************************************************************/
+LzMatch_t find_lz_match(const LzMatchFinder_t *finder, size_t position,
+    size_t max_length) {
+
+    LzMatch_t best = { 0, 0 };
+    const unsigned char *data = finder->data;
+    int chain = LZ_MAX_CHAIN;
+
+    if (max_length < LZ_MIN_MATCH || position + LZ_MIN_MATCH > finder->size) {
+        return best;
+    }
+
+    size_t candidate = finder->head[lz_hash(data + position)];
+    while (candidate != 0 && chain-- > 0) {
+        size_t start = candidate - 1;
+
+        /* Older positions have been overwritten in the window table */
+        if (start >= position || position - start > LZ_WINDOW_SIZE) {
+            break;
+        }
+
+        /* Only compare in full if it could beat the best so far */
+        if (data[start + best.length] == data[position + best.length]) {
+            size_t length = 0;
+            while (length < max_length &&
+                data[start + length] == data[position + length]) {
+                length++;
+            }
+
+            if (length > best.length) {
+                best.length = length;
+                best.distance = position - start;
+                if (length >= LZ_NICE_MATCH || length == max_length) {
+                    break;
+                }
+            }
+        }
+
+        candidate = finder->previous[start % LZ_WINDOW_ENTRIES];
+    }
+
+    if (best.length < LZ_MIN_MATCH) {
+        best.length = 0;
+        best.distance = 0;
+    }
+    return best;
+}
+
+/*******************************************************************************
+ * Free a match finder.
+ *
+ * inputs:
+ * - finder: The match finder to free
+ * outputs:
+ * - none
+ ******************************************************************************/
+void free_lz_match_finder(LzMatchFinder_t *finder) {
+
+    free(finder->head);
+    free(finder->previous);
+    finder->head = NULL;
+    finder->previous = NULL;
+}
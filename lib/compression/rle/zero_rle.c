@@ -0,0 +1,172 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "compression/compression.h"
+#include "compression/varint.h"
+
+/* Shortest run of zeros worth storing as a run. Shorter runs stay in the
+ * literals, so no run costs more than the zeros it replaces.
+ */
+#define ZERO_RLE_MIN_RUN 4
+
+/*******************************************************************************
+ * Counts the zeros at the start of some data.
+ * 8 bytes are compared at a time.
+ *
+ * inputs:
+ * - data: The data
+ * - size: The number of bytes available
+ * outputs:
+ * - The number of zeros before the first other byte
+ ******************************************************************************/
+size_t zero_rle_count_zeros(const unsigned char *data, size_t size) {
+
+    size_t count = 0;
+    uint64_t word;
+
+    while (size - count >= 8) {
+        memcpy(&word, data + count, 8);
+        if (word != 0) {
+            break;
+        }
+        count += 8;
+    }
+    while (count < size && data[count] == 0) {
+        count++;
+    }
+    return count;
+}
+
+/*******************************************************************************
+ * Gets the most bytes zero_rle_encode() can write for an input.
+ *
+ * inputs:
+ * - input_size: The number of bytes to encode
+ * outputs:
+ * - The size of output buffer that is always large enough
+ ******************************************************************************/
+size_t zero_rle_bound(size_t input_size) {
+
+    /* Each run pays for its own sizes. Only the last literals, of up to
+     * 1 size byte per 128 bytes, & the final empty run are extra.
+     */
+    return input_size + input_size / 128 + 2 + COMPRESSION_MAX_VARINT_SIZE;
+}
+
+/*******************************************************************************
+ * Replaces runs of zeros with their length.
+ * The output is pairs of: number of literal bytes | literal bytes | number
+ * of zeros. Numbers are stored like the sizes in Huffman headers. The last
+ * pair has no zeros.
+ *
+ * inputs:
+ * - input: The data to encode
+ * - input_size: The number of bytes in the data
+ * - output: Where to write the encoded data
+ * - output_capacity: The size of output. zero_rle_bound() is always enough.
+ * - output_size: Set to the number of bytes in the encoded data
+ * outputs:
+ * - 0 on success, 1 if the output is too small
+ ******************************************************************************/
+int zero_rle_encode(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    size_t size = 0;
+    size_t literal_start = 0;
+    size_t position = 0;
+
+    while (1) {
+
+        /* Next run of zeros long enough to store as a run */
+        size_t run = 0;
+        while (position < input_size) {
+            const unsigned char *zero = (const unsigned char *)memchr(
+                input + position, 0, input_size - position);
+            if (zero == NULL) {
+                position = input_size;
+                break;
+            }
+            position = (size_t)(zero - input);
+            run = zero_rle_count_zeros(zero, input_size - position);
+            if (run >= ZERO_RLE_MIN_RUN) {
+                break;
+            }
+            position += run;
+            run = 0;
+        }
+
+        unsigned char literals_size[COMPRESSION_MAX_VARINT_SIZE];
+        unsigned char run_size[COMPRESSION_MAX_VARINT_SIZE];
+        size_t num_literals = position - literal_start;
+        size_t literals_size_bytes = compression_write_varint(literals_size,
+            num_literals);
+        size_t run_size_bytes = compression_write_varint(run_size, run);
+        if (output_capacity - size <
+            literals_size_bytes + num_literals + run_size_bytes) {
+            printf("[ERROR] Output buffer is too small\n");
+            return 1;
+        }
+
+        memcpy(output + size, literals_size, literals_size_bytes);
+        size += literals_size_bytes;
+        memcpy(output + size, input + literal_start, num_literals);
+        size += num_literals;
+        memcpy(output + size, run_size, run_size_bytes);
+        size += run_size_bytes;
+
+        if (run == 0) {
+            break;
+        }
+        position += run;
+        literal_start = position;
+    }
+
+    *output_size = size;
+    return 0;
+}
+
+/*******************************************************************************
+ * Restores data encoded by zero_rle_encode().
+ *
+ * inputs:
+ * - input: The encoded data
+ * - input_size: The number of bytes in the encoded data
+ * - output: Where to write the decoded data
+ * - output_capacity: The size of output
+ * - output_size: Set to the number of bytes in the decoded data
+ * outputs:
+ * - 0 on success, 1 if the data is invalid or the output is too small
+ ******************************************************************************/
+int zero_rle_decode(const unsigned char *input, size_t input_size,
+    unsigned char *output, size_t output_capacity, size_t *output_size) {
+
+    size_t position = 0;
+    size_t size = 0;
+
+    while (position < input_size) {
+        size_t num_literals, run, read;
+
+        read = compression_read_varint(input + position, input_size - position,
+            &num_literals);
+        if (read == 0 || num_literals > input_size - position - read ||
+            num_literals > output_capacity - size) {
+            return 1;
+        }
+        position += read;
+        memcpy(output + size, input + position, num_literals);
+        position += num_literals;
+        size += num_literals;
+
+        read = compression_read_varint(input + position, input_size - position, &run);
+        if (read == 0 || run > output_capacity - size) {
+            return 1;
+        }
+        position += read;
+        memset(output + size, 0, run);
+        size += run;
+    }
+
+    *output_size = size;
+    return 0;
+}
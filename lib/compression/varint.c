@@ -0,0 +1,61 @@
+#include <stddef.h>
+
+#include "compression/varint.h"
+
+/*******************************************************************************
+ * Stores a size 7 bits per byte, lowest first, with the top bit set on every
+ * byte but the last.
+ *
+ * inputs:
+ * - output: Where to store it. Room for COMPRESSION_MAX_VARINT_SIZE bytes.
+ * - value: The size
+ * outputs:
+ * - The number of bytes written
+ ******************************************************************************/
+size_t compression_write_varint(unsigned char *output, size_t value) {
+
+    size_t size = 0;
+    while (value >= 0x80) {
+        output[size++] = (unsigned char)((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    output[size++] = (unsigned char)value;
+    return size;
+}
+
+/*******************************************************************************
+ * Reads a size stored by compression_write_varint().
+ *
+ * inputs:
+ * - input: The stored size
+ * - input_size: The number of bytes available
+ * - value: Set to the size
+ * outputs:
+ * - The number of bytes read or 0 if the size is invalid
+ ******************************************************************************/
+size_t compression_read_varint(const unsigned char *input, size_t input_size,
+    size_t *value) {
+
+    size_t result = 0;
+    size_t size = 0;
+    int shift = 0;
+
+    while (size < input_size && size < COMPRESSION_MAX_VARINT_SIZE) {
+        unsigned char byte = input[size++];
+
+        /* Would not fit in a size_t */
+        if (shift >= (int)(8 * sizeof(size_t)) ||
+            ((size_t)(byte & 0x7F) << shift) >> shift != (size_t)(byte & 0x7F)) {
+            return 0;
+        }
+        result |= (size_t)(byte & 0x7F) << shift;
+        shift += 7;
+
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return size;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,383 @@
+#include "encryption/aes/core.h"
+#include "encryption/aes/aesni.h"
+#include "encryption/aes/keyschedule.h"
+#include "encryption/aes/ttable.h"
+#include "utils/cpu.h"
+
+/* The AES-NI backend is only compiled for x86 with GCC/Clang.
+ * Functions are compiled for AES-NI individually so the rest of the
+ * library still runs on CPUs without it.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AES_AESNI_COMPILED
+#include <wmmintrin.h>
+#define AES_AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif
+
+#ifdef AES_AESNI_COMPILED
+
+/*******************************************************************************
+ * Checks whether the AES-NI backend can be used.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if the AES-NI backend can be used, otherwise 0.
+ ******************************************************************************/
+int aes_aesni_available(void)
+{
+    return cpu_has_aesni();
+}
+
+/*******************************************************************************
+ * XORs each word of the block with all the words before it.
+ * word[i] = word[0] ⊕ ... ⊕ word[i]
+ * Shared step of every AES key expansion.
+ *
+ * inputs:
+ * - block - The 4 words to combine.
+ * outputs:
+ * - The combined words.
+ ******************************************************************************/
+AES_AESNI_TARGET
+__m128i aes_aesni_prefix_xor(__m128i block)
+{
+    block = _mm_xor_si128(block, _mm_slli_si128(block, 4));
+    block = _mm_xor_si128(block, _mm_slli_si128(block, 4));
+    return _mm_xor_si128(block, _mm_slli_si128(block, 4));
+}
+
+/*******************************************************************************
+ * Generates the next AES-128 round key.
+ *
+ * inputs:
+ * - key - The previous round key.
+ * - assist - The output of AESKEYGENASSIST for the previous round key.
+ * outputs:
+ * - The next round key.
+ ******************************************************************************/
+AES_AESNI_TARGET
+__m128i aes_aesni_expand_128(__m128i key, __m128i assist)
+{
+    /* RotWord(SubWord(w3)) ⊕ Rcon is in the top word */
+    assist = _mm_shuffle_epi32(assist, 0xFF);
+    return _mm_xor_si128(aes_aesni_prefix_xor(key), assist);
+}
+
+/*******************************************************************************
+ * Generates the next 6 words of an AES-192 key schedule.
+ *
+ * inputs:
+ * - low - Words 0-3 of the previous 6 words. Updated in place.
+ * - high - Words 4-5 of the previous 6 words(low half). Updated in place.
+ * - assist - The output of AESKEYGENASSIST for 'high'.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+AES_AESNI_TARGET
+void aes_aesni_expand_192(__m128i *low, __m128i *high, __m128i assist)
+{
+    __m128i carry;
+
+    /* RotWord(SubWord(w5)) ⊕ Rcon is in the second word */
+    assist = _mm_shuffle_epi32(assist, 0x55);
+    *low = _mm_xor_si128(aes_aesni_prefix_xor(*low), assist);
+
+    /* Words 4 & 5 depend on the last new word */
+    carry = _mm_shuffle_epi32(*low, 0xFF);
+    *high = _mm_xor_si128(*high, _mm_slli_si128(*high, 4));
+    *high = _mm_xor_si128(*high, carry);
+}
+
+/*******************************************************************************
+ * Generates the second half of the next AES-256 round key pair.
+ * Uses SubWord without RotWord or Rcon.
+ *
+ * inputs:
+ * - key - The round key generated just before.
+ * - previous - The round key 2 positions before.
+ * outputs:
+ * - The next round key.
+ ******************************************************************************/
+AES_AESNI_TARGET
+__m128i aes_aesni_expand_256_odd(__m128i key, __m128i previous)
+{
+    /* SubWord(w3) is in the third word */
+    __m128i assist = _mm_aeskeygenassist_si128(key, 0x00);
+    assist = _mm_shuffle_epi32(assist, 0xAA);
+    return _mm_xor_si128(aes_aesni_prefix_xor(previous), assist);
+}
+
+/* AESKEYGENASSIST needs Rcon as a constant so each round is unrolled */
+#define AES_AESNI_128_ROUND(keys, i, rcon) \
+    keys[i] = aes_aesni_expand_128( \
+        keys[i - 1], _mm_aeskeygenassist_si128(keys[i - 1], rcon))
+
+#define AES_AESNI_256_ROUND(keys, i, rcon) \
+    keys[i] = aes_aesni_expand_128( \
+        keys[i - 2], _mm_aeskeygenassist_si128(keys[i - 1], rcon))
+
+#define AES_AESNI_256_ROUND_ODD(keys, i) \
+    keys[i] = aes_aesni_expand_256_odd(keys[i - 1], keys[i - 2])
+
+#define AES_AESNI_192_ROUND(low, high, words, n, rcon) \
+    do { \
+        aes_aesni_expand_192(&low, &high, \
+            _mm_aeskeygenassist_si128(high, rcon)); \
+        _mm_storeu_si128((__m128i *)(words + (n) * 24), low); \
+        _mm_storel_epi64((__m128i *)(words + (n) * 24 + 16), high); \
+    } while (0)
+
+/*******************************************************************************
+ * Expands the key using AESKEYGENASSIST.
+ *
+ * inputs:
+ * - ctx - The context to fill. num_rounds & key_size must already be set.
+ * - key - The 128, 192, or 256 bit key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+AES_AESNI_TARGET
+void aes_aesni_key_expansion(aes_context_t *ctx, const unsigned char *key)
+{
+    __m128i keys[AES_MAX_ROUNDS + 1];
+    int i;
+
+    if (ctx->key_size == 16)
+    {
+        keys[0] = _mm_loadu_si128((const __m128i *)key);
+        AES_AESNI_128_ROUND(keys, 1, 0x01);
+        AES_AESNI_128_ROUND(keys, 2, 0x02);
+        AES_AESNI_128_ROUND(keys, 3, 0x04);
+        AES_AESNI_128_ROUND(keys, 4, 0x08);
+        AES_AESNI_128_ROUND(keys, 5, 0x10);
+        AES_AESNI_128_ROUND(keys, 6, 0x20);
+        AES_AESNI_128_ROUND(keys, 7, 0x40);
+        AES_AESNI_128_ROUND(keys, 8, 0x80);
+        AES_AESNI_128_ROUND(keys, 9, 0x1B);
+        AES_AESNI_128_ROUND(keys, 10, 0x36);
+    }
+    else if (ctx->key_size == 24)
+    {
+        /* AES-192 generates 6 words per step which does not line up with
+         * 4 word round keys, so the words are written out as bytes.
+         * 8 steps of 24 bytes after the key cover all 13 round keys.
+         */
+        unsigned char words[24 * 9];
+        __m128i low = _mm_loadu_si128((const __m128i *)key);
+        __m128i high = _mm_loadl_epi64((const __m128i *)(key + 16));
+        _mm_storeu_si128((__m128i *)words, low);
+        _mm_storel_epi64((__m128i *)(words + 16), high);
+
+        AES_AESNI_192_ROUND(low, high, words, 1, 0x01);
+        AES_AESNI_192_ROUND(low, high, words, 2, 0x02);
+        AES_AESNI_192_ROUND(low, high, words, 3, 0x04);
+        AES_AESNI_192_ROUND(low, high, words, 4, 0x08);
+        AES_AESNI_192_ROUND(low, high, words, 5, 0x10);
+        AES_AESNI_192_ROUND(low, high, words, 6, 0x20);
+        AES_AESNI_192_ROUND(low, high, words, 7, 0x40);
+        AES_AESNI_192_ROUND(low, high, words, 8, 0x80);
+
+        for (i = 0; i <= 12; i++)
+        {
+            keys[i] = _mm_loadu_si128((const __m128i *)(words + (i * 16)));
+        }
+    }
+    else
+    {
+        keys[0] = _mm_loadu_si128((const __m128i *)key);
+        keys[1] = _mm_loadu_si128((const __m128i *)(key + 16));
+        AES_AESNI_256_ROUND(keys, 2, 0x01);
+        AES_AESNI_256_ROUND_ODD(keys, 3);
+        AES_AESNI_256_ROUND(keys, 4, 0x02);
+        AES_AESNI_256_ROUND_ODD(keys, 5);
+        AES_AESNI_256_ROUND(keys, 6, 0x04);
+        AES_AESNI_256_ROUND_ODD(keys, 7);
+        AES_AESNI_256_ROUND(keys, 8, 0x08);
+        AES_AESNI_256_ROUND_ODD(keys, 9);
+        AES_AESNI_256_ROUND(keys, 10, 0x10);
+        AES_AESNI_256_ROUND_ODD(keys, 11);
+        AES_AESNI_256_ROUND(keys, 12, 0x20);
+        AES_AESNI_256_ROUND_ODD(keys, 13);
+        AES_AESNI_256_ROUND(keys, 14, 0x40);
+    }
+
+    /* Store the cipher round keys */
+    for (i = 0; i <= ctx->num_rounds; i++)
+    {
+        _mm_storeu_si128((__m128i *)(ctx->round_keys + (i * 16)), keys[i]);
+    }
+
+    /* Equivalent inverse cipher: reverse order & InvMixColumns(AESIMC)
+     * applied to the middle round keys.
+     */
+    _mm_storeu_si128((__m128i *)ctx->inv_round_keys, keys[ctx->num_rounds]);
+    for (i = 1; i < ctx->num_rounds; i++)
+    {
+        _mm_storeu_si128((__m128i *)(ctx->inv_round_keys + (i * 16)),
+            _mm_aesimc_si128(keys[ctx->num_rounds - i]));
+    }
+    _mm_storeu_si128(
+        (__m128i *)(ctx->inv_round_keys + (ctx->num_rounds * 16)), keys[0]);
+}
+
+/*******************************************************************************
+ * AES encryption of a single block using AESENC.
+ *
+ * inputs:
+ * - input - The input to encrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted data.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+AES_AESNI_TARGET
+void aes_aesni_encrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output)
+{
+    const __m128i *round_keys = (const __m128i *)ctx->round_keys;
+    __m128i state = _mm_loadu_si128((const __m128i *)input);
+    int i;
+
+    /* Initial round key, middle rounds & final round(no MixColumns) */
+    state = _mm_xor_si128(state, _mm_loadu_si128(round_keys));
+    for (i = 1; i < ctx->num_rounds; i++)
+    {
+        state = _mm_aesenc_si128(state, _mm_loadu_si128(round_keys + i));
+    }
+    state = _mm_aesenclast_si128(
+        state, _mm_loadu_si128(round_keys + ctx->num_rounds));
+
+    _mm_storeu_si128((__m128i *)output, state);
+}
+
+/*******************************************************************************
+ * AES encryption of several independent blocks using AESENC.
+ * Each round key is loaded once & applied to AES_BATCH_BLOCKS blocks.
+ *
+ * inputs:
+ * - input - The blocks to encrypt. num_blocks * 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted blocks.
+ * - num_blocks - The number of blocks.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+AES_AESNI_TARGET
+void aes_aesni_encrypt_blocks(
+    const unsigned char *input, const aes_context_t *ctx,
+    unsigned char *output, size_t num_blocks)
+{
+    const __m128i *round_keys = (const __m128i *)ctx->round_keys;
+    __m128i state[AES_BATCH_BLOCKS];
+    __m128i key;
+    int i, j;
+
+    while (num_blocks >= AES_BATCH_BLOCKS)
+    {
+        /* Initial round key */
+        key = _mm_loadu_si128(round_keys);
+        for (j = 0; j < AES_BATCH_BLOCKS; j++)
+        {
+            state[j] = _mm_xor_si128(
+                _mm_loadu_si128((const __m128i *)input + j), key);
+        }
+
+        /* Middle rounds */
+        for (i = 1; i < ctx->num_rounds; i++)
+        {
+            key = _mm_loadu_si128(round_keys + i);
+            for (j = 0; j < AES_BATCH_BLOCKS; j++)
+            {
+                state[j] = _mm_aesenc_si128(state[j], key);
+            }
+        }
+
+        /* Final round(no MixColumns) */
+        key = _mm_loadu_si128(round_keys + ctx->num_rounds);
+        for (j = 0; j < AES_BATCH_BLOCKS; j++)
+        {
+            _mm_storeu_si128((__m128i *)output + j,
+                _mm_aesenclast_si128(state[j], key));
+        }
+
+        input += AES_BATCH_BLOCKS * 16;
+        output += AES_BATCH_BLOCKS * 16;
+        num_blocks -= AES_BATCH_BLOCKS;
+    }
+
+    /* Remaining blocks one at a time */
+    while (num_blocks > 0)
+    {
+        aes_aesni_encrypt_block(input, ctx, output);
+        input += 16;
+        output += 16;
+        num_blocks--;
+    }
+}
+
+/*******************************************************************************
+ * AES decryption of a single block using AESDEC.
+ * AESDEC implements the equivalent inverse cipher.
+ *
+ * inputs:
+ * - input - The input to decrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the decrypted data.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+AES_AESNI_TARGET
+void aes_aesni_decrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output)
+{
+    const __m128i *round_keys = (const __m128i *)ctx->inv_round_keys;
+    __m128i state = _mm_loadu_si128((const __m128i *)input);
+    int i;
+
+    /* Initial round key, middle rounds & final round(no InvMixColumns) */
+    state = _mm_xor_si128(state, _mm_loadu_si128(round_keys));
+    for (i = 1; i < ctx->num_rounds; i++)
+    {
+        state = _mm_aesdec_si128(state, _mm_loadu_si128(round_keys + i));
+    }
+    state = _mm_aesdeclast_si128(
+        state, _mm_loadu_si128(round_keys + ctx->num_rounds));
+
+    _mm_storeu_si128((__m128i *)output, state);
+}
+
+#else
+
+/* AES-NI is not compiled in. The portable code is always used. */
+
+int aes_aesni_available(void)
+{
+    return 0;
+}
+
+void aes_aesni_key_expansion(aes_context_t *ctx, const unsigned char *key)
+{
+    key_expansion_into(key, ctx->key_size, ctx->round_keys);
+}
+
+void aes_aesni_encrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output)
+{
+    aes_ttable_encrypt_block(input, ctx, output);
+}
+
+void aes_aesni_decrypt_block(
+    const unsigned char *input, const aes_context_t *ctx, unsigned char *output)
+{
+    aes_ttable_decrypt_block(input, ctx, output);
+}
+
+void aes_aesni_encrypt_blocks(
+    const unsigned char *input, const aes_context_t *ctx,
+    unsigned char *output, size_t num_blocks)
+{
+    aes_ttable_encrypt_blocks(input, ctx, output, num_blocks);
+}
+
+#endif
@@ -7,6 +7,11 @@
 #include "encryption/aes/keyschedule.h"
 #include "encryption/aes/operations.h"
 #include "encryption/aes/maths/gf.h"
+#include "encryption/aes/ttable.h"
+#include "encryption/aes/aesni.h"
+
+/* Backend in use. -1 until the first call to aes_get_backend(). */
+int aes_selected_backend = -1;
 
 
 /*******************************************************************************
@@ -58,36 +63,190 @@ void convert_to_byte_array(byte state[4][4], unsigned char *output)
 }
 
 /*******************************************************************************
- * AES encryption function.
+ * Gets the AES backend in use.
+ * On first use the backend is chosen from the AES_BACKEND environment
+ * variable("portable" or "aesni"). Otherwise AES-NI is used when the CPU
+ * supports it.
  *
  * inputs:
- * - input - The input to encrypt. Must be 16 bytes long.
- * - key - The 128, 192, or 256 bit key to use for encryption.
+ * - None.
+ * outputs:
+ * - AES_BACKEND_PORTABLE or AES_BACKEND_AESNI.
+*******************************************************************************/
+int aes_get_backend(void)
+{
+    /* Choose the backend the first time */
+    if (aes_selected_backend == -1)
+    {
+        const char *requested = getenv("AES_BACKEND");
+
+        /* Default to AES-NI when the CPU supports it */
+        aes_selected_backend = aes_aesni_available()
+            ? AES_BACKEND_AESNI : AES_BACKEND_PORTABLE;
+
+        /* The environment variable can force either backend */
+        if (requested != NULL && strcmp(requested, "portable") == 0)
+        {
+            aes_selected_backend = AES_BACKEND_PORTABLE;
+        }
+        else if (requested != NULL && strcmp(requested, "aesni") == 0 &&
+            aes_set_backend(AES_BACKEND_AESNI) != 0)
+        {
+            printf("[WARNING] AES-NI is not supported, using portable AES\n");
+        }
+    }
+
+    return aes_selected_backend;
+}
+
+/*******************************************************************************
+ * Forces the given AES backend to be used.
+ *
+ * inputs:
+ * - backend - AES_BACKEND_PORTABLE or AES_BACKEND_AESNI.
+ * outputs:
+ * - 0 if the backend is now in use, 1 if it is not supported.
+*******************************************************************************/
+int aes_set_backend(int backend)
+{
+    /* AES-NI can only be used if the CPU supports it */
+    if (backend == AES_BACKEND_AESNI && !aes_aesni_available())
+    {
+        return 1;
+    }
+
+    /* Only known backends can be used */
+    if (backend != AES_BACKEND_AESNI && backend != AES_BACKEND_PORTABLE)
+    {
+        return 1;
+    }
+
+    aes_selected_backend = backend;
+    return 0;
+}
+
+/*******************************************************************************
+ * Generates the equivalent inverse cipher round keys from the cipher round
+ * keys. InvMixColumns(w) is done with the T-tables:
+ *   InvMixColumns(w) = td0[S(w0)] ⊕ td1[S(w1)] ⊕ td2[S(w2)] ⊕ td3[S(w3)]
+ * since each td table already applies InvSubBytes.
+ *
+ * inputs:
+ * - ctx - The context. round_keys & num_rounds must already be set.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_context_inverse_keys(aes_context_t *ctx)
+{
+    /* Declare variables */
+    int i, col;
+
+    /* The inverse cipher uses the round keys in reverse order.
+     * First & last round keys are used as is.
+     */
+    memcpy(ctx->inv_round_keys,
+        ctx->round_keys + (ctx->num_rounds * 16), 16);
+    memcpy(ctx->inv_round_keys + (ctx->num_rounds * 16),
+        ctx->round_keys, 16);
+
+    /* Middle round keys have InvMixColumns applied.
+     * Lets decryption use the same round order as encryption.
+     */
+    for (i = 1; i < ctx->num_rounds; i++)
+    {
+        const byte *key = ctx->round_keys + ((ctx->num_rounds - i) * 16);
+        byte *inv_key = ctx->inv_round_keys + (i * 16);
+
+        for (col = 0; col < 4; col++)
+        {
+            const byte *word = key + (col * 4);
+            uint32_t mixed = aes_td0[sbox_table[word[0]]] ^
+                aes_td1[sbox_table[word[1]]] ^
+                aes_td2[sbox_table[word[2]]] ^
+                aes_td3[sbox_table[word[3]]];
+
+            inv_key[col * 4] = (byte)(mixed >> 24);
+            inv_key[col * 4 + 1] = (byte)(mixed >> 16);
+            inv_key[col * 4 + 2] = (byte)(mixed >> 8);
+            inv_key[col * 4 + 3] = (byte)mixed;
+        }
+    }
+}
+
+/*******************************************************************************
+ * Expands the key into the given AES context.
+ * Only needs to be called once per key.
+ *
+ * inputs:
+ * - ctx - The context to initialize.
+ * - key - The 128, 192, or 256 bit key.
  * - key_size - The size of the key.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_context_init(aes_context_t *ctx, const byte *key, int key_size)
+{
+    /* Declare variables */
+    int i;
+
+    /* 10/12/14 rounds for 128/192/256 bit keys */
+    ctx->key_size = key_size;
+    ctx->num_rounds = (key_size / 4) + 6;
+
+    /* Generate the round keys for the cipher & the inverse cipher. */
+    if (aes_get_backend() == AES_BACKEND_AESNI)
+    {
+        aes_aesni_key_expansion(ctx, key);
+    }
+    else
+    {
+        key_expansion_into(key, key_size, ctx->round_keys);
+        aes_context_inverse_keys(ctx);
+    }
+
+    /* Store the round keys as words for the T-table round engine
+     * Done for every backend so the context works with all of them.
+     */
+    for (i = 0; i < (ctx->num_rounds + 1) * 4; i++)
+    {
+        const byte *word = ctx->round_keys + (i * 4);
+        const byte *inv_word = ctx->inv_round_keys + (i * 4);
+
+        ctx->round_words[i] = ((uint32_t)word[0] << 24) |
+            ((uint32_t)word[1] << 16) | ((uint32_t)word[2] << 8) | word[3];
+        ctx->inv_round_words[i] = ((uint32_t)inv_word[0] << 24) |
+            ((uint32_t)inv_word[1] << 16) | ((uint32_t)inv_word[2] << 8) |
+            inv_word[3];
+    }
+}
+
+/*******************************************************************************
+ * AES encryption using the reference round engine.
+ *
+ * inputs:
+ * - input - The input to encrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
  * - output - The output to store the encrypted data.
  * outputs:
  * - None.
 *******************************************************************************/
-void aes_encrypt_block(const byte *input, const byte *key, int key_size, byte *output)
+void aes_reference_encrypt_block(const byte *input, const aes_context_t *ctx, byte *output)
 {
     /* Declare variables */
     int i;
     byte input_state[4][4];
 
-    /* Get the keys for each round. */
-    roundKeys_t *round_keys = key_expansion(key, key_size);
-
     /* Convert the input to a state matrix. */
     convert_bytes_to_state_matrix(input, input_state);
 
     /* Add the initial round key to the input. */
-    add_round_key(input_state, round_keys->keys);
+    add_round_key(input_state, ctx->round_keys);
 
     /* Loop based on the number of rounds
      * Number of rounds depends on the key size.
      * 10/12/14 rounds for 128/192/256 bit keys.
      */
-    for (i = 1; i < round_keys->count; i++)
+    for (i = 1; i <= ctx->num_rounds; i++)
     {
         /* SubBytes transformation. */
         sub_bytes(input_state);
@@ -96,74 +255,203 @@ void aes_encrypt_block(const byte *input, const byte *key, int key_size, byte *o
         shift_rows(input_state);
 
         /* If this is not the last round, mix the columns. */
-        if (i != round_keys->count - 1)
+        if (i != ctx->num_rounds)
         {
             /* MixColumns transformation. */
             mix_columns(input_state);
         }
 
         /* Add the current round key. */
-        add_round_key(input_state, round_keys->keys + (i * 16));
+        add_round_key(input_state, ctx->round_keys + (i * 16));
     }
 
-    /* Free the round keys. */
-    free(round_keys->keys);
-    free(round_keys);
-
     /* Convert the output state matrix to a byte array. */
     convert_to_byte_array(input_state, output);
 }
 
 /*******************************************************************************
- * AES decryption function. TODO
+ * AES decryption using the reference round engine.
+ * Implements the equivalent inverse cipher from FIPS-197.
  *
  * inputs:
  * - input - The input to decrypt. Must be 16 bytes long.
- * - key - The 128, 192, or 256 bit key to use for decryption.
+ * - ctx - The expanded key created by aes_context_init().
  * - output - The output to store the decrypted data.
  * outputs:
  * - None.
 *******************************************************************************/
-void aes_decrypt_block(const byte *input, const byte *key, int key_size, byte *output)
+void aes_reference_decrypt_block(const byte *input, const aes_context_t *ctx, byte *output)
 {
     /* Declare variables */
     int i;
     byte input_state[4][4];
 
-    /* Get the keys for each round. */
-    roundKeys_t *round_keys = key_expansion(key, key_size);
-
     /* Convert the input to a state matrix. */
     convert_bytes_to_state_matrix(input, input_state);
 
     /* Add the initial round key to the input. */
-    /* Use the last round key. */
-    add_round_key(input_state, round_keys->keys + ((round_keys->count - 1) * 16));
+    add_round_key(input_state, ctx->inv_round_keys);
 
     /***** Other rounds *****/
-    for (i = round_keys->count - 2; i >= 0; i--) {
-
-        /* InvShiftRows transformation. */
-        inv_shift_rows(input_state);   
-
+    for (i = 1; i <= ctx->num_rounds; i++)
+    {
         /* InvSubBytes transformation. */
         inv_sub_bytes(input_state);
 
-        /* Add the current round key to the input. */
-        const unsigned char *current_round_key = round_keys->keys + (i * 16);
-        add_round_key(input_state, current_round_key);
+        /* InvShiftRows transformation. */
+        inv_shift_rows(input_state);
 
         /* If this is not the last round, mix the columns. */
-        if (i != 0) {
+        if (i != ctx->num_rounds)
+        {
             /* InvMixColumns transformation. */
             inv_mix_columns(input_state);
         }
-    }
 
-    /* Free the round keys. */
-    free(round_keys->keys);
-    free(round_keys);
+        /* Add the current round key. */
+        add_round_key(input_state, ctx->inv_round_keys + (i * 16));
+    }
 
     /* Convert the output state matrix to a byte array. */
     convert_to_byte_array(input_state, output);
 }
+
+/*******************************************************************************
+ * AES encryption using an already expanded key.
+ * Uses AES-NI if selected, otherwise the round engine chosen at build
+ * time(AES_TTABLES).
+ *
+ * inputs:
+ * - input - The input to encrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted data.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_encrypt_block_ctx(const byte *input, const aes_context_t *ctx, byte *output)
+{
+    /* Use the AES instructions if selected */
+    if (aes_get_backend() == AES_BACKEND_AESNI)
+    {
+        aes_aesni_encrypt_block(input, ctx, output);
+        return;
+    }
+
+#ifdef AES_TTABLES
+    aes_ttable_encrypt_block(input, ctx, output);
+#else
+    aes_reference_encrypt_block(input, ctx, output);
+#endif
+}
+
+/*******************************************************************************
+ * AES encryption of several independent blocks using an already expanded
+ * key.
+ * Uses AES-NI if selected, otherwise the round engine chosen at build
+ * time(AES_TTABLES).
+ *
+ * inputs:
+ * - input - The blocks to encrypt. num_blocks * 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the encrypted blocks.
+ * - num_blocks - The number of blocks.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_encrypt_blocks_ctx(
+    const byte *input, const aes_context_t *ctx, byte *output,
+    size_t num_blocks)
+{
+    /* Use the AES instructions if selected */
+    if (aes_get_backend() == AES_BACKEND_AESNI)
+    {
+        aes_aesni_encrypt_blocks(input, ctx, output, num_blocks);
+        return;
+    }
+
+#ifdef AES_TTABLES
+    aes_ttable_encrypt_blocks(input, ctx, output, num_blocks);
+#else
+    /* The reference engine has no batched version */
+    while (num_blocks > 0)
+    {
+        aes_reference_encrypt_block(input, ctx, output);
+        input += 16;
+        output += 16;
+        num_blocks--;
+    }
+#endif
+}
+
+/*******************************************************************************
+ * AES decryption using an already expanded key.
+ * Uses AES-NI if selected, otherwise the round engine chosen at build
+ * time(AES_TTABLES).
+ *
+ * inputs:
+ * - input - The input to decrypt. Must be 16 bytes long.
+ * - ctx - The expanded key created by aes_context_init().
+ * - output - The output to store the decrypted data.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_decrypt_block_ctx(const byte *input, const aes_context_t *ctx, byte *output)
+{
+    /* Use the AES instructions if selected */
+    if (aes_get_backend() == AES_BACKEND_AESNI)
+    {
+        aes_aesni_decrypt_block(input, ctx, output);
+        return;
+    }
+
+#ifdef AES_TTABLES
+    aes_ttable_decrypt_block(input, ctx, output);
+#else
+    aes_reference_decrypt_block(input, ctx, output);
+#endif
+}
+
+/*******************************************************************************
+ * AES encryption function.
+ * Expands the key on every call. Prefer aes_encrypt_block_ctx() when
+ * encrypting more than one block with the same key.
+ *
+ * inputs:
+ * - input - The input to encrypt. Must be 16 bytes long.
+ * - key - The 128, 192, or 256 bit key to use for encryption.
+ * - key_size - The size of the key.
+ * - output - The output to store the encrypted data.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_encrypt_block(const byte *input, const byte *key, int key_size, byte *output)
+{
+    /* Expand the key on the stack. */
+    aes_context_t ctx;
+    aes_context_init(&ctx, key, key_size);
+
+    /* Encrypt the block. */
+    aes_encrypt_block_ctx(input, &ctx, output);
+}
+
+/*******************************************************************************
+ * AES decryption function.
+ * Expands the key on every call. Prefer aes_decrypt_block_ctx() when
+ * decrypting more than one block with the same key.
+ *
+ * inputs:
+ * - input - The input to decrypt. Must be 16 bytes long.
+ * - key - The 128, 192, or 256 bit key to use for decryption.
+ * - output - The output to store the decrypted data.
+ * outputs:
+ * - None.
+*******************************************************************************/
+void aes_decrypt_block(const byte *input, const byte *key, int key_size, byte *output)
+{
+    /* Expand the key on the stack. */
+    aes_context_t ctx;
+    aes_context_init(&ctx, key, key_size);
+
+    /* Decrypt the block. */
+    aes_decrypt_block_ctx(input, &ctx, output);
+}
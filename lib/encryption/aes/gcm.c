@@ -1,60 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <math.h>
+
+#ifdef AES_GCM_PTHREADS
+#include <pthread.h>
+#endif
 
 #include "utils/random.h"
 #include "encryption/aes/core.h"
 #include "encryption/aes/keyschedule.h"
 #include "encryption/aes/operations.h"
 #include "encryption/aes/gcm.h"
+#include "encryption/aes/ghash.h"
 #include "encryption/encryption.h"
 
 
-/* Context needed during GCM encryption */
-struct aes_gcm_context
-{
-    /*** Input/Outputs ***/
-    /* The nonce */
-    unsigned char nonce[12];
-
-    /* Holds the AAD(Additional Authentication Data) & its length */
-    const unsigned char *aad;
-    int aad_length;
-
-    /* Holds the key & its size */
-    const unsigned char *key;
-    int key_size;
-
-    /*** Internal Variables ***/
-
-    /* The counter block */
-    unsigned char counter_block[16];
-
-    /* The number of blocks needed for the plaintext */
-    /* int num_blocks_input; */
-
-    /* The number of blocks needed for the AAD */
-    /* int num_blocks_aad; */
+/* Bytes encrypted before their GHASH is computed.
+ * Small enough to still be in cache when GHASH reads it back.
+ * A multiple of 64 so the CLMUL GHASH can use its 4 block path.
+ */
+#define AES_GCM_CHUNK_SIZE 256
 
-    /* Holds the bytes processed */
-    int bytes_processed;
+/* Smallest amount of data(in bytes) worth giving to a thread */
+#define AES_GCM_PARALLEL_MIN_SIZE (64 * 1024)
 
-    /* Holds the hash subkey
-    * Used in GHASH calculations.
-    */
-    unsigned char hash_subkey[16];
+/* Number of threads AES-GCM may use. 0 until aes_gcm_get_threads(). */
+int aes_gcm_num_threads = 0;
 
-    /* Holds the ghash */
-    unsigned char ghash[16];
+/* Identifies a chunked encrypted file */
+#define AES_GCM_FILE_MAGIC "AESGCMC1"
 
-    /* Holds y0 aka the first counter block encrypted with the key 
-    * Used in tag generation.
-    */
-    unsigned char y0[16];
+/* Magic followed by the chunk size */
+#define AES_GCM_FILE_HEADER_SIZE 12
 
-};
-typedef struct aes_gcm_context aes_gcm_context_t;
+/* Largest chunk size accepted from an encrypted file */
+#define AES_GCM_FILE_MAX_CHUNK_SIZE (64UL * 1024 * 1024)
 
 /*******************************************************************************
  * Generates a 12-byte random sequence of bytes.
@@ -75,198 +55,192 @@ unsigned char *aes_gcm_generate_nonce()
 }
 
 /*******************************************************************************
- * Initializes the GCM context for encryption.
- * Used if the caller does not want to provide a nonce.
+ * Increments the counter block.
  *
  * inputs:
- * - input - The input to transform. E.g. plaintext or ciphertext.
- * - input_size - The size of the input.
- * - key - The key to use for the transformation.
- * - key_size - The size of the key.
- * - nonce - The nonce to use for the transformation.
+ * - counter_block - The counter block to increment.
  *
  * outputs:
- * - The GCM context.
+ * - None.
  ******************************************************************************/
-aes_gcm_context_t *aes_gcm_context_init(
-    const unsigned char *key,
-    int key_size,
-    const unsigned char *aad,
-    int aad_length,
-    const unsigned char *nonce)
-{
-    /* Allocate memory for the context */
-    aes_gcm_context_t *ctx = (aes_gcm_context_t *)malloc(
-        sizeof(aes_gcm_context_t));
+void aes_gcm_increment_counter_block(unsigned char counter_block[16]) {
 
-    /* Set the bytes processed to 0 */
-    ctx->bytes_processed = 0;
+    /* Indicates whether to add 1 to the current byte
+     * By default, this is 1 to increment the rightmost byte.
+     */
+    int add_one = 1;
+
+    /* Iterate from the rightmost byte to the leftmost byte
+     * Only the last 4 bytes are considered.
+     */
+    int i;
+    for ( i = 15; i >= 12; i-- ) {
 
-    /* Set the key and its size */
-    ctx->key = key;
-    ctx->key_size = key_size;
-    /* Set the AAD & its length */
-    ctx->aad = aad;
-    ctx->aad_length = aad_length;
+        /* If 1 should be added to the current byte */
+        if ( add_one == 1 ) {
 
-    /* Initialize the hash subkey 
-    * The hash subkey is an 16 byte block of 0s encrypted with the key.
-    */
-    memset(ctx->hash_subkey, 0, 16);
-    aes_encrypt_block(ctx->hash_subkey, ctx->key, ctx->key_size, ctx->hash_subkey);
+            /* If the leftmost byte is at its max value(255) */
+            if ( i == 12 && counter_block[12] == 0xFF ) {
+                /* Exit with an error to prevent overflow */
+                /* Source: https://crypto.stackexchange.com/a/31798 */
+                printf("[ERROR] Counter block is at its max value\n");
+                exit(1);
 
-    /* Add the nonce to this context */
-    memcpy(ctx->nonce, nonce, 12);
+            /* If any other byte is at its max value(255) */
+            } else if (counter_block[i] == 0xFF ) {
 
-    /* Initialize the counter block which is 16 bytes long
-    * The first 12 bytes of the counter block are the nonce.
-    * The last 4 bytes of the counter block are 0x00000001.
-    */
-    memcpy(ctx->counter_block, nonce, 12); 
-    ctx->counter_block[12] = 0x00;
-    ctx->counter_block[13] = 0x00;
-    ctx->counter_block[14] = 0x00;
-    ctx->counter_block[15] = 0x01;
+                /* Reset the byte back to 0 */
+                counter_block[i] = 0;
 
-    /* Encrypt the counter block to get y0
-    * This is needed to generate the tag.
-    */
-    aes_encrypt_block(ctx->counter_block, ctx->key, ctx->key_size, ctx->y0);
+                /* Set the next byte to be incremented */
+                add_one = 1;
+       
+            } else {
+                /* Increment the current byte by 1 */
+                counter_block[i] += 1;
 
-    /* Return the context */
-    return ctx;
+                /* Exit the loop since the increment is complete */
+                break;
+            }
+        }
+    }
 }
 
 /*******************************************************************************
- * Determines the number of blocks needed for the given input.
+ * Moves to the next counter block & generates its keystream block.
  *
  * inputs:
- * - input_size - The size of the input.
+ * - aes - The expanded key.
+ * - counter_block - The counter block. Incremented in place.
+ * - keystream_block - Where to write the keystream block.
  *
  * outputs:
- * - The number of blocks needed to process the input.
+ * - None.
  ******************************************************************************/
-int determine_num_blocks(int input_size) {
-    return (int) ceil((float) input_size / 16);
+void aes_gcm_next_keystream(
+    const aes_context_t *aes,
+    unsigned char counter_block[16],
+    unsigned char keystream_block[16]
+) {
+    /* Counter block 1 is the first used for data.
+    * Counter block 0(E(K,Y0)) is reserved for the tag.
+    */
+    aes_gcm_increment_counter_block(counter_block);
+
+    /* Generate the keystream block */
+    aes_encrypt_block_ctx(counter_block, aes, keystream_block);
 }
 
 /*******************************************************************************
- * Generates the ciphertext/plaintext for the current block.
+ * XORs the input with the keystream.
+ * Works a machine word at a time. memcpy() copes with unaligned input &
+ * compiles to a single load/store. Only a final partial word is done a byte
+ * at a time.
  *
  * inputs:
- * - context - The context to use for the GCM encryption.
- * - input - The input to encrypt.
- * - input_length - The length of the input.
- * - output - The output to write the ciphertext/plaintext to.
+ * - input - The input.
+ * - keystream - The keystream.
+ * - length - The number of bytes.
+ * - output - Where to write the result. Can be the same as 'input'.
  *
  * outputs:
  * - None.
  ******************************************************************************/
-void aes_gcm_xor_input_with_keystream(
-    aes_gcm_context_t *ctx, 
+void aes_gcm_xor_keystream(
     const unsigned char *input,
-    int input_length,
-    unsigned char *keystream_block,
-    unsigned char *output
-    )
+    const unsigned char *keystream,
+    size_t length,
+    unsigned char *output)
 {
-  
-    /* Get the location to place the ciphertext/plaintext */
-    unsigned char *output_offset = output + ctx->bytes_processed;
-
-    /* Number of bytes to process */
-    /* By default, assume there are 16 bytes to process */
-    int bytes_to_process = 16;
-
-    /* If there are not 16 bytes remaining */
-    if (ctx->bytes_processed + 16 > input_length) {
-        bytes_to_process = input_length - ctx->bytes_processed;
+    unsigned long word, key_word;
+    size_t i;
+
+    for (i = 0; i + sizeof(word) <= length; i += sizeof(word)) {
+        memcpy(&word, input + i, sizeof(word));
+        memcpy(&key_word, keystream + i, sizeof(key_word));
+        word ^= key_word;
+        memcpy(output + i, &word, sizeof(word));
     }
 
-    /* Process the remaining bytes */
-    int i;
-    for (i = 0; i < bytes_to_process; i++)
-    {
-        /* XOR the plaintext with the keystream */
-        output_offset[i] = input[i] ^ keystream_block[i];
+    for (; i < length; i++) {
+        output[i] = input[i] ^ keystream[i];
     }
-    /* Update the bytes processed */
-    ctx->bytes_processed += bytes_to_process;
-}
-
-/*******************************************************************************
- * Generates the keystream block for the GCM encryption.
- * This updates every block.
- * 
- * inputs:
- * - ctx - The context to use for the GCM encryption.
- *
- * outputs:
- * - None.
- ******************************************************************************/
-void aes_gcm_create_keystream(
-    aes_gcm_context_t *ctx,
-    unsigned char *keystream_block
-) {
-
-    /* Generate the keystream block */
-    aes_encrypt_block(
-        ctx->counter_block,
-        ctx->key,
-        ctx->key_size,
-        keystream_block
-    );
 }
 
 /*******************************************************************************
- * Increments the counter block.
+ * Encrypts/decrypts whole blocks & absorbs the ciphertext into a GHASH.
+ * Blocks are processed AES_GCM_CHUNK_SIZE bytes at a time. Each chunk is
+ * encrypted then hashed while it is still in cache, so the data is only
+ * read from memory once.
+ * The counter blocks of a chunk are encrypted AES_BATCH_BLOCKS at a time so
+ * the AES rounds of different blocks overlap.
  *
  * inputs:
- * - ctx - The context to use for the GCM encryption.
+ * - ctx - The GCM context. Only the key, GHASH key & mode are used.
+ * - counter_block - The counter block before the first block. Updated in
+ *                   place.
+ * - ghash - The running GHASH. Updated in place.
+ * - input - The input. Must be a multiple of 16 bytes.
+ * - length - The length of the input.
+ * - output - Where to write the result. Can be the same as 'input'.
  *
  * outputs:
  * - None.
  ******************************************************************************/
-void aes_gcm_increment_counter_block(aes_gcm_context_t *ctx) {
-
-    /* Indicates whether to add 1 to the current byte
-     * By default, this is 1 to increment the rightmost byte.
-     */
-    int add_one = 1;
+void aes_gcm_process_blocks(
+    const aes_gcm_context_t *ctx,
+    unsigned char counter_block[16],
+    unsigned char ghash[16],
+    const unsigned char *input,
+    size_t length,
+    unsigned char *output)
+{
+    unsigned char counters[AES_BATCH_BLOCKS * 16];
+    unsigned char keystream[AES_BATCH_BLOCKS * 16];
+    size_t i, batch, b;
 
-    /* Iterate from the rightmost byte to the leftmost byte
-     * Only the last 4 bytes are considered.
-     */
-    int i;
-    for ( i = 15; i >= 12; i-- ) {
+    while (length > 0) {
 
-        /* If 1 should be added to the current byte */
-        if ( add_one == 1 ) {
+        /* Size of this chunk */
+        size_t chunk = length;
+        if (chunk > AES_GCM_CHUNK_SIZE) {
+            chunk = AES_GCM_CHUNK_SIZE;
+        }
 
-            /* If the leftmost byte is at its max value(255) */
-            if ( i == 12 && ctx->counter_block[12] == 0xFF ) {
-                /* Exit with an error to prevent overflow */
-                /* Source: https://crypto.stackexchange.com/a/31798 */
-                printf("[ERROR] Counter block is at its max value\n");
-                exit(1);
+        /* Ciphertext is the input when decrypting.
+        * Hashed first in case the output overwrites it.
+        */
+        if (ctx->mode == AES_GCM_DECRYPT) {
+            ghash_update(&ctx->ghash_key, ghash, input, chunk);
+        }
 
-            /* If any other byte is at its max value(255) */
-            } else if (ctx->counter_block[i] == 0xFF ) {
+        /* XOR each batch of blocks with its keystream */
+        for (i = 0; i < chunk; i += batch) {
+            batch = chunk - i;
+            if (batch > sizeof(counters)) {
+                batch = sizeof(counters);
+            }
 
-                /* Reset the byte back to 0 */
-                ctx->counter_block[i] = 0;
+            /* Counter block 1 is the first used for data.
+            * Counter block 0(E(K,Y0)) is reserved for the tag.
+            */
+            for (b = 0; b < batch; b += 16) {
+                aes_gcm_increment_counter_block(counter_block);
+                memcpy(counters + b, counter_block, 16);
+            }
 
-                /* Set the next byte to be incremented */
-                add_one = 1;
-       
-            } else {
-                /* Increment the current byte by 1 */
-                ctx->counter_block[i] += 1;
+            aes_encrypt_blocks_ctx(counters, &ctx->aes, keystream, batch / 16);
+            aes_gcm_xor_keystream(input + i, keystream, batch, output + i);
+        }
 
-                /* Exit the loop since the increment is complete */
-                break;
-            }
+        /* Ciphertext is the output when encrypting */
+        if (ctx->mode == AES_GCM_ENCRYPT) {
+            ghash_update(&ctx->ghash_key, ghash, output, chunk);
         }
+
+        input += chunk;
+        output += chunk;
+        length -= chunk;
     }
 }
 
@@ -282,15 +256,14 @@ void aes_gcm_increment_counter_block(aes_gcm_context_t *ctx) {
  */
 void aes_gcm_calculate_length_block(
     const aes_gcm_context_t *ctx,
-    int ciphertext_length,
     unsigned char length_block[16]
 ) {
 
     /* Length of associated data in bits */
-    unsigned long long len_a = (unsigned long long)ctx->aad_length * 8;
+    unsigned long long len_a = ctx->aad_length * 8;
     
     /* Length of ciphertext in bits */
-    unsigned long long len_c = (unsigned long long)ciphertext_length * 8;  
+    unsigned long long len_c = ctx->text_length * 8;
 
     /* Calculate len(A)||len(C) where:
      * len(A) = length of associated data in bits
@@ -309,91 +282,22 @@ void aes_gcm_calculate_length_block(
     }
 }
 
-void aes_gcm_update_ghash(
-    aes_gcm_context_t *ctx, 
-    const unsigned char *block, 
-    int block_size) {
-    
-    int i;
-
-    /* XOR the block with the current GHASH value */
-    for (i = 0; i < block_size; i++) {
-        ctx->ghash[i] ^= block[i];
-    }
-
-    /* Perform GF multiplication: xᵢ = (xᵢ₋₁ ⊕ Cᵢ) • H 
-    * Cᵢ = encrypted version of the ith block of plaintext.
-    * H = hash subkey.
-    */
-    gf_multiply_2_128(
-        ctx->ghash, ctx->hash_subkey, ctx->ghash
-    );
-}
-
-void b(
-    aes_gcm_context_t *ctx, 
-    const unsigned char *ciphertext, int ciphertext_length,
-    int num_blocks_ciphertext, int num_blocks_aad
-    ) {
-    /* Initialize GHASH to zero */
-    memset(ctx->ghash, 0, 16);
-
-    int i;
-    /* First process AAD blocks */
-    for (i = 0; i < num_blocks_aad; i++) {
-
-        /* Pointer to the current block's AAD */
-        const unsigned char *current_aad_block = ctx->aad 
-            + (i * 16);
-
-        /* Calculate how many bytes to process */
-        int bytes_to_process = 16;
-        if (i == num_blocks_aad - 1) {
-            bytes_to_process = ctx->aad_length - (i * 16);
-        }
-
-        /* Update the GHASH */
-        aes_gcm_update_ghash(ctx, current_aad_block, bytes_to_process);
-    }
-
-    /* Then process ciphertext blocks */
-    for (i = 0; i < num_blocks_ciphertext; i++) {
-
-        /* Pointer to the current block's ciphertext */
-        const unsigned char *current_ciphertext = ciphertext + (i * 16);
-
-        /* Calculate how many bytes to process */
-        int bytes_to_process = 16;
-        if (i == num_blocks_ciphertext - 1) {
-            bytes_to_process = ciphertext_length - (i * 16);
-        }
-
-        /* Update the GHASH */
-        aes_gcm_update_ghash(ctx, current_ciphertext, bytes_to_process);
-    }
-
-    /* Finally process length block */
-    unsigned char length_block[16] = {0};
-    aes_gcm_calculate_length_block(ctx, ciphertext_length, length_block);
-    
-    /* Update the GHASH */
-    aes_gcm_update_ghash(ctx, length_block, 16);
-}
-
-
-void aes_gcm_calculate_tag(
-    aes_gcm_context_t *ctx, 
-    const unsigned char *ciphertext, int ciphertext_length,
-    int num_blocks_ciphertext, int num_blocks_aad,
-    unsigned char tag[16]) {
-
-    /* Calculate the ghash needed for creating the tag */
-    b(ctx, ciphertext, ciphertext_length, num_blocks_ciphertext, num_blocks_aad);
+/*******************************************************************************
+ * Absorbs the bytes waiting in the GHASH buffer.
+ * The missing bytes of the block are treated as zeros.
+ *
+ * inputs:
+ * - ctx - The context to use for the AES-GCM encryption.
+ * - length - The number of bytes waiting in the buffer.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_flush_ghash_buffer(aes_gcm_context_t *ctx, int length) {
 
-    /* XOR the GHash with the nonce */
-    int i;
-    for (i = 0; i < 16; i++) {
-        tag[i] = ctx->ghash[i] ^ ctx->y0[i];
+    /* xᵢ = (xᵢ₋₁ ⊕ Cᵢ) • H */
+    if (length > 0) {
+        ghash_update(&ctx->ghash_key, ctx->ghash, ctx->ghash_buffer, length);
     }
 }
 
@@ -441,172 +345,517 @@ void debug_print(aes_gcm_context_t *ctx, int round) {
 #endif
 
 /*******************************************************************************
- * Encrypts the input using AES-GCM.
+ * Gets the number of threads AES-GCM may use.
+ * On first use this is read from the AES_GCM_THREADS environment variable.
+ * Defaults to 1.
  *
  * inputs:
- * - input - The input to encrypt.
- * - input_size - The size of the input.
- * - key - The key to use for the encryption.
- * - key_size - The size of the key.
- * - aad - The additional authentication data.
- * - aad_length - The length of the additional authentication data.
- * - nonce - The nonce. Must be 12 bytes.
+ * - None.
  *
  * outputs:
- * - The ciphertext.
+ * - The number of threads.
  ******************************************************************************/
-aes_gcm_data_t *aes_gcm_encrypt(
-    const unsigned char *plaintext, 
-    int plaintext_size, 
-    const unsigned char *key, 
-    int key_size,
-    const unsigned char *aad,
-    int aad_length,
-    const unsigned char *nonce) {
-
-    /* Get the number of blocks needed for the plaintext */
-    int num_blocks_plaintext = determine_num_blocks(plaintext_size);
-
-    /* Get the number of blocks needed for the AAD */
-    int num_blocks_aad = determine_num_blocks(aad_length);
-
-    /* Initialize the context needed for AES-GCM encryption */
-    aes_gcm_context_t *ctx = aes_gcm_context_init(
-        key, key_size, aad, aad_length, nonce
-    );
-
-    /* Allocate memory for the ciphertext */
-    int ciphertext_size = plaintext_size;
-    unsigned char *ciphertext = (unsigned char *)malloc(
-        ciphertext_size * sizeof(unsigned char));
+int aes_gcm_get_threads(void)
+{
+    /* Choose the thread count the first time */
+    if (aes_gcm_num_threads == 0) {
+        const char *requested = getenv("AES_GCM_THREADS");
 
-    /* Iterate through all the blocks */
-    int i; 
-    for (i = 0; i < num_blocks_plaintext; i++)
-    {
-        /* Increment the counter block */
-        /* Start at 1 because counter block 0(E(K,Y0)) is reserved for the nonce. */
-        aes_gcm_increment_counter_block(ctx);
-
-        /* Generate the keystream block for this block */
-        unsigned char keystream_block[16];
-        aes_gcm_create_keystream(ctx, keystream_block);
-
-        /* XOR the current plaintext block of 16 bytes with the keystream */
-        /* Creates the ciphertext for this plaintext block */
-        aes_gcm_xor_input_with_keystream(
-            ctx, 
-            plaintext + (i * 16), 
-            plaintext_size,
-            keystream_block,
-            ciphertext);
-
-        /* Debugging if needed */
-        #if defined(DEBUG) && DEBUG_LEVEL == 3
-            debug_print(ctx, i);
-        #endif
+        aes_gcm_num_threads = 1;
+        if (requested != NULL && aes_gcm_set_threads(atoi(requested)) != 0) {
+            printf("[WARNING] Invalid AES_GCM_THREADS, using 1 thread\n");
+        }
     }
-    
-    /* Calculate the tag */
-    unsigned char tag[16];
-    aes_gcm_calculate_tag(ctx, 
-        ciphertext, 
-        ciphertext_size,
-        num_blocks_plaintext, /* Plaintext is always same size as ciphertext */
-        num_blocks_aad,
-        tag
-    );
-
-    /* Debugging if needed */
-    #if defined(DEBUG) && DEBUG_LEVEL == 3
-        debug_print(ctx, i);
-    #endif
-
-    /* Free the memory allocated for the context */
-    free(ctx);
-
-    /* Create the output data */
-    aes_gcm_data_t *output = (aes_gcm_data_t *)malloc(
-        sizeof(aes_gcm_data_t));
-    output->output = ciphertext;
-    output->output_length = ciphertext_size;
 
-    /* Copy the tag to the output */
-    memcpy(output->tag, tag, 16);
-
-    /* Return the encrypted data */
-    return output;
+    return aes_gcm_num_threads;
 }
 
 /*******************************************************************************
- * Encrypts a file using AES-GCM.
+ * Sets the number of threads AES-GCM may use.
  *
  * inputs:
- * - plaintext_file - The file to encrypt.
- * - encrypted_file - The file to write the encrypted data to.
- * - key - The key to use for the encryption.
- * - key_size - The size of the key.
- * - aad - The additional authentication data.
- * - aad_length - The length of the additional authentication data.
- * - nonce - The nonce. Must be 12 bytes.
+ * - num_threads - Between 1 & AES_GCM_MAX_THREADS.
  *
  * outputs:
- * - None.
+ * - 0 if the thread count is now in use, 1 if it is not supported.
  ******************************************************************************/
-void aes_gcm_encrypt_file(
-    const char *plaintext_file,
-    const char *encrypted_file,
-    const unsigned char *key,
-    int key_size,
-    const unsigned char *aad,
-    int aad_length,
-    const unsigned char *nonce) {
-
-    /* Open the plaintext file */
-    FILE *plaintext_file_ptr = fopen(plaintext_file, "rb");
-    if (plaintext_file_ptr == NULL) {
-        printf("[ERROR] Failed to open plaintext file\n");
-        return;
+int aes_gcm_set_threads(int num_threads)
+{
+    /* Only a single thread without pthreads */
+#ifndef AES_GCM_PTHREADS
+    if (num_threads != 1) {
+        return 1;
     }
-    
-    /* Open the encrypted file */
-    FILE *encrypted_file_ptr = fopen(encrypted_file, "wb");
-    if (encrypted_file_ptr == NULL) {
-        printf("[ERROR] Failed to open encrypted file\n");
-        return;
+#endif
+
+    if (num_threads < 1 || num_threads > AES_GCM_MAX_THREADS) {
+        return 1;
     }
-    
-    /* Determine the size of the plaintext file */
-    fseek(plaintext_file_ptr, 0, SEEK_END);
-    int plaintext_size = ftell(plaintext_file_ptr);
-    fseek(plaintext_file_ptr, 0, SEEK_SET);
 
-    /* Read the plaintext file into memory */
-    unsigned char *plaintext = (unsigned char *)malloc(plaintext_size);
-    fread(plaintext, 1, plaintext_size, plaintext_file_ptr);
+    aes_gcm_num_threads = num_threads;
+    return 0;
+}
 
-    /* Encrypt the plaintext */
-    aes_gcm_data_t *encrypted_data = aes_gcm_encrypt(
-        plaintext, plaintext_size, key, key_size, aad, aad_length, nonce);
+#ifdef AES_GCM_PTHREADS
 
-    /* Write the authentication tag to the encrypted file */
-    fwrite(encrypted_data->tag, 1, 16, encrypted_file_ptr);
+/* A range of blocks processed by one thread */
+struct aes_gcm_worker
+{
+    /* Shared context. Only read. */
+    const aes_gcm_context_t *ctx;
 
-    /* Write the encrypted data to the encrypted file */
-    fwrite(encrypted_data->output, 1, encrypted_data->output_length, encrypted_file_ptr);
+    /* Counter block before the first block of the range */
+    unsigned char counter_block[16];
 
-    /* Free any memory allocated */
-    free(plaintext);
-    free(encrypted_data);
+    /* GHASH of the range alone(starting from zero) */
+    unsigned char ghash[16];
 
-    /* Close the files */
-    fclose(plaintext_file_ptr);
-    fclose(encrypted_file_ptr);
-}
+    /* The range */
+    const unsigned char *input;
+    size_t length;
+    unsigned char *output;
 
+    pthread_t thread;
+};
+typedef struct aes_gcm_worker aes_gcm_worker_t;
 
 /*******************************************************************************
- * Decrypts the input using AES-GCM.
+ * Processes the range of blocks given to a thread.
+ *
+ * inputs:
+ * - arg - The aes_gcm_worker_t of the thread.
+ *
+ * outputs:
+ * - NULL.
+ ******************************************************************************/
+void *aes_gcm_worker_run(void *arg)
+{
+    aes_gcm_worker_t *worker = (aes_gcm_worker_t *)arg;
+
+    aes_gcm_process_blocks(worker->ctx, worker->counter_block, worker->ghash,
+        worker->input, worker->length, worker->output);
+    return NULL;
+}
+
+/*******************************************************************************
+ * Encrypts/decrypts whole blocks using several threads.
+ * CTR mode lets each thread start at its own counter value. Each thread
+ * computes the GHASH of its range on its own. The results are combined in
+ * order using: GHASH(A || B) = GHASH(A) • H^blocks(B) ⊕ GHASH(B)
+ * The output & the GHASH are identical to the single-threaded path.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - input - The input. Must be a multiple of 16 bytes.
+ * - length - The length of the input.
+ * - output - Where to write the result. Can be the same as 'input'.
+ *
+ * outputs:
+ * - 0 if the input was processed, 1 if it should be processed by a single
+ *   thread instead.
+ ******************************************************************************/
+int aes_gcm_update_parallel(
+    aes_gcm_context_t *ctx,
+    const unsigned char *input,
+    size_t length,
+    unsigned char *output)
+{
+    aes_gcm_worker_t workers[AES_GCM_MAX_THREADS];
+    size_t num_blocks = length / 16;
+    size_t blocks_per_worker, offset;
+    unsigned long counter;
+    int num_workers, i, j;
+
+    /* Each thread needs enough work to be worth starting */
+    num_workers = aes_gcm_get_threads();
+    if ((size_t)num_workers > length / AES_GCM_PARALLEL_MIN_SIZE) {
+        num_workers = (int)(length / AES_GCM_PARALLEL_MIN_SIZE);
+    }
+    if (num_workers < 2) {
+        return 1;
+    }
+
+    /* The single-threaded path reports a counter overflow */
+    counter = ((unsigned long)ctx->counter_block[12] << 24) |
+        ((unsigned long)ctx->counter_block[13] << 16) |
+        ((unsigned long)ctx->counter_block[14] << 8) |
+        ctx->counter_block[15];
+    if (num_blocks > 0xFFFFFFFFUL - counter) {
+        return 1;
+    }
+
+    /* Split the blocks into one range per thread */
+    blocks_per_worker = (num_blocks + num_workers - 1) / num_workers;
+    offset = 0;
+    for (i = 0; i < num_workers; i++) {
+        size_t blocks = num_blocks - offset < blocks_per_worker
+            ? num_blocks - offset : blocks_per_worker;
+        unsigned long start = counter + offset;
+
+        workers[i].ctx = ctx;
+        memcpy(workers[i].counter_block, ctx->counter_block, 12);
+        workers[i].counter_block[12] = (unsigned char)(start >> 24);
+        workers[i].counter_block[13] = (unsigned char)(start >> 16);
+        workers[i].counter_block[14] = (unsigned char)(start >> 8);
+        workers[i].counter_block[15] = (unsigned char)start;
+        memset(workers[i].ghash, 0, 16);
+        workers[i].input = input + offset * 16;
+        workers[i].length = blocks * 16;
+        workers[i].output = output + offset * 16;
+
+        offset += blocks;
+    }
+
+    /* The calling thread takes the first range.
+    * A range is run here too if its thread cannot be started.
+    */
+    for (i = 1; i < num_workers; i++) {
+        if (pthread_create(&workers[i].thread, NULL,
+                aes_gcm_worker_run, &workers[i]) != 0) {
+            workers[i].ctx = NULL;
+        }
+    }
+    aes_gcm_worker_run(&workers[0]);
+    for (i = 1; i < num_workers; i++) {
+        if (workers[i].ctx == NULL) {
+            workers[i].ctx = ctx;
+            aes_gcm_worker_run(&workers[i]);
+        } else {
+            pthread_join(workers[i].thread, NULL);
+        }
+    }
+
+    /* Combine the GHASH of each range in order */
+    for (i = 0; i < num_workers; i++) {
+        ghash_multiply_h_power(
+            &ctx->ghash_key, ctx->ghash, workers[i].length / 16);
+        for (j = 0; j < 16; j++) {
+            ctx->ghash[j] ^= workers[i].ghash[j];
+        }
+    }
+
+    /* Continue from the counter after the last range */
+    memcpy(ctx->counter_block, workers[num_workers - 1].counter_block, 16);
+    return 0;
+}
+
+#else
+
+int aes_gcm_update_parallel(
+    aes_gcm_context_t *ctx,
+    const unsigned char *input,
+    size_t length,
+    unsigned char *output)
+{
+    return 1;
+}
+
+#endif
+
+/*******************************************************************************
+ * Starts a streaming AES-GCM encryption/decryption.
+ *
+ * inputs:
+ * - ctx - The context to initialize.
+ * - key - The key to use.
+ * - key_size - The size of the key.
+ * - nonce - The nonce. Must be 12 bytes.
+ * - mode - AES_GCM_ENCRYPT or AES_GCM_DECRYPT.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_init(
+    aes_gcm_context_t *ctx,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *nonce,
+    int mode)
+{
+    ctx->mode = mode;
+
+    /* Expand the key once for the whole message */
+    aes_context_init(&ctx->aes, key, key_size);
+
+    /* Initialize the hash subkey 
+    * The hash subkey is an 16 byte block of 0s encrypted with the key.
+    */
+    memset(ctx->hash_subkey, 0, 16);
+    aes_encrypt_block_ctx(ctx->hash_subkey, &ctx->aes, ctx->hash_subkey);
+    ghash_key_init(&ctx->ghash_key, ctx->hash_subkey);
+
+    /* Initialize the counter block which is 16 bytes long
+    * The first 12 bytes of the counter block are the nonce.
+    * The last 4 bytes of the counter block are 0x00000001.
+    */
+    memcpy(ctx->counter_block, nonce, 12); 
+    ctx->counter_block[12] = 0x00;
+    ctx->counter_block[13] = 0x00;
+    ctx->counter_block[14] = 0x00;
+    ctx->counter_block[15] = 0x01;
+
+    /* Encrypt the counter block to get y0
+    * This is needed to generate the tag.
+    */
+    aes_encrypt_block_ctx(ctx->counter_block, &ctx->aes, ctx->y0);
+
+    /* Nothing processed yet */
+    memset(ctx->ghash, 0, 16);
+    ctx->aad_length = 0;
+    ctx->text_length = 0;
+    ctx->aad_finished = 0;
+
+    /* Debugging if needed */
+    #if defined(DEBUG) && DEBUG_LEVEL == 3
+        debug_print(ctx, 0);
+    #endif
+}
+
+/*******************************************************************************
+ * Adds AAD(additional authentication data) to a streaming operation.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - aad - The AAD.
+ * - aad_length - The length of the AAD.
+ *
+ * outputs:
+ * - 0 if the AAD was added, 1 if aes_gcm_update() was already called.
+ ******************************************************************************/
+int aes_gcm_update_aad(
+    aes_gcm_context_t *ctx,
+    const unsigned char *aad,
+    size_t aad_length)
+{
+    /* GCM hashes all the AAD before the ciphertext */
+    if (ctx->aad_finished) {
+        printf("[ERROR] AAD must be added before any data\n");
+        return 1;
+    }
+
+    /* Fill up a partial block left by the previous call */
+    while (aad_length > 0 && ctx->aad_length % 16 != 0) {
+        ctx->ghash_buffer[ctx->aad_length % 16] = *aad;
+        aad++;
+        aad_length--;
+        ctx->aad_length++;
+
+        if (ctx->aad_length % 16 == 0) {
+            aes_gcm_flush_ghash_buffer(ctx, 16);
+        }
+    }
+
+    /* Absorb the whole blocks directly */
+    if (aad_length >= 16) {
+        size_t whole = aad_length - aad_length % 16;
+        ghash_update(&ctx->ghash_key, ctx->ghash, aad, whole);
+        aad += whole;
+        aad_length -= whole;
+        ctx->aad_length += whole;
+    }
+
+    /* Keep the rest until the block is complete */
+    if (aad_length > 0) {
+        memcpy(ctx->ghash_buffer, aad, aad_length);
+    }
+    ctx->aad_length += aad_length;
+    return 0;
+}
+
+/*******************************************************************************
+ * Encrypts/decrypts the next chunk of input.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - input - The plaintext(encrypting) or ciphertext(decrypting).
+ * - length - The length of the input.
+ * - output - Where to write the result. Can be the same as 'input'.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_update(
+    aes_gcm_context_t *ctx,
+    const unsigned char *input,
+    size_t length,
+    unsigned char *output)
+{
+    size_t i;
+
+    /* The last AAD block is padded with zeros before the ciphertext */
+    if (!ctx->aad_finished) {
+        aes_gcm_flush_ghash_buffer(ctx, (int)(ctx->aad_length % 16));
+        ctx->aad_finished = 1;
+    }
+
+    /* Use up the keystream left over from the previous call */
+    while (length > 0 && ctx->text_length % 16 != 0) {
+        int position = (int)(ctx->text_length % 16);
+        unsigned char result = *input ^ ctx->keystream[position];
+
+        /* GHASH always covers the ciphertext */
+        ctx->ghash_buffer[position] =
+            ctx->mode == AES_GCM_ENCRYPT ? result : *input;
+        *output = result;
+
+        input++;
+        output++;
+        length--;
+        ctx->text_length++;
+
+        if (position == 15) {
+            aes_gcm_flush_ghash_buffer(ctx, 16);
+        }
+    }
+
+    /* Whole blocks */
+    if (length >= 16) {
+        size_t whole = length - length % 16;
+
+        /* Large inputs are split between threads if allowed */
+        if (aes_gcm_update_parallel(ctx, input, whole, output) != 0) {
+            aes_gcm_process_blocks(
+                ctx, ctx->counter_block, ctx->ghash, input, whole, output);
+        }
+
+        input += whole;
+        output += whole;
+        length -= whole;
+        ctx->text_length += whole;
+    }
+
+    /* Partial last block
+    * The rest of the keystream is kept for the next call.
+    */
+    if (length > 0) {
+        aes_gcm_next_keystream(&ctx->aes, ctx->counter_block, ctx->keystream);
+        for (i = 0; i < length; i++) {
+            unsigned char result = input[i] ^ ctx->keystream[i];
+            ctx->ghash_buffer[i] =
+                ctx->mode == AES_GCM_ENCRYPT ? result : input[i];
+            output[i] = result;
+        }
+        ctx->text_length += length;
+    }
+}
+
+/*******************************************************************************
+ * Finishes a streaming operation & creates the authentication tag.
+ * tag = GHASH(H, A || C || len(A) || len(C)) ⊕ E(K,Y0)
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - tag - Where to write the 16 byte tag.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_final(aes_gcm_context_t *ctx, unsigned char tag[16])
+{
+    unsigned char length_block[16];
+    int i;
+
+    /* Pad the last AAD or ciphertext block with zeros */
+    if (!ctx->aad_finished) {
+        aes_gcm_flush_ghash_buffer(ctx, (int)(ctx->aad_length % 16));
+        ctx->aad_finished = 1;
+    } else {
+        aes_gcm_flush_ghash_buffer(ctx, (int)(ctx->text_length % 16));
+    }
+
+    /* Finally process length block */
+    aes_gcm_calculate_length_block(ctx, length_block);
+    ghash_update(&ctx->ghash_key, ctx->ghash, length_block, 16);
+
+    /* XOR the GHash with E(K,Y0) */
+    for (i = 0; i < 16; i++) {
+        tag[i] = ctx->ghash[i] ^ ctx->y0[i];
+    }
+
+    /* Debugging if needed */
+    #if defined(DEBUG) && DEBUG_LEVEL == 3
+        debug_print(ctx, (int)((ctx->text_length + 15) / 16));
+    #endif
+}
+
+/*******************************************************************************
+ * Finishes a streaming operation & checks the authentication tag.
+ * Every byte is compared so the time taken does not reveal where the tags
+ * differ.
+ *
+ * inputs:
+ * - ctx - The GCM context.
+ * - tag - The 16 byte tag to check against.
+ *
+ * outputs:
+ * - 0 if the tag is valid, 1 otherwise.
+ ******************************************************************************/
+int aes_gcm_verify(aes_gcm_context_t *ctx, const unsigned char tag[16])
+{
+    unsigned char expected[16];
+    unsigned char difference = 0;
+    int i;
+
+    aes_gcm_final(ctx, expected);
+    for (i = 0; i < 16; i++) {
+        difference |= expected[i] ^ tag[i];
+    }
+
+    return difference != 0;
+}
+
+/*******************************************************************************
+ * Encrypts the input using AES-GCM.
+ *
+ * inputs:
+ * - input - The input to encrypt.
+ * - input_size - The size of the input.
+ * - key - The key to use for the encryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ *
+ * outputs:
+ * - The ciphertext.
+ ******************************************************************************/
+aes_gcm_data_t *aes_gcm_encrypt(
+    const unsigned char *plaintext, 
+    int plaintext_size, 
+    const unsigned char *key, 
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce) {
+
+    /* Initialize the context needed for AES-GCM encryption */
+    aes_gcm_context_t ctx;
+    aes_gcm_init(&ctx, key, key_size, nonce, AES_GCM_ENCRYPT);
+    aes_gcm_update_aad(&ctx, aad, aad_length);
+
+    /* Allocate memory for the ciphertext */
+    int ciphertext_size = plaintext_size;
+    unsigned char *ciphertext = (unsigned char *)malloc(
+        ciphertext_size * sizeof(unsigned char));
+
+    /* Encrypt & hash in one pass */
+    aes_gcm_update(&ctx, plaintext, plaintext_size, ciphertext);
+
+    /* Create the output data */
+    aes_gcm_data_t *output = (aes_gcm_data_t *)malloc(
+        sizeof(aes_gcm_data_t));
+    output->output = ciphertext;
+    output->output_length = ciphertext_size;
+
+    /* Calculate the tag */
+    aes_gcm_final(&ctx, output->tag);
+
+    /* Return the encrypted data */
+    return output;
+}
+
+/*******************************************************************************
+ * Decrypts the input using AES-GCM.
  *
  * inputs:
  * - input - The input to decrypt.
@@ -615,102 +864,619 @@ void aes_gcm_encrypt_file(
  * - key_size - The size of the key.
  * - aad - The additional authentication data.
  * - aad_length - The length of the additional authentication data.
- * - nonce - The nonce. Must be 12 bytes.
- * - auth_tag - The 16 byte authentication tag verifying ciphertext integrity.
+ * - nonce - The nonce. Must be 12 bytes.
+ * - auth_tag - The 16 byte authentication tag verifying ciphertext integrity.
+ *
+ * outputs:
+ * - The decrypted data.
+ ******************************************************************************/
+aes_gcm_data_t *aes_gcm_decrypt(
+    const unsigned char *ciphertext,
+    int ciphertext_size,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce,
+    const unsigned char *auth_tag) {
+
+    /* Initialize the context needed for AES-GCM decryption */
+    aes_gcm_context_t ctx;
+    aes_gcm_init(&ctx, key, key_size, nonce, AES_GCM_DECRYPT);
+    aes_gcm_update_aad(&ctx, aad, aad_length);
+
+    /* Allocate memory for the plaintext */
+    int plaintext_size = ciphertext_size;
+    unsigned char *plaintext = (unsigned char *)malloc(
+        plaintext_size * sizeof(unsigned char));
+
+    /* Decrypt & hash in one pass */
+    aes_gcm_update(&ctx, ciphertext, ciphertext_size, plaintext);
+
+    /* Check if the tag is valid
+    * The plaintext is never returned if it is not.
+    */
+    if (aes_gcm_verify(&ctx, auth_tag) != 0) {
+        printf("[ERROR] Tag is invalid\n");
+
+        /* Wipe the unauthenticated plaintext */
+        memset(plaintext, 0, plaintext_size);
+        free(plaintext);
+        return NULL;
+    }
+
+    /* Create the output data */
+    aes_gcm_data_t *output = (aes_gcm_data_t *)malloc(
+        sizeof(aes_gcm_data_t));
+    output->output = plaintext;
+    output->output_length = ciphertext_size;
+
+    /* Return the decrypted data */
+    return output;
+}
+
+/*******************************************************************************
+ * Creates the nonce for a chunk of an encrypted file.
+ * The chunk index is XORed into the last 8 bytes of the file's nonce so no
+ * two chunks share a keystream.
+ *
+ * inputs:
+ * - nonce - The nonce of the file. Must be 12 bytes.
+ * - index - The index of the chunk.
+ * - chunk_nonce - Where to write the 12 byte nonce of the chunk.
+ *
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void aes_gcm_file_chunk_nonce(
+    const unsigned char *nonce,
+    unsigned long long index,
+    unsigned char chunk_nonce[12])
+{
+    int i;
+
+    memcpy(chunk_nonce, nonce, 12);
+    for (i = 0; i < 8; i++) {
+        chunk_nonce[11 - i] ^= (unsigned char)(index >> (i * 8));
+    }
+}
+
+/*******************************************************************************
+ * Encrypts/decrypts a chunk of a file in place.
+ * A flag marking the last chunk is authenticated with the AAD, so removing
+ * chunks from the end of a file is detected.
+ *
+ * inputs:
+ * - key - The key to use.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce of the file. Must be 12 bytes.
+ * - index - The index of the chunk.
+ * - final - 1 if this is the last chunk of the file, otherwise 0.
+ * - mode - AES_GCM_ENCRYPT or AES_GCM_DECRYPT.
+ * - buffer - The chunk. Replaced with the result.
+ * - length - The length of the chunk.
+ * - tag - The tag of the chunk. Written when encrypting, checked when
+ *         decrypting.
+ *
+ * outputs:
+ * - 0 on success, 1 if the tag is invalid.
+ ******************************************************************************/
+int aes_gcm_file_transform_chunk(
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce,
+    unsigned long long index,
+    int final,
+    int mode,
+    unsigned char *buffer,
+    size_t length,
+    unsigned char tag[16])
+{
+    aes_gcm_context_t ctx;
+    unsigned char chunk_nonce[12];
+    unsigned char final_flag = (unsigned char)final;
+
+    aes_gcm_file_chunk_nonce(nonce, index, chunk_nonce);
+    aes_gcm_init(&ctx, key, key_size, chunk_nonce, mode);
+    aes_gcm_update_aad(&ctx, aad, aad_length);
+    aes_gcm_update_aad(&ctx, &final_flag, 1);
+    aes_gcm_update(&ctx, buffer, length, buffer);
+
+    if (mode == AES_GCM_ENCRYPT) {
+        aes_gcm_final(&ctx, tag);
+        return 0;
+    }
+    return aes_gcm_verify(&ctx, tag);
+}
+
+/*******************************************************************************
+ * Checks whether the end of a file has been reached.
+ * Unlike feof() this also works straight after a read that ended exactly at
+ * the end of the file.
+ *
+ * inputs:
+ * - file - The file to check.
+ *
+ * outputs:
+ * - 1 if there is nothing left to read, otherwise 0.
+ ******************************************************************************/
+int aes_gcm_file_at_end(FILE *file) {
+
+    int c = fgetc(file);
+    if (c == EOF) {
+        return 1;
+    }
+
+    ungetc(c, file);
+    return 0;
+}
+
+/* Where decrypted data is written: a file, or a buffer that grows. */
+struct aes_gcm_file_output
+{
+    /* Written to if not NULL */
+    FILE *file;
+
+    /* Used when there is no file */
+    unsigned char *buffer;
+    size_t length;
+    size_t capacity;
+};
+typedef struct aes_gcm_file_output aes_gcm_file_output_t;
+
+/*******************************************************************************
+ * Writes decrypted data to the output of a decryption.
+ *
+ * inputs:
+ * - output - The output.
+ * - data - The data to write.
+ * - length - The length of the data.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_file_output_write(
+    aes_gcm_file_output_t *output,
+    const unsigned char *data,
+    size_t length)
+{
+    /* Nothing to write. data may be NULL. */
+    if (length == 0) {
+        return 0;
+    }
+
+    if (output->file != NULL) {
+        if (fwrite(data, 1, length, output->file) != length) {
+            printf("[ERROR] Failed to write decrypted file\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    /* Grow the buffer by doubling so appends stay cheap */
+    if (output->length + length > output->capacity) {
+        size_t capacity = output->capacity > 0 ?
+            output->capacity : AES_GCM_FILE_CHUNK_SIZE;
+        while (capacity < output->length + length) {
+            capacity *= 2;
+        }
+
+        /* Not realloc() so the old copy of the plaintext can be wiped */
+        unsigned char *buffer = (unsigned char *)malloc(capacity);
+        if (buffer == NULL) {
+            printf("[ERROR] Failed to allocate memory\n");
+            return 1;
+        }
+        if (output->buffer != NULL) {
+            memcpy(buffer, output->buffer, output->length);
+            memset(output->buffer, 0, output->length);
+            free(output->buffer);
+        }
+        output->buffer = buffer;
+        output->capacity = capacity;
+    }
+
+    memcpy(output->buffer + output->length, data, length);
+    output->length += length;
+    return 0;
+}
+
+/*******************************************************************************
+ * Writes the header of a chunked encrypted file.
+ *
+ * inputs:
+ * - file - The encrypted file.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_file_write_header(FILE *file)
+{
+    unsigned char header[AES_GCM_FILE_HEADER_SIZE];
+
+    memcpy(header, AES_GCM_FILE_MAGIC, 8);
+    header[8] = (unsigned char)(AES_GCM_FILE_CHUNK_SIZE >> 24);
+    header[9] = (unsigned char)(AES_GCM_FILE_CHUNK_SIZE >> 16);
+    header[10] = (unsigned char)(AES_GCM_FILE_CHUNK_SIZE >> 8);
+    header[11] = (unsigned char)AES_GCM_FILE_CHUNK_SIZE;
+
+    if (fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        printf("[ERROR] Failed to write encrypted file\n");
+        return 1;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Encrypts a chunk in place & writes it to an encrypted file.
+ *
+ * inputs:
+ * - file - The encrypted file.
+ * - key - The key to use for the encryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce of the file. Must be 12 bytes.
+ * - index - The index of the chunk.
+ * - final - 1 if this is the last chunk of the file, otherwise 0.
+ * - buffer - The chunk. Replaced with the ciphertext.
+ * - length - The length of the chunk.
  *
  * outputs:
- * - The decrypted data.
+ * - 0 on success, 1 on failure.
  ******************************************************************************/
-aes_gcm_data_t *aes_gcm_decrypt(
-    const unsigned char *ciphertext,
-    int ciphertext_size,
+int aes_gcm_file_write_chunk(
+    FILE *file,
     const unsigned char *key,
     int key_size,
     const unsigned char *aad,
     int aad_length,
     const unsigned char *nonce,
-    const unsigned char *auth_tag) {
+    unsigned long long index,
+    int final,
+    unsigned char *buffer,
+    size_t length)
+{
+    unsigned char tag[16];
 
-    /* Get the number of blocks needed for the ciphertext */
-    int num_blocks_ciphertext = determine_num_blocks(ciphertext_size);
+    aes_gcm_file_transform_chunk(key, key_size, aad, aad_length, nonce,
+        index, final, AES_GCM_ENCRYPT, buffer, length, tag);
 
-    /* Get the number of blocks needed for the AAD */
-    int num_blocks_aad = determine_num_blocks(aad_length);
+    /* Write the ciphertext followed by its tag */
+    if (fwrite(buffer, 1, length, file) != length ||
+        fwrite(tag, 1, 16, file) != 16) {
+        printf("[ERROR] Failed to write encrypted file\n");
+        return 1;
+    }
+    return 0;
+}
 
-    /* Initialize the context needed for AES-GCM decryption */
-    aes_gcm_context_t *ctx = aes_gcm_context_init(
-        key, key_size, 
-        aad, aad_length,
-        nonce
-    );
+/*******************************************************************************
+ * Encrypts a file using AES-GCM.
+ * The file is processed AES_GCM_FILE_CHUNK_SIZE bytes at a time so memory
+ * use does not depend on the size of the file.
+ *
+ * File format:
+ *   "AESGCMC1" | chunk size(4 bytes, big-endian) |
+ *   ciphertext₀ | tag₀ | ciphertext₁ | tag₁ | ...
+ * Every chunk except the last holds exactly 'chunk size' bytes.
+ *
+ * inputs:
+ * - plaintext_file - The file to encrypt.
+ * - encrypted_file - The file to write the encrypted data to.
+ * - key - The key to use for the encryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_encrypt_file(
+    const char *plaintext_file,
+    const char *encrypted_file,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce) {
 
-    /* Calculate the tag */
-    unsigned char tag[16];
-    aes_gcm_calculate_tag(ctx, ciphertext, ciphertext_size, 
-        num_blocks_ciphertext, num_blocks_aad, tag);
+    /* Open the plaintext file */
+    FILE *plaintext_file_ptr = fopen(plaintext_file, "rb");
+    if (plaintext_file_ptr == NULL) {
+        printf("[ERROR] Failed to open plaintext file\n");
+        return 1;
+    }
+    
+    /* Open the encrypted file */
+    FILE *encrypted_file_ptr = fopen(encrypted_file, "wb");
+    if (encrypted_file_ptr == NULL) {
+        printf("[ERROR] Failed to open encrypted file\n");
+        fclose(plaintext_file_ptr);
+        return 1;
+    }
 
-    /* Check if the tag is valid */
-    if (memcmp(auth_tag, tag, 16) != 0) {
-        printf("[ERROR] Tag is invalid\n");
-        
-        /* Print the two different tags */
-        printf("[DEBUG] Generated tag: ");
-        int temp_i;
-        for (temp_i = 0; temp_i < 16; temp_i++) printf("%02X", tag[temp_i]);
-        printf("\n");
-        printf("[DEBUG] Expected tag: ");
-        for (temp_i = 0; temp_i < 16; temp_i++) printf("%02X", auth_tag[temp_i]);
-        printf("\n");
+    /* Buffer reused for every chunk */
+    unsigned char *buffer = (unsigned char *)malloc(AES_GCM_FILE_CHUNK_SIZE);
 
-        return NULL;
+    /* Write the header */
+    int failed = aes_gcm_file_write_header(encrypted_file_ptr);
+
+    /* Encrypt each chunk. An empty file still gets one(empty) chunk. */
+    unsigned long long index = 0;
+    int final = 0;
+    while (!failed && !final) {
+
+        /* Read the next chunk */
+        size_t length = fread(
+            buffer, 1, AES_GCM_FILE_CHUNK_SIZE, plaintext_file_ptr);
+        if (ferror(plaintext_file_ptr)) {
+            printf("[ERROR] Failed to read plaintext file\n");
+            failed = 1;
+            break;
+        }
+        final = length < AES_GCM_FILE_CHUNK_SIZE ||
+            aes_gcm_file_at_end(plaintext_file_ptr);
+
+        /* Encrypt & write the chunk */
+        failed = aes_gcm_file_write_chunk(encrypted_file_ptr, key, key_size,
+            aad, aad_length, nonce, index, final, buffer, length);
+        index++;
     }
 
-    /* Allocate memory for the plaintext */
-    int plaintext_size = ciphertext_size;
-    unsigned char *plaintext = (unsigned char *)malloc(
-        plaintext_size * sizeof(unsigned char));
+    /* Free any memory allocated */
+    free(buffer);
+
+    /* Close the files */
+    fclose(plaintext_file_ptr);
+    if (fclose(encrypted_file_ptr) != 0) {
+        failed = 1;
+    }
+
+    return failed;
+}
+
+/*******************************************************************************
+ * Encrypts data in memory straight into an encrypted file.
+ * Writes the same format as aes_gcm_encrypt_file() without the data ever
+ * being written to a plaintext file.
+ *
+ * inputs:
+ * - data - The data to encrypt.
+ * - length - The length of the data.
+ * - encrypted_file - The file to write the encrypted data to.
+ * - key - The key to use for the encryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_encrypt_buffer_to_file(
+    const unsigned char *data,
+    size_t length,
+    const char *encrypted_file,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce) {
+
+    /* Open the encrypted file */
+    FILE *encrypted_file_ptr = fopen(encrypted_file, "wb");
+    if (encrypted_file_ptr == NULL) {
+        printf("[ERROR] Failed to open encrypted file\n");
+        return 1;
+    }
+
+    /* Chunks are encrypted here so the caller's data is left untouched */
+    size_t buffer_size = length < AES_GCM_FILE_CHUNK_SIZE ?
+        length : AES_GCM_FILE_CHUNK_SIZE;
+    unsigned char *buffer = (unsigned char *)malloc(
+        buffer_size > 0 ? buffer_size : 1);
 
+    /* Write the header */
+    int failed = aes_gcm_file_write_header(encrypted_file_ptr);
 
-    /* Iterate through all the blocks of ciphertext */
-    int i; 
-    for (i = 0; i < num_blocks_ciphertext; i++)
-    {
-        /* Increment the counter block */
-        aes_gcm_increment_counter_block(ctx);
+    /* Encrypt each chunk. Empty data still gets one(empty) chunk. */
+    unsigned long long index = 0;
+    size_t offset = 0;
+    int final = 0;
+    while (!failed && !final) {
 
-        /* Generate the keystream block for this block */
-        unsigned char keystream_block[16];
-        aes_gcm_create_keystream(ctx, keystream_block);
+        size_t chunk_length = length - offset;
+        if (chunk_length > AES_GCM_FILE_CHUNK_SIZE) {
+            chunk_length = AES_GCM_FILE_CHUNK_SIZE;
+        }
+        final = offset + chunk_length == length;
 
-        /* XOR the current ciphertext block of 16 bytes with the keystream */
-        /* Creates the plaintext for this ciphertext block */
-        aes_gcm_xor_input_with_keystream(
-            ctx, 
-            ciphertext + (i * 16), ciphertext_size,
-            keystream_block,
-            plaintext);
+        memcpy(buffer, data + offset, chunk_length);
+        failed = aes_gcm_file_write_chunk(encrypted_file_ptr, key, key_size,
+            aad, aad_length, nonce, index, final, buffer, chunk_length);
 
-        /* Debugging if needed */
-        #if defined(DEBUG) && DEBUG_LEVEL == 3
-            debug_print(ctx, i);
-        #endif
+        offset += chunk_length;
+        index++;
     }
 
-    /* Free the memory allocated for the context */
-    free(ctx);
+    /* Free any memory allocated */
+    free(buffer);
 
-    /* Create the output data */
-    aes_gcm_data_t *output = (aes_gcm_data_t *)malloc(
-        sizeof(aes_gcm_data_t));
-    output->output = plaintext;
-    output->output_length = ciphertext_size;
+    /* Close the file */
+    if (fclose(encrypted_file_ptr) != 0) {
+        failed = 1;
+    }
 
-    /* Return the decrypted data */
-    return output;
+    return failed;
+}
+
+/*******************************************************************************
+ * Decrypts a file written by the old whole-file format.
+ * Format: tag | ciphertext
+ * The file is read twice: once to check the tag & once to decrypt it. No
+ * plaintext is written unless the tag is valid.
+ *
+ * inputs:
+ * - encrypted_file_ptr - The encrypted file. Positioned at the start.
+ * - output - Where to write the decrypted data.
+ * - key - The key to use for the decryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ * - buffer - Buffer of AES_GCM_FILE_CHUNK_SIZE bytes.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_decrypt_file_whole(
+    FILE *encrypted_file_ptr,
+    aes_gcm_file_output_t *output,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce,
+    unsigned char *buffer) {
+
+    aes_gcm_context_t ctx;
+    unsigned char auth_tag[16];
+    size_t length;
+    int pass;
+
+    /* Read the authentication tag from the file */
+    if (fread(auth_tag, 1, 16, encrypted_file_ptr) != 16) {
+        printf("[ERROR] Encrypted file is too short\n");
+        return 1;
+    }
+
+    /* Pass 0 checks the tag, pass 1 writes the plaintext */
+    for (pass = 0; pass < 2; pass++) {
+
+        fseek(encrypted_file_ptr, 16, SEEK_SET);
+        aes_gcm_init(&ctx, key, key_size, nonce, AES_GCM_DECRYPT);
+        aes_gcm_update_aad(&ctx, aad, aad_length);
+
+        while ((length = fread(buffer, 1, AES_GCM_FILE_CHUNK_SIZE,
+                    encrypted_file_ptr)) > 0) {
+            aes_gcm_update(&ctx, buffer, length, buffer);
+
+            if (pass == 1 &&
+                aes_gcm_file_output_write(output, buffer, length) != 0) {
+                return 1;
+            }
+        }
+
+        if (pass == 0 && aes_gcm_verify(&ctx, auth_tag) != 0) {
+            printf("[ERROR] Tag is invalid\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+ * Decrypts an open encrypted file.
+ * Each chunk is only written to the output once its tag has been checked.
+ * Files written before chunking was added are still supported.
+ *
+ * inputs:
+ * - encrypted_file_ptr - The encrypted file. Positioned at the start.
+ * - output - Where to write the decrypted data.
+ * - key - The key to use for the decryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ *
+ * outputs:
+ * - 0 on success, 1 on failure.
+ ******************************************************************************/
+int aes_gcm_decrypt_stream(
+    FILE *encrypted_file_ptr,
+    aes_gcm_file_output_t *output,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce) {
+
+    /* Read the header */
+    unsigned char header[AES_GCM_FILE_HEADER_SIZE];
+    size_t header_length = fread(header, 1, sizeof(header), encrypted_file_ptr);
+    unsigned long chunk_size = 0;
+    int failed = 0;
+
+    /* Files without the header use the old whole-file format */
+    if (header_length < sizeof(header) ||
+        memcmp(header, AES_GCM_FILE_MAGIC, 8) != 0) {
+
+        unsigned char *buffer = (unsigned char *)malloc(
+            AES_GCM_FILE_CHUNK_SIZE);
+        fseek(encrypted_file_ptr, 0, SEEK_SET);
+        failed = aes_gcm_decrypt_file_whole(encrypted_file_ptr, output,
+            key, key_size, aad, aad_length, nonce, buffer);
+        free(buffer);
+        return failed;
+    }
+
+    /* The chunk size is chosen by the writer */
+    chunk_size = ((unsigned long)header[8] << 24) |
+        ((unsigned long)header[9] << 16) |
+        ((unsigned long)header[10] << 8) | header[11];
+    if (chunk_size == 0 || chunk_size > AES_GCM_FILE_MAX_CHUNK_SIZE) {
+        printf("[ERROR] Invalid chunk size in encrypted file\n");
+        return 1;
+    }
+
+    /* Buffer holds a chunk & its tag */
+    unsigned char *buffer = (unsigned char *)malloc(chunk_size + 16);
+    unsigned long long index = 0;
+    int final = 0;
+
+    /* Decrypt each chunk */
+    while (!failed && !final) {
+
+        /* Read the next chunk & its tag */
+        size_t length = fread(
+            buffer, 1, chunk_size + 16, encrypted_file_ptr);
+        if (length < 16) {
+            printf("[ERROR] Encrypted file is truncated\n");
+            failed = 1;
+            break;
+        }
+        final = length < chunk_size + 16 ||
+            aes_gcm_file_at_end(encrypted_file_ptr);
+        length -= 16;
+
+        /* Only write the chunk if it is authentic */
+        if (aes_gcm_file_transform_chunk(key, key_size, aad, aad_length,
+                nonce, index, final, AES_GCM_DECRYPT,
+                buffer, length, buffer + length) != 0) {
+            printf("[ERROR] Tag is invalid\n");
+            failed = 1;
+        } else {
+            failed = aes_gcm_file_output_write(output, buffer, length);
+        }
+        index++;
+    }
+
+    free(buffer);
+    return failed;
 }
 
 /*******************************************************************************
  * Decrypts a file using AES-GCM.
+ * Each chunk is only written once its tag has been checked. If any chunk is
+ * invalid the decrypted file is deleted.
+ * Files written before chunking was added are still supported.
  *
  * inputs:
  * - encrypted_file - The file to decrypt.
@@ -722,9 +1488,9 @@ aes_gcm_data_t *aes_gcm_decrypt(
  * - nonce - The nonce. Must be 12 bytes.
  *
  * outputs:
- * - None.
+ * - 0 on success, 1 on failure.
  ******************************************************************************/
-void aes_gcm_decrypt_file(
+int aes_gcm_decrypt_file(
     const char *encrypted_file,
     const char *decrypted_file,
     const unsigned char *key,
@@ -733,60 +1499,94 @@ void aes_gcm_decrypt_file(
     int aad_length,
     const unsigned char *nonce) {
 
-    /* Open the decrypted file */
-    FILE *decrypted_file_ptr = fopen(decrypted_file, "wb");
-    if (decrypted_file_ptr == NULL) {
-        printf("[ERROR] Failed to open decrypted file\n");
-        return;
-    }
-
     /* Open the encrypted file */
     FILE *encrypted_file_ptr = fopen(encrypted_file, "rb");
     if (encrypted_file_ptr == NULL) {
         printf("[ERROR] Failed to open encrypted file\n");
-        return;
+        return 1;
     }
 
-    /* Determine the size of the encrypted file */
-    fseek(encrypted_file_ptr, 0, SEEK_END);
-    int encrypted_file_size = ftell(encrypted_file_ptr);
-    fseek(encrypted_file_ptr, 0, SEEK_SET);
+    /* Open the decrypted file */
+    aes_gcm_file_output_t output;
+    memset(&output, 0, sizeof(output));
+    output.file = fopen(decrypted_file, "wb");
+    if (output.file == NULL) {
+        printf("[ERROR] Failed to open decrypted file\n");
+        fclose(encrypted_file_ptr);
+        return 1;
+    }
 
-    /* Subtract 16 due to the authentication tag */
-    encrypted_file_size -= 16;
+    int failed = aes_gcm_decrypt_stream(encrypted_file_ptr, &output,
+        key, key_size, aad, aad_length, nonce);
 
-    /* Read the authentication tag from the file */
-    unsigned char auth_tag[16];
-    fread(auth_tag, 1, 16, encrypted_file_ptr);
+    /* Close the files */
+    fclose(encrypted_file_ptr);
+    if (fclose(output.file) != 0) {
+        failed = 1;
+    }
 
-    /* Read the encrypted file into memory */
-    unsigned char *encrypted_data = (unsigned char *)malloc(encrypted_file_size);
-    fread(encrypted_data, 1, encrypted_file_size, encrypted_file_ptr);
-;
+    /* Never leave behind part of a file that failed to decrypt */
+    if (failed) {
+        remove(decrypted_file);
+    }
 
-    /* Decrypt the encrypted data */
-    aes_gcm_data_t *decrypted_data = aes_gcm_decrypt(
-        encrypted_data, encrypted_file_size, 
-        key, key_size,
-        aad, aad_length,
-        nonce,
-        auth_tag);
+    return failed;
+}
 
-    /* Check if the decrypted data is valid */
-    if (decrypted_data == NULL) {
-        printf("[ERROR] Failed to decrypt data\n");
-        return;
-    }
+/*******************************************************************************
+ * Decrypts a file using AES-GCM straight into memory.
+ * Accepts every format aes_gcm_decrypt_file() does. Nothing is returned
+ * unless every chunk of the file is authentic.
+ *
+ * inputs:
+ * - encrypted_file - The file to decrypt.
+ * - key - The key to use for the decryption.
+ * - key_size - The size of the key.
+ * - aad - The additional authentication data.
+ * - aad_length - The length of the additional authentication data.
+ * - nonce - The nonce. Must be 12 bytes.
+ * - length - Set to the length of the decrypted data.
+ *
+ * outputs:
+ * - The decrypted data(must be freed) or NULL on failure.
+ ******************************************************************************/
+unsigned char *aes_gcm_decrypt_file_to_buffer(
+    const char *encrypted_file,
+    const unsigned char *key,
+    int key_size,
+    const unsigned char *aad,
+    int aad_length,
+    const unsigned char *nonce,
+    size_t *length) {
 
-    /* Write the decrypted data to the decrypted file */
-    fwrite(decrypted_data->output, 1, 
-        decrypted_data->output_length, decrypted_file_ptr);
+    /* Open the encrypted file */
+    FILE *encrypted_file_ptr = fopen(encrypted_file, "rb");
+    if (encrypted_file_ptr == NULL) {
+        printf("[ERROR] Failed to open encrypted file\n");
+        return NULL;
+    }
 
-    /* Free any memory allocated */
-    free(encrypted_data);
-    free(decrypted_data);
+    aes_gcm_file_output_t output;
+    memset(&output, 0, sizeof(output));
 
-    /* Close the files */
+    int failed = aes_gcm_decrypt_stream(encrypted_file_ptr, &output,
+        key, key_size, aad, aad_length, nonce);
     fclose(encrypted_file_ptr);
-    fclose(decrypted_file_ptr);
-}
\ No newline at end of file
+
+    /* Wipe anything decrypted before a bad chunk was found */
+    if (failed) {
+        if (output.buffer != NULL) {
+            memset(output.buffer, 0, output.length);
+            free(output.buffer);
+        }
+        return NULL;
+    }
+
+    /* Empty data still returns a buffer so NULL always means failure */
+    if (output.buffer == NULL) {
+        output.buffer = (unsigned char *)malloc(1);
+    }
+
+    *length = output.length;
+    return output.buffer;
+}
@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "encryption/aes/ghash.h"
+#include "encryption/aes/operations.h"
+
+/* Backend in use. -1 until the first call to ghash_get_backend(). */
+int ghash_selected_backend = -1;
+
+/*******************************************************************************
+ * Gets the GHASH backend in use.
+ * On first use the backend is chosen from the GHASH_BACKEND environment
+ * variable("portable" or "clmul"). Otherwise CLMUL is used when the CPU
+ * supports it.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - GHASH_BACKEND_PORTABLE or GHASH_BACKEND_CLMUL.
+ ******************************************************************************/
+int ghash_get_backend(void)
+{
+    /* Choose the backend the first time */
+    if (ghash_selected_backend == -1)
+    {
+        const char *requested = getenv("GHASH_BACKEND");
+
+        /* Default to CLMUL when the CPU supports it */
+        ghash_selected_backend = ghash_clmul_available()
+            ? GHASH_BACKEND_CLMUL : GHASH_BACKEND_PORTABLE;
+
+        /* The environment variable can force either backend */
+        if (requested != NULL && strcmp(requested, "portable") == 0)
+        {
+            ghash_selected_backend = GHASH_BACKEND_PORTABLE;
+        }
+        else if (requested != NULL && strcmp(requested, "clmul") == 0 &&
+            ghash_set_backend(GHASH_BACKEND_CLMUL) != 0)
+        {
+            printf("[WARNING] PCLMULQDQ is not supported, "
+                "using portable GHASH\n");
+        }
+    }
+
+    return ghash_selected_backend;
+}
+
+/*******************************************************************************
+ * Forces the given GHASH backend to be used.
+ *
+ * inputs:
+ * - backend - GHASH_BACKEND_PORTABLE or GHASH_BACKEND_CLMUL.
+ * outputs:
+ * - 0 if the backend is now in use, 1 if it is not supported.
+ ******************************************************************************/
+int ghash_set_backend(int backend)
+{
+    /* CLMUL can only be used if the CPU supports it */
+    if (backend == GHASH_BACKEND_CLMUL && !ghash_clmul_available())
+    {
+        return 1;
+    }
+
+    /* Only known backends can be used */
+    if (backend != GHASH_BACKEND_CLMUL && backend != GHASH_BACKEND_PORTABLE)
+    {
+        return 1;
+    }
+
+    ghash_selected_backend = backend;
+    return 0;
+}
+
+/*******************************************************************************
+ * Precomputes everything needed to GHASH with the given hash subkey.
+ *
+ * inputs:
+ * - key - The GHASH key to initialize.
+ * - h - The hash subkey. The all-zero block encrypted with the AES key.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_key_init(ghash_key_t *key, const unsigned char h[16])
+{
+    /* Store the hash subkey */
+    memcpy(key->h, h, 16);
+
+    /* Multiples of H for the portable backend */
+    ghash_table_key_init(key);
+
+    /* Precompute the powers of H whenever the CPU could use them.
+     * Lets the backend be switched after the key is created.
+     */
+    memset(key->clmul_powers, 0, sizeof(key->clmul_powers));
+    if (ghash_clmul_available())
+    {
+        ghash_clmul_key_init(key);
+    }
+}
+
+/*******************************************************************************
+ * Absorbs data into a running GHASH using the portable backend.
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - state - The running GHASH value. Updated in place.
+ * - data - The data to absorb.
+ * - length - The length of the data in bytes.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_portable_update(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    const unsigned char *data,
+    size_t length)
+{
+    /* Process each block */
+    while (length > 0)
+    {
+        /* Last block may be partial. Missing bytes count as zeros. */
+        size_t block_size = length < 16 ? length : 16;
+        size_t i;
+
+        /* XOR the block with the current GHASH value */
+        for (i = 0; i < block_size; i++)
+        {
+            state[i] ^= data[i];
+        }
+
+        /* xᵢ = (xᵢ₋₁ ⊕ Cᵢ) • H */
+        ghash_table_multiply(key, state);
+
+        data += block_size;
+        length -= block_size;
+    }
+}
+
+/*******************************************************************************
+ * Absorbs data into a running GHASH.
+ * For each 16 byte block: state = (state ⊕ block) • H
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - state - The running GHASH value. Updated in place.
+ * - data - The data to absorb.
+ * - length - The length of the data in bytes.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_update(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    const unsigned char *data,
+    size_t length)
+{
+    if (ghash_get_backend() == GHASH_BACKEND_CLMUL)
+    {
+        ghash_clmul_update(key, state, data, length);
+    }
+    else
+    {
+        ghash_portable_update(key, state, data, length);
+    }
+}
+
+/*******************************************************************************
+ * Multiplies a GHASH value by a power of H.
+ * Uses square-and-multiply so only about 2•log₂(exponent) multiplications
+ * are needed.
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - state - The GHASH value. Updated in place.
+ * - exponent - The power of H.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_multiply_h_power(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    unsigned long long exponent)
+{
+    /* H^(2^i) for the current bit of the exponent */
+    unsigned char power[16];
+    memcpy(power, key->h, 16);
+
+    while (exponent > 0)
+    {
+        if (exponent & 1)
+        {
+            gf_multiply_2_128(state, power, state);
+        }
+
+        exponent >>= 1;
+        if (exponent > 0)
+        {
+            gf_multiply_2_128(power, power, power);
+        }
+    }
+}
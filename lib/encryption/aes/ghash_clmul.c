@@ -0,0 +1,275 @@
+#include <string.h>
+
+#include "encryption/aes/ghash.h"
+#include "utils/cpu.h"
+
+/* The CLMUL backend is only compiled for x86 with GCC/Clang.
+ * Functions are compiled for PCLMULQDQ individually so the rest of the
+ * library still runs on CPUs without it.
+ *
+ * Based on Intel's "Carry-Less Multiplication Instruction and its Usage for
+ * Computing the GCM Mode" (Gueron & Kounavis). GHASH treats bit 0 of byte 0
+ * as the highest power of x, so blocks are byte-reversed before multiplying
+ * & the 256-bit product is shifted left by 1 bit before it is reduced.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GHASH_CLMUL_COMPILED
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#define GHASH_CLMUL_TARGET __attribute__((target("pclmul,ssse3,sse2")))
+#endif
+
+#ifdef GHASH_CLMUL_COMPILED
+
+/*******************************************************************************
+ * Checks whether the CLMUL backend can be used.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if the CLMUL backend can be used, otherwise 0.
+ ******************************************************************************/
+int ghash_clmul_available(void)
+{
+    return cpu_has_pclmul();
+}
+
+/*******************************************************************************
+ * Reverses the order of the bytes in a block.
+ *
+ * inputs:
+ * - block - The block to reverse.
+ * outputs:
+ * - The reversed block.
+ ******************************************************************************/
+GHASH_CLMUL_TARGET
+__m128i ghash_clmul_byte_swap(__m128i block)
+{
+    const __m128i mask = _mm_set_epi8(
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return _mm_shuffle_epi8(block, mask);
+}
+
+/*******************************************************************************
+ * Carry-less multiplies two blocks without reducing the result.
+ * The 256-bit product is XORed into 'low' & 'high' so several products can
+ * be summed & reduced once(aggregated reduction).
+ *
+ * inputs:
+ * - a - The first block.
+ * - b - The second block.
+ * - low - Lower 128 bits of the running sum. Updated in place.
+ * - high - Upper 128 bits of the running sum. Updated in place.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+GHASH_CLMUL_TARGET
+void ghash_clmul_multiply(__m128i a, __m128i b, __m128i *low, __m128i *high)
+{
+    /* a₀b₀, a₁b₁ & the two middle terms */
+    __m128i lo = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i hi = _mm_clmulepi64_si128(a, b, 0x11);
+    __m128i mid = _mm_xor_si128(
+        _mm_clmulepi64_si128(a, b, 0x10), _mm_clmulepi64_si128(a, b, 0x01));
+
+    /* Middle terms straddle both halves */
+    *low = _mm_xor_si128(*low, _mm_xor_si128(lo, _mm_slli_si128(mid, 8)));
+    *high = _mm_xor_si128(*high, _mm_xor_si128(hi, _mm_srli_si128(mid, 8)));
+}
+
+/*******************************************************************************
+ * Reduces a 256-bit product modulo the GCM polynomial x¹²⁸+x⁷+x²+x+1.
+ *
+ * inputs:
+ * - low - Lower 128 bits of the product.
+ * - high - Upper 128 bits of the product.
+ * outputs:
+ * - The reduced 128-bit result.
+ ******************************************************************************/
+GHASH_CLMUL_TARGET
+__m128i ghash_clmul_reduce(__m128i low, __m128i high)
+{
+    __m128i carry_low, carry_high, carry_across, a, b, c, d;
+
+    /* Shift the 256-bit product left by 1 bit(bit-reflection fix up) */
+    carry_low = _mm_srli_epi32(low, 31);
+    carry_high = _mm_srli_epi32(high, 31);
+    low = _mm_slli_epi32(low, 1);
+    high = _mm_slli_epi32(high, 1);
+    carry_across = _mm_srli_si128(carry_low, 12);
+    carry_high = _mm_slli_si128(carry_high, 4);
+    carry_low = _mm_slli_si128(carry_low, 4);
+    low = _mm_or_si128(low, carry_low);
+    high = _mm_or_si128(high, carry_high);
+    high = _mm_or_si128(high, carry_across);
+
+    /* First phase of the reduction */
+    a = _mm_slli_epi32(low, 31);
+    b = _mm_slli_epi32(low, 30);
+    c = _mm_slli_epi32(low, 25);
+    a = _mm_xor_si128(a, b);
+    a = _mm_xor_si128(a, c);
+    d = _mm_srli_si128(a, 4);
+    a = _mm_slli_si128(a, 12);
+    low = _mm_xor_si128(low, a);
+
+    /* Second phase of the reduction */
+    b = _mm_srli_epi32(low, 1);
+    c = _mm_srli_epi32(low, 2);
+    a = _mm_srli_epi32(low, 7);
+    b = _mm_xor_si128(b, c);
+    b = _mm_xor_si128(b, a);
+    b = _mm_xor_si128(b, d);
+    low = _mm_xor_si128(low, b);
+
+    return _mm_xor_si128(high, low);
+}
+
+/*******************************************************************************
+ * Multiplies two byte-reversed blocks in GF(2^128).
+ *
+ * inputs:
+ * - a - The first block.
+ * - b - The second block.
+ * outputs:
+ * - a • b
+ ******************************************************************************/
+GHASH_CLMUL_TARGET
+__m128i ghash_clmul_gf_multiply(__m128i a, __m128i b)
+{
+    __m128i low = _mm_setzero_si128();
+    __m128i high = _mm_setzero_si128();
+
+    ghash_clmul_multiply(a, b, &low, &high);
+    return ghash_clmul_reduce(low, high);
+}
+
+/*******************************************************************************
+ * Precomputes H¹, H², H³ & H⁴ for the CLMUL backend.
+ *
+ * inputs:
+ * - key - The GHASH key. 'h' must already be set.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+GHASH_CLMUL_TARGET
+void ghash_clmul_key_init(ghash_key_t *key)
+{
+    __m128i h = ghash_clmul_byte_swap(
+        _mm_loadu_si128((const __m128i *)key->h));
+    __m128i power = h;
+    int i;
+
+    /* Hⁱ⁺¹ = Hⁱ • H */
+    _mm_storeu_si128((__m128i *)key->clmul_powers[0], power);
+    for (i = 1; i < 4; i++)
+    {
+        power = ghash_clmul_gf_multiply(power, h);
+        _mm_storeu_si128((__m128i *)key->clmul_powers[i], power);
+    }
+}
+
+/*******************************************************************************
+ * Absorbs data into a running GHASH using PCLMULQDQ.
+ *
+ * 4 blocks are handled per iteration with a single reduction:
+ *   Y' = (Y ⊕ X₁)•H⁴ ⊕ X₂•H³ ⊕ X₃•H² ⊕ X₄•H
+ * which equals applying Y = (Y ⊕ Xᵢ)•H four times.
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - state - The running GHASH value. Updated in place.
+ * - data - The data to absorb.
+ * - length - The length of the data in bytes.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+GHASH_CLMUL_TARGET
+void ghash_clmul_update(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    const unsigned char *data,
+    size_t length)
+{
+    const __m128i h1 = _mm_loadu_si128((const __m128i *)key->clmul_powers[0]);
+    const __m128i h2 = _mm_loadu_si128((const __m128i *)key->clmul_powers[1]);
+    const __m128i h3 = _mm_loadu_si128((const __m128i *)key->clmul_powers[2]);
+    const __m128i h4 = _mm_loadu_si128((const __m128i *)key->clmul_powers[3]);
+    __m128i y = ghash_clmul_byte_swap(_mm_loadu_si128((const __m128i *)state));
+
+    /* 4 blocks at a time with one reduction */
+    while (length >= 64)
+    {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+        const __m128i *blocks = (const __m128i *)data;
+
+        __m128i x1 = ghash_clmul_byte_swap(_mm_loadu_si128(blocks));
+        __m128i x2 = ghash_clmul_byte_swap(_mm_loadu_si128(blocks + 1));
+        __m128i x3 = ghash_clmul_byte_swap(_mm_loadu_si128(blocks + 2));
+        __m128i x4 = ghash_clmul_byte_swap(_mm_loadu_si128(blocks + 3));
+
+        ghash_clmul_multiply(_mm_xor_si128(y, x1), h4, &low, &high);
+        ghash_clmul_multiply(x2, h3, &low, &high);
+        ghash_clmul_multiply(x3, h2, &low, &high);
+        ghash_clmul_multiply(x4, h1, &low, &high);
+        y = ghash_clmul_reduce(low, high);
+
+        data += 64;
+        length -= 64;
+    }
+
+    /* Remaining blocks one at a time */
+    while (length > 0)
+    {
+        __m128i x;
+
+        /* Last block may be partial. Missing bytes count as zeros. */
+        if (length >= 16)
+        {
+            x = _mm_loadu_si128((const __m128i *)data);
+            data += 16;
+            length -= 16;
+        }
+        else
+        {
+            unsigned char padded[16] = {0};
+            memcpy(padded, data, length);
+            x = _mm_loadu_si128((const __m128i *)padded);
+            length = 0;
+        }
+
+        y = ghash_clmul_gf_multiply(
+            _mm_xor_si128(y, ghash_clmul_byte_swap(x)), h1);
+    }
+
+    _mm_storeu_si128((__m128i *)state, ghash_clmul_byte_swap(y));
+}
+
+#else
+
+/* CLMUL is not compiled in. The portable code is always used. */
+
+int ghash_clmul_available(void)
+{
+    return 0;
+}
+
+void ghash_clmul_key_init(ghash_key_t *key)
+{
+    (void)key;
+}
+
+void ghash_clmul_update(
+    const ghash_key_t *key,
+    unsigned char state[16],
+    const unsigned char *data,
+    size_t length)
+{
+    (void)key;
+    (void)state;
+    (void)data;
+    (void)length;
+}
+
+#endif
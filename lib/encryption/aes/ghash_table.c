@@ -0,0 +1,189 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "encryption/aes/ghash.h"
+
+/* Portable GHASH using Shoup's table method.
+ * H is multiplied by every GHASH_TABLE_BITS-bit value once per key. A block
+ * is then multiplied by H one chunk at a time, starting from the chunk with
+ * the highest power of x(Horner's rule):
+ *   Z = (Z • x^GHASH_TABLE_BITS) ⊕ table[chunk]
+ * Bits shifted out of Z by the multiplication by x^GHASH_TABLE_BITS are
+ * folded back in with a small reduction table.
+ *
+ * Values are held as two big-endian 64-bit halves. GHASH treats the most
+ * significant bit as x⁰, so multiplying by x is a right shift.
+ */
+
+#if GHASH_TABLE_BITS == 8
+
+/* Reduction of the 8 bits shifted out of Z, as the top 16 bits of Z */
+const uint16_t ghash_table_reduce[256] = {
+    0x0000U, 0x01C2U, 0x0384U, 0x0246U, 0x0708U, 0x06CAU, 0x048CU, 0x054EU,
+    0x0E10U, 0x0FD2U, 0x0D94U, 0x0C56U, 0x0918U, 0x08DAU, 0x0A9CU, 0x0B5EU,
+    0x1C20U, 0x1DE2U, 0x1FA4U, 0x1E66U, 0x1B28U, 0x1AEAU, 0x18ACU, 0x196EU,
+    0x1230U, 0x13F2U, 0x11B4U, 0x1076U, 0x1538U, 0x14FAU, 0x16BCU, 0x177EU,
+    0x3840U, 0x3982U, 0x3BC4U, 0x3A06U, 0x3F48U, 0x3E8AU, 0x3CCCU, 0x3D0EU,
+    0x3650U, 0x3792U, 0x35D4U, 0x3416U, 0x3158U, 0x309AU, 0x32DCU, 0x331EU,
+    0x2460U, 0x25A2U, 0x27E4U, 0x2626U, 0x2368U, 0x22AAU, 0x20ECU, 0x212EU,
+    0x2A70U, 0x2BB2U, 0x29F4U, 0x2836U, 0x2D78U, 0x2CBAU, 0x2EFCU, 0x2F3EU,
+    0x7080U, 0x7142U, 0x7304U, 0x72C6U, 0x7788U, 0x764AU, 0x740CU, 0x75CEU,
+    0x7E90U, 0x7F52U, 0x7D14U, 0x7CD6U, 0x7998U, 0x785AU, 0x7A1CU, 0x7BDEU,
+    0x6CA0U, 0x6D62U, 0x6F24U, 0x6EE6U, 0x6BA8U, 0x6A6AU, 0x682CU, 0x69EEU,
+    0x62B0U, 0x6372U, 0x6134U, 0x60F6U, 0x65B8U, 0x647AU, 0x663CU, 0x67FEU,
+    0x48C0U, 0x4902U, 0x4B44U, 0x4A86U, 0x4FC8U, 0x4E0AU, 0x4C4CU, 0x4D8EU,
+    0x46D0U, 0x4712U, 0x4554U, 0x4496U, 0x41D8U, 0x401AU, 0x425CU, 0x439EU,
+    0x54E0U, 0x5522U, 0x5764U, 0x56A6U, 0x53E8U, 0x522AU, 0x506CU, 0x51AEU,
+    0x5AF0U, 0x5B32U, 0x5974U, 0x58B6U, 0x5DF8U, 0x5C3AU, 0x5E7CU, 0x5FBEU,
+    0xE100U, 0xE0C2U, 0xE284U, 0xE346U, 0xE608U, 0xE7CAU, 0xE58CU, 0xE44EU,
+    0xEF10U, 0xEED2U, 0xEC94U, 0xED56U, 0xE818U, 0xE9DAU, 0xEB9CU, 0xEA5EU,
+    0xFD20U, 0xFCE2U, 0xFEA4U, 0xFF66U, 0xFA28U, 0xFBEAU, 0xF9ACU, 0xF86EU,
+    0xF330U, 0xF2F2U, 0xF0B4U, 0xF176U, 0xF438U, 0xF5FAU, 0xF7BCU, 0xF67EU,
+    0xD940U, 0xD882U, 0xDAC4U, 0xDB06U, 0xDE48U, 0xDF8AU, 0xDDCCU, 0xDC0EU,
+    0xD750U, 0xD692U, 0xD4D4U, 0xD516U, 0xD058U, 0xD19AU, 0xD3DCU, 0xD21EU,
+    0xC560U, 0xC4A2U, 0xC6E4U, 0xC726U, 0xC268U, 0xC3AAU, 0xC1ECU, 0xC02EU,
+    0xCB70U, 0xCAB2U, 0xC8F4U, 0xC936U, 0xCC78U, 0xCDBAU, 0xCFFCU, 0xCE3EU,
+    0x9180U, 0x9042U, 0x9204U, 0x93C6U, 0x9688U, 0x974AU, 0x950CU, 0x94CEU,
+    0x9F90U, 0x9E52U, 0x9C14U, 0x9DD6U, 0x9898U, 0x995AU, 0x9B1CU, 0x9ADEU,
+    0x8DA0U, 0x8C62U, 0x8E24U, 0x8FE6U, 0x8AA8U, 0x8B6AU, 0x892CU, 0x88EEU,
+    0x83B0U, 0x8272U, 0x8034U, 0x81F6U, 0x84B8U, 0x857AU, 0x873CU, 0x86FEU,
+    0xA9C0U, 0xA802U, 0xAA44U, 0xAB86U, 0xAEC8U, 0xAF0AU, 0xAD4CU, 0xAC8EU,
+    0xA7D0U, 0xA612U, 0xA454U, 0xA596U, 0xA0D8U, 0xA11AU, 0xA35CU, 0xA29EU,
+    0xB5E0U, 0xB422U, 0xB664U, 0xB7A6U, 0xB2E8U, 0xB32AU, 0xB16CU, 0xB0AEU,
+    0xBBF0U, 0xBA32U, 0xB874U, 0xB9B6U, 0xBCF8U, 0xBD3AU, 0xBF7CU, 0xBEBEU
+};
+
+/* Gets chunk 'c' of a block. Chunk 0 holds the lowest powers of x. */
+#define GHASH_TABLE_CHUNK(block, c) ((block)[(c)])
+
+#elif GHASH_TABLE_BITS == 4
+
+/* Reduction of the 4 bits shifted out of Z, as the top 16 bits of Z */
+const uint16_t ghash_table_reduce[16] = {
+    0x0000U, 0x1C20U, 0x3840U, 0x2460U, 0x7080U, 0x6CA0U, 0x48C0U, 0x54E0U,
+    0xE100U, 0xFD20U, 0xD940U, 0xC560U, 0x9180U, 0x8DA0U, 0xA9C0U, 0xB5E0U
+};
+
+/* Gets chunk 'c' of a block. Chunk 0 holds the lowest powers of x.
+ * The high nibble of a byte holds the lower powers of x.
+ */
+#define GHASH_TABLE_CHUNK(block, c) \
+    (((c) & 1) ? ((block)[(c) >> 1] & 0x0F) : ((block)[(c) >> 1] >> 4))
+
+#else
+#error "GHASH_TABLE_BITS must be 4 or 8"
+#endif
+
+/* Number of chunks in a 128-bit block */
+#define GHASH_TABLE_CHUNKS (128 / GHASH_TABLE_BITS)
+
+/* Reads 8 bytes as a big-endian 64-bit word */
+#define GHASH_LOAD_64(p) \
+    (((uint64_t)(p)[0] << 56) | ((uint64_t)(p)[1] << 48) | \
+     ((uint64_t)(p)[2] << 40) | ((uint64_t)(p)[3] << 32) | \
+     ((uint64_t)(p)[4] << 24) | ((uint64_t)(p)[5] << 16) | \
+     ((uint64_t)(p)[6] << 8) | ((uint64_t)(p)[7]))
+
+/*******************************************************************************
+ * Writes a 64-bit word as 8 big-endian bytes.
+ *
+ * inputs:
+ * - p - Where to write the bytes.
+ * - w - The word to write.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_store_64(unsigned char *p, uint64_t w)
+{
+    int i;
+    for (i = 7; i >= 0; i--)
+    {
+        p[i] = (unsigned char)w;
+        w >>= 8;
+    }
+}
+
+/*******************************************************************************
+ * Precomputes the multiplication table of H for the portable backend.
+ * table[i] = i • H, where the top bit of 'i' is the coefficient of x⁰.
+ *
+ * inputs:
+ * - key - The GHASH key. key->h must already be set.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_table_key_init(ghash_key_t *key)
+{
+    uint64_t high = GHASH_LOAD_64(key->h);
+    uint64_t low = GHASH_LOAD_64(key->h + 8);
+    int i, j;
+
+    /* Only the top bit set(x⁰) is H itself */
+    i = GHASH_TABLE_SIZE / 2;
+    key->table_high[i] = high;
+    key->table_low[i] = low;
+
+    /* Each lower bit is the previous entry multiplied by x */
+    for (i >>= 1; i > 0; i >>= 1)
+    {
+        uint64_t carry = low & 1;
+        low = (high << 63) | (low >> 1);
+        high >>= 1;
+
+        /* x¹²⁸ = x⁷ + x² + x + 1 */
+        if (carry)
+        {
+            high ^= (uint64_t)0xE1 << 56;
+        }
+
+        key->table_high[i] = high;
+        key->table_low[i] = low;
+    }
+
+    /* Every other entry is the sum of the entries of its bits */
+    key->table_high[0] = 0;
+    key->table_low[0] = 0;
+    for (i = 2; i < GHASH_TABLE_SIZE; i <<= 1)
+    {
+        for (j = 1; j < i; j++)
+        {
+            key->table_high[i + j] = key->table_high[i] ^ key->table_high[j];
+            key->table_low[i + j] = key->table_low[i] ^ key->table_low[j];
+        }
+    }
+}
+
+/*******************************************************************************
+ * Multiplies a block by H using the precomputed table.
+ *
+ * inputs:
+ * - key - The GHASH key.
+ * - block - The block to multiply. Replaced with block • H.
+ * outputs:
+ * - None.
+ ******************************************************************************/
+void ghash_table_multiply(const ghash_key_t *key, unsigned char block[16])
+{
+    /* Start with the chunk holding the highest powers of x */
+    int chunk = GHASH_TABLE_CHUNK(block, GHASH_TABLE_CHUNKS - 1);
+    uint64_t high = key->table_high[chunk];
+    uint64_t low = key->table_low[chunk];
+    int c;
+
+    for (c = GHASH_TABLE_CHUNKS - 2; c >= 0; c--)
+    {
+        /* Z = Z • x^GHASH_TABLE_BITS */
+        int remainder = (int)(low & (GHASH_TABLE_SIZE - 1));
+        low = (high << (64 - GHASH_TABLE_BITS)) | (low >> GHASH_TABLE_BITS);
+        high >>= GHASH_TABLE_BITS;
+        high ^= (uint64_t)ghash_table_reduce[remainder] << 48;
+
+        /* Z = Z ⊕ (chunk • H) */
+        chunk = GHASH_TABLE_CHUNK(block, c);
+        high ^= key->table_high[chunk];
+        low ^= key->table_low[chunk];
+    }
+
+    ghash_store_64(block, high);
+    ghash_store_64(block + 8, low);
+}
@@ -88,19 +88,23 @@ int keyschedule_get_number_of_rounds(int key_size)
 }
 
 /**
- * Initialize the key expansion context.
+ * Set up a key expansion context that writes into the given round keys.
  *
  * inputs:
+ * - context - The context to set up.
+ * - round_keys - Where the round keys will be written.
+ *                Must hold (number of rounds + 1) * 16 bytes.
  * - key - The key to use for the key expansion.
  * - key_size - The size of the key.
  * outputs:
- * - The key expansion context.
+ * - None.
  */
-key_expansion_context_t *key_expansion_init(const unsigned char *key, int key_size)
+void key_expansion_setup(
+    key_expansion_context_t *context,
+    roundKeys_t *round_keys,
+    const unsigned char *key,
+    int key_size)
 {
-    /* Allocate memory for the context */
-    key_expansion_context_t *context = malloc(sizeof(key_expansion_context_t));
-
     /* Set the key size */
     context->key_size = key_size;
 
@@ -120,9 +124,8 @@ key_expansion_context_t *key_expansion_init(const unsigned char *key, int key_si
      */
     context->total_words = (context->num_rounds + 1) * 4;
 
-    /* Allocate memory for the round keys. */
-    context->round_keys = malloc(sizeof(roundKeys_t));
-    context->round_keys->keys = malloc((context->num_rounds + 1) * 16);
+    /* Store the round keys in the given location */
+    context->round_keys = round_keys;
     context->round_keys->count = context->num_rounds + 1;
 
     /* Copy the original key to the start of the round keys array. */
@@ -130,6 +133,29 @@ key_expansion_context_t *key_expansion_init(const unsigned char *key, int key_si
 
     /* Update the number of words processed */
     context->words_processed = context->num_words;
+}
+
+/**
+ * Initialize the key expansion context.
+ *
+ * inputs:
+ * - key - The key to use for the key expansion.
+ * - key_size - The size of the key.
+ * outputs:
+ * - The key expansion context.
+ */
+key_expansion_context_t *key_expansion_init(const unsigned char *key, int key_size)
+{
+    /* Allocate memory for the context */
+    key_expansion_context_t *context = malloc(sizeof(key_expansion_context_t));
+
+    /* Allocate memory for the round keys. */
+    int num_rounds = keyschedule_get_number_of_rounds(key_size);
+    roundKeys_t *round_keys = malloc(sizeof(roundKeys_t));
+    round_keys->keys = malloc((num_rounds + 1) * 16);
+
+    /* Set up the context to write into the allocated round keys */
+    key_expansion_setup(context, round_keys, key, key_size);
 
     /* Return the context */
     return context;
@@ -290,3 +316,32 @@ roundKeys_t *key_expansion(const unsigned char *key, int key_size)
     /* Return the round keys */
     return round_keys;
 }
+
+
+/**
+ * Expand the key into a caller-provided buffer.
+ * Unlike key_expansion(), no memory is allocated.
+ *
+ * @param key The key to expand.
+ * @param key_size The size of the key.
+ * @param keys Where to store the round keys.
+ *             Must hold (number of rounds + 1) * 16 bytes.
+ * @return The number of round keys generated.
+ */
+int key_expansion_into(
+    const unsigned char *key,
+    int key_size,
+    unsigned char *keys)
+{
+    /* Context & round keys live on the stack */
+    key_expansion_context_t context;
+    roundKeys_t round_keys;
+    round_keys.keys = keys;
+
+    /* Generate the round keys */
+    key_expansion_setup(&context, &round_keys, key, key_size);
+    key_expansion_expand_keys(&context, key);
+
+    /* Return the number of round keys */
+    return round_keys.count;
+}
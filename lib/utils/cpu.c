@@ -0,0 +1,62 @@
+#include "utils/cpu.h"
+
+/* CPUID is only available on x86 */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CPU_HAS_CPUID
+#include <cpuid.h>
+#endif
+
+/*******************************************************************************
+ * Reads the feature flags in ECX from CPUID leaf 1.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - The ECX feature flags. 0 if CPUID is not available.
+ ******************************************************************************/
+unsigned int cpu_feature_flags_ecx(void) {
+#ifdef CPU_HAS_CPUID
+    unsigned int eax, ebx, ecx, edx;
+
+    /* Leaf 1 holds the processor feature flags */
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+        return 0;
+    }
+    return ecx;
+#else
+    return 0;
+#endif
+}
+
+/*******************************************************************************
+ * Checks whether the CPU supports the AES-NI instructions.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if AES-NI is supported, otherwise 0.
+ ******************************************************************************/
+int cpu_has_aesni(void) {
+#ifdef CPU_HAS_CPUID
+    return (cpu_feature_flags_ecx() & bit_AES) != 0;
+#else
+    return 0;
+#endif
+}
+
+/*******************************************************************************
+ * Checks whether the CPU supports the PCLMULQDQ(carry-less multiply)
+ * instruction.
+ *
+ * inputs:
+ * - None.
+ * outputs:
+ * - 1 if PCLMULQDQ is supported, otherwise 0.
+ ******************************************************************************/
+int cpu_has_pclmul(void) {
+#ifdef CPU_HAS_CPUID
+    return (cpu_feature_flags_ecx() & bit_PCLMUL) != 0;
+#else
+    return 0;
+#endif
+}
@@ -1,8 +1,49 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "compression/compression.h"
+#include "compression/huffman/frequency_table.h"
+#include "compression/huffman/canonical.h"
+#include "compression/huffman/decode_table.h"
 #include "test_shared.h"
 
+/* Compresses data in memory into a new buffer.
+ * Exits if the data could not be compressed.
+*/
+unsigned char *test_compress(const unsigned char *data, size_t size,
+    size_t *compressed_size) {
+
+    size_t bound = huffman_compress_bound(size);
+    unsigned char *compressed = (unsigned char *)malloc(bound);
+    if (huffman_compress_buffer(data, size, compressed, bound,
+            compressed_size) != 0) {
+        printf("Test failed\n");
+        printf("Could not compress %lu bytes\n", (unsigned long)size);
+        exit(1);
+    }
+    return compressed;
+}
+
+/* Decompresses data in memory into a new buffer.
+ * Returns NULL if the data could not be decompressed.
+*/
+unsigned char *test_decompress(const unsigned char *data, size_t size,
+    size_t *decompressed_size) {
+
+    size_t capacity;
+    if (huffman_decompressed_size(data, size, &capacity) != 0) {
+        return NULL;
+    }
+    unsigned char *decompressed = (unsigned char *)malloc(
+        capacity > 0 ? capacity : 1);
+    if (huffman_decompress_buffer(data, size, decompressed, capacity,
+            decompressed_size) != 0) {
+        free(decompressed);
+        return NULL;
+    }
+    return decompressed;
+}
+
 void test_compression() {
 
     const char *input = "test_input.txt";
@@ -49,7 +90,797 @@ void test_compression() {
     }
 }
 
+/* Ensures data in memory survives compression & decompression. */
+void test_compression_buffer() {
+
+    const char *input = "test_input.txt";
+    const char *compressed = "compressed.huffman";
+    unsigned char data[5000];
+    size_t sizes[4];
+    int i;
+
+    /* Text-like data with a skewed distribution */
+    for (i = 0; i < 5000; i++) {
+        data[i] = (unsigned char)("aaaabbc d\n"[(i * 7 + i / 13) % 10]);
+    }
+
+    /* Empty, single byte, small, larger */
+    sizes[0] = 0;
+    sizes[1] = 1;
+    sizes[2] = 12;
+    sizes[3] = 5000;
+
+    for (i = 0; i < 4; i++) {
+        size_t compressed_size, decompressed_size;
+        unsigned char *packed = test_compress(
+            data, sizes[i], &compressed_size);
+        unsigned char *unpacked = test_decompress(
+            packed, compressed_size, &decompressed_size);
+
+        if (unpacked == NULL || decompressed_size != sizes[i] ||
+            memcmp(unpacked, data, sizes[i]) != 0) {
+            printf("Test failed\n");
+            printf("%lu bytes did not round trip\n", (unsigned long)sizes[i]);
+            exit(1);
+        }
+        free(unpacked);
+
+        /* The file written by huffman_compress() must be identical */
+        FILE *file = fopen(input, "wb");
+        fwrite(data, 1, sizes[i], file);
+        fclose(file);
+        huffman_compress(input, compressed);
+
+        unsigned char *expected = (unsigned char *)malloc(compressed_size + 1);
+        file = fopen(compressed, "rb");
+        size_t expected_size = fread(expected, 1, compressed_size + 1, file);
+        fclose(file);
+        if (expected_size != compressed_size ||
+            memcmp(expected, packed, compressed_size) != 0) {
+            printf("Test failed\n");
+            printf("Buffer of %lu bytes does not match huffman_compress()\n",
+                (unsigned long)sizes[i]);
+            exit(1);
+        }
+        free(expected);
+        free(packed);
+    }
+
+    /* A single repeated byte has no codes at all */
+    size_t compressed_size, decompressed_size;
+    memset(data, 'z', 100);
+    unsigned char *packed = test_compress(data, 100, &compressed_size);
+    unsigned char *unpacked = test_decompress(
+        packed, compressed_size, &decompressed_size);
+    if (unpacked == NULL || decompressed_size != 100 ||
+        memcmp(unpacked, data, 100) != 0) {
+        printf("Test failed\n");
+        printf("Single repeated byte did not round trip\n");
+        exit(1);
+    }
+    free(unpacked);
+
+    /* Truncated data is rejected */
+    if (test_decompress(packed, 3,
+            &decompressed_size) != NULL) {
+        printf("Test failed\n");
+        printf("Truncated header was accepted\n");
+        exit(1);
+    }
+    free(packed);
+    for (i = 0; i < 5000; i++) {
+        data[i] = (unsigned char)(i % 7);
+    }
+    packed = test_compress(data, 5000, &compressed_size);
+    if (test_decompress(packed, compressed_size - 10,
+            &decompressed_size) != NULL) {
+        printf("Test failed\n");
+        printf("Truncated data was accepted\n");
+        exit(1);
+    }
+    free(packed);
+
+    remove(input);
+    remove(compressed);
+}
+
+/* Compresses & decompresses data both in memory & through files.
+ * Exits if either does not give back the original data.
+*/
+void test_compression_round_trip(const char *name, const unsigned char *data,
+    size_t size) {
+
+    const char *input = "test_input.txt";
+    const char *compressed = "compressed.huffman";
+    const char *decompressed = "decompressed.txt";
+    size_t compressed_size, decompressed_size;
+
+    /* In memory */
+    unsigned char *packed = test_compress(data, size, &compressed_size);
+    unsigned char *unpacked = test_decompress(
+        packed, compressed_size, &decompressed_size);
+    if (unpacked == NULL || decompressed_size != size ||
+        memcmp(unpacked, data, size) != 0) {
+        printf("Test failed\n");
+        printf("%s did not round trip in memory\n", name);
+        exit(1);
+    }
+    free(packed);
+
+    /* Through files */
+    FILE *file = fopen(input, "wb");
+    fwrite(data, 1, size, file);
+    fclose(file);
+    huffman_compress(input, compressed);
+    huffman_decompress(compressed, decompressed);
+
+    file = fopen(decompressed, "rb");
+    decompressed_size = fread(unpacked, 1, size, file);
+    int extra = fgetc(file);
+    fclose(file);
+    if (decompressed_size != size || extra != EOF ||
+        memcmp(unpacked, data, size) != 0) {
+        printf("Test failed\n");
+        printf("%s did not round trip through files\n", name);
+        exit(1);
+    }
+    free(unpacked);
+
+    remove(input);
+    remove(compressed);
+    remove(decompressed);
+}
+
+/* Ensures multi-megabyte inputs survive compression & decompression. */
+void test_compression_large() {
+
+    size_t size = 6 * 1024 * 1024;
+    unsigned char *data = (unsigned char *)malloc(size);
+    unsigned long state = 1;
+    size_t i;
+
+    /* Every byte value, evenly spread */
+    for (i = 0; i < size; i++) {
+        state = state * 1103515245UL + 12345UL;
+        data[i] = (unsigned char)(state >> 16);
+    }
+    test_compression_round_trip("Random bytes", data, size);
+
+    /* Mostly zeros, like the padded fields of the database */
+    for (i = 0; i < size; i++) {
+        data[i] = i % 256 < 20 ? (unsigned char)('a' + i % 26) : 0;
+    }
+    test_compression_round_trip("Padded records", data, size);
+
+    /* Fibonacci frequencies give the longest possible codes. Their lengths
+     * are limited to HUFFMAN_MAX_CODE_LENGTH, which still needs more than one
+     * decode table.
+     */
+    size_t fibonacci[28];
+    size_t position = 0;
+    int j;
+    fibonacci[0] = 1;
+    fibonacci[1] = 1;
+    for (j = 2; j < 28; j++) {
+        fibonacci[j] = fibonacci[j - 1] + fibonacci[j - 2];
+    }
+    for (j = 0; j < 28 && position < size; j++) {
+        for (i = 0; i < fibonacci[j] && position < size; i++) {
+            data[position++] = (unsigned char)(j * 9);
+        }
+    }
+    /* Shuffle so long & short codes are mixed */
+    for (i = position - 1; i > 0; i--) {
+        state = state * 1103515245UL + 12345UL;
+        size_t other = (size_t)((state >> 8) % (i + 1));
+        unsigned char temp = data[i];
+        data[i] = data[other];
+        data[other] = temp;
+    }
+    test_compression_round_trip("Fibonacci frequencies", data, position);
+
+    free(data);
+}
+
+/* Ensures the header is small & data from the previous format still
+ * decompresses.
+*/
+void test_compression_format() {
+
+    const char *compressed = "compressed.huffman";
+    const char *decompressed = "decompressed.txt";
+    const char *content = "Hello Huffman!";
+    size_t size = strlen(content);
+    size_t compressed_size, decompressed_size;
+
+    /* Version 1 header: frequency table | leftover bits | size */
+    unsigned char v1[HUFFMAN_V1_HEADER_SIZE + 6];
+    unsigned int frequency_table[256] = { 0 };
+    unsigned int v1_size = (unsigned int)size;
+    const unsigned char v1_data[6] = { 0x5b, 0x20, 0xa4, 0x5b, 0xec, 0xfb };
+    size_t i;
+    for (i = 0; i < size; i++) {
+        frequency_table[(unsigned char)content[i]] += 1;
+    }
+    memcpy(v1, frequency_table, sizeof(frequency_table));
+    v1[256 * sizeof(unsigned int)] = 0;
+    memcpy(v1 + 256 * sizeof(unsigned int) + 1, &v1_size, sizeof(v1_size));
+    memcpy(v1 + HUFFMAN_V1_HEADER_SIZE, v1_data, sizeof(v1_data));
+
+    /* In memory */
+    unsigned char *unpacked = test_decompress(
+        v1, sizeof(v1), &decompressed_size);
+    if (unpacked == NULL || decompressed_size != size ||
+        memcmp(unpacked, content, size) != 0) {
+        printf("Test failed\n");
+        printf("Version 1 data did not decompress in memory\n");
+        exit(1);
+    }
+    free(unpacked);
+
+    /* Through files */
+    FILE *file = fopen(compressed, "wb");
+    fwrite(v1, 1, sizeof(v1), file);
+    fclose(file);
+    huffman_decompress(compressed, decompressed);
+    char text[32];
+    file = fopen(decompressed, "rb");
+    decompressed_size = fread(text, 1, sizeof(text), file);
+    fclose(file);
+    if (decompressed_size != size || memcmp(text, content, size) != 0) {
+        printf("Test failed\n");
+        printf("Version 1 data did not decompress through files\n");
+        exit(1);
+    }
+    remove(compressed);
+    remove(decompressed);
+
+    /* The new header only stores code lengths */
+    unsigned char *packed = test_compress(
+        (const unsigned char *)content, size, &compressed_size);
+    if (memcmp(packed, HUFFMAN_MAGIC, 3) != 0 ||
+        packed[3] != HUFFMAN_VERSION || compressed_size > 64) {
+        printf("Test failed\n");
+        printf("Header is %lu bytes\n", (unsigned long)compressed_size);
+        exit(1);
+    }
+
+    /* Unknown versions are rejected */
+    packed[3] = HUFFMAN_VERSION + 1;
+    if (test_decompress(packed, compressed_size,
+            &decompressed_size) != NULL) {
+        printf("Test failed\n");
+        printf("Unknown version was accepted\n");
+        exit(1);
+    }
+    free(packed);
+}
+
+/* Ensures buffers given by the caller are filled exactly & ones too small
+ * are refused.
+*/
+void test_compression_caller_buffers() {
+
+    unsigned char data[3000];
+    unsigned char compressed[6000];
+    unsigned char decompressed[3000];
+    size_t compressed_size, decompressed_size, size;
+    size_t i;
+
+    for (i = 0; i < sizeof(data); i++) {
+        data[i] = (unsigned char)("caller"[i % 6] + i % 5);
+    }
+
+    /* Exactly the compressed size is enough */
+    if (huffman_compress_bound(sizeof(data)) > sizeof(compressed) ||
+        huffman_compress_buffer(data, sizeof(data), compressed,
+            sizeof(compressed), &compressed_size) != 0 ||
+        huffman_compress_buffer(data, sizeof(data), compressed,
+            compressed_size, &size) != 0 || size != compressed_size) {
+        printf("Test failed\n");
+        printf("Could not compress into a buffer of the exact size\n");
+        exit(1);
+    }
+    if (huffman_compress_buffer(data, sizeof(data), compressed,
+            compressed_size - 1, &size) == 0) {
+        printf("Test failed\n");
+        printf("Compressed into a buffer too small\n");
+        exit(1);
+    }
+
+    /* The header gives the size to decompress into */
+    if (huffman_decompressed_size(compressed, compressed_size, &size) != 0 ||
+        size != sizeof(data) ||
+        huffman_decompress_buffer(compressed, compressed_size, decompressed,
+            sizeof(decompressed), &decompressed_size) != 0 ||
+        decompressed_size != sizeof(data) ||
+        memcmp(decompressed, data, sizeof(data)) != 0) {
+        printf("Test failed\n");
+        printf("Could not decompress into a buffer of the exact size\n");
+        exit(1);
+    }
+    if (huffman_decompress_buffer(compressed, compressed_size, decompressed,
+            sizeof(decompressed) - 1, &decompressed_size) == 0) {
+        printf("Test failed\n");
+        printf("Decompressed into a buffer too small\n");
+        exit(1);
+    }
+
+    /* Lengths needing about the most second tables still fit without
+     * allocating: 41 prefixes each with codes of 11 to 15 bits, & the rest
+     * of the first table filled by short codes.
+     */
+    unsigned char lengths[256];
+    int short_lengths[8] = { 1, 2, 3, 4, 6, 8, 9, 10 };
+    int j, k, byte = 0;
+    memset(lengths, 0, sizeof(lengths));
+    for (j = 0; j < 8; j++) {
+        lengths[byte++] = (unsigned char)short_lengths[j];
+    }
+    for (j = 0; j < 41; j++) {
+        for (k = 11; k <= 15; k++) {
+            lengths[byte++] = (unsigned char)k;
+        }
+        lengths[byte++] = 15;
+    }
+    HuffmanDecodeTable_t table;
+    if (!huffman_code_lengths_valid(lengths) ||
+        create_huffman_decode_table_from_lengths(&table, lengths) != 0 ||
+        table.entries != table.fixed_entries) {
+        printf("Test failed\n");
+        printf("Long codes did not fit the fixed decode table\n");
+        exit(1);
+    }
+    free_huffman_decode_table(&table);
+}
+
+/* Ensures bytes are counted correctly in memory & from files, whatever the
+ * size & alignment of the data.
+*/
+void test_frequency_table() {
+
+    size_t size = 100000;
+    unsigned char *data = (unsigned char *)malloc(size + 8);
+    unsigned int expected[256];
+    unsigned int actual[256];
+    size_t sizes[6] = { 0, 7, 1023, 1024, 1031, 100000 };
+    size_t i;
+    int j, offset;
+
+    for (i = 0; i < size + 8; i++) {
+        data[i] = i % 256 < 20 ? (unsigned char)(i * 7) : 0;
+    }
+
+    for (j = 0; j < 6; j++) {
+        for (offset = 0; offset < 8; offset += 3) {
+            memset(expected, 0, sizeof(expected));
+            for (i = 0; i < sizes[j]; i++) {
+                expected[data[offset + i]] += 1;
+            }
+            create_frequency_table_buffer(data + offset, sizes[j], actual);
+            if (memcmp(expected, actual, sizeof(expected)) != 0) {
+                printf("Test failed\n");
+                printf("Wrong counts for %lu bytes at offset %d\n",
+                    (unsigned long)sizes[j], offset);
+                exit(1);
+            }
+        }
+    }
+
+    /* From a file of several read blocks */
+    const char *input = "test_input.txt";
+    FILE *file = fopen(input, "wb");
+    for (j = 0; j < 3; j++) {
+        fwrite(data, 1, size, file);
+    }
+    fclose(file);
+    memset(expected, 0, sizeof(expected));
+    for (i = 0; i < size; i++) {
+        expected[data[i]] += 3;
+    }
+    create_frequency_table(input, actual);
+    if (memcmp(expected, actual, sizeof(expected)) != 0) {
+        printf("Test failed\n");
+        printf("Wrong counts for a file\n");
+        exit(1);
+    }
+    remove(input);
+
+    free(data);
+}
+
+/* Ensures streams compress to the same data as buffers & decompress back. */
+void test_compression_stream() {
+
+    size_t sizes[4] = { 0, 1, 5000, 300000 };
+    size_t compressed_size;
+    int j;
+
+    for (j = 0; j < 4; j++) {
+        size_t size = sizes[j];
+        unsigned char *data = (unsigned char *)malloc(size + 1);
+        unsigned char *read_back = (unsigned char *)malloc(size + 1);
+        size_t i;
+        for (i = 0; i < size; i++) {
+            data[i] = (unsigned char)("stream"[i % 6] + i / 1000 % 3);
+        }
+
+        /* Compress from one stream to another */
+        FILE *input = tmpfile();
+        FILE *compressed = tmpfile();
+        FILE *output = tmpfile();
+        fwrite(data, 1, size, input);
+        rewind(input);
+        if (huffman_compress_stream(input, compressed) != 0) {
+            printf("Test failed\n");
+            printf("Could not compress a stream of %lu bytes\n",
+                (unsigned long)size);
+            exit(1);
+        }
+
+        /* Same as compressing a buffer */
+        unsigned char *expected = test_compress(
+            data, size, &compressed_size);
+        unsigned char *actual = (unsigned char *)malloc(compressed_size + 1);
+        rewind(compressed);
+        if (fread(actual, 1, compressed_size + 1, compressed) !=
+                compressed_size ||
+            memcmp(actual, expected, compressed_size) != 0) {
+            printf("Test failed\n");
+            printf("Stream of %lu bytes does not match the buffer\n",
+                (unsigned long)size);
+            exit(1);
+        }
+
+        /* And back */
+        rewind(compressed);
+        if (huffman_decompress_stream(compressed, output) != 0) {
+            printf("Test failed\n");
+            printf("Could not decompress a stream of %lu bytes\n",
+                (unsigned long)size);
+            exit(1);
+        }
+        rewind(output);
+        if (fread(read_back, 1, size + 1, output) != size ||
+            memcmp(read_back, data, size) != 0) {
+            printf("Test failed\n");
+            printf("Stream of %lu bytes did not round trip\n",
+                (unsigned long)size);
+            exit(1);
+        }
+
+        fclose(input);
+        fclose(compressed);
+        fclose(output);
+        free(expected);
+        free(actual);
+        free(read_back);
+        free(data);
+    }
+}
+
+/* Ensures block compressed data round trips with any number of threads &
+ * any part of it can be read on its own.
+*/
+void test_compression_blocks() {
+
+    size_t size = 1024 * 1024 + 123;
+    unsigned char *data = (unsigned char *)malloc(size);
+    unsigned char *part = (unsigned char *)malloc(size);
+    unsigned long state = 7;
+    size_t compressed_size, decompressed_size;
+    size_t i;
+
+    /* Blocks of different kinds of data */
+    for (i = 0; i < size; i++) {
+        state = state * 1103515245UL + 12345UL;
+        if (i / 100000 % 3 == 0) {
+            data[i] = (unsigned char)(state >> 16);
+        } else if (i / 100000 % 3 == 1) {
+            data[i] = (unsigned char)('a' + (state >> 16) % 4);
+        } else {
+            data[i] = 'z';
+        }
+    }
+
+    int threads[3] = { 1, 2, 5 };
+    size_t block_sizes[3] = { 0, 65536, 1000 };
+    size_t sizes[4] = { 0, 1, 65536, 1024 * 1024 + 123 };
+    int t, b, j;
+
+    for (t = 0; t < 3; t++) {
+        if (huffman_set_threads(threads[t]) != 0) {
+            continue;
+        }
+        for (b = 0; b < 3; b++) {
+            for (j = 0; j < 4; j++) {
+                unsigned char *packed = huffman_compress_blocks(
+                    data, sizes[j], block_sizes[b], &compressed_size);
+                unsigned char *unpacked = huffman_decompress_blocks(
+                    packed, compressed_size, &decompressed_size);
+                if (unpacked == NULL || decompressed_size != sizes[j] ||
+                    memcmp(unpacked, data, sizes[j]) != 0) {
+                    printf("Test failed\n");
+                    printf("%lu bytes in blocks of %lu with %d threads did "
+                        "not round trip\n", (unsigned long)sizes[j],
+                        (unsigned long)block_sizes[b], threads[t]);
+                    exit(1);
+                }
+                free(unpacked);
+                free(packed);
+            }
+        }
+    }
+    huffman_set_threads(1);
+
+    /* Parts within a block, across blocks & whole blocks */
+    unsigned char *packed = huffman_compress_blocks(
+        data, size, 65536, &compressed_size);
+    size_t ranges[5][2] = {
+        { 0, 10 }, { 65530, 20 }, { 65536, 65536 }, { 100, 300000 },
+        { size - 5, 5 }
+    };
+    for (j = 0; j < 5; j++) {
+        if (huffman_read_blocks(packed, compressed_size, ranges[j][0],
+                ranges[j][1], part) != 0 ||
+            memcmp(part, data + ranges[j][0], ranges[j][1]) != 0) {
+            printf("Test failed\n");
+            printf("Could not read %lu bytes at %lu\n",
+                (unsigned long)ranges[j][1], (unsigned long)ranges[j][0]);
+            exit(1);
+        }
+    }
+    if (huffman_read_blocks(packed, compressed_size, size - 5, 6, part) == 0) {
+        printf("Test failed\n");
+        printf("Range past the end was accepted\n");
+        exit(1);
+    }
+
+    /* A block index pointing past the data is rejected */
+    packed[HUFFMAN_BLOCKS_HEADER_SIZE + 7] = 0x7F;
+    if (huffman_decompress_blocks(packed, compressed_size,
+            &decompressed_size) != NULL) {
+        printf("Test failed\n");
+        printf("Invalid block index was accepted\n");
+        exit(1);
+    }
+
+    free(packed);
+    free(part);
+    free(data);
+}
+
+/* Ensures data compressed at the LZ level round trips, is smaller than
+ * Huffman alone for repetitive records & corrupt data is rejected.
+*/
+void test_compression_lz() {
+
+    /* Records padded with zeros, spanning several LZ blocks */
+    size_t size = 2 * LZ_BLOCK_SIZE + 777;
+    unsigned char *data = (unsigned char *)calloc(size, 1);
+    unsigned long state = 11;
+    size_t i;
+    for (i = 0; i + 256 <= size; i += 256) {
+        sprintf((char *)data + i, "patient%lu@example.com",
+            (unsigned long)(i / 256 % 5000));
+    }
+
+    /* Then random bytes with no matches, & short repeats */
+    size_t random_start = LZ_BLOCK_SIZE + 1000;
+    for (i = random_start; i < random_start + 300000; i++) {
+        state = state * 1103515245UL + 12345UL;
+        data[i] = (unsigned char)(state >> 16);
+    }
+    for (i = random_start + 300000; i < random_start + 400000; i++) {
+        data[i] = (unsigned char)"abcab"[i % 5];
+    }
+
+    size_t sizes[5] = { 0, 1, 5, 70000, 2 * LZ_BLOCK_SIZE + 777 };
+    size_t offsets[5] = { 0, 0, 0, random_start, 0 };
+    int j;
+    for (j = 0; j < 5; j++) {
+        const unsigned char *input = data + offsets[j];
+        size_t bound = compression_bound(COMPRESSION_LEVEL_LZ, sizes[j]);
+        unsigned char *compressed = (unsigned char *)malloc(bound);
+        unsigned char *decompressed = (unsigned char *)malloc(sizes[j] + 1);
+        size_t compressed_size, decompressed_size, expected_size;
+
+        if (compression_compress(COMPRESSION_LEVEL_LZ, input, sizes[j],
+                compressed, bound, &compressed_size) != 0 ||
+            compressed_size > bound ||
+            compression_decompressed_size(compressed, compressed_size,
+                &expected_size) != 0 || expected_size != sizes[j] ||
+            compression_decompress(compressed, compressed_size, decompressed,
+                sizes[j], &decompressed_size) != 0 ||
+            decompressed_size != sizes[j] ||
+            memcmp(decompressed, input, sizes[j]) != 0) {
+            printf("Test failed\n");
+            printf("%lu bytes did not round trip at the LZ level\n",
+                (unsigned long)sizes[j]);
+            exit(1);
+        }
+        free(compressed);
+        free(decompressed);
+    }
+
+    /* Matches must beat Huffman alone on records */
+    size_t records_size = LZ_BLOCK_SIZE;
+    size_t huffman_size, lz_size;
+    unsigned char *huffman_data = test_compress(data, records_size,
+        &huffman_size);
+    size_t bound = lz_compress_bound(records_size);
+    unsigned char *lz_data = (unsigned char *)malloc(bound);
+    unsigned char *decompressed = (unsigned char *)malloc(records_size);
+    if (lz_compress_buffer(data, records_size, lz_data, bound,
+            &lz_size) != 0 || lz_size * 4 > huffman_size) {
+        printf("Test failed\n");
+        printf("LZ level was not smaller: %lu vs %lu bytes\n",
+            (unsigned long)lz_size, (unsigned long)huffman_size);
+        exit(1);
+    }
+
+    /* Huffman data is still read by the level dispatch */
+    size_t decompressed_size;
+    if (compression_decompress(huffman_data, huffman_size, decompressed,
+            records_size, &decompressed_size) != 0 ||
+        memcmp(decompressed, data, records_size) != 0) {
+        printf("Test failed\n");
+        printf("Huffman data was not decompressed\n");
+        exit(1);
+    }
+
+    /* Too small an output, trailing bytes & damaged streams are rejected */
+    if (lz_decompress_buffer(lz_data, lz_size, decompressed,
+            records_size - 1, &decompressed_size) == 0 ||
+        lz_decompress_buffer(lz_data, lz_size + 1, decompressed,
+            records_size, &decompressed_size) == 0) {
+        printf("Test failed\n");
+        printf("Invalid LZ data was accepted\n");
+        exit(1);
+    }
+    /* Damage anywhere must not write past the output */
+    for (i = 5; i < lz_size; i += lz_size / 50 + 1) {
+        lz_data[i] ^= 0x5A;
+        if (lz_decompress_buffer(lz_data, lz_size, decompressed,
+                records_size, &decompressed_size) == 0 &&
+            decompressed_size > records_size) {
+            printf("Test failed\n");
+            printf("Damaged LZ data at %lu was accepted\n",
+                (unsigned long)i);
+            exit(1);
+        }
+        lz_data[i] ^= 0x5A;
+    }
+
+    /* Unknown level */
+    if (compression_compress(99, data, 10, lz_data, bound,
+            &lz_size) == 0) {
+        printf("Test failed\n");
+        printf("Unknown level was accepted\n");
+        exit(1);
+    }
+
+    free(huffman_data);
+    free(lz_data);
+    free(decompressed);
+    free(data);
+}
+
+/* Ensures the zero run filter round trips on its own & in front of each
+ * level, never grows past its bound & rejects invalid data.
+*/
+void test_compression_zero_rle() {
+
+    size_t size = 100000;
+    unsigned char *data = (unsigned char *)calloc(size, 1);
+    unsigned char *encoded = (unsigned char *)malloc(zero_rle_bound(size));
+    unsigned char *decoded = (unsigned char *)malloc(size + 1);
+    size_t encoded_size, decoded_size;
+    size_t i;
+    int j, k;
+
+    /* Fields padded with zeros, short zero runs, & zeros at both ends */
+    for (i = 0; i + 256 <= size / 2; i += 256) {
+        sprintf((char *)data + i + 3, "patient%lu", (unsigned long)i);
+    }
+    for (i = size / 2; i < size - 100; i++) {
+        data[i] = (unsigned char)(i % 5 == 0 ? 0 : 'a' + i % 7);
+    }
+
+    /* Literals with the longest runs too short to store: the worst case */
+    unsigned char *worst = (unsigned char *)malloc(size);
+    for (i = 0; i < size; i++) {
+        worst[i] = (unsigned char)(i % 4 == 0 ? 'x' : 0);
+    }
+
+    const unsigned char *inputs[2] = { data, worst };
+    size_t sizes[6] = { 0, 1, 4, 129, 50000, 100000 };
+    for (j = 0; j < 2; j++) {
+        for (k = 0; k < 6; k++) {
+            if (zero_rle_encode(inputs[j], sizes[k], encoded,
+                    zero_rle_bound(sizes[k]), &encoded_size) != 0 ||
+                encoded_size > zero_rle_bound(sizes[k]) ||
+                zero_rle_decode(encoded, encoded_size, decoded, sizes[k],
+                    &decoded_size) != 0 ||
+                decoded_size != sizes[k] ||
+                memcmp(decoded, inputs[j], sizes[k]) != 0) {
+                printf("Test failed\n");
+                printf("%lu bytes did not round trip the zero run filter\n",
+                    (unsigned long)sizes[k]);
+                exit(1);
+            }
+        }
+    }
+
+    /* Padding is removed */
+    zero_rle_encode(data, size / 2, encoded, zero_rle_bound(size),
+        &encoded_size);
+    if (encoded_size * 8 > size / 2) {
+        printf("Test failed\n");
+        printf("Zero padding was not removed: %lu bytes\n",
+            (unsigned long)encoded_size);
+        exit(1);
+    }
+
+    /* Truncated data & too small an output are rejected */
+    if (zero_rle_decode(encoded, encoded_size - 1, decoded, size,
+            &decoded_size) == 0 ||
+        zero_rle_decode(encoded, encoded_size, decoded, size / 2 - 1,
+            &decoded_size) == 0) {
+        printf("Test failed\n");
+        printf("Invalid zero run data was accepted\n");
+        exit(1);
+    }
+
+    /* In front of each level */
+    int levels[2] = { COMPRESSION_LEVEL_HUFFMAN, COMPRESSION_LEVEL_LZ };
+    for (j = 0; j < 2; j++) {
+        int level = levels[j] | COMPRESSION_FILTER_ZERO_RLE;
+        size_t bound = compression_bound(level, size);
+        unsigned char *compressed = (unsigned char *)malloc(bound);
+        size_t compressed_size, expected_size;
+
+        if (compression_compress(level, data, size, compressed, bound,
+                &compressed_size) != 0 ||
+            compression_decompressed_size(compressed, compressed_size,
+                &expected_size) != 0 || expected_size != size ||
+            compression_decompress(compressed, compressed_size, decoded,
+                size, &decoded_size) != 0 ||
+            decoded_size != size || memcmp(decoded, data, size) != 0) {
+            printf("Test failed\n");
+            printf("Zero run filter did not round trip at level %d\n",
+                levels[j]);
+            exit(1);
+        }
+
+        /* A header claiming more data than was filtered is rejected */
+        compressed[5] += 1;
+        if (compression_decompress(compressed, compressed_size, decoded,
+                size + 1, &decoded_size) == 0) {
+            printf("Test failed\n");
+            printf("Invalid zero run filter size was accepted\n");
+            exit(1);
+        }
+        free(compressed);
+    }
+
+    free(worst);
+    free(data);
+    free(encoded);
+    free(decoded);
+}
+
 int main() {
     test_run_method("Huffman compression", test_compression);
+    test_run_method("Huffman compression in memory", test_compression_buffer);
+    test_run_method("Huffman compression (large)", test_compression_large);
+    test_run_method("Huffman compression format", test_compression_format);
+    test_run_method("Huffman compression into caller buffers",
+        test_compression_caller_buffers);
+    test_run_method("Frequency table", test_frequency_table);
+    test_run_method("Huffman compression of streams", test_compression_stream);
+    test_run_method("Huffman block compression", test_compression_blocks);
+    test_run_method("LZ compression level", test_compression_lz);
+    test_run_method("Zero run filter", test_compression_zero_rle);
     return 0;
 }
\ No newline at end of file
@@ -7,7 +7,9 @@
 #include "application/users/doctor.h"
 #include "application/users/patient.h"
 #include "utils/hash.h"
+#include "utils/hex.h"
 #include "utils/scanner.h"
+#include "encryption/encryption.h"
 #include "test_shared.h"
 
 /*******************************************************************************
@@ -22,47 +24,44 @@
 void test_seed_data_alternate(hospital_record_t *records) {
 
     /* Doctor Walter White */
-    doctor_details_t *doctor = (doctor_details_t *)calloc(
-        1, sizeof(doctor_details_t)
-    );
-    strcpy(doctor->username, "1");
-    strcpy(doctor->name, "Walter White");
-    strcpy(doctor->email, "walter.white@example.com");
-    strcpy(doctor->phone, "1234567890");
-    doctor->password = hash_string("1");
-    strcpy(doctor->specialization, "Cardiology");
-    strcpy(doctor->license_number, "1234567890");
-    doctor_signup_silent(records, doctor);
+    doctor_details_t doctor;
+    memset(&doctor, 0, sizeof(doctor));
+    doctor.username = "1";
+    doctor.name = "Walter White";
+    doctor.email = "walter.white@example.com";
+    doctor.phone = "1234567890";
+    doctor.password = hash_string("1");
+    doctor.specialization = "Cardiology";
+    doctor.license_number = "1234567890";
+    doctor_add(records, &doctor);
 
     /* Patient Gus Fring */
-    patient_details_t *patient = (patient_details_t *)calloc(
-        1, sizeof(patient_details_t)
-    );
-    strcpy(patient->username, "2");
-    strcpy(patient->name, "Gus Fring");
-    strcpy(patient->email, "gus.fring@example.com");
-    strcpy(patient->phone, "1234567890");
-    patient->password = hash_string("2");
-    strcpy(patient->blood_type, "A+");
-    strcpy(patient->medical_history, "None");
-    patient->weight = 100;
-    patient->height = 180;
-    patient_signup_silent(records, patient);
+    patient_details_t patient;
+    memset(&patient, 0, sizeof(patient));
+    patient.username = "2";
+    patient.name = "Gus Fring";
+    patient.email = "gus.fring@example.com";
+    patient.phone = "1234567890";
+    patient.password = hash_string("2");
+    strcpy(patient.blood_type, "A+");
+    patient.medical_history = "None";
+    patient.weight = 100;
+    patient.height = 180;
+    patient_add(records, &patient);
 
     /* Patient Hector Salamanca */
-    patient_details_t *patient2 = (patient_details_t *)calloc(
-        1, sizeof(patient_details_t)
-    );
-    strcpy(patient2->username, "3");
-    strcpy(patient2->name, "Hector Salamanca");
-    strcpy(patient2->email, "hector.salamanca@example.com");
-    strcpy(patient2->phone, "1234567890");
-    patient2->password = hash_string("3");
-    strcpy(patient2->blood_type, "B-");
-    strcpy(patient2->medical_history, "None");
-    patient2->weight = 100;
-    patient2->height = 180;
-    patient_signup_silent(records, patient2);
+    patient_details_t patient2;
+    memset(&patient2, 0, sizeof(patient2));
+    patient2.username = "3";
+    patient2.name = "Hector Salamanca";
+    patient2.email = "hector.salamanca@example.com";
+    patient2.phone = "1234567890";
+    patient2.password = hash_string("3");
+    strcpy(patient2.blood_type, "B-");
+    patient2.medical_history = "None";
+    patient2.weight = 100;
+    patient2.height = 180;
+    patient_add(records, &patient2);
 }
 
 /*******************************************************************************
@@ -124,8 +123,828 @@ void test_load_save_database() {
         
 }
 
+/*******************************************************************************
+ * Tests that saving writes only the encrypted database & that the serialized
+ * database round trips.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_save_database_in_memory() {
+
+    /* Hospital name */
+    const char *hospital_name = "Los Pollos Hermanos";
+
+    /* Save a seeded database */
+    hospital_record_t *records = load_database(hospital_name);
+    test_seed_data_alternate(records);
+    save_database(records);
+
+    /* No temporary files should be left */
+    FILE *file = fopen("Los Pollos Hermanos.db", "rb");
+    FILE *compressed = fopen("Los Pollos Hermanos_compressed.db", "rb");
+    if (file != NULL || compressed != NULL) {
+        printf("Test failed\n");
+        printf("Temporary database files were written\n");
+        exit(1);
+    }
+
+    /* Serialize & read back into an empty database */
+    size_t size;
+    unsigned char *data = database_serialize(records, &size);
+    hospital_record_t *copy = load_database("Los Pollos Hermanos Copy");
+    if (data == NULL || database_deserialize(copy, data, size) != 0 ||
+        copy->num_doctors != 1 || copy->num_patients != 2 ||
+        strcmp(find_patient(copy, "3")->blood_type, "B-") != 0) {
+        printf("Test failed\n");
+        printf("Serialized database did not round trip\n");
+        exit(1);
+    }
+
+    /* A truncated database is rejected */
+    hospital_record_t *truncated = load_database("Los Pollos Hermanos Copy");
+    if (database_deserialize(truncated, data, size - 1) == 0) {
+        printf("Test failed\n");
+        printf("Truncated database was accepted\n");
+        exit(1);
+    }
+
+    free(data);
+    close_database(truncated);
+    close_database(copy);
+    close_dummy_hospital(records);
+}
+
+/*******************************************************************************
+ * Tests that databases saved at every compression level load again.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_database_compression_levels() {
+
+    int levels[4] = {
+        COMPRESSION_LEVEL_HUFFMAN,
+        COMPRESSION_LEVEL_HUFFMAN | COMPRESSION_FILTER_ZERO_RLE,
+        COMPRESSION_LEVEL_LZ,
+        COMPRESSION_LEVEL_LZ | COMPRESSION_FILTER_ZERO_RLE
+    };
+    int i;
+
+    for (i = 0; i < 4; i++) {
+        if (database_set_compression_level(levels[i]) != 0) {
+            printf("Test failed\n");
+            printf("Compression level %d was rejected\n", levels[i]);
+            exit(1);
+        }
+
+        /* Save & load back */
+        hospital_record_t *records = load_database("Compression Levels");
+        test_seed_data_alternate(records);
+        save_database(records);
+        hospital_record_t *loaded = load_database("Compression Levels");
+        if (loaded->num_doctors != 1 || loaded->num_patients != 2 ||
+            strcmp(find_patient(loaded, "2")->name, "Gus Fring") != 0) {
+            printf("Test failed\n");
+            printf("Database saved at level %d did not load\n", levels[i]);
+            exit(1);
+        }
+        close_database(records);
+        close_dummy_hospital(loaded);
+    }
+
+    /* Unknown levels are not used */
+    if (database_set_compression_level(COMPRESSION_FILTER_ZERO_RLE) == 0 ||
+        database_set_compression_level(99) == 0) {
+        printf("Test failed\n");
+        printf("Unknown compression level was accepted\n");
+        exit(1);
+    }
+    database_set_compression_level(DATABASE_DEFAULT_COMPRESSION_LEVEL);
+}
+
+/*******************************************************************************
+ * Tests that the username index finds every user it holds, & none it does
+ * not, as users are added & removed.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_username_index() {
+
+    int num_users = 5000;
+    char (*usernames)[16] = malloc(num_users * sizeof(*usernames));
+    username_index_t index;
+    int i;
+
+    username_index_init(&index);
+    if (username_index_find(&index, "missing") != NULL ||
+        username_index_remove(&index, "missing") != NULL) {
+        printf("Test failed\n");
+        printf("Empty index found a user\n");
+        exit(1);
+    }
+
+    /* Add enough users to grow the index several times */
+    for (i = 0; i < num_users; i++) {
+        sprintf(usernames[i], "user%d", i);
+        if (username_index_insert(&index, usernames[i], usernames[i]) != 0) {
+            printf("Test failed\n");
+            printf("Could not add %s\n", usernames[i]);
+            exit(1);
+        }
+    }
+    if (username_index_insert(&index, "user7", NULL) == 0) {
+        printf("Test failed\n");
+        printf("Username was added twice\n");
+        exit(1);
+    }
+
+    /* Remove every third user, which shifts the others back */
+    for (i = 0; i < num_users; i += 3) {
+        if (username_index_remove(&index, usernames[i]) != usernames[i]) {
+            printf("Test failed\n");
+            printf("Could not remove %s\n", usernames[i]);
+            exit(1);
+        }
+    }
+    for (i = 0; i < num_users; i++) {
+        void *expected = i % 3 == 0 ? NULL : usernames[i];
+        if (username_index_find(&index, usernames[i]) != expected) {
+            printf("Test failed\n");
+            printf("Wrong result for %s after removals\n", usernames[i]);
+            exit(1);
+        }
+    }
+    if (index.count != (size_t)(num_users - (num_users + 2) / 3)) {
+        printf("Test failed\n");
+        printf("Index holds %lu users\n", (unsigned long)index.count);
+        exit(1);
+    }
+
+    /* Removed users can be added again */
+    for (i = 0; i < num_users; i += 3) {
+        username_index_insert(&index, usernames[i], usernames[i]);
+    }
+    for (i = 0; i < num_users; i++) {
+        if (username_index_find(&index, usernames[i]) != usernames[i]) {
+            printf("Test failed\n");
+            printf("%s was not found after being added again\n",
+                usernames[i]);
+            exit(1);
+        }
+    }
+
+    username_index_free(&index);
+    free(usernames);
+}
+
+/*******************************************************************************
+ * Tests that patients & doctors are found by username after signup, a
+ * change of username, deletion & loading.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_find_users() {
+
+    hospital_record_t *records = load_database("Index Hospital");
+    test_seed_data_alternate(records);
+
+    if (find_doctor(records, "1") == NULL || find_patient(records, "2") == NULL ||
+        find_patient(records, "1") != NULL || find_doctor(records, "2") != NULL) {
+        printf("Test failed\n");
+        printf("Users were not found after signup\n");
+        exit(1);
+    }
+
+    /* Renamed the way the update menus do */
+    patient_details_t *patient = find_patient(records, "3");
+    username_index_remove(&records->patient_index, patient->username);
+    patient->username = string_pool_copy(&records->strings, "hector");
+    username_index_insert(&records->patient_index, patient->username, patient);
+    if (find_patient(records, "3") != NULL ||
+        find_patient(records, "hector") != patient) {
+        printf("Test failed\n");
+        printf("Renamed patient was not found\n");
+        exit(1);
+    }
+
+    /* Deleting from the front of the list & deleting nobody */
+    if (delete_patient_silent(records, "2") != 1 ||
+        delete_patient_silent(records, "nobody") != 0) {
+        printf("Test failed\n");
+        printf("Deleting reported the wrong result\n");
+        exit(1);
+    }
+    if (find_patient(records, "2") != NULL || records->num_patients != 1 ||
+        records->patients != patient || patient->next != NULL) {
+        printf("Test failed\n");
+        printf("Deleted patient was still found\n");
+        exit(1);
+    }
+
+    /* Loading indexes the saved users */
+    save_database(records);
+    hospital_record_t *loaded = load_database("Index Hospital");
+    if (find_patient(loaded, "hector") == NULL ||
+        find_doctor(loaded, "1") == NULL || find_patient(loaded, "2") != NULL) {
+        printf("Test failed\n");
+        printf("Loaded users were not found\n");
+        exit(1);
+    }
+
+    /* Users linked in directly are found once the indexes are rebuilt */
+    patient_details_t fields;
+    memset(&fields, 0, sizeof(fields));
+    fields.username = "linked";
+    patient_details_t *linked = patient_copy(loaded, &fields);
+    linked->next = loaded->patients;
+    loaded->patients = linked;
+    loaded->num_patients++;
+    if (database_rebuild_indexes(loaded) != 0 ||
+        find_patient(loaded, "linked") != linked ||
+        find_patient(loaded, "hector") == NULL) {
+        printf("Test failed\n");
+        printf("Rebuilt index did not find the users\n");
+        exit(1);
+    }
+
+    close_database(records);
+    close_dummy_hospital(loaded);
+}
+
+/*******************************************************************************
+ * Tests that patients & doctors are added to the end of the lists, one at a
+ * time or in a batch, & that a batch with a taken username adds nobody.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_import_batch() {
+
+    hospital_record_t *records = load_database("Import Hospital");
+    test_seed_data_alternate(records);
+
+    patient_details_t patients[3];
+    char usernames[3][16];
+    int i;
+    memset(patients, 0, sizeof(patients));
+    for (i = 0; i < 3; i++) {
+        sprintf(usernames[i], "imported%d", i);
+        patients[i].username = usernames[i];
+    }
+
+    /* A username already in use, or used twice, rejects the whole batch */
+    patients[1].username = "2";
+    if (patient_import_batch(records, patients, 3) == 0) {
+        printf("Test failed\n");
+        printf("Batch with a taken username was imported\n");
+        exit(1);
+    }
+    patients[1].username = "imported0";
+    if (patient_import_batch(records, patients, 3) == 0 ||
+        records->num_patients != 2 || find_patient(records, "imported0") != NULL) {
+        printf("Test failed\n");
+        printf("Batch with a repeated username was imported\n");
+        exit(1);
+    }
+
+    /* A valid batch goes after the existing patients, in order */
+    patients[1].username = usernames[1];
+    if (patient_import_batch(records, patients, 3) != 0) {
+        printf("Test failed\n");
+        printf("Valid batch was not imported\n");
+        exit(1);
+    }
+
+    /* An imported batch is saved, so it is there after reopening */
+    hospital_record_t *reopened = load_database("Import Hospital");
+    if (reopened->num_patients != 5 ||
+        find_patient(reopened, "imported2") == NULL) {
+        printf("Test failed\n");
+        printf("Imported batch was not saved\n");
+        exit(1);
+    }
+    close_database(reopened);
+    patient_details_t *imported[3];
+    for (i = 0; i < 3; i++) {
+        imported[i] = find_patient(records, usernames[i]);
+    }
+    if (records->num_patients != 5 || imported[1] == NULL ||
+        imported[1]->username == patients[1].username ||
+        records->patients->next->next != imported[0] ||
+        imported[0]->next != imported[1] || imported[2]->next != NULL ||
+        records->patients_tail != imported[2]) {
+        printf("Test failed\n");
+        printf("Batch was not added to the end of the list\n");
+        exit(1);
+    }
+
+    /* Deleting the last patient moves the end of the list back */
+    delete_patient_silent(records, "imported2");
+    patient_details_t late;
+    memset(&late, 0, sizeof(late));
+    late.username = "late";
+    patient_details_t *patient = patient_signup_silent(records, &late);
+    if (patient == NULL || records->patients_tail != patient ||
+        imported[1]->next != patient || records->num_patients != 5) {
+        printf("Test failed\n");
+        printf("Signup after deleting the last patient was misplaced\n");
+        exit(1);
+    }
+
+    /* Doctors work the same way */
+    doctor_details_t doctors[2];
+    memset(doctors, 0, sizeof(doctors));
+    doctors[0].username = "doctor0";
+    doctors[1].username = "doctor1";
+    if (doctor_import_batch(records, doctors, 2) != 0 ||
+        records->num_doctors != 3 ||
+        records->doctors->next != find_doctor(records, "doctor0") ||
+        records->doctors_tail != find_doctor(records, "doctor1")) {
+        printf("Test failed\n");
+        printf("Doctors were not imported\n");
+        exit(1);
+    }
+
+    /* Saved & loaded in the same order */
+    save_database(records);
+    hospital_record_t *loaded = load_database("Import Hospital");
+    database_load_all(loaded);
+    if (loaded->num_patients != 5 ||
+        strcmp(loaded->patients_tail->username, "late") != 0 ||
+        strcmp(loaded->doctors_tail->username, "doctor1") != 0) {
+        printf("Test failed\n");
+        printf("Imported users were not loaded in order\n");
+        exit(1);
+    }
+
+    close_database(records);
+    close_dummy_hospital(loaded);
+}
+
+/*******************************************************************************
+ * Tests that records are copied into the database's own memory, with
+ * repeated strings stored once & released records reused.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_record_store() {
+
+    hospital_record_t *records = load_database("Store Hospital");
+    test_seed_data_alternate(records);
+
+    /* Patients are copies, sharing the interned medical history */
+    patient_details_t *gus = find_patient(records, "2");
+    patient_details_t *hector = find_patient(records, "3");
+    if (strcmp(gus->name, "Gus Fring") != 0 ||
+        strcmp(gus->blood_type, "A+") != 0 ||
+        gus->medical_history != hector->medical_history ||
+        strcmp(gus->medical_history, "None") != 0 ||
+        gus->email == hector->email) {
+        printf("Test failed\n");
+        printf("Patient strings were not copied or interned\n");
+        exit(1);
+    }
+
+    /* The caller's strings can change once the patient is added */
+    char name[32];
+    patient_details_t fields;
+    memset(&fields, 0, sizeof(fields));
+    strcpy(name, "Skyler White");
+    fields.username = "skyler";
+    fields.name = name;
+    strcpy(fields.blood_type, "AB+");
+    patient_details_t *skyler = patient_signup_silent(records, &fields);
+    strcpy(name, "changed");
+    if (skyler == NULL || strcmp(skyler->name, "Skyler White") != 0 ||
+        strcmp(skyler->medical_history, "") != 0) {
+        printf("Test failed\n");
+        printf("Patient was not copied\n");
+        exit(1);
+    }
+
+    /* A deleted patient's memory is used by the next patient */
+    delete_patient_silent(records, "skyler");
+    fields.username = "walter";
+    fields.name = "Walter White Jr";
+    if (patient_signup_silent(records, &fields) != skyler) {
+        printf("Test failed\n");
+        printf("Deleted patient's memory was not reused\n");
+        exit(1);
+    }
+
+    /* The longest blood type & strings longer than a block survive loading */
+    char *long_history = (char *)malloc(STRING_POOL_BLOCK_SIZE + 1);
+    memset(long_history, 'x', STRING_POOL_BLOCK_SIZE);
+    long_history[STRING_POOL_BLOCK_SIZE] = '\0';
+    if (string_pool_copy(&records->strings, long_history) == NULL ||
+        strcmp(string_pool_intern(&records->strings, long_history),
+            long_history) != 0) {
+        printf("Test failed\n");
+        printf("Long string was not copied\n");
+        exit(1);
+    }
+    free(long_history);
+
+    save_database(records);
+    hospital_record_t *loaded = load_database("Store Hospital");
+    patient_details_t *walter = find_patient(loaded, "walter");
+    if (walter == NULL || strcmp(walter->blood_type, "AB+") != 0 ||
+        strcmp(walter->name, "Walter White Jr") != 0 ||
+        find_patient(loaded, "2")->medical_history !=
+            find_patient(loaded, "3")->medical_history ||
+        strcmp(find_doctor(loaded, "1")->specialization, "Cardiology") != 0) {
+        printf("Test failed\n");
+        printf("Stored patients were not loaded\n");
+        exit(1);
+    }
+
+    close_database(records);
+    close_dummy_hospital(loaded);
+}
+
+/*******************************************************************************
+ * Changes a byte of a file.
+ * 
+ * inputs:
+ * - filename - The file
+ * - offset - The byte to change
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_corrupt_byte(const char *filename, long offset) {
+
+    FILE *file = fopen(filename, "r+b");
+    fseek(file, offset, SEEK_SET);
+    int byte = fgetc(file);
+    fseek(file, offset, SEEK_SET);
+    fputc(byte ^ 1, file);
+    fclose(file);
+}
+
+/*******************************************************************************
+ * Tests that a paged database file only reads the records used, keeps
+ * records added or renamed since it was opened, & rejects damaged pages.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_paged_database_file() {
+
+    const char *filename = "Paged Hospital_encrypted.db";
+    patient_details_t patients[300];
+    char usernames[300][16];
+    int i;
+
+    /* Enough patients for several pages */
+    hospital_record_t *records = load_database("Paged Hospital");
+    test_seed_data_alternate(records);
+    memset(patients, 0, sizeof(patients));
+    for (i = 0; i < 300; i++) {
+        sprintf(usernames[i], "paged%d", i);
+        patients[i].username = usernames[i];
+        patients[i].name = usernames[i];
+    }
+    if (patient_import_batch(records, patients, 300) != 0) {
+        printf("Test failed\n");
+        printf("Patients were not imported\n");
+        exit(1);
+    }
+    save_database(records);
+    close_database(records);
+    if (!database_file_is_paged(filename)) {
+        printf("Test failed\n");
+        printf("Database was not saved as a paged file\n");
+        exit(1);
+    }
+
+    /* Loading reads no records until they are used */
+    hospital_record_t *loaded = load_database("Paged Hospital");
+    if (loaded->file == NULL || loaded->num_patients != 302 ||
+        loaded->num_doctors != 1 || loaded->patients != NULL ||
+        loaded->patient_index.count != 0) {
+        printf("Test failed\n");
+        printf("Paged database was read when loaded\n");
+        exit(1);
+    }
+    patient_details_t *patient = find_patient(loaded, "paged250");
+    if (patient == NULL || strcmp(patient->name, "paged250") != 0 ||
+        loaded->patient_index.count != 1 ||
+        find_patient(loaded, "paged250") != patient ||
+        find_patient(loaded, "nobody") != NULL) {
+        printf("Test failed\n");
+        printf("Patient was not found in the paged database\n");
+        exit(1);
+    }
+
+    /* A renamed patient is only found by its new username */
+    username_index_remove(&loaded->patient_index, patient->username);
+    patient->username = string_pool_copy(&loaded->strings, "renamed");
+    username_index_insert(&loaded->patient_index, patient->username, patient);
+    patient_details_t late;
+    memset(&late, 0, sizeof(late));
+    late.username = "late";
+    if (find_patient(loaded, "paged250") != NULL ||
+        find_patient(loaded, "renamed") != patient ||
+        patient_signup_silent(loaded, &late) == NULL) {
+        printf("Test failed\n");
+        printf("Renamed patient was found by its old username\n");
+        exit(1);
+    }
+
+    /* Reading the rest keeps the saved order, then the added patients */
+    database_load_all(loaded);
+    int count = 0;
+    patient_details_t *patients_list;
+    for (patients_list = loaded->patients; patients_list != NULL;
+        patients_list = patients_list->next) {
+        count++;
+    }
+    if (loaded->file != NULL || count != 303 ||
+        loaded->num_patients != 303 ||
+        strcmp(loaded->patients->username, "2") != 0 ||
+        strcmp(loaded->patients_tail->username, "late") != 0 ||
+        find_patient(loaded, "paged251")->next->next->next !=
+            find_patient(loaded, "paged254")) {
+        printf("Test failed\n");
+        printf("Paged database was not read in order\n");
+        exit(1);
+    }
+    save_database(loaded);
+    close_database(loaded);
+
+    /* A damaged page is found when it is read, rather than the doctor on it
+     * being reported missing
+     */
+    test_corrupt_byte(filename, DATABASE_FILE_ALIGNMENT + 8);
+    loaded = load_database("Paged Hospital");
+    doctor_details_t *damaged = NULL;
+    if (database_file_find_doctor(loaded, "1", &damaged) != 1 ||
+        damaged != NULL || find_patient(loaded, "renamed") == NULL) {
+        printf("Test failed\n");
+        printf("Damaged page was read\n");
+        exit(1);
+    }
+    close_database(loaded);
+
+    /* A damaged header is found when the file is opened */
+    unsigned char *key = convert_hex_string_to_bytes(
+        "feffe9928665731c6d6a8f9467308308");
+    database_file_t *file = database_file_open(filename, key, 16);
+    test_corrupt_byte(filename, 20);
+    if (file == NULL || database_file_open(filename, key, 16) != NULL) {
+        printf("Test failed\n");
+        printf("Damaged header was accepted\n");
+        exit(1);
+    }
+    database_file_close(file);
+
+    /* Databases saved whole still load */
+    records = load_database("Paged Hospital Whole");
+    test_seed_data_alternate(records);
+    size_t size;
+    unsigned char *data = database_serialize(records, &size);
+    size_t bound = compression_bound(DATABASE_DEFAULT_COMPRESSION_LEVEL, size);
+    unsigned char *compressed = (unsigned char *)malloc(bound);
+    compression_compress(DATABASE_DEFAULT_COMPRESSION_LEVEL, data, size,
+        compressed, bound, &size);
+    unsigned char *nonce = convert_hex_string_to_bytes(
+        "cafebabefacedbaddecaf888");
+    aes_gcm_encrypt_buffer_to_file(compressed, size,
+        "Paged Hospital Whole_encrypted.db", key, 16, NULL, 0, nonce);
+    loaded = load_database("Paged Hospital Whole");
+    if (loaded->file != NULL || loaded->num_patients != 2 ||
+        strcmp(find_patient(loaded, "3")->name, "Hector Salamanca") != 0) {
+        printf("Test failed\n");
+        printf("Database saved whole did not load\n");
+        exit(1);
+    }
+
+    free(key);
+    free(nonce);
+    free(data);
+    free(compressed);
+    close_database(records);
+    close_dummy_hospital(loaded);
+    remove(filename);
+}
+
+/*******************************************************************************
+ * Tests that logged changes are replayed when the database is loaded, that
+ * a change cut short is dropped, & that checkpoints write the changes to the
+ * database file.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_database_log() {
+
+    const char *log_name = "Log Hospital_encrypted.log";
+    const char *old_log_name = "Log Hospital_encrypted.log.old";
+
+    hospital_record_t *records = load_database("Log Hospital");
+    test_seed_data_alternate(records);
+    save_database(records);
+
+    /* Add, change, rename & delete patients, logging each change */
+    patient_details_t fields;
+    memset(&fields, 0, sizeof(fields));
+    fields.username = "jesse";
+    fields.name = "Jesse Pinkman";
+    strcpy(fields.blood_type, "O+");
+    patient_signup_silent(records, &fields);
+    fields.username = "skinny";
+    fields.name = "Skinny Pete";
+    patient_signup_silent(records, &fields);
+
+    patient_details_t *patient = find_patient(records, "2");
+    patient->name = string_pool_copy(&records->strings, "Gustavo Fring");
+    database_log_patient(records, "2", patient);
+
+    patient = find_patient(records, "3");
+    username_index_remove(&records->patient_index, patient->username);
+    patient->username = string_pool_copy(&records->strings, "hector");
+    username_index_insert(&records->patient_index, patient->username, patient);
+    database_log_patient(records, "3", patient);
+
+    delete_patient_silent(records, "jesse");
+    database_log_delete_patient(records, "jesse");
+
+    doctor_details_t *doctor = find_doctor(records, "1");
+    doctor->specialization = string_pool_intern(&records->strings, "Oncology");
+    database_log_doctor(records, "1", doctor);
+    close_database(records);
+
+    /* The changes are replayed on top of the database file */
+    hospital_record_t *loaded = load_database("Log Hospital");
+    if (loaded->num_patients != 3 || find_patient(loaded, "jesse") != NULL ||
+        find_patient(loaded, "3") != NULL ||
+        find_patient(loaded, "hector") == NULL ||
+        strcmp(find_patient(loaded, "2")->name, "Gustavo Fring") != 0 ||
+        strcmp(find_doctor(loaded, "1")->specialization, "Oncology") != 0) {
+        printf("Test failed\n");
+        printf("Logged changes were not replayed\n");
+        exit(1);
+    }
+    database_load_all(loaded);
+    if (strcmp(loaded->patients_tail->username, "skinny") != 0) {
+        printf("Test failed\n");
+        printf("Logged patient was not added to the end of the list\n");
+        exit(1);
+    }
+    close_database(loaded);
+
+    /* A change cut short by a crash is dropped. The changes before it are
+     * saved & later changes go to a new log.
+     */
+    FILE *log = fopen(log_name, "ab");
+    fwrite("partial", 1, 7, log);
+    fclose(log);
+    loaded = load_database("Log Hospital");
+    patient = find_patient(loaded, "skinny");
+    if (patient == NULL) {
+        printf("Test failed\n");
+        printf("Changes before a damaged change were dropped\n");
+        exit(1);
+    }
+    log = fopen(log_name, "rb");
+    if (log != NULL || loaded->log.checkpoint != 2 ||
+        loaded->log.size != 0) {
+        if (log != NULL) {
+            fclose(log);
+        }
+        printf("Test failed\n");
+        printf("Log was appended to after a damaged change\n");
+        exit(1);
+    }
+    patient->weight = 80;
+    database_log_patient(loaded, "skinny", patient);
+    close_database(loaded);
+    loaded = load_database("Log Hospital");
+    if (find_patient(loaded, "skinny")->weight != 80) {
+        printf("Test failed\n");
+        printf("Change after a damaged change was not replayed\n");
+        exit(1);
+    }
+
+    /* Changes made during a checkpoint go to a new log */
+    database_log_checkpoint(loaded);
+    fields.username = "badger";
+    fields.name = "Badger";
+    patient_signup_silent(loaded, &fields);
+    if (database_log_wait(loaded) != 0) {
+        printf("Test failed\n");
+        printf("Checkpoint failed\n");
+        exit(1);
+    }
+    FILE *old_log = fopen(old_log_name, "rb");
+    if (old_log != NULL) {
+        fclose(old_log);
+        printf("Test failed\n");
+        printf("Checkpoint did not remove the old log\n");
+        exit(1);
+    }
+    close_database(loaded);
+
+    /* The database file holds the checkpoint, the log only the change after */
+    loaded = load_database("Log Hospital");
+    if (loaded->file == NULL || loaded->file->checkpoint != 3 ||
+        loaded->log.checkpoint != 3 || loaded->log.sequence != 1 ||
+        find_patient(loaded, "badger") == NULL ||
+        find_patient(loaded, "skinny")->weight != 80) {
+        printf("Test failed\n");
+        printf("Checkpoint was not written to the database file\n");
+        exit(1);
+    }
+    close_database(loaded);
+
+    /* A checkpoint that did not finish is written again */
+    rename(log_name, old_log_name);
+    loaded = load_database("Log Hospital");
+    log = fopen(log_name, "rb");
+    old_log = fopen(old_log_name, "rb");
+    if (log != NULL || old_log != NULL || loaded->log.checkpoint <= 3 ||
+        find_patient(loaded, "badger") == NULL) {
+        if (log != NULL) {
+            fclose(log);
+        }
+        if (old_log != NULL) {
+            fclose(old_log);
+        }
+        printf("Test failed\n");
+        printf("Unfinished checkpoint was not written again\n");
+        exit(1);
+    }
+
+    close_dummy_hospital(loaded);
+}
+
+/*******************************************************************************
+ * Tests that a database can be saved over a database file that already
+ * exists, which rename() alone does not do on every system.
+ * 
+ * inputs:
+ * - None
+ * outputs:
+ * - None
+ ******************************************************************************/
+void test_save_twice() {
+
+    hospital_record_t *records = load_database("Twice Hospital");
+    test_seed_data_alternate(records);
+    save_database(records);
+    find_patient(records, "2")->weight = 75;
+    save_database(records);
+    close_database(records);
+
+    /* The second save replaced the first & no temporary file is left */
+    hospital_record_t *loaded = load_database("Twice Hospital");
+    FILE *temporary = fopen("Twice Hospital_encrypted.db.tmp", "rb");
+    if (temporary != NULL) {
+        fclose(temporary);
+    }
+    if (temporary != NULL || loaded->file == NULL ||
+        loaded->file->checkpoint != 2 || loaded->num_patients != 2 ||
+        find_patient(loaded, "2")->weight != 75) {
+        printf("Test failed\n");
+        printf("Second save did not replace the database file\n");
+        exit(1);
+    }
+
+    close_dummy_hospital(loaded);
+}
+
 int main() {
 
     test_run_method("load & save database", test_load_save_database);
+    test_run_method("save database in memory", test_save_database_in_memory);
+    test_run_method("database compression levels",
+        test_database_compression_levels);
+    test_run_method("username index", test_username_index);
+    test_run_method("find users by username", test_find_users);
+    test_run_method("import patients & doctors in a batch", test_import_batch);
+    test_run_method("store records & strings", test_record_store);
+    test_run_method("paged database file", test_paged_database_file);
+    test_run_method("save database twice", test_save_twice);
+    test_run_method("database log", test_database_log);
     return 0;
 }
\ No newline at end of file
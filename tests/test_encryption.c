@@ -5,6 +5,10 @@
 #include "encryption/aes/core.h"
 #include "encryption/aes/gcm.h"
 #include "encryption/aes/operations.h"
+#include "encryption/aes/ttable.h"
+#include "encryption/aes/aesni.h"
+#include "encryption/aes/ghash.h"
+#include "encryption/encryption.h"
 #include "utils/hex.h"
 
 void test_bytes_to_hex_str() {
@@ -151,6 +155,325 @@ void test_fips_example() {
     free(input_bytes);
 }
 
+/* Validates the expanded-key API against the FIPS-197 examples.
+ * The same context is reused for encryption & decryption.
+*/
+void test_fips_example_ctx() {
+
+    /* Declare variables */
+    int i;
+    aes_context_t ctx;
+    const char *keys_hex[3] = {
+        "000102030405060708090a0b0c0d0e0f",
+        "000102030405060708090a0b0c0d0e0f1011121314151617",
+        "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    };
+    const char *expected_hex[3] = {
+        "69C4E0D86A7B0430D8CDB78070B4C55A",
+        "DDA97CA4864CDFE06EAF70A0EC0D7191",
+        "8EA2B7CA516745BFEAFC49904B496089"
+    };
+    int key_sizes[3] = {16, 24, 32};
+    byte *input_bytes = convert_hex_string_to_bytes("00112233445566778899AABBCCDDEEFF");
+
+    /* Iterate over the different keys */
+    for (i = 0; i < 3; i++) {
+
+        /* Expand the key once */
+        byte *key = convert_hex_string_to_bytes(keys_hex[i]);
+        aes_context_init(&ctx, key, key_sizes[i]);
+
+        /* Encrypt in place */
+        unsigned char block[16];
+        memcpy(block, input_bytes, 16);
+        aes_encrypt_block_ctx(block, &ctx, block);
+
+        /* Ensure the result matches the expected hex */
+        char *result_hex = convert_bytes_to_hex_string(block, 16);
+        if ( strcmp(result_hex, expected_hex[i]) != 0 ) {
+            printf("Test failed\n");
+            printf("Key size: %d\n", key_sizes[i]);
+            printf("Expected: %s\n", expected_hex[i]);
+            printf("Actual: %s\n", result_hex);
+            exit(1);
+        }
+
+        /* Decrypt in place & ensure the input is recovered */
+        aes_decrypt_block_ctx(block, &ctx, block);
+        if ( memcmp(block, input_bytes, 16) != 0 ) {
+            printf("Test failed\n");
+            printf("Key size: %d\n", key_sizes[i]);
+            printf("Decryption did not recover the input\n");
+            exit(1);
+        }
+
+        /* Free the result & the current key */
+        free(result_hex);
+        free(key);
+    }
+
+    /* Free the input bytes */
+    free(input_bytes);
+}
+
+/* Ensures the T-table round engine matches the reference round engine.
+ * Both engines are always compiled so they can be compared directly.
+*/
+void test_round_engines_match() {
+
+    /* Declare variables */
+    int i, j, k;
+    aes_context_t ctx;
+    int key_sizes[3] = {16, 24, 32};
+    unsigned char key[32];
+    unsigned char block[16];
+    unsigned char reference[16];
+    unsigned char ttable[16];
+
+    /* Iterate over the different key sizes */
+    for (i = 0; i < 3; i++) {
+
+        /* Derive a key from the key size */
+        for (k = 0; k < 32; k++) {
+            key[k] = (unsigned char)(k * 7 + key_sizes[i]);
+        }
+        aes_context_init(&ctx, key, key_sizes[i]);
+
+        /* Chain blocks so each input depends on the previous output */
+        memset(block, 0, 16);
+        for (j = 0; j < 64; j++) {
+
+            /* Encrypt with both engines */
+            aes_reference_encrypt_block(block, &ctx, reference);
+            aes_ttable_encrypt_block(block, &ctx, ttable);
+            if (memcmp(reference, ttable, 16) != 0) {
+                printf("Test failed\n");
+                printf("Key size: %d, block %d encryption differs\n",
+                    key_sizes[i], j);
+                exit(1);
+            }
+
+            /* Decrypt with both engines */
+            aes_reference_decrypt_block(reference, &ctx, reference);
+            aes_ttable_decrypt_block(ttable, &ctx, ttable);
+            if (memcmp(reference, block, 16) != 0 ||
+                memcmp(ttable, block, 16) != 0) {
+                printf("Test failed\n");
+                printf("Key size: %d, block %d decryption differs\n",
+                    key_sizes[i], j);
+                exit(1);
+            }
+
+            /* Next input is the ciphertext */
+            aes_ttable_encrypt_block(block, &ctx, block);
+        }
+    }
+}
+
+/* Ensures the AES-NI backend matches the portable backend.
+ * Compares the expanded keys as well as the encrypted/decrypted blocks.
+*/
+void test_backends_match() {
+
+    /* Declare variables */
+    int i, j, k;
+    aes_context_t portable_ctx, aesni_ctx;
+    int key_sizes[3] = {16, 24, 32};
+    unsigned char key[32];
+    unsigned char block[16];
+    unsigned char portable[16];
+    unsigned char aesni[16];
+
+    /* Nothing to compare if the CPU does not support AES-NI */
+    if (!aes_aesni_available()) {
+        printf("AES-NI not supported, skipping\n");
+        return;
+    }
+
+    /* Iterate over the different key sizes */
+    for (i = 0; i < 3; i++) {
+
+        /* Derive a key from the key size */
+        for (k = 0; k < 32; k++) {
+            key[k] = (unsigned char)(k * 13 + key_sizes[i]);
+        }
+
+        /* Expand the key with each backend */
+        aes_set_backend(AES_BACKEND_PORTABLE);
+        aes_context_init(&portable_ctx, key, key_sizes[i]);
+        aes_set_backend(AES_BACKEND_AESNI);
+        aes_context_init(&aesni_ctx, key, key_sizes[i]);
+
+        /* Round keys must be identical */
+        if (memcmp(portable_ctx.round_keys, aesni_ctx.round_keys,
+                (portable_ctx.num_rounds + 1) * 16) != 0 ||
+            memcmp(portable_ctx.inv_round_keys, aesni_ctx.inv_round_keys,
+                (portable_ctx.num_rounds + 1) * 16) != 0) {
+            printf("Test failed\n");
+            printf("Key size: %d, round keys differ\n", key_sizes[i]);
+            exit(1);
+        }
+
+        /* Chain blocks so each input depends on the previous output */
+        memset(block, 0, 16);
+        for (j = 0; j < 64; j++) {
+            aes_ttable_encrypt_block(block, &portable_ctx, portable);
+            aes_aesni_encrypt_block(block, &aesni_ctx, aesni);
+            if (memcmp(portable, aesni, 16) != 0) {
+                printf("Test failed\n");
+                printf("Key size: %d, block %d encryption differs\n",
+                    key_sizes[i], j);
+                exit(1);
+            }
+
+            aes_aesni_decrypt_block(aesni, &aesni_ctx, aesni);
+            if (memcmp(aesni, block, 16) != 0) {
+                printf("Test failed\n");
+                printf("Key size: %d, block %d decryption differs\n",
+                    key_sizes[i], j);
+                exit(1);
+            }
+
+            memcpy(block, portable, 16);
+        }
+    }
+}
+
+/* Ensures the batched round engines encrypt every block the same as the
+ * reference engine. Covers counts that are not multiples of the batch size.
+*/
+void test_batched_engines_match() {
+
+    /* Declare variables */
+    int i, k;
+    size_t n, b;
+    aes_context_t ctx;
+    int key_sizes[3] = {16, 24, 32};
+    unsigned char key[32];
+    unsigned char blocks[19 * 16];
+    unsigned char expected[19 * 16];
+    unsigned char actual[19 * 16];
+
+    for (k = 0; k < (int)sizeof(blocks); k++) {
+        blocks[k] = (unsigned char)(k * 13 + 7);
+    }
+
+    for (i = 0; i < 3; i++) {
+
+        for (k = 0; k < 32; k++) {
+            key[k] = (unsigned char)(k * 5 + key_sizes[i]);
+        }
+        aes_context_init(&ctx, key, key_sizes[i]);
+
+        for (n = 0; n <= 19; n++) {
+
+            /* One block at a time with the reference engine */
+            for (b = 0; b < n; b++) {
+                aes_reference_encrypt_block(
+                    blocks + b * 16, &ctx, expected + b * 16);
+            }
+
+            aes_ttable_encrypt_blocks(blocks, &ctx, actual, n);
+            if (memcmp(expected, actual, n * 16) != 0) {
+                printf("Test failed\n");
+                printf("Key size: %d, %d blocks: T-table batch differs\n",
+                    key_sizes[i], (int)n);
+                exit(1);
+            }
+
+            if (aes_aesni_available()) {
+                aes_aesni_encrypt_blocks(blocks, &ctx, actual, n);
+                if (memcmp(expected, actual, n * 16) != 0) {
+                    printf("Test failed\n");
+                    printf("Key size: %d, %d blocks: AES-NI batch differs\n",
+                        key_sizes[i], (int)n);
+                    exit(1);
+                }
+            }
+        }
+    }
+}
+
+/* Ensures the table GHASH multiplies the same as the bit-by-bit
+ * GF(2^128) multiplication.
+*/
+void test_ghash_table_matches_reference() {
+
+    /* Declare variables */
+    int i, j;
+    ghash_key_t key;
+    unsigned char h[16];
+    unsigned char block[16];
+    unsigned char expected[16];
+
+    for (i = 0; i < 32; i++) {
+
+        /* Different subkey & block each time */
+        for (j = 0; j < 16; j++) {
+            h[j] = (unsigned char)(i * 37 + j * 11 + 1);
+            block[j] = (unsigned char)(i * 13 + j * 7 + 9);
+        }
+        ghash_key_init(&key, h);
+
+        gf_multiply_2_128(block, h, expected);
+        ghash_table_multiply(&key, block);
+
+        if (memcmp(block, expected, 16) != 0) {
+            printf("Test failed\n");
+            printf("Case %d: table GHASH differs\n", i);
+            exit(1);
+        }
+    }
+}
+
+/* Ensures every GHASH backend produces the same hash.
+ * Covers lengths that are not multiples of 16 or of 4 blocks.
+*/
+void test_ghash_backends_match() {
+
+    /* Declare variables */
+    int i, length;
+    ghash_key_t key;
+    unsigned char h[16];
+    unsigned char data[200];
+    unsigned char portable[16];
+    unsigned char other[16];
+
+    /* Nothing to compare if the CPU does not support PCLMULQDQ */
+    if (!ghash_clmul_available()) {
+        printf("PCLMULQDQ not supported, skipping\n");
+        return;
+    }
+
+    /* Arbitrary hash subkey & data */
+    for (i = 0; i < 16; i++) {
+        h[i] = (unsigned char)(i * 29 + 3);
+    }
+    for (i = 0; i < 200; i++) {
+        data[i] = (unsigned char)(i * 17 + 5);
+    }
+    ghash_key_init(&key, h);
+
+    /* Compare every length up to 200 bytes */
+    for (length = 0; length <= 200; length++) {
+
+        /* Start from a non-zero state */
+        memset(portable, 0xA5, 16);
+        memset(other, 0xA5, 16);
+
+        ghash_set_backend(GHASH_BACKEND_PORTABLE);
+        ghash_update(&key, portable, data, length);
+        ghash_set_backend(GHASH_BACKEND_CLMUL);
+        ghash_update(&key, other, data, length);
+
+        if (memcmp(portable, other, 16) != 0) {
+            printf("Test failed\n");
+            printf("Length %d: CLMUL GHASH differs\n", length);
+            exit(1);
+        }
+    }
+}
+
 void test_aes_gcm_all() {
 
     /* Implements test cases from NIST GCM specification 
@@ -294,6 +617,448 @@ void test_aes_gcm_all() {
     }
 }
 
+/* Ensures the streaming GCM API gives the same result as the one-shot
+ * functions, no matter how the input is split up.
+*/
+void test_aes_gcm_streaming() {
+
+    /* Test case 4 from the NIST GCM specification */
+    unsigned char *key = convert_hex_string_to_bytes("feffe9928665731c6d6a8f9467308308");
+    unsigned char *nonce = convert_hex_string_to_bytes("cafebabefacedbaddecaf888");
+    unsigned char *aad = convert_hex_string_to_bytes("feedfacedeadbeeffeedfacedeadbeefabaddad2");
+    unsigned char *plaintext = convert_hex_string_to_bytes("d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657ba637b39");
+    unsigned char *expected_ciphertext = convert_hex_string_to_bytes("42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e2329aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac973d58e091");
+    unsigned char *expected_tag = convert_hex_string_to_bytes("5bc94fbc3221a5db94fae95ae7121a47");
+
+    /* Declare variables */
+    aes_gcm_context_t ctx;
+    unsigned char output[60];
+    unsigned char tag[16];
+    int step, offset, chunk;
+
+    /* Split the plaintext into chunks of every size */
+    for (step = 1; step <= 60; step++) {
+
+        /* Encrypt. The AAD is split too. */
+        aes_gcm_init(&ctx, key, 16, nonce, AES_GCM_ENCRYPT);
+        aes_gcm_update_aad(&ctx, aad, 3);
+        aes_gcm_update_aad(&ctx, aad + 3, 17);
+        for (offset = 0; offset < 60; offset += step) {
+            chunk = 60 - offset < step ? 60 - offset : step;
+            aes_gcm_update(&ctx, plaintext + offset, chunk, output + offset);
+        }
+        aes_gcm_final(&ctx, tag);
+
+        if (memcmp(output, expected_ciphertext, 60) != 0 ||
+            memcmp(tag, expected_tag, 16) != 0) {
+            printf("Test failed\n");
+            printf("Chunks of %d bytes: wrong ciphertext or tag\n", step);
+            exit(1);
+        }
+
+        /* Decrypt in place */
+        aes_gcm_init(&ctx, key, 16, nonce, AES_GCM_DECRYPT);
+        aes_gcm_update_aad(&ctx, aad, 20);
+        for (offset = 0; offset < 60; offset += step) {
+            chunk = 60 - offset < step ? 60 - offset : step;
+            aes_gcm_update(&ctx, output + offset, chunk, output + offset);
+        }
+
+        if (aes_gcm_verify(&ctx, expected_tag) != 0 ||
+            memcmp(output, plaintext, 60) != 0) {
+            printf("Test failed\n");
+            printf("Chunks of %d bytes: decryption failed\n", step);
+            exit(1);
+        }
+    }
+
+    /* A modified ciphertext must fail verification */
+    memcpy(output, expected_ciphertext, 60);
+    output[59] ^= 1;
+    aes_gcm_init(&ctx, key, 16, nonce, AES_GCM_DECRYPT);
+    aes_gcm_update_aad(&ctx, aad, 20);
+    aes_gcm_update(&ctx, output, 60, output);
+    if (aes_gcm_verify(&ctx, expected_tag) == 0) {
+        printf("Test failed\n");
+        printf("Modified ciphertext was accepted\n");
+        exit(1);
+    }
+
+    /* AAD cannot be added after the data */
+    if (aes_gcm_update_aad(&ctx, aad, 20) == 0) {
+        printf("Test failed\n");
+        printf("AAD was accepted after the data\n");
+        exit(1);
+    }
+}
+
+/* Ensures large inputs streamed in odd sized chunks match the one-shot
+ * encryption.
+*/
+void test_aes_gcm_streaming_large() {
+
+    /* Declare variables */
+    const int size = 5000;
+    unsigned char key[32];
+    unsigned char nonce[12];
+    unsigned char *plaintext = malloc(size);
+    unsigned char *output = malloc(size);
+    unsigned char tag[16];
+    aes_gcm_context_t ctx;
+    int i, offset, chunk;
+
+    /* Arbitrary key, nonce & plaintext */
+    for (i = 0; i < 32; i++) {
+        key[i] = (unsigned char)(i * 7 + 1);
+    }
+    for (i = 0; i < 12; i++) {
+        nonce[i] = (unsigned char)(i * 5 + 2);
+    }
+    for (i = 0; i < size; i++) {
+        plaintext[i] = (unsigned char)(i * 31 + 3);
+    }
+
+    /* Reference result */
+    aes_gcm_data_t *expected = aes_gcm_encrypt(
+        plaintext, size, key, 32, NULL, 0, nonce);
+
+    /* Chunks of 1 to 700 bytes */
+    aes_gcm_init(&ctx, key, 32, nonce, AES_GCM_ENCRYPT);
+    for (offset = 0, chunk = 1; offset < size; offset += chunk, chunk += 37) {
+        if (chunk > 700) {
+            chunk = 1;
+        }
+        if (chunk > size - offset) {
+            chunk = size - offset;
+        }
+        aes_gcm_update(&ctx, plaintext + offset, chunk, output + offset);
+    }
+    aes_gcm_final(&ctx, tag);
+
+    if (memcmp(output, expected->output, size) != 0 ||
+        memcmp(tag, expected->tag, 16) != 0) {
+        printf("Test failed\n");
+        printf("Streamed result differs from aes_gcm_encrypt()\n");
+        exit(1);
+    }
+
+    free(expected->output);
+    free(expected);
+    free(plaintext);
+    free(output);
+}
+
+/* Ensures splitting AES-GCM between threads gives the same result as a
+ * single thread.
+*/
+void test_aes_gcm_threads() {
+
+    /* Declare variables */
+    const int size = 3 * 1024 * 1024 + 37;
+    unsigned char key[16];
+    unsigned char nonce[12];
+    unsigned char aad[21];
+    unsigned char *plaintext = malloc(size);
+    int thread_counts[4] = {2, 3, 4, 7};
+    int i, t;
+
+    /* Arbitrary key, nonce, AAD & plaintext */
+    for (i = 0; i < 16; i++) {
+        key[i] = (unsigned char)(i * 3 + 1);
+    }
+    for (i = 0; i < 12; i++) {
+        nonce[i] = (unsigned char)(i * 11 + 4);
+    }
+    for (i = 0; i < 21; i++) {
+        aad[i] = (unsigned char)(i * 5);
+    }
+    for (i = 0; i < size; i++) {
+        plaintext[i] = (unsigned char)(i * 29 + i / 4096);
+    }
+
+    /* Reference result from a single thread */
+    aes_gcm_set_threads(1);
+    aes_gcm_data_t *expected = aes_gcm_encrypt(
+        plaintext, size, key, 16, aad, 21, nonce);
+
+    for (t = 0; t < 4; t++) {
+
+        /* Threads are not available on every build */
+        if (aes_gcm_set_threads(thread_counts[t]) != 0) {
+            printf("Threads not supported, skipping\n");
+            break;
+        }
+
+        /* Starts part way into a block to check the counter hand-off */
+        aes_gcm_context_t ctx;
+        unsigned char tag[16];
+        unsigned char *output = malloc(size);
+        aes_gcm_init(&ctx, key, 16, nonce, AES_GCM_ENCRYPT);
+        aes_gcm_update_aad(&ctx, aad, 21);
+        aes_gcm_update(&ctx, plaintext, 5, output);
+        aes_gcm_update(&ctx, plaintext + 5, size - 5, output + 5);
+        aes_gcm_final(&ctx, tag);
+
+        if (memcmp(output, expected->output, size) != 0 ||
+            memcmp(tag, expected->tag, 16) != 0) {
+            printf("Test failed\n");
+            printf("%d threads: result differs from 1 thread\n",
+                thread_counts[t]);
+            exit(1);
+        }
+
+        /* Decrypt in place with the same number of threads */
+        aes_gcm_init(&ctx, key, 16, nonce, AES_GCM_DECRYPT);
+        aes_gcm_update_aad(&ctx, aad, 21);
+        aes_gcm_update(&ctx, output, size, output);
+        if (aes_gcm_verify(&ctx, expected->tag) != 0 ||
+            memcmp(output, plaintext, size) != 0) {
+            printf("Test failed\n");
+            printf("%d threads: decryption failed\n", thread_counts[t]);
+            exit(1);
+        }
+
+        free(output);
+    }
+
+    aes_gcm_set_threads(1);
+    free(expected->output);
+    free(expected);
+    free(plaintext);
+}
+
+/* Files used by the file encryption tests */
+#define TEST_PLAIN_FILE "test_gcm_plain.tmp"
+#define TEST_ENCRYPTED_FILE "test_gcm_encrypted.tmp"
+#define TEST_DECRYPTED_FILE "test_gcm_decrypted.tmp"
+
+/* Writes 'size' bytes of test data to a file. */
+void test_write_pattern_file(const char *filename, long size) {
+    FILE *file = fopen(filename, "wb");
+    long i;
+    for (i = 0; i < size; i++) {
+        fputc((int)((i * 131 + i / 977) & 0xFF), file);
+    }
+    fclose(file);
+}
+
+/* Checks whether two files have the same contents. */
+int test_files_match(const char *first, const char *second) {
+    FILE *a = fopen(first, "rb");
+    FILE *b = fopen(second, "rb");
+    int ca, cb;
+
+    if (a == NULL || b == NULL) {
+        return 0;
+    }
+    do {
+        ca = fgetc(a);
+        cb = fgetc(b);
+    } while (ca == cb && ca != EOF);
+
+    fclose(a);
+    fclose(b);
+    return ca == cb;
+}
+
+/* Ensures files of various sizes survive encryption & decryption. */
+void test_aes_gcm_file_round_trip() {
+
+    unsigned char *key = convert_hex_string_to_bytes("feffe9928665731c6d6a8f9467308308");
+    unsigned char *nonce = convert_hex_string_to_bytes("cafebabefacedbaddecaf888");
+    long sizes[5];
+    int i;
+
+    /* Empty, small, exactly one chunk, one chunk + 1, several chunks */
+    sizes[0] = 0;
+    sizes[1] = 100;
+    sizes[2] = AES_GCM_FILE_CHUNK_SIZE;
+    sizes[3] = AES_GCM_FILE_CHUNK_SIZE + 1;
+    sizes[4] = AES_GCM_FILE_CHUNK_SIZE * 5L / 2;
+
+    for (i = 0; i < 5; i++) {
+        test_write_pattern_file(TEST_PLAIN_FILE, sizes[i]);
+
+        if (aes_gcm_encrypt_file(TEST_PLAIN_FILE, TEST_ENCRYPTED_FILE,
+                key, 16, NULL, 0, nonce) != 0 ||
+            aes_gcm_decrypt_file(TEST_ENCRYPTED_FILE, TEST_DECRYPTED_FILE,
+                key, 16, NULL, 0, nonce) != 0 ||
+            !test_files_match(TEST_PLAIN_FILE, TEST_DECRYPTED_FILE)) {
+            printf("Test failed\n");
+            printf("File of %ld bytes did not round trip\n", sizes[i]);
+            exit(1);
+        }
+    }
+
+    remove(TEST_PLAIN_FILE);
+    remove(TEST_ENCRYPTED_FILE);
+    remove(TEST_DECRYPTED_FILE);
+}
+
+/* Ensures modified or truncated files are rejected & no plaintext is left
+ * behind.
+*/
+void test_aes_gcm_file_tampering() {
+
+    unsigned char *key = convert_hex_string_to_bytes("feffe9928665731c6d6a8f9467308308");
+    unsigned char *nonce = convert_hex_string_to_bytes("cafebabefacedbaddecaf888");
+    long chunk_with_tag = AES_GCM_FILE_CHUNK_SIZE + 16;
+    FILE *file;
+    unsigned char *contents;
+    long size;
+
+    /* Two and a half chunks */
+    test_write_pattern_file(TEST_PLAIN_FILE, AES_GCM_FILE_CHUNK_SIZE * 5L / 2);
+    aes_gcm_encrypt_file(TEST_PLAIN_FILE, TEST_ENCRYPTED_FILE,
+        key, 16, NULL, 0, nonce);
+
+    /* Read the encrypted file */
+    file = fopen(TEST_ENCRYPTED_FILE, "rb");
+    fseek(file, 0, SEEK_END);
+    size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    contents = malloc(size);
+    fread(contents, 1, size, file);
+    fclose(file);
+
+    /* Flip a bit in the second chunk */
+    contents[12 + chunk_with_tag + 5] ^= 1;
+    file = fopen(TEST_ENCRYPTED_FILE, "wb");
+    fwrite(contents, 1, size, file);
+    fclose(file);
+    if (aes_gcm_decrypt_file(TEST_ENCRYPTED_FILE, TEST_DECRYPTED_FILE,
+            key, 16, NULL, 0, nonce) == 0 ||
+        fopen(TEST_DECRYPTED_FILE, "rb") != NULL) {
+        printf("Test failed\n");
+        printf("Modified chunk was accepted\n");
+        exit(1);
+    }
+    contents[12 + chunk_with_tag + 5] ^= 1;
+
+    /* Drop the last chunk */
+    file = fopen(TEST_ENCRYPTED_FILE, "wb");
+    fwrite(contents, 1, 12 + 2 * chunk_with_tag, file);
+    fclose(file);
+    if (aes_gcm_decrypt_file(TEST_ENCRYPTED_FILE, TEST_DECRYPTED_FILE,
+            key, 16, NULL, 0, nonce) == 0) {
+        printf("Test failed\n");
+        printf("Truncated file was accepted\n");
+        exit(1);
+    }
+
+    free(contents);
+    remove(TEST_PLAIN_FILE);
+    remove(TEST_ENCRYPTED_FILE);
+}
+
+/* Ensures files in the old whole-file format can still be decrypted. */
+void test_aes_gcm_file_old_format() {
+
+    unsigned char *key = convert_hex_string_to_bytes("feffe9928665731c6d6a8f9467308308");
+    unsigned char *nonce = convert_hex_string_to_bytes("cafebabefacedbaddecaf888");
+    unsigned char plaintext[3000];
+    FILE *file;
+    int i;
+
+    for (i = 0; i < 3000; i++) {
+        plaintext[i] = (unsigned char)(i * 7);
+    }
+
+    /* Old format: tag | ciphertext */
+    aes_gcm_data_t *encrypted = aes_gcm_encrypt(
+        plaintext, 3000, key, 16, NULL, 0, nonce);
+    file = fopen(TEST_ENCRYPTED_FILE, "wb");
+    fwrite(encrypted->tag, 1, 16, file);
+    fwrite(encrypted->output, 1, 3000, file);
+    fclose(file);
+
+    file = fopen(TEST_PLAIN_FILE, "wb");
+    fwrite(plaintext, 1, 3000, file);
+    fclose(file);
+
+    if (aes_gcm_decrypt_file(TEST_ENCRYPTED_FILE, TEST_DECRYPTED_FILE,
+            key, 16, NULL, 0, nonce) != 0 ||
+        !test_files_match(TEST_PLAIN_FILE, TEST_DECRYPTED_FILE)) {
+        printf("Test failed\n");
+        printf("Old format file was not decrypted\n");
+        exit(1);
+    }
+
+    free(encrypted->output);
+    free(encrypted);
+    remove(TEST_PLAIN_FILE);
+    remove(TEST_ENCRYPTED_FILE);
+    remove(TEST_DECRYPTED_FILE);
+}
+
+/* Ensures data in memory is encrypted to the same file as aes_gcm_encrypt_file()
+ * writes & can be decrypted back into memory.
+*/
+void test_aes_gcm_buffer_file() {
+
+    unsigned char *key = convert_hex_string_to_bytes("feffe9928665731c6d6a8f9467308308");
+    unsigned char *nonce = convert_hex_string_to_bytes("cafebabefacedbaddecaf888");
+    long sizes[4];
+    unsigned char *plaintext;
+    unsigned char *decrypted;
+    size_t length;
+    FILE *file;
+    long i, j;
+
+    /* Empty, small, exactly one chunk, several chunks */
+    sizes[0] = 0;
+    sizes[1] = 100;
+    sizes[2] = AES_GCM_FILE_CHUNK_SIZE;
+    sizes[3] = AES_GCM_FILE_CHUNK_SIZE * 5L / 2;
+
+    plaintext = (unsigned char *)malloc(sizes[3]);
+    for (j = 0; j < sizes[3]; j++) {
+        plaintext[j] = (unsigned char)((j * 131 + j / 977) & 0xFF);
+    }
+
+    for (i = 0; i < 4; i++) {
+        test_write_pattern_file(TEST_PLAIN_FILE, sizes[i]);
+        aes_gcm_encrypt_file(TEST_PLAIN_FILE, TEST_DECRYPTED_FILE,
+            key, 16, NULL, 0, nonce);
+
+        if (aes_gcm_encrypt_buffer_to_file(plaintext, sizes[i],
+                TEST_ENCRYPTED_FILE, key, 16, NULL, 0, nonce) != 0 ||
+            !test_files_match(TEST_ENCRYPTED_FILE, TEST_DECRYPTED_FILE)) {
+            printf("Test failed\n");
+            printf("Buffer of %ld bytes was not encrypted like a file\n",
+                sizes[i]);
+            exit(1);
+        }
+
+        decrypted = aes_gcm_decrypt_file_to_buffer(TEST_ENCRYPTED_FILE,
+            key, 16, NULL, 0, nonce, &length);
+        if (decrypted == NULL || length != (size_t)sizes[i] ||
+            memcmp(decrypted, plaintext, length) != 0) {
+            printf("Test failed\n");
+            printf("Buffer of %ld bytes did not round trip\n", sizes[i]);
+            exit(1);
+        }
+        free(decrypted);
+    }
+
+    /* Flip a bit in the last chunk */
+    file = fopen(TEST_ENCRYPTED_FILE, "r+b");
+    fseek(file, -20, SEEK_END);
+    fputc(0x55, file);
+    fclose(file);
+    if (aes_gcm_decrypt_file_to_buffer(TEST_ENCRYPTED_FILE,
+            key, 16, NULL, 0, nonce, &length) != NULL) {
+        printf("Test failed\n");
+        printf("Tampered file was decrypted into memory\n");
+        exit(1);
+    }
+
+    free(plaintext);
+    remove(TEST_PLAIN_FILE);
+    remove(TEST_ENCRYPTED_FILE);
+    remove(TEST_DECRYPTED_FILE);
+}
+
 int main() {
 
     #ifdef DEBUG
@@ -307,7 +1072,38 @@ int main() {
     test_run_method("convert bytes to hex string", test_bytes_to_hex_str);
     test_run_method("convert hex string to bytes", test_hex_str_to_bytes);
     test_run_method("FIPS examples", test_fips_example);
+    test_run_method("FIPS examples (expanded key)", test_fips_example_ctx);
+    test_run_method("T-table matches reference", test_round_engines_match);
+    test_run_method("AES-NI matches portable", test_backends_match);
+    test_run_method("Batched engines match", test_batched_engines_match);
+    test_run_method("GHASH table matches reference",
+        test_ghash_table_matches_reference);
+    test_run_method("GHASH backends match", test_ghash_backends_match);
     test_run_method("AES-GCM all", test_aes_gcm_all);
+    test_run_method("AES-GCM streaming", test_aes_gcm_streaming);
+    test_run_method("AES-GCM streaming large", test_aes_gcm_streaming_large);
+    test_run_method("AES-GCM threads", test_aes_gcm_threads);
+    test_run_method("AES-GCM file round trip", test_aes_gcm_file_round_trip);
+    test_run_method("AES-GCM file tampering", test_aes_gcm_file_tampering);
+    test_run_method("AES-GCM old file format", test_aes_gcm_file_old_format);
+    test_run_method("AES-GCM buffer to file", test_aes_gcm_buffer_file);
+
+    /* Repeat the GCM tests with the portable GHASH */
+    ghash_set_backend(GHASH_BACKEND_PORTABLE);
+    test_run_method("AES-GCM all (portable GHASH)", test_aes_gcm_all);
+    test_run_method("AES-GCM streaming large (portable GHASH)",
+        test_aes_gcm_streaming_large);
+
+    /* Repeat the known answer tests with the portable backend */
+    aes_set_backend(AES_BACKEND_PORTABLE);
+    test_run_method("FIPS examples (portable)", test_fips_example_ctx);
+    test_run_method("AES-GCM all (portable)", test_aes_gcm_all);
+
+    /* Repeat the known answer tests with the AES-NI backend */
+    if (aes_set_backend(AES_BACKEND_AESNI) == 0) {
+        test_run_method("FIPS examples (AES-NI)", test_fips_example_ctx);
+        test_run_method("AES-GCM all (AES-NI)", test_aes_gcm_all);
+    }
 
     exit(0);
 
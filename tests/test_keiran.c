@@ -15,14 +15,14 @@ int main(int argc, char *argv[]) {
             printf("  program_name.exe -D <doctor_user> <doctor_pass> -p <patient_user>\n");
         }
 
-        // command 1 - View patient
+        /* command 1 - View patient */
         if (strcmp(mode, "-V") == 0) {             
             printf("%s %s %s\n", doctor_username, doctor_password, patient_username);
-        }  else if (strcmp(mode, "-D") == 0 ) { // command 2 - Delete patient
+        }  else if (strcmp(mode, "-D") == 0 ) { /* command 2 - Delete patient */
             printf("%s %s %s\n", doctor_username, doctor_password, patient_username);
         } else {
             printf("Invalid arguments. Use -V/-D and -p correctly.\n");
-        }scanf  
+        }
         
     } else {
         printf("Usage:\n");
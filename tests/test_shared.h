@@ -23,47 +23,44 @@
 void test_seed_data(hospital_record_t *records) {
 
     /* Doctor Homer Simpson */
-    doctor_details_t *doctor = (doctor_details_t *)calloc(
-        1, sizeof(doctor_details_t)
-    );
-    strcpy(doctor->username, "1");
-    strcpy(doctor->name, "Homer Simpson");
-    strcpy(doctor->email, "homer.simpson@example.com");
-    strcpy(doctor->phone, "1234567890");
-    doctor->password = hash_string("1");
-    strcpy(doctor->specialization, "Cardiology");
-    strcpy(doctor->license_number, "1234567890");
-    doctor_signup_silent(records, doctor);
+    doctor_details_t doctor;
+    memset(&doctor, 0, sizeof(doctor));
+    doctor.username = "1";
+    doctor.name = "Homer Simpson";
+    doctor.email = "homer.simpson@example.com";
+    doctor.phone = "1234567890";
+    doctor.password = hash_string("1");
+    doctor.specialization = "Cardiology";
+    doctor.license_number = "1234567890";
+    doctor_add(records, &doctor);
 
     /* Patient Bart Simpson */
-    patient_details_t *patient = (patient_details_t *)calloc(
-        1, sizeof(patient_details_t)
-    );
-    strcpy(patient->username, "2");
-    strcpy(patient->name, "Bart Simpson");
-    strcpy(patient->email, "bart.simpson@example.com");
-    strcpy(patient->phone, "1234567890");
-    patient->password = hash_string("2");
-    strcpy(patient->blood_type, "A+");
-    strcpy(patient->medical_history, "None");
-    patient->weight = 100;
-    patient->height = 180;
-    patient_signup_silent(records, patient);
+    patient_details_t patient;
+    memset(&patient, 0, sizeof(patient));
+    patient.username = "2";
+    patient.name = "Bart Simpson";
+    patient.email = "bart.simpson@example.com";
+    patient.phone = "1234567890";
+    patient.password = hash_string("2");
+    strcpy(patient.blood_type, "A+");
+    patient.medical_history = "None";
+    patient.weight = 100;
+    patient.height = 180;
+    patient_add(records, &patient);
 
     /* Patient Lisa Simpson */
-    patient_details_t *patient2 = (patient_details_t *)calloc(
-        1, sizeof(patient_details_t)
-    );
-    strcpy(patient2->username, "3");
-    strcpy(patient2->name, "Lisa Simpson");
-    strcpy(patient2->email, "lisa.simpson@example.com");
-    strcpy(patient2->phone, "1234567890");
-    patient2->password = hash_string("3");
-    strcpy(patient2->blood_type, "B-");
-    strcpy(patient2->medical_history, "None");
-    patient2->weight = 100;
-    patient2->height = 180;
-    patient_signup_silent(records, patient2);
+    patient_details_t patient2;
+    memset(&patient2, 0, sizeof(patient2));
+    patient2.username = "3";
+    patient2.name = "Lisa Simpson";
+    patient2.email = "lisa.simpson@example.com";
+    patient2.phone = "1234567890";
+    patient2.password = hash_string("3");
+    strcpy(patient2.blood_type, "B-");
+    patient2.medical_history = "None";
+    patient2.weight = 100;
+    patient2.height = 180;
+    patient_add(records, &patient2);
 }
 
 /*******************************************************************************
@@ -100,15 +97,18 @@ hospital_record_t *init_dummy_hospital() {
  ******************************************************************************/
 void close_dummy_hospital(hospital_record_t *records) {
     
-    /* Store the name of the database */
+    /* Store the name of the database & its log */
     char database_name[256];
+    char log_name[sizeof(records->log.name)];
     strcpy(database_name, records->encrypted_database_name);
+    strcpy(log_name, records->log.name);
 
     /* Close the database */
     close_database(records);
 
-    /* Delete the database */
+    /* Delete the database & its log */
     remove(database_name);
+    remove(log_name);
 }
 
 